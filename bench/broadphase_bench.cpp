@@ -0,0 +1,188 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  broadphase_bench.cpp
+ *
+ *    Description:  Benchmark of the broadphase structures over object counts and velocity distributions
+ *
+ *        Version:  1.0
+ *        Created:  10/19/2026 06:47:03 PM
+ *       Revision:  none
+ *
+ *         Author:  Samuel Knoethig (), samuel@knoethig.net
+ *
+ * =====================================================================================
+ */
+
+#include "Broadphase.hpp"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <set>
+#include <string>
+#include <utility>
+
+using namespace SpaceAppPhysics;
+
+namespace {
+	struct Object {
+		glm::vec3 position;
+		glm::vec3 velocity;
+		float radius;
+		ProxyId proxy;
+	};
+
+	enum class Scenario {
+		UniformSlow,
+		UniformFast,
+		Dogfight,
+		MixedSizes,
+	};
+
+	const char* scenario_name( Scenario s ){
+		switch( s ){
+			case Scenario::UniformSlow:
+				return "uniform slow";
+			case Scenario::UniformFast:
+				return "uniform fast";
+			case Scenario::Dogfight:
+				return "dogfight";
+			case Scenario::MixedSizes:
+				return "mixed sizes";
+		}
+		return "";
+	}
+
+	constexpr int steps{ 60 };
+	// Average distance between objects, keeps the density the same for all counts
+	constexpr float spacing{ 4 };
+	constexpr float small_radius{ 0.5f };
+	constexpr float large_radius{ 40 };
+
+	AABB bounds( const Object& o ){
+		return { o.position - o.radius, o.position + o.radius };
+	}
+
+	std::vector<Object> spawn( Scenario scenario, size_t count, std::mt19937& rng ){
+		float half = std::cbrt( static_cast<float>( count )) * spacing * 0.5f;
+		std::uniform_real_distribution<float> uniform( -half, half );
+		std::normal_distribution<float> cluster( 0, half * 0.25f );
+		std::uniform_real_distribution<float> unit( -1, 1 );
+
+		float speed = scenario == Scenario::UniformFast ? 2.0f : scenario == Scenario::Dogfight ? 1.0f : 0.1f;
+
+		std::vector<Object> objects( count );
+		for( auto& o: objects ){
+			if( scenario == Scenario::Dogfight )
+				o.position = { cluster( rng ), cluster( rng ), cluster( rng )};
+			else
+				o.position = { uniform( rng ), uniform( rng ), uniform( rng )};
+
+			o.velocity = glm::vec3( unit( rng ), unit( rng ), unit( rng )) * speed;
+			o.radius = ( scenario == Scenario::MixedSizes && rng() % 100 == 0 ) ? large_radius : small_radius;
+		}
+		return objects;
+	}
+
+	void step( std::vector<Object>& objects, float half ){
+		for( auto& o: objects ){
+			o.position = o.position + o.velocity;
+			for( int i = 0; i < 3; ++i )
+				if( std::abs( o.position[i] ) > half )
+					o.velocity[i] = -o.velocity[i];
+		}
+	}
+
+	std::set<std::pair<uint32_t, uint32_t>> collect( Broadphase& broadphase ){
+		std::set<std::pair<uint32_t, uint32_t>> pairs;
+		broadphase.find_pairs( [&]( const PairBatch& batch ){
+			for( size_t i = 0; i < batch.count; ++i )
+				pairs.insert( std::minmax( batch.first[i], batch.second[i] ));
+		});
+		return pairs;
+	}
+
+	/**
+	 *	Checks the reported pairs against a brute force search. The tree works on fattened boxes,
+	 *	so it may report more pairs, but never fewer
+	 */
+	bool verify( Broadphase& broadphase, const std::vector<Object>& objects, bool exact ){
+		auto pairs = collect( broadphase );
+
+		size_t expected = 0;
+		for( uint32_t a = 0; a < objects.size(); ++a )
+			for( uint32_t b = a + 1; b < objects.size(); ++b )
+				if( bounds( objects[a] ).overlaps( bounds( objects[b] ))){
+					++expected;
+					if( !pairs.contains({ a, b }))
+						return false;
+				}
+
+		return !exact || pairs.size() == expected;
+	}
+
+	struct Result {
+		double ms_per_step;
+		double pairs_per_step;
+		bool valid;
+	};
+
+	Result run( Scenario scenario, size_t count, bool use_tree ){
+		std::mt19937 rng( 42 );
+		auto objects = spawn( scenario, count, rng );
+		float half = std::cbrt( static_cast<float>( count )) * spacing * 0.5f;
+
+		std::unique_ptr<Broadphase> broadphase;
+		if( use_tree )
+			broadphase = std::make_unique<DynamicTree>( 0.1f, 2.0f );
+		else
+			broadphase = std::make_unique<SpatialHashGrid>( small_radius * 4 );
+
+		for( uint32_t i = 0; i < objects.size(); ++i )
+			objects[i].proxy = broadphase->create_proxy( bounds( objects[i] ), i );
+
+		size_t pairs = 0;
+		auto start = std::chrono::steady_clock::now();
+		for( int s = 0; s < steps; ++s ){
+			step( objects, half );
+			for( auto& o: objects )
+				broadphase->move_proxy( o.proxy, bounds( o ), o.velocity );
+
+			broadphase->find_pairs( [&]( const PairBatch& batch ){ pairs += batch.count; });
+		}
+		std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+
+		// Brute force is quadratic, only check the small runs
+		bool valid = count > 4000 || verify( *broadphase, objects, !use_tree );
+
+		return { elapsed.count() / steps, static_cast<double>( pairs ) / steps, valid };
+	}
+}
+
+int main( int argc, char** argv ){
+	std::vector<size_t> counts{ 1000, 4000, 16000, 64000 };
+	if( argc > 1 && strcmp( argv[1], "--quick" ) == 0 )
+		counts = { 1000, 4000 };
+
+	printf( "%-14s %8s %14s %14s %14s %14s\n", "scenario", "objects", "grid ms/step", "grid pairs", "tree ms/step", "tree pairs" );
+
+	bool all_valid = true;
+	for( auto scenario: { Scenario::UniformSlow, Scenario::UniformFast, Scenario::Dogfight, Scenario::MixedSizes }){
+		for( auto count: counts ){
+			auto grid = run( scenario, count, false );
+			auto tree = run( scenario, count, true );
+
+			printf( "%-14s %8zu %14.3f %14.0f %14.3f %14.0f%s\n", scenario_name( scenario ), count,
+					grid.ms_per_step, grid.pairs_per_step, tree.ms_per_step, tree.pairs_per_step,
+					grid.valid && tree.valid ? "" : "  MISMATCH" );
+
+			all_valid = all_valid && grid.valid && tree.valid;
+		}
+	}
+
+	return all_valid ? 0 : 1;
+}
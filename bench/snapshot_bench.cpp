@@ -0,0 +1,215 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  snapshot_bench.cpp
+ *
+ *    Description:  Benchmark of the snapshot format over entity counts and motion patterns
+ *
+ *        Version:  1.0
+ *        Created:  10/19/2026 01:24:37 PM
+ *       Revision:  none
+ *
+ *         Author:  Samuel Knoethig (), samuel@knoethig.net
+ *
+ * =====================================================================================
+ */
+
+#include "Snapshot.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <random>
+#include <vector>
+
+using namespace SpaceAppSim;
+
+namespace {
+	enum class Scenario {
+		Idle,
+		Cruising,
+		Combat,
+	};
+
+	const char* scenario_name( Scenario s ){
+		switch( s ){
+			case Scenario::Idle:
+				return "idle";
+			case Scenario::Cruising:
+				return "cruising";
+			case Scenario::Combat:
+				return "combat";
+		}
+		return "";
+	}
+
+	constexpr int frames{ 600 };
+	constexpr int seeks{ 200 };
+	constexpr float half_extent{ 2000 };
+
+	SimulationState spawn( size_t count, std::mt19937& rng ){
+		std::uniform_real_distribution<float> position( -half_extent, half_extent );
+		std::uniform_real_distribution<float> unit( -1, 1 );
+
+		SimulationState state;
+		state.entities.resize( count );
+		for( uint32_t i = 0; i < count; ++i ){
+			auto& e = state.entities[i];
+			e.id = i;
+			e.position = { position( rng ), position( rng ), position( rng )};
+			e.orientation = glm::normalize( glm::vec4( unit( rng ), unit( rng ), unit( rng ), unit( rng )));
+			e.velocity = glm::vec3( unit( rng ), unit( rng ), unit( rng )) * 5.0f;
+			e.flags = i % 4;
+		}
+		return state;
+	}
+
+	void step( Scenario scenario, SimulationState& state, std::mt19937& rng ){
+		std::uniform_real_distribution<float> unit( -1, 1 );
+		++state.tick;
+
+		for( size_t i = 0; i < state.entities.size(); ++i ){
+			auto& e = state.entities[i];
+			// Only every tenth entity moves while idle
+			if( scenario == Scenario::Idle && i % 10 != 0 )
+				continue;
+
+			e.position = e.position + e.velocity * ( 1 / 60.0f );
+			if( scenario == Scenario::Combat ){
+				if( rng() % 20 == 0 )
+					e.velocity = glm::vec3( unit( rng ), unit( rng ), unit( rng )) * 50.0f;
+				e.orientation = glm::normalize( e.orientation + glm::vec4( unit( rng ), unit( rng ), unit( rng ), unit( rng )) * 0.02f );
+			}
+		}
+	}
+
+	float error( float recorded, float read, float scale ){
+		// Half a quantisation step is the most rounding may lose, plus what float can not represent
+		float allowed = 0.5f / scale + std::abs( recorded ) * 1e-6f;
+		return std::abs( recorded - read ) / allowed;
+	}
+
+	/**
+	 *	Largest error of the state read back, relative to what quantisation allows. Above 1 is a bug
+	 */
+	float compare( const SimulationState& recorded, const SimulationState& read ){
+		if( recorded.tick != read.tick || recorded.entities.size() != read.entities.size() )
+			return INFINITY;
+
+		float worst = 0;
+		for( size_t n = 0; n < recorded.entities.size(); ++n ){
+			auto& a = recorded.entities[n];
+			auto& b = read.entities[n];
+			if( a.id != b.id || a.flags != b.flags )
+				return INFINITY;
+
+			for( int i = 0; i < 3; ++i ){
+				worst = std::max( worst, error( a.position[i], b.position[i], Quantisation::position ));
+				worst = std::max( worst, error( a.velocity[i], b.velocity[i], Quantisation::velocity ));
+			}
+			for( int i = 0; i < 4; ++i )
+				worst = std::max( worst, error( a.orientation[i], b.orientation[i], Quantisation::orientation ));
+		}
+		return worst;
+	}
+
+	struct Result {
+		double bytes_per_frame;
+		double write_us;
+		double read_us;
+		double seek_us;
+		float worst_error;
+	};
+
+	Result run( Scenario scenario, size_t count, const std::filesystem::path& path ){
+		std::mt19937 rng( 42 );
+		std::vector<SimulationState> states{ spawn( count, rng )};
+		for( int f = 1; f < frames; ++f ){
+			states.push_back( states.back() );
+			step( scenario, states.back(), rng );
+		}
+
+		Result result{};
+		{
+			SnapshotWriter writer( path );
+			auto start = std::chrono::steady_clock::now();
+			for( auto& state: states )
+				writer.write( state );
+			writer.close();
+			std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+			result.write_us = elapsed.count() / frames;
+			result.bytes_per_frame = static_cast<double>( writer.bytes_written() ) / frames;
+		}
+
+		SnapshotReader reader( path );
+		std::vector<SimulationState> read( frames );
+		auto start = std::chrono::steady_clock::now();
+		for( int f = 0; f < frames; ++f )
+			read[f] = reader.read( f );
+		std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+		result.read_us = elapsed.count() / frames;
+
+		for( int f = 0; f < frames; ++f )
+			result.worst_error = std::max( result.worst_error, compare( states[f], read[f] ));
+
+		std::vector<size_t> targets( seeks );
+		for( auto& t: targets )
+			t = rng() % frames;
+
+		start = std::chrono::steady_clock::now();
+		for( auto t: targets )
+			read[t] = reader.read( t );
+		elapsed = std::chrono::steady_clock::now() - start;
+		result.seek_us = elapsed.count() / seeks;
+
+		for( auto t: targets )
+			result.worst_error = std::max( result.worst_error, compare( states[t], read[t] ));
+
+		return result;
+	}
+
+	/**
+	 *	Values beyond the 32 bit range have to saturate, not wrap around to the other side
+	 */
+	bool check_saturation( const std::filesystem::path& path ){
+		SimulationState state;
+		state.entities.push_back({ 0, { 1e7f, -1e7f, 0 }, { 0, 0, 0, 1 }, { 1e8f, 0, -1e8f }, 0 });
+		save_snapshot( path, state );
+
+		auto loaded = load_snapshot( path );
+		auto& e = loaded.entities.at( 0 );
+		return e.position.x > 2e6f && e.position.y < -2e6f && e.velocity.x > 8e6f && e.velocity.z < -8e6f;
+	}
+}
+
+int main( int argc, char** argv ){
+	std::vector<size_t> counts{ 100, 1000, 10000 };
+	if( argc > 1 && strcmp( argv[1], "--quick" ) == 0 )
+		counts = { 100, 1000 };
+
+	auto path = std::filesystem::temp_directory_path() / "snapshot_bench.snap";
+
+	printf( "%-10s %8s %14s %12s %12s %12s %12s\n", "scenario", "entities", "bytes/frame", "write us", "read us", "seek us", "error" );
+
+	bool all_valid = true;
+	for( auto scenario: { Scenario::Idle, Scenario::Cruising, Scenario::Combat }){
+		for( auto count: counts ){
+			auto r = run( scenario, count, path );
+			bool valid = r.worst_error <= 1;
+
+			printf( "%-10s %8zu %14.0f %12.1f %12.1f %12.1f %12.2f%s\n", scenario_name( scenario ), count,
+					r.bytes_per_frame, r.write_us, r.read_us, r.seek_us, r.worst_error, valid ? "" : "  MISMATCH" );
+
+			all_valid = all_valid && valid;
+		}
+	}
+
+	bool saturates = check_saturation( path );
+	printf( "\nout of range values %s\n", saturates ? "saturate" : "WRAP AROUND" );
+
+	std::filesystem::remove( path );
+	return all_valid && saturates ? 0 : 1;
+}
@@ -0,0 +1,55 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  AllocationCounter.hpp
+ *
+ *    Description:  Debug build counter of global operator new calls
+ *
+ *        Version:  1.0
+ *        Created:  10/19/2026 09:41:27 PM
+ *       Revision:  none
+ *
+ *         Author:  Samuel Knoethig (), samuel@knoethig.net
+ *
+ * =====================================================================================
+ */
+#pragma once
+
+#include <cstdint>
+
+namespace Debug {
+	/**
+	 *	Number of global operator new calls on the calling thread so far.
+	 *	Only debug builds replace operator new, release builds always return 0
+	 */
+	uint64_t allocations();
+
+	/**
+	 *	Allocations on this thread are not counted while one is alive,
+	 *	for rare events in the frame loop like swapchain recreation or streaming
+	 */
+	class AllowAllocations {
+		public:
+			AllowAllocations();
+			~AllowAllocations();
+
+			AllowAllocations( const AllowAllocations& ) = delete;
+			AllowAllocations& operator=( const AllowAllocations& ) = delete;
+	};
+
+	/**
+	 *	Asserts in its destructor that no counted allocation happened on this thread during its lifetime
+	 */
+	class NoAllocations {
+		public:
+			explicit NoAllocations( bool enabled = true );
+			~NoAllocations();
+
+			NoAllocations( const NoAllocations& ) = delete;
+			NoAllocations& operator=( const NoAllocations& ) = delete;
+
+		private:
+			bool enabled;
+			uint64_t start;
+	};
+}
@@ -17,11 +17,17 @@
 
 #include <vulkan/vulkan.hpp>
 #include <optional>
+#include <filesystem>
+#include <map>
 
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
 #include <glm/glm.hpp>
 
 namespace SpaceAppVideo {
 	constexpr int MAX_FRAMES_IN_FLIGHT{ 2 };
+	// Cleared to 0, nearer fragments have a greater depth
+	constexpr vk::Format DEPTH_FORMAT{ vk::Format::eD32Sfloat };
 
 	/**
 	 *	Struct to save queue family indices
@@ -31,17 +37,84 @@ namespace SpaceAppVideo {
 
 		std::optional<uint32_t> graphics;
 		std::optional<uint32_t> present;
+		// A compute only family if the device has one, the graphics family otherwise
+		std::optional<uint32_t> compute;
+		// A family with neither graphics nor compute support if there is one, the compute family otherwise
+		std::optional<uint32_t> transfer;
+	};
+
+	/**
+	 *	A buffer together with its memory, mapped is only set for host visible buffers
+	 */
+	struct Buffer {
+		vk::UniqueBuffer buffer;
+		vk::UniqueDeviceMemory memory;
+		void* mapped{ nullptr };
+		vk::DeviceSize size{ 0 };
+	};
+
+	uint32_t find_mem_type( vk::PhysicalDevice phys_dev, uint32_t type_filter, vk::MemoryPropertyFlags flags );
+
+	/**
+	 *	Creates a buffer with its own allocation. Host visible buffers stay mapped for their whole lifetime.
+	 *	If more than one distinct queue family is given, the buffer is shared concurrently between them
+	 */
+	Buffer create_buffer( vk::PhysicalDevice phys_dev, vk::Device device, vk::DeviceSize size, vk::BufferUsageFlags usage,
+			vk::MemoryPropertyFlags flags, std::vector<uint32_t> queue_families = {} );
+
+	struct Camera {
+		glm::vec3 position{ 0, 0, -5 };
+		glm::vec3 forward{ 0, 0, 1 };
+		glm::vec3 up{ 0, 1, 0 };
+		float fov{ glm::radians( 70.0f )};
+		float z_near{ 0.1f };
+
+		glm::mat4 view() const;
+		/**
+		 *	Vulkan style projection, y points down. Depth is reversed and the far plane at infinity,
+		 *	z_near maps to 1 and depth approaches 0 with distance, which keeps float depth precise from
+		 *	the cockpit out to planets
+		 */
+		glm::mat4 projection( float aspect ) const;
+		glm::vec3 right() const;
 	};
 
 	struct SwapchainDetails {
 		SwapchainDetails() = default;
-		SwapchainDetails( vk::PhysicalDevice phys_dev, vk::UniqueSurfaceKHR& surface );
+		SwapchainDetails( vk::PhysicalDevice phys_dev, vk::SurfaceKHR surface );
 
 		vk::SurfaceCapabilitiesKHR capabilities;
 		std::vector<vk::SurfaceFormatKHR> formats;
 		std::vector<vk::PresentModeKHR> present_modes;
 	};
 
+	/**
+	 *	Remembers the result of the surface independent device checks, keyed by device uuid.
+	 *	An entry is only valid for the driver version and requested extensions it was created with
+	 */
+	struct DeviceCache {
+		public:
+			using UUID = std::array<uint8_t, VK_UUID_SIZE>;
+
+			struct Entry {
+				uint32_t driver_version;
+				// 0 if the device misses required extensions
+				uint64_t score;
+			};
+
+			DeviceCache( std::filesystem::path path, uint64_t ext_hash );
+
+			std::optional<Entry> find( const UUID& uuid, uint32_t driver_version ) const;
+			void store( const UUID& uuid, Entry entry );
+			void write();
+
+		private:
+			std::filesystem::path path;
+			uint64_t ext_hash;
+			std::map<UUID, Entry> entries;
+			bool dirty{ false };
+	};
+
 	struct Vertex {
 		glm::vec3 pos;
 		glm::vec3 col;
@@ -21,12 +21,33 @@
 #include <GLFW/glfw3.h>
 #include <vulkan/vulkan.hpp>
 
+#include <atomic>
 #include <filesystem>
+#include <memory>
+#include <mutex>
 
 #include "AppGraphics.hpp"
+#include "FramePacer.hpp"
+#include "ShaderManager.hpp"
+#include "PipelineVariants.hpp"
+#include "ParticleSystem.hpp"
+#include "Starfield.hpp"
+#include "Snapshot.hpp"
+#include "View.hpp"
+#include "QueueManager.hpp"
+#include "ClusteredLighting.hpp"
+#include "TextureStreamer.hpp"
+#include "Terrain.hpp"
+#include "OcclusionCulling.hpp"
+#include "ConfigStore.hpp"
+#include "FrameArena.hpp"
+#include "Task.hpp"
+#include "Metrics.hpp"
+#include "DynamicResolution.hpp"
 
 /**
- *	Class representing the whole application
+ *	Class representing the whole application. It is the renderer owning the device and everything shared,
+ *	the windows and offscreen targets are views, which are all recorded into one submission per frame
  */
 struct SpaceApplication {
 	public:
@@ -35,6 +56,23 @@ struct SpaceApplication {
 		 */
 		void operator()();
 
+		/**
+		 *	Builds every pipeline variant declared by materials and writes them to the pipeline cache. Only creates
+		 *	what the pipelines depend on and needs no display
+		 */
+		void precompile_pipelines();
+
+		/**
+		 *	Renders frames without a window through VK_EXT_headless_surface and returns after the given number of frames.
+		 *	Time advances by a fixed step each frame, so captured frames are reproducible
+		 */
+		void run_headless( uint64_t frames );
+
+		/**
+		 *	Applies runtime safe options changed in store's file while running
+		 */
+		void watch_config( Config::ConfigStore& store );
+
 	private:
 		void init_window();
 		void init_vk();
@@ -42,65 +80,145 @@ struct SpaceApplication {
 		void cleanup();
 
 		void draw_frame();
+		void poll_input();
 
 		void create_instance();
-		void create_surface();
+		void create_views();
 		void choose_physical_dev( const std::vector<vk::ExtensionProperties>& required_exts );
 		SpaceAppVideo::QueueFamilyIndices find_queue_families( vk::PhysicalDevice phys_dev );
 		void create_device();
-		void create_swapchain();
-		void create_image_views();
 		void create_render_pass();
+		void create_view_targets();
+		void recreate_view( SpaceAppVideo::View& view );
 		void recreate_swapchain();
-		vk::UniqueShaderModule create_shader_module( const std::filesystem::path& path );
+		void create_pipeline_variants();
 		void create_pipeline();
-		void create_framebuffers();
-		void create_command_pool();
-		void create_vertex_buffers();
-		uint32_t find_mem_type( uint32_t type_filter, vk::MemoryPropertyFlags flags );
-		void alloc_command_buffers();
+		vk::Pipeline get_pipeline( SpaceAppVideo::PipelineKey key );
+		void rebuild_pipelines();
+		void swap_pending_pipelines();
+		SpaceAppVideo::Task<> upload_vertex_buffers();
+		void create_particle_system();
+		void create_starfield();
+		void create_scheduler();
+		void create_lighting();
+		void create_textures();
+		void create_terrain();
+		void create_culling();
+		void create_dynamic_resolution();
+		std::chrono::microseconds gpu_budget() const;
+		void record_commands( vk::CommandBuffer cmd, const SpaceAppVideo::ArenaVector<SpaceAppVideo::View*>& drawn,
+				const SpaceAppVideo::ArenaVector<SpaceAppVideo::ClusterParams>& cluster_params, size_t frame_slot );
 		void create_semaphores();
+		void configure_present_strategy();
+		void record_replay();
+		void apply_config_reload();
 
-		vk::SurfaceFormatKHR choose_swapchain_surface_format();
-		vk::PresentModeKHR choose_swapchain_present_mode();
-		vk::Extent2D choose_swapchain_extent();
-
-		GLFWwindow* window;
+		// Created by init_window in the order of the views they belong to
+		std::vector<GLFWwindow*> windows;
+		bool headless{ false };
+		// Only used in headless mode
+		uint64_t frame_limit{ 0 };
+		uint64_t frame_number{ 0 };
 		vk::UniqueInstance instance;
-		vk::UniqueSurfaceKHR surface;
 		vk::PhysicalDevice phys_dev;
-		SpaceAppVideo::SwapchainDetails swapchain_support;
 		vk::UniqueDevice device;
 		SpaceAppVideo::QueueFamilyIndices queue_indices;
-		vk::Queue graphics_queue;
+		std::unique_ptr<SpaceAppVideo::QueueManager> queue_manager;
 		vk::Queue present_queue;
-		vk::UniqueSwapchainKHR swapchain;
-		std::vector<vk::Image> swapchain_imgs;
-		vk::Format swapchain_img_fmt;
-		vk::Extent2D swapchain_img_size;
-		std::vector<vk::UniqueImageView> swapchain_img_views;
+		// Format of every view, chosen by the first one
+		vk::Format render_format;
+		// All four are compatible, so pipelines work with any. Every view is drawn in two passes, the early one
+		// clears and leaves its depth to be read by the occlusion culling, the other one finishes the image
+		vk::UniqueRenderPass early_render_pass;
 		vk::UniqueRenderPass render_pass;
+		vk::UniqueRenderPass offscreen_render_pass;
+		// Finishes the scene image of views with dynamic resolution, which is blitted afterwards
+		vk::UniqueRenderPass scaled_render_pass;
 		vk::UniquePipelineLayout pipeline_layout;
-		std::vector<vk::UniquePipeline> pipelines;
-		std::vector<vk::UniqueFramebuffer> swapchain_framebuffers;
-		vk::UniqueCommandPool command_pool;
-		std::vector<vk::UniqueCommandBuffer> command_buffers;
-		vk::UniqueBuffer vertex_buffer;
-		vk::UniqueDeviceMemory vertex_buffer_memory;
-
-		std::vector<vk::UniqueSemaphore> img_available_sema;
-		std::vector<vk::UniqueSemaphore> img_ready_sema;
+		SpaceAppVideo::PipelineVariants::Table pipelines;
+		// Guards the pipelines built on the shader reload thread
+		std::mutex pipeline_mutex;
+		SpaceAppVideo::PipelineVariants::Table pending_pipelines;
+		std::atomic<bool> pipelines_pending{ false };
+		bool pipeline_feedback_supported{ false };
+		// Set if the graphics queue can bind sparse memory and the device supports sparse 2D images
+		bool sparse_textures{ false };
+		SpaceAppVideo::Buffer vertex_buffer;
+
 		std::vector<vk::UniqueFence> inflight_fences;
-		std::vector<vk::Fence> inflight_imgs;
+		// Owns the command buffers, every frame is submitted through it
+		std::unique_ptr<SpaceAppVideo::FrameScheduler> scheduler;
+		std::vector<SpaceAppVideo::FrameScheduler::BufferId> particle_buffers;
+		// In the order of ClusteredLighting::buffers()
+		std::vector<SpaceAppVideo::FrameScheduler::BufferId> light_buffers;
+		SpaceAppVideo::FrameScheduler::BufferId terrain_tiles;
+		size_t frames_in_flight{ SpaceAppVideo::MAX_FRAMES_IN_FLIGHT };
+		// Transient allocations of a frame, reset once its fence was waited on
+		std::array<SpaceAppVideo::FrameArena, SpaceAppVideo::MAX_FRAMES_IN_FLIGHT> frame_arenas;
+
+		SpaceAppVideo::FramePacer frame_pacer;
+		SpaceAppVideo::LatencyCounter input_latency;
+		SpaceAppVideo::Clock::time_point input_sampled;
+		SpaceAppVideo::Clock::time_point last_frame{ SpaceAppVideo::Clock::now() };
+
+		// Exported through the metrics segment, tools/metrics_top shows them live
+		struct {
+			Metrics::Histogram frame_time_us;
+			Metrics::Gauge draw_calls;
+			Metrics::Counter swapchain_recreations;
+			Metrics::Gauge frame_arena_peak_bytes;
+			Metrics::Gauge culling_visible;
+			Metrics::Gauge render_scale_percent;
+			Metrics::Histogram gpu_time_us;
+		} metrics;
+
+		// The player, views derive their cameras from it
+		SpaceAppVideo::Camera camera;
+		// Seeds the procedural galaxy, every seed has its own set of files in the star cache
+		static constexpr uint64_t galaxy_seed{ 0x5eed };
+
+		// Only set if the config is watched for changes
+		Config::ConfigStore* config_store{ nullptr };
+
+		// Only created if config.record_replay is set
+		std::unique_ptr<SpaceAppSim::SnapshotRecorder> replay_recorder;
+		SpaceAppSim::SimulationState replay_state;
 
 		std::vector<const char*> dev_exts = {
 			"VK_KHR_swapchain",
 		};
 
+		// Enabled if available
+		std::vector<const char*> optional_dev_exts = {
+			VK_EXT_PIPELINE_CREATION_FEEDBACK_EXTENSION_NAME,
+		};
+
 
 		std::vector<SpaceAppVideo::Vertex> vertices = {
 			{{ -0.5, -0.5,  0.0 }, { 1, 0, 0 }},
 			{{  0.5, -0.5,  0.0 }, { 0, 1, 0 }},
 			{{  0.0,  0.5,  0.0 }, { 0, 0, 1 }},
 		};
+		SpaceAppVideo::Material vertices_material{ SpaceAppVideo::Material::Hull };
+
+		std::unique_ptr<SpaceAppVideo::PipelineVariants> pipeline_variants;
+		std::unique_ptr<SpaceAppVideo::ParticleSystem> particles;
+		std::unique_ptr<SpaceAppVideo::Starfield> starfield;
+		std::unique_ptr<SpaceAppVideo::ClusteredLighting> lighting;
+		std::unique_ptr<SpaceAppVideo::TextureStreamer> textures;
+		std::vector<SpaceAppVideo::TextureStreamer::TextureId> texture_ids;
+		std::unique_ptr<SpaceAppVideo::Terrain> terrain;
+		std::unique_ptr<SpaceAppVideo::OcclusionCulling> culling;
+		// Only created if config.dynamic_resolution is set and supported
+		std::unique_ptr<SpaceAppVideo::DynamicResolution> dynamic_resolution;
+		// The first one is the main window, cleared by cleanup() before glfw is terminated
+		std::vector<std::unique_ptr<SpaceAppVideo::View>> views;
+
+		// Loading work continues on the pool, the waiter resumes it once the gpu is done. Both are destroyed after
+		// the shader manager, which reads on the pool, and the waiter before the pool it resumes on
+		std::unique_ptr<SpaceAppVideo::ThreadPool> thread_pool;
+		std::unique_ptr<SpaceAppVideo::GpuWaiter> gpu_waiter;
+
+		// Declared last, so shader reloading stops before anything it touches is destroyed
+		std::unique_ptr<SpaceAppVideo::ShaderManager> shader_manager;
 };
@@ -0,0 +1,45 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  BlockCompression.hpp
+ *
+ *    Description:  BC4, BC5 and BC7 block encoders used by the texture packer
+ *
+ *        Version:  1.0
+ *        Created:  10/20/2026 02:31:52 AM
+ *       Revision:  none
+ *
+ *         Author:  Samuel Knoethig (), samuel@knoethig.net
+ *
+ * =====================================================================================
+ */
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "TextureAsset.hpp"
+
+namespace SpaceAppVideo {
+	/**
+	 *	One channel of a 4x4 block, row by row, into 8 bytes
+	 */
+	void encode_bc4( const uint8_t values[16], uint8_t out[8] );
+
+	/**
+	 *	Interleaved red and green of a 4x4 block into 16 bytes
+	 */
+	void encode_bc5( const uint8_t rg[32], uint8_t out[16] );
+
+	/**
+	 *	RGBA of a 4x4 block into 16 bytes. Only uses mode 6, a single RGBA line with 16 steps, with its endpoints
+	 *	fitted along the principal axis and refined by least squares, which is good enough for offline packing
+	 */
+	void encode_bc7( const uint8_t rgba[64], uint8_t out[16] );
+
+	/**
+	 *	Compresses an image of RGBA pixels, BC5 only uses red and green and BC4 only red.
+	 *	Blocks reaching over the edge repeat the edge pixels. Runs on every core
+	 */
+	std::vector<uint8_t> compress( TextureCodec codec, const uint8_t* rgba, uint32_t width, uint32_t height );
+}
@@ -0,0 +1,209 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  Broadphase.hpp
+ *
+ *    Description:  Collision broadphase, finds candidate pairs of overlapping bounding boxes
+ *
+ *        Version:  1.0
+ *        Created:  10/19/2026 05:58:12 PM
+ *       Revision:  none
+ *
+ *         Author:  Samuel Knoethig (), samuel@knoethig.net
+ *
+ * =====================================================================================
+ */
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+namespace SpaceAppPhysics {
+	struct AABB {
+		glm::vec3 min;
+		glm::vec3 max;
+
+		bool overlaps( const AABB& other ) const {
+			return min.x <= other.max.x && other.min.x <= max.x
+				&& min.y <= other.max.y && other.min.y <= max.y
+				&& min.z <= other.max.z && other.min.z <= max.z;
+		}
+
+		bool contains( const AABB& other ) const {
+			return min.x <= other.min.x && min.y <= other.min.y && min.z <= other.min.z
+				&& other.max.x <= max.x && other.max.y <= max.y && other.max.z <= max.z;
+		}
+
+		float surface_area() const {
+			glm::vec3 d = max - min;
+			return 2 * ( d.x * d.y + d.y * d.z + d.z * d.x );
+		}
+
+		static AABB merge( const AABB& a, const AABB& b ){
+			return { glm::min( a.min, b.min ), glm::max( a.max, b.max )};
+		}
+	};
+
+	using ProxyId = uint32_t;
+	constexpr ProxyId null_proxy{ UINT32_MAX };
+
+	/**
+	 *	Candidate pairs as two arrays of user data, so a narrowphase can process them several at a time
+	 */
+	struct PairBatch {
+		static constexpr size_t capacity{ 256 };
+
+		std::array<uint32_t, capacity> first;
+		std::array<uint32_t, capacity> second;
+		size_t count{ 0 };
+	};
+
+	// Called for every full batch and once for the remainder, the batch is only valid during the call
+	using PairCallback = std::function<void( const PairBatch& )>;
+
+	/**
+	 *	Common interface of the broadphase structures. Every overlapping pair is reported exactly once per find_pairs call
+	 */
+	class Broadphase {
+		public:
+			virtual ~Broadphase() = default;
+
+			virtual ProxyId create_proxy( const AABB& box, uint32_t user_data ) = 0;
+			virtual void destroy_proxy( ProxyId proxy ) = 0;
+			/**
+			 *	Updates the bounds of a proxy, displacement is the expected movement until the next update
+			 */
+			virtual void move_proxy( ProxyId proxy, const AABB& box, glm::vec3 displacement ) = 0;
+			virtual void find_pairs( const PairCallback& callback ) = 0;
+			virtual size_t proxy_count() const = 0;
+	};
+
+	/**
+	 *	Loose hash grid. Proxies are stored in the cell containing their center, cells are treated as twice their
+	 *	size, so pairs only have to be searched in neighbouring cells. Best for many similarly sized, evenly spread
+	 *	objects like projectiles; proxies larger than a cell fall back to being tested against all others
+	 */
+	class SpatialHashGrid: public Broadphase {
+		public:
+			explicit SpatialHashGrid( float cell_size );
+
+			ProxyId create_proxy( const AABB& box, uint32_t user_data ) override;
+			void destroy_proxy( ProxyId proxy ) override;
+			void move_proxy( ProxyId proxy, const AABB& box, glm::vec3 displacement ) override;
+			void find_pairs( const PairCallback& callback ) override;
+			size_t proxy_count() const override;
+
+		private:
+			struct Proxy {
+				AABB box;
+				uint32_t user_data;
+				bool alive;
+			};
+
+			struct CellEntry {
+				uint64_t cell;
+				ProxyId proxy;
+			};
+
+			struct CellRange {
+				uint64_t cell;
+				uint32_t first;
+				uint32_t count;
+			};
+
+			uint64_t cell_key( glm::vec3 position ) const;
+			const CellRange* find_cell( uint64_t cell ) const;
+
+			float cell_size;
+			std::vector<Proxy> proxies;
+			std::vector<ProxyId> free_list;
+			size_t alive_count{ 0 };
+
+			// Rebuilt by every find_pairs call, kept to reuse their memory
+			std::vector<CellEntry> entries;
+			std::vector<CellRange> table;
+			std::vector<ProxyId> oversized;
+	};
+
+	/**
+	 *	Dynamic bounding volume hierarchy over fattened boxes. Proxies are inserted at the sibling with the lowest
+	 *	surface area cost and the ancestors are rebalanced with tree rotations. A moved proxy is only reinserted once
+	 *	it leaves its fat box, so slow objects cost nothing. Handles mixed sizes from debris to capital ships
+	 */
+	class DynamicTree: public Broadphase {
+		public:
+			/**
+			 *	margin is added to every side of the proxy boxes, displacements additionally extend them
+			 *	by displacement_factor times the movement in that direction
+			 */
+			explicit DynamicTree( float margin = 0.1f, float displacement_factor = 2.0f );
+
+			ProxyId create_proxy( const AABB& box, uint32_t user_data ) override;
+			void destroy_proxy( ProxyId proxy ) override;
+			void move_proxy( ProxyId proxy, const AABB& box, glm::vec3 displacement ) override;
+			void find_pairs( const PairCallback& callback ) override;
+			size_t proxy_count() const override;
+
+			/**
+			 *	Calls callback with the user data of every proxy whose fat box overlaps box
+			 */
+			void query( const AABB& box, const std::function<void( uint32_t )>& callback ) const;
+
+			// Sum of the surface areas of all inner nodes, the quantity the insertion minimises
+			float cost() const;
+			int height() const;
+
+		private:
+			static constexpr uint32_t null_node{ UINT32_MAX };
+
+			struct Node {
+				AABB box;
+				uint32_t parent;
+				uint32_t child1;
+				uint32_t child2;
+				// Leaf: user data of the proxy
+				uint32_t user_data;
+				int height;
+
+				bool leaf() const {
+					return child1 == null_node;
+				}
+			};
+
+			// Node to visit while searching the best sibling, with the growth of its ancestors
+			struct SiblingCandidate {
+				uint32_t node;
+				float inherited;
+			};
+
+			// Pair of subtrees to test, a == b stands for all pairs within that subtree
+			struct NodePair {
+				uint32_t a;
+				uint32_t b;
+			};
+
+			uint32_t alloc_node();
+			void free_node( uint32_t node );
+			void insert_leaf( uint32_t leaf );
+			void remove_leaf( uint32_t leaf );
+			uint32_t find_best_sibling( const AABB& box );
+			void refit_and_rotate( uint32_t node );
+			void rotate( uint32_t node );
+
+			float margin;
+			float displacement_factor;
+
+			std::vector<Node> nodes;
+			uint32_t root{ null_node };
+			uint32_t free_nodes{ null_node };
+			size_t leaf_count{ 0 };
+
+			// Traversal stacks, kept to reuse their memory
+			std::vector<SiblingCandidate> sibling_stack;
+			std::vector<NodePair> pair_stack;
+	};
+}
@@ -0,0 +1,136 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  ClusteredLighting.hpp
+ *
+ *    Description:  Dynamic point lights binned into froxel clusters for forward shading
+ *
+ *        Version:  1.0
+ *        Created:  10/20/2026 12:21:09 AM
+ *       Revision:  none
+ *
+ *         Author:  Samuel Knoethig (), samuel@knoethig.net
+ *
+ * =====================================================================================
+ */
+#pragma once
+
+#include <vulkan/vulkan.hpp>
+
+#include <array>
+#include <span>
+#include <vector>
+
+#include "AppGraphics.hpp"
+#include "ShaderManager.hpp"
+
+namespace SpaceAppVideo {
+	/**
+	 *	A point light, std430 layout. Has to match Light in light_cull.comp.glsl and basic.frag.glsl
+	 */
+	struct Light {
+		glm::vec3 position;
+		// Nothing beyond it is lit
+		float radius;
+		glm::vec3 color;
+		float intensity;
+	};
+
+	/**
+	 *	Everything the culling and the lit shaders need to know about a view, pushed as push constants.
+	 *	Has to match Params in light_cull.comp.glsl, basic.vert.glsl and basic.frag.glsl
+	 */
+	struct ClusterParams {
+		glm::mat4 view;
+		// P[0][0], P[1][1], P[2][2] and P[3][2] of the projection, the rest of it is 0 or -1
+		glm::vec4 projection;
+		// Slice of a view space depth is log( depth ) * x - y, z and w turn pixels into tiles
+		glm::vec4 slicing;
+		// Clusters per axis and the first cluster of the view
+		glm::uvec4 grid;
+	};
+
+	/**
+	 *	Lights live in a device local buffer, only lights changed since the last frame are copied into it.
+	 *	Each frame a compute pass splits every view into a grid of froxels, screen space tiles with
+	 *	logarithmically spaced depth slices, and lists the lights touching each one. Fragments only iterate
+	 *	the list of their cluster, which is capped, so shading cost follows local light density instead of the total
+	 */
+	class ClusteredLighting {
+		public:
+			static constexpr uint32_t max_lights{ 16384 };
+			static constexpr uint32_t grid_x{ 16 };
+			static constexpr uint32_t grid_y{ 9 };
+			static constexpr uint32_t grid_z{ 24 };
+			static constexpr uint32_t clusters_per_view{ grid_x * grid_y * grid_z };
+			// Has to match basic.frag.glsl, further lights are dropped from the cluster
+			static constexpr uint32_t max_lights_per_cluster{ 128 };
+			static constexpr uint32_t max_views{ 4 };
+			// Far end of the depth slices, the last one reaches on to infinity
+			static constexpr float slice_depth{ 20000 };
+
+			using LightId = uint32_t;
+
+			ClusteredLighting( vk::PhysicalDevice phys_dev, vk::Device device, ShaderManager& shaders, vk::PipelineCache cache );
+
+			LightId add( const Light& light );
+			void update( LightId id, const Light& light );
+			void remove( LightId id );
+			uint32_t count() const;
+
+			/**
+			 *	Set 0 of every lit pipeline
+			 */
+			vk::DescriptorSetLayout set_layout() const;
+			vk::DescriptorSet descriptor_set() const;
+			/**
+			 *	The light buffer, written by record_culling and read by lit draws, followed by the cluster buffers
+			 */
+			std::vector<vk::Buffer> buffers() const;
+
+			/**
+			 *	Parameters for the view_index'th view this frame, rendered with camera to a target of extent
+			 */
+			ClusterParams params( const Camera& camera, vk::Extent2D extent, uint32_t view_index ) const;
+
+			/**
+			 *	Copies changed lights and bins all of them into the clusters of every view. Outside of a render pass,
+			 *	frame is the frame in flight cmd belongs to
+			 */
+			void record_culling( vk::CommandBuffer cmd, size_t frame, std::span<const ClusterParams> views );
+
+		private:
+			void create_descriptors();
+			void create_pipeline( vk::PipelineCache cache );
+			void mark_dirty( uint32_t index );
+
+			vk::PhysicalDevice phys_dev;
+			vk::Device device;
+			ShaderManager& shaders;
+
+			// Densely packed, so the culling only walks live lights
+			std::vector<Light> lights;
+			std::vector<uint32_t> id_to_index;
+			std::vector<LightId> index_to_id;
+			std::vector<LightId> free_ids;
+
+			// Indices changed since the last upload, reserved for every light
+			std::vector<uint32_t> dirty;
+			std::vector<bool> dirty_flags;
+			std::vector<vk::BufferCopy> regions;
+
+			Buffer light_buffer;
+			// Per frame in flight, the copy of the last frame may still be reading its staging buffer
+			std::array<Buffer, MAX_FRAMES_IN_FLIGHT> staging;
+			// Light count of every cluster of every view and its fixed size list of light indices
+			Buffer cluster_counts;
+			Buffer cluster_lights;
+
+			vk::UniqueDescriptorSetLayout descriptor_layout;
+			vk::UniqueDescriptorPool descriptor_pool;
+			vk::DescriptorSet descriptors;
+
+			vk::UniquePipelineLayout cull_layout;
+			vk::UniquePipeline cull_pipeline;
+	};
+}
@@ -0,0 +1,187 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  ConfigStore.hpp
+ *
+ *    Description:  Validated loading, caching, write back and live reloading of the config
+ *
+ *        Version:  1.0
+ *        Created:  10/19/2026 08:51:17 PM
+ *       Revision:  none
+ *
+ *         Author:  Samuel Knoethig (), samuel@knoethig.net
+ *
+ * =====================================================================================
+ */
+#pragma once
+
+#include "Util.hpp"
+
+#include <atomic>
+#include <bitset>
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <string_view>
+
+#include "FileWatcher.hpp"
+
+namespace Config {
+	/**
+	 *	Every option declared in CFGOPTIONS, in declaration order
+	 */
+	enum class Option {
+		#define CFGOPTION( name, type, def ) name,
+		CFGOPTIONS
+		#undef CFGOPTION
+	};
+
+	constexpr size_t option_count{ 0
+		#define CFGOPTION( name, type, def ) + 1
+		CFGOPTIONS
+		#undef CFGOPTION
+	};
+
+	using OptionSet = std::bitset<option_count>;
+
+	/**
+	 *	Plain copy of all option values, independent of the parser's storage
+	 */
+	struct Values {
+		#define CFGOPTION( name, type, def ) type name{ def };
+		CFGOPTIONS
+		#undef CFGOPTION
+
+		static Values from( const Config& config );
+		void apply( Config& config ) const;
+	};
+
+	/**
+	 *	Options without a specialisation accept every value of their type and need a restart.
+	 *	runtime_safe options may change while the renderer is running, min and max are inclusive
+	 */
+	template <Option O>
+	struct OptionTraits {
+		static constexpr bool runtime_safe{ false };
+	};
+
+	template <>
+	struct OptionTraits<Option::res> {
+		static constexpr bool runtime_safe{ false };
+		static constexpr Resolution min{ 320, 240 };
+		static constexpr Resolution max{ 16384, 16384 };
+	};
+
+	template <>
+	struct OptionTraits<Option::present_strategy> {
+		static constexpr bool runtime_safe{ true };
+	};
+
+	template <>
+	struct OptionTraits<Option::record_replay> {
+		static constexpr bool runtime_safe{ true };
+	};
+
+	template <>
+	struct OptionTraits<Option::capture> {
+		static constexpr bool runtime_safe{ true };
+	};
+
+	// In MiB
+	template <>
+	struct OptionTraits<Option::texture_budget> {
+		static constexpr bool runtime_safe{ false };
+		static constexpr uint32_t min{ 64 };
+		static constexpr uint32_t max{ 1 << 20 };
+	};
+
+	// Gpu time per frame dynamic resolution aims for, 0 uses the refresh interval of the display
+	template <>
+	struct OptionTraits<Option::gpu_budget_us> {
+		static constexpr bool runtime_safe{ true };
+		static constexpr uint32_t min{ 0 };
+		static constexpr uint32_t max{ 1000000 };
+	};
+
+	/**
+	 *	Compile time description of one option
+	 */
+	template <Option O, typename T>
+	struct Field {
+		using Type = T;
+		using Traits = OptionTraits<O>;
+		static constexpr Option id{ O };
+
+		std::string_view name;
+		T Values::* member;
+	};
+
+	/**
+	 *	Calls f with the Field of every option
+	 */
+	template <typename F>
+	void for_each_field( F&& f ){
+		#define CFGOPTION( name, type, def ) f( Field<Option::name, type>{ #name, &Values::name });
+		CFGOPTIONS
+		#undef CFGOPTION
+	}
+
+	/**
+	 *	Reads config files as lines of name = value, '#' starts a comment. Values that fail to parse or lie
+	 *	outside of their range are reported and replaced by the default.
+	 *
+	 *	The parsed values are kept in a binary cache next to the file, which is used as long as the file's
+	 *	modification time and size or its hash match, so an unchanged config is never parsed
+	 */
+	class ConfigStore {
+		public:
+			ConfigStore( const std::filesystem::path& path, const std::filesystem::path& cache_path );
+
+			void load( Config& config );
+			/**
+			 *	Rewrites only the lines of options that differ from the loaded file and keeps everything else,
+			 *	does not touch the file at all if nothing changed
+			 */
+			void write( const Config& config );
+
+			/**
+			 *	Starts watching the file for changes. Runtime safe options are queued for apply_reload,
+			 *	changes to other options are only reported
+			 */
+			void watch();
+			bool reload_pending() const;
+			/**
+			 *	Applies the queued runtime safe options, has to be called from the thread that owns config.
+			 *	Returns the options that changed
+			 */
+			OptionSet apply_reload( Config& config );
+
+		private:
+			// Identifies the file contents a cache was built from
+			struct CacheKey {
+				uint64_t mtime;
+				uint64_t size;
+				uint64_t hash;
+			};
+
+			Values parse( const std::string& text ) const;
+			bool read_cache( CacheKey& key, Values& values ) const;
+			void write_cache( const CacheKey& key, const Values& values ) const;
+			void reload();
+
+			std::filesystem::path path;
+			std::filesystem::path cache_path;
+
+			std::mutex mutex;
+			// Values as last read from or written to the file
+			Values on_disk;
+			// Restart only options that were edited while running, write() leaves them as they are in the file
+			OptionSet edited;
+			Values pending;
+			OptionSet pending_options;
+			std::atomic<bool> pending_flag{ false };
+
+			// Declared last, so the watcher thread is stopped before anything else gets destroyed
+			FileWatcher watcher;
+	};
+}
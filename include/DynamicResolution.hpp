@@ -0,0 +1,81 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  DynamicResolution.hpp
+ *
+ *    Description:  Scales the rendered resolution to keep the measured gpu time within a budget
+ *
+ *        Version:  1.0
+ *        Created:  10/20/2026 09:12:40 AM
+ *       Revision:  none
+ *
+ *         Author:  Samuel Knoethig (), samuel@knoethig.net
+ *
+ * =====================================================================================
+ */
+#pragma once
+
+#include <vulkan/vulkan.hpp>
+
+#include <array>
+#include <chrono>
+
+#include "AppGraphics.hpp"
+
+namespace SpaceAppVideo {
+	/**
+	 *	Measures the gpu time of the scene passes with timestamp queries and derives the fraction of each view's
+	 *	width and height that is rendered. The time mostly grows with the pixels drawn, so with the square of the
+	 *	scale. The scale drops right away when the budget is exceeded and only creeps back up with headroom to spare,
+	 *	so a single slow frame does not make the image swing back and forth
+	 */
+	class DynamicResolution {
+		public:
+			static constexpr float min_scale{ 0.5f };
+			static constexpr float max_scale{ 1.0f };
+
+			/**
+			 *	Whether queue_family can write timestamps
+			 */
+			static bool supported( vk::PhysicalDevice phys_dev, uint32_t queue_family );
+
+			DynamicResolution( vk::PhysicalDevice phys_dev, vk::Device device, uint32_t queue_family, std::chrono::microseconds budget );
+
+			/**
+			 *	Gpu time the scene passes may take per frame, usually a bit less than the refresh interval
+			 */
+			void set_budget( std::chrono::microseconds budget );
+
+			/**
+			 *	Reads the times of frame's last submission and adjusts the scale. Has to be called once frame's fence was waited on
+			 */
+			void begin_frame( size_t frame );
+
+			/**
+			 *	Encloses the measured commands of frame. Outside of a render pass
+			 */
+			void record_begin( vk::CommandBuffer cmd, size_t frame );
+			void record_end( vk::CommandBuffer cmd, size_t frame );
+
+			float scale() const;
+			/**
+			 *	Smoothed gpu time of the measured commands, at the current scale
+			 */
+			std::chrono::microseconds gpu_time() const;
+
+		private:
+			vk::Device device;
+			vk::UniqueQueryPool query_pool;
+			// Nanoseconds per tick
+			double timestamp_period;
+			uint64_t timestamp_mask;
+			std::array<bool, MAX_FRAMES_IN_FLIGHT> written{};
+			// Scale the measured commands of each frame were recorded with, a measurement arrives frames after its scale changed
+			std::array<float, MAX_FRAMES_IN_FLIGHT> recorded_scales{};
+
+			double budget_us;
+			// Time the measured commands would take at full resolution
+			double smoothed_full_us{ 0 };
+			float current_scale{ max_scale };
+	};
+}
@@ -0,0 +1,59 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  FileWatcher.hpp
+ *
+ *    Description:  Watches directories for modified files using inotify
+ *
+ *        Version:  1.0
+ *        Created:  10/19/2026 01:05:31 PM
+ *       Revision:  none
+ *
+ *         Author:  Samuel Knoethig (), samuel@knoethig.net
+ *
+ * =====================================================================================
+ */
+#pragma once
+
+#include <filesystem>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <thread>
+
+/**
+ *	Calls a callback on a background thread for every file that was written to or moved into a watched directory
+ */
+class FileWatcher {
+	public:
+		using Callback = std::function<void( const std::filesystem::path& )>;
+
+		FileWatcher();
+		FileWatcher( const FileWatcher& ) = delete;
+		FileWatcher& operator=( const FileWatcher& ) = delete;
+		~FileWatcher();
+
+		/**
+		 *	Adds a directory to the watch list, starts the watcher thread if it isn't running yet
+		 */
+		void watch( const std::filesystem::path& directory, Callback callback );
+
+		/**
+		 *	Stops the watcher thread, no callback is called after this returns
+		 */
+		void stop();
+
+	private:
+		void run();
+
+		struct Watch {
+			std::filesystem::path directory;
+			Callback callback;
+		};
+
+		int inotify_fd{ -1 };
+		int stop_fd{ -1 };
+		std::mutex watches_mutex;
+		std::map<int, Watch> watches;
+		std::thread thread;
+};
@@ -0,0 +1,150 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  FrameArena.hpp
+ *
+ *    Description:  Per frame linear allocator and fixed capacity containers for the render path
+ *
+ *        Version:  1.0
+ *        Created:  10/19/2026 09:36:02 PM
+ *       Revision:  none
+ *
+ *         Author:  Samuel Knoethig (), samuel@knoethig.net
+ *
+ * =====================================================================================
+ */
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <span>
+#include <stdexcept>
+#include <type_traits>
+
+namespace SpaceAppVideo {
+	/**
+	 *	Contiguous container with a capacity fixed at creation, over storage it does not own.
+	 *	Only meant for the trivially destructible structs passed to Vulkan
+	 */
+	template <typename T>
+	class ArenaVector {
+		static_assert( std::is_trivially_destructible_v<T> );
+
+		public:
+			ArenaVector() = default;
+			explicit ArenaVector( std::span<T> storage ): storage( storage ){}
+
+			void push_back( const T& val ){
+				if( count == storage.size() )
+					throw std::runtime_error( "ArenaVector capacity exceeded" );
+				storage[count++] = val;
+			}
+
+			T& operator[]( size_t i ){ return storage[i]; }
+			const T& operator[]( size_t i ) const { return storage[i]; }
+
+			T* data(){ return storage.data(); }
+			const T* data() const { return storage.data(); }
+			uint32_t size() const { return static_cast<uint32_t>( count ); }
+			size_t capacity() const { return storage.size(); }
+			bool empty() const { return count == 0; }
+			void clear(){ count = 0; }
+
+			T* begin(){ return storage.data(); }
+			T* end(){ return storage.data() + count; }
+			const T* begin() const { return storage.data(); }
+			const T* end() const { return storage.data() + count; }
+
+		private:
+			std::span<T> storage;
+			size_t count{ 0 };
+	};
+
+	/**
+	 *	ArenaVector with inline storage, for arrays with a small known upper bound
+	 */
+	template <typename T, size_t N>
+	class FixedVector {
+		public:
+			FixedVector() = default;
+			FixedVector( std::initializer_list<T> vals ){
+				for( auto& v: vals )
+					push_back( v );
+			}
+
+			void push_back( const T& val ){
+				if( count == N )
+					throw std::runtime_error( "FixedVector capacity exceeded" );
+				storage[count++] = val;
+			}
+
+			T& operator[]( size_t i ){ return storage[i]; }
+			const T& operator[]( size_t i ) const { return storage[i]; }
+
+			T* data(){ return storage.data(); }
+			const T* data() const { return storage.data(); }
+			uint32_t size() const { return static_cast<uint32_t>( count ); }
+			static constexpr size_t capacity(){ return N; }
+			bool empty() const { return count == 0; }
+			void clear(){ count = 0; }
+
+			T* begin(){ return storage.data(); }
+			T* end(){ return storage.data() + count; }
+			const T* begin() const { return storage.data(); }
+			const T* end() const { return storage.data() + count; }
+
+		private:
+			std::array<T, N> storage{};
+			size_t count{ 0 };
+	};
+
+	/**
+	 *	Bump allocator owned by one frame in flight and reset once that frame's fence was waited on,
+	 *	so transient arrays of a frame never touch the global heap. Nothing allocated from it is destroyed
+	 */
+	class FrameArena {
+		public:
+			explicit FrameArena( size_t capacity = 64 * 1024 ): memory( std::make_unique<std::byte[]>( capacity )), capacity( capacity ){}
+
+			template <typename T>
+			std::span<T> allocate( size_t count ){
+				static_assert( std::is_trivially_destructible_v<T> );
+
+				auto base = reinterpret_cast<uintptr_t>( memory.get() );
+				size_t start = (( base + used + alignof( T ) - 1 ) & ~( alignof( T ) - 1 )) - base;
+				if( start + sizeof( T ) * count > capacity )
+					throw std::runtime_error( "Frame arena exhausted" );
+				used = start + sizeof( T ) * count;
+				high_water = std::max( high_water, used );
+
+				T* data = reinterpret_cast<T*>( memory.get() + start );
+				for( size_t i = 0; i < count; ++i )
+					new ( data + i ) T{};
+				return { data, count };
+			}
+
+			template <typename T>
+			ArenaVector<T> vector( size_t capacity ){
+				return ArenaVector<T>( allocate<T>( capacity ));
+			}
+
+			void reset(){
+				used = 0;
+			}
+
+			// Most bytes used by a single frame so far
+			size_t peak() const {
+				return high_water;
+			}
+
+		private:
+			std::unique_ptr<std::byte[]> memory;
+			size_t capacity;
+			size_t used{ 0 };
+			size_t high_water{ 0 };
+	};
+}
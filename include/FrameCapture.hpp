@@ -0,0 +1,112 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  FrameCapture.hpp
+ *
+ *    Description:  Reads rendered frames back and writes them to disk for recordings and image tests
+ *
+ *        Version:  1.0
+ *        Created:  10/19/2026 08:03:41 PM
+ *       Revision:  none
+ *
+ *         Author:  Samuel Knoethig (), samuel@knoethig.net
+ *
+ * =====================================================================================
+ */
+#pragma once
+
+#include "Util.hpp"
+
+#include <vulkan/vulkan.hpp>
+
+#include <atomic>
+#include <condition_variable>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "AppGraphics.hpp"
+
+namespace SpaceAppVideo {
+	/**
+	 *	Copies swapchain images into a ring of persistently mapped readback buffers at the end of a frame.
+	 *	Once the frame's fence has been waited on, the buffer is handed to an encoder thread, which writes it
+	 *	as a PNG or appends it to a raw video file. If every buffer is still being encoded, the frame is dropped
+	 *	instead of stalling the render loop
+	 */
+	class FrameCapture {
+		public:
+			FrameCapture( vk::PhysicalDevice phys_dev, vk::Device device, vk::Extent2D extent, vk::Format format,
+					Config::CaptureMode mode, const std::filesystem::path& directory = "./capture",
+					size_t ring_size = MAX_FRAMES_IN_FLIGHT + 2 );
+			// Waits until every recorded frame is written, the device has to be idle
+			~FrameCapture();
+
+			FrameCapture( const FrameCapture& ) = delete;
+			FrameCapture& operator=( const FrameCapture& ) = delete;
+
+			// Only 8 bit RGBA and BGRA swapchains can be captured
+			static bool supported( vk::Format format );
+
+			/**
+			 *	Records the copy of image, which has to be in layout and is left in it.
+			 *	frame_slot is the frame in flight cmd belongs to. Returns false if the frame was dropped
+			 */
+			bool record_copy( vk::CommandBuffer cmd, vk::Image image, size_t frame_slot, uint64_t frame_number,
+					vk::ImageLayout layout = vk::ImageLayout::ePresentSrcKHR );
+			/**
+			 *	Has to be called after the fence of frame_slot was waited on, queues its copy for encoding
+			 */
+			void frame_retired( size_t frame_slot );
+
+			uint64_t captured() const;
+			uint64_t dropped() const;
+
+		private:
+			enum class SlotState {
+				Free,
+				Recorded,
+				Encoding,
+			};
+
+			struct Slot {
+				Buffer buffer;
+				bool coherent;
+				std::atomic<SlotState> state{ SlotState::Free };
+				uint64_t frame_number;
+			};
+
+			void run();
+			void encode( Slot& slot );
+			void write_png( const uint8_t* pixels, uint64_t frame_number );
+			void write_raw( const uint8_t* pixels, uint64_t frame_number );
+
+			vk::Device device;
+			vk::Extent2D extent;
+			bool bgra;
+			Config::CaptureMode mode;
+			std::filesystem::path directory;
+
+			std::vector<std::unique_ptr<Slot>> slots;
+			// Slot each frame in flight copied into, if any
+			std::vector<Slot*> in_flight;
+			size_t next_slot{ 0 };
+
+			std::mutex mutex;
+			std::condition_variable cv;
+			// Reserved for every slot, so queueing never allocates
+			std::vector<Slot*> queue;
+			bool stopping{ false };
+
+			// Only touched by the encoder thread
+			std::ofstream raw_file;
+			std::vector<uint8_t> scratch;
+
+			std::atomic<uint64_t> captured_frames{ 0 };
+			std::atomic<uint64_t> dropped_frames{ 0 };
+			std::thread thread;
+	};
+}
@@ -0,0 +1,77 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  FramePacer.hpp
+ *
+ *    Description:  Frame pacing and input latency instrumentation
+ *
+ *        Version:  1.0
+ *        Created:  10/19/2026 11:40:12 AM
+ *       Revision:  none
+ *
+ *         Author:  Samuel Knoethig (), samuel@knoethig.net
+ *
+ * =====================================================================================
+ */
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+namespace SpaceAppVideo {
+	using Clock = std::chrono::steady_clock;
+
+	/**
+	 *	Sleeps until the latest point at which the next frame can be started and still make its deadline.
+	 *	The cpu time a frame takes is predicted from an exponential moving average of previous frames.
+	 */
+	class FramePacer {
+		public:
+			/**
+			 *	Sets the time between two deadlines, usually the refresh interval of the display.
+			 *	An interval of zero disables pacing
+			 */
+			void set_interval( Clock::duration interval );
+
+			/**
+			 *	Blocks until the predicted start of the next frame
+			 */
+			void wait();
+
+			/**
+			 *	Has to be called once a frame was handed to the presentation engine
+			 */
+			void frame_presented();
+
+			bool enabled() const;
+
+		private:
+			Clock::duration interval{};
+			Clock::time_point next_deadline{};
+			Clock::time_point frame_start{};
+			// Predicted cpu time per frame in nanoseconds
+			double predicted_work{ 0 };
+
+			// Time left in front of the deadline for scheduling jitter
+			static constexpr Clock::duration safety_margin{ std::chrono::microseconds( 500 )};
+			// The last part of the sleep is spun to avoid oversleeping
+			static constexpr Clock::duration spin_threshold{ std::chrono::microseconds( 1000 )};
+	};
+
+	/**
+	 *	Accumulates the latency between sampling input and presenting the corresponding frame
+	 */
+	struct LatencyCounter {
+		void record( Clock::duration latency );
+		void reset();
+
+		double average_ms() const;
+		double max_ms() const;
+		double last_ms() const;
+
+		uint64_t frames{ 0 };
+		Clock::duration last{};
+		Clock::duration max{};
+		Clock::duration total{};
+	};
+}
@@ -0,0 +1,122 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  Materials.hpp
+ *
+ *    Description:  Declares shader programs, materials and the pipeline permutations they need
+ *
+ *        Version:  1.0
+ *        Created:  10/19/2026 02:22:15 PM
+ *       Revision:  none
+ *
+ *         Author:  Samuel Knoethig (), samuel@knoethig.net
+ *
+ * =====================================================================================
+ */
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#ifndef SHADER_PROGRAMS
+#define SHADER_PROGRAMS													\
+SHADER_PROGRAM( Basic, "basic.vert.glsl.spv", "basic.frag.glsl.spv" )
+#endif //SHADER_PROGRAMS
+
+/**
+ *	MATERIAL( name, program, cull mode, front face, blend mode, features, optional features )
+ *	Every combination of the optional features gets precompiled
+ */
+#ifndef MATERIALS
+#define MATERIALS																										\
+MATERIAL( Hull, Basic, Back, Clockwise, Opaque, VertexColor | Lit, Emissive )											\
+MATERIAL( Cockpit, Basic, None, Clockwise, Opaque, VertexColor | Lit, 0 )												\
+MATERIAL( Shield, Basic, None, Clockwise, Additive, VertexColor | Emissive, 0 )											\
+MATERIAL( Glass, Basic, Back, Clockwise, Alpha, Translucent, VertexColor )
+#endif //MATERIALS
+
+namespace SpaceAppVideo {
+	enum class ShaderProgram : uint8_t {
+		#define SHADER_PROGRAM( name, vert, frag ) name,
+		SHADER_PROGRAMS
+		#undef SHADER_PROGRAM
+	};
+
+	enum class CullMode : uint8_t {
+		None,
+		Front,
+		Back,
+	};
+
+	enum class FrontFace : uint8_t {
+		Clockwise,
+		CounterClockwise,
+	};
+
+	enum class BlendMode : uint8_t {
+		Opaque,
+		Alpha,
+		Additive,
+	};
+
+	/**
+	 *	Shader features, passed to the shaders as specialization constant 0
+	 */
+	namespace ShaderFeature {
+		enum ShaderFeature : uint16_t {
+			VertexColor	= 1 << 0,
+			Emissive	= 1 << 1,
+			Translucent	= 1 << 2,
+			// Shaded by the clustered lights
+			Lit			= 1 << 3,
+		};
+	}
+
+	/**
+	 *	Everything that distinguishes two pipeline variants, packed into 32 bits
+	 */
+	struct PipelineKey {
+		ShaderProgram program;
+		CullMode cull_mode;
+		FrontFace front_face;
+		BlendMode blend_mode;
+		uint16_t features;
+
+		constexpr uint32_t pack() const {
+			return static_cast<uint32_t>( program )
+				| static_cast<uint32_t>( cull_mode ) << 8
+				| static_cast<uint32_t>( front_face ) << 10
+				| static_cast<uint32_t>( blend_mode ) << 11
+				| static_cast<uint32_t>( features ) << 16;
+		}
+
+		constexpr static PipelineKey unpack( uint32_t key ){
+			return {
+				static_cast<ShaderProgram>( key & 0xff ),
+				static_cast<CullMode>(( key >> 8 ) & 0x3 ),
+				static_cast<FrontFace>(( key >> 10 ) & 0x1 ),
+				static_cast<BlendMode>(( key >> 11 ) & 0x3 ),
+				static_cast<uint16_t>( key >> 16 ),
+			};
+		}
+	};
+
+	enum class Material {
+		#define MATERIAL( name, program, cull, front, blend, features, optional ) name,
+		MATERIALS
+		#undef MATERIAL
+	};
+
+	/**
+	 *	Returns the key of the material with all optional features disabled
+	 */
+	PipelineKey material_key( Material material );
+
+	/**
+	 *	Returns the keys of every permutation declared by any material, without duplicates
+	 */
+	std::vector<PipelineKey> material_permutations();
+
+	const char* vertex_shader( ShaderProgram program );
+	const char* fragment_shader( ShaderProgram program );
+}
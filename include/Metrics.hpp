@@ -0,0 +1,194 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  Metrics.hpp
+ *
+ *    Description:  Named counters, gauges and histograms living in a shared memory segment
+ *
+ *        Version:  1.0
+ *        Created:  10/20/2026 08:03:19 AM
+ *       Revision:  none
+ *
+ *         Author:  Samuel Knoethig (), samuel@knoethig.net
+ *
+ * =====================================================================================
+ */
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <string_view>
+
+/**
+ *	Metrics are updated with relaxed atomics right inside a POSIX shared memory segment, so recording one is a single
+ *	atomic add and never does I/O. Other processes (tools/metrics_top) map the segment read only and sample it live.
+ *	Every process exports its own segment, named segment_prefix followed by its pid.
+ *	The layout below is shared with them and versioned through segment_version
+ */
+namespace Metrics {
+	constexpr char segment_prefix[]{ "/spaceflight_metrics." };
+	constexpr uint32_t segment_magic{ 0x53464d54 };
+	constexpr uint32_t segment_version{ 1 };
+
+	constexpr size_t max_metrics{ 128 };
+	constexpr size_t max_histograms{ 16 };
+	constexpr size_t name_length{ 48 };
+
+	// Histograms are log-linear like HDR histograms: every power of two is split into 2^sub_bucket_bits buckets,
+	// so a recorded value is off by at most 1/8 of itself
+	constexpr uint32_t sub_bucket_bits{ 3 };
+	constexpr uint32_t sub_buckets{ 1u << sub_bucket_bits };
+	constexpr uint32_t histogram_buckets{ ( 64 - sub_bucket_bits + 1 ) << sub_bucket_bits };
+
+	static_assert( std::atomic<uint64_t>::is_always_lock_free && std::atomic<int64_t>::is_always_lock_free,
+			"Metrics are shared between processes, their atomics must not hide a lock" );
+
+	constexpr uint32_t bucket_index( uint64_t value ){
+		if( value < sub_buckets )
+			return static_cast<uint32_t>( value );
+		uint32_t shift = std::bit_width( value ) - 1 - sub_bucket_bits;
+		return (( shift + 1 ) << sub_bucket_bits ) + static_cast<uint32_t>(( value >> shift ) & ( sub_buckets - 1 ));
+	}
+
+	/**
+	 *	Smallest value recorded into bucket index
+	 */
+	constexpr uint64_t bucket_lower( uint32_t index ){
+		if( index < sub_buckets )
+			return index;
+		uint32_t shift = ( index >> sub_bucket_bits ) - 1;
+		return static_cast<uint64_t>( sub_buckets + ( index & ( sub_buckets - 1 ))) << shift;
+	}
+
+	enum class Kind: uint32_t {
+		// Only ever grows, readers derive rates from it
+		Counter,
+		// Last value set
+		Gauge,
+		Histogram,
+	};
+
+	struct MetricSlot {
+		char name[name_length];
+		Kind kind;
+		// Index into Segment::histograms for histograms
+		uint32_t histogram;
+		std::atomic<int64_t> value;
+	};
+
+	struct HistogramSlot {
+		std::atomic<uint64_t> count;
+		std::atomic<uint64_t> sum;
+		std::atomic<uint64_t> max;
+		std::array<std::atomic<uint64_t>, histogram_buckets> buckets;
+	};
+
+	struct Segment {
+		// Written once everything else is initialised
+		std::atomic<uint32_t> magic;
+		uint32_t version;
+		uint32_t pid;
+		// Slots below it are complete, it is raised with release order after a slot was written
+		std::atomic<uint32_t> metric_count;
+		std::array<MetricSlot, max_metrics> metrics;
+		std::array<HistogramSlot, max_histograms> histograms;
+	};
+
+	// Handles created without a registry write here, so recording never has to check for one
+	inline MetricSlot unregistered_metric;
+	inline HistogramSlot unregistered_histogram;
+
+	class Counter {
+		public:
+			Counter() = default;
+			explicit Counter( MetricSlot* slot ): slot( slot ){}
+
+			void add( int64_t n = 1 ) const {
+				slot->value.fetch_add( n, std::memory_order_relaxed );
+			}
+
+		private:
+			MetricSlot* slot{ &unregistered_metric };
+	};
+
+	class Gauge {
+		public:
+			Gauge() = default;
+			explicit Gauge( MetricSlot* slot ): slot( slot ){}
+
+			void set( int64_t value ) const {
+				slot->value.store( value, std::memory_order_relaxed );
+			}
+
+		private:
+			MetricSlot* slot{ &unregistered_metric };
+	};
+
+	class Histogram {
+		public:
+			Histogram() = default;
+			explicit Histogram( HistogramSlot* slot ): slot( slot ){}
+
+			void record( uint64_t value ) const {
+				slot->count.fetch_add( 1, std::memory_order_relaxed );
+				slot->sum.fetch_add( value, std::memory_order_relaxed );
+				slot->buckets[bucket_index( value )].fetch_add( 1, std::memory_order_relaxed );
+
+				uint64_t max = slot->max.load( std::memory_order_relaxed );
+				while( value > max && !slot->max.compare_exchange_weak( max, value, std::memory_order_relaxed ));
+			}
+
+		private:
+			HistogramSlot* slot{ &unregistered_histogram };
+	};
+
+	/**
+	 *	Owns the segment. Metrics are registered once, usually when their subsystem is created, and looked up by name,
+	 *	so registering a name twice returns the same metric. If the segment can not be created the metrics live in
+	 *	private memory instead and nothing is exported
+	 */
+	class Registry {
+		public:
+			/**
+			 *	Exports to the segment of this process
+			 */
+			Registry();
+			explicit Registry( std::string segment_name );
+			// Unlinks the segment, readers keep their mapping until they close it
+			~Registry();
+
+			Registry( const Registry& ) = delete;
+			Registry& operator=( const Registry& ) = delete;
+
+			Counter counter( std::string_view name );
+			Gauge gauge( std::string_view name );
+			Histogram histogram( std::string_view name );
+
+			bool exported() const;
+			const char* segment_name() const;
+
+		private:
+			MetricSlot& find_or_add( std::string_view name, Kind kind );
+
+			std::string name;
+			bool shared{ false };
+			Segment* segment{ nullptr };
+			std::mutex mutex;
+	};
+
+	/**
+	 *	The process wide registry, created on first use
+	 */
+	Registry& registry();
+
+	/**
+	 *	Name of the segment exported by the process pid
+	 */
+	inline std::string segment_for( uint32_t pid ){
+		return segment_prefix + std::to_string( pid );
+	}
+}
@@ -0,0 +1,187 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  OcclusionCulling.hpp
+ *
+ *    Description:  Two phase instance culling against a hierarchical depth pyramid
+ *
+ *        Version:  1.0
+ *        Created:  10/20/2026 06:02:36 AM
+ *       Revision:  none
+ *
+ *         Author:  Samuel Knoethig (), samuel@knoethig.net
+ *
+ * =====================================================================================
+ */
+#pragma once
+
+#include <vulkan/vulkan.hpp>
+
+#include <array>
+#include <span>
+#include <vector>
+
+#include "AppGraphics.hpp"
+#include "ShaderManager.hpp"
+
+namespace SpaceAppVideo {
+	// Enough for a pyramid of 8192 texels on its longer side
+	constexpr uint32_t MAX_HIZ_LEVELS{ 14 };
+
+	/**
+	 *	Depth buffer of a view and the pyramid built from it, owned by the view
+	 */
+	struct HizTarget {
+		// Unique for every target ever created, handles of destroyed images may be reused
+		uint64_t id;
+		vk::ImageView depth;
+		vk::Image image;
+		// Every level, sampled by the culling
+		vk::ImageView pyramid;
+		// Single levels, written while building
+		std::array<vk::ImageView, MAX_HIZ_LEVELS> levels;
+		uint32_t level_count;
+		// Of level 0, the largest power of two not above the depth buffer in each dimension
+		vk::Extent2D extent;
+		// Part of the depth buffer drawn to, level 0 is built from it. Smaller than the depth buffer with dynamic resolution
+		vk::Extent2D drawn;
+	};
+
+	/**
+	 *	Bounding sphere of one drawn instance in world space, std430 layout. Has to match Instance in
+	 *	occlusion_cull.comp.glsl and basic.vert.glsl
+	 */
+	struct CullInstance {
+		glm::vec3 position;
+		float radius;
+	};
+
+	/**
+	 *	What the culling of one frame did, summed over every view
+	 */
+	struct OcclusionStats {
+		uint32_t tested{ 0 };
+		uint32_t frustum_culled{ 0 };
+		uint32_t occluded{ 0 };
+		// Visible last frame and drawn before the pyramid was built
+		uint32_t early{ 0 };
+		// Disoccluded this frame and drawn after it
+		uint32_t late{ 0 };
+	};
+
+	/**
+	 *	Culls instances of a mesh per view in two phases, so nothing has to be drawn twice and nothing waits for
+	 *	last frame's depth to be read back. The early phase draws what was visible last frame and is still inside the
+	 *	frustum. Its depth, together with everything opaque drawn before it, is reduced into a pyramid of the farthest
+	 *	depth per texel. The late phase tests every instance against the pyramid, draws the ones that became visible
+	 *	and remembers the visible set for the next frame.
+	 *
+	 *	Draws are indirect, instance n of a phase is draw_list[first_instance + n], so the vertex shader finds its
+	 *	instance through set 1 of the lit pipelines
+	 */
+	class OcclusionCulling {
+		public:
+			static constexpr uint32_t max_instances{ 16384 };
+			static constexpr uint32_t max_views{ 4 };
+
+			OcclusionCulling( vk::PhysicalDevice phys_dev, vk::Device device, ShaderManager& shaders, vk::PipelineCache cache );
+
+			/**
+			 *	Replaces every instance, each is drawn with vertex_count vertices starting at 0
+			 */
+			void set_instances( std::span<const CullInstance> instances, uint32_t vertex_count );
+			uint32_t count() const;
+
+			/**
+			 *	Set 1 of every pipeline drawing culled instances
+			 */
+			vk::DescriptorSetLayout set_layout() const;
+			vk::DescriptorSet descriptor_set( size_t frame, uint32_t view_index ) const;
+
+			/**
+			 *	Copies changed instances and collects the stats of frame's last submission.
+			 *	Has to be called once frame's fence was waited on
+			 */
+			void begin_frame( size_t frame );
+
+			/**
+			 *	Stats of the last frame whose fence was waited on
+			 */
+			const OcclusionStats& stats() const;
+
+			/**
+			 *	Chooses the early instances of the view. Outside of a render pass, before the view is drawn
+			 */
+			void record_early( vk::CommandBuffer cmd, size_t frame, uint32_t view_index, const Camera& camera, vk::Extent2D extent,
+					const HizTarget& target );
+
+			/**
+			 *	Builds the view's pyramid from the depth of the early draws and chooses the late instances.
+			 *	Outside of a render pass, the depth buffer has to be in DepthStencilReadOnlyOptimal
+			 */
+			void record_late( vk::CommandBuffer cmd, size_t frame, uint32_t view_index, const HizTarget& target );
+
+			/**
+			 *	Draws the instances of a phase, 0 is early and 1 late. Pipeline and descriptor sets have to be bound
+			 */
+			void record_draw( vk::CommandBuffer cmd, uint32_t view_index, uint32_t phase );
+
+		private:
+			struct CullParams {
+				glm::mat4 view;
+				// P[0][0], P[1][1] and z_near of the projection
+				glm::vec4 projection;
+				// Texels of pyramid level 0
+				glm::vec2 pyramid_size;
+				uint32_t instance_count;
+				uint32_t phase;
+				uint32_t view_index;
+				uint32_t level_count;
+			};
+
+			void create_descriptors();
+			void create_pipelines( vk::PipelineCache cache );
+			void update_target( size_t frame, uint32_t view_index, const HizTarget& target );
+
+			vk::PhysicalDevice phys_dev;
+			vk::Device device;
+			ShaderManager& shaders;
+
+			std::vector<CullInstance> instances;
+			uint32_t vertex_count{ 0 };
+			// Frame slots still holding an older copy of the instances
+			int stale_frames{ 0 };
+			std::array<uint32_t, MAX_FRAMES_IN_FLIGHT> frame_counts{};
+			std::array<uint32_t, MAX_FRAMES_IN_FLIGHT> frame_views{};
+			bool visibility_cleared{ false };
+
+			OcclusionStats last_stats;
+			std::array<CullParams, max_views> params{};
+
+			// Per frame in flight, host visible
+			Buffer instance_buffer;
+			// Two lists of instance indices per view, early and late
+			Buffer draw_lists;
+			// One draw per phase and view
+			Buffer draw_commands;
+			// Per view and instance, whether it passed the late test last frame
+			Buffer visibility;
+			// Four counters per view and frame in flight, host visible
+			Buffer stats_buffer;
+
+			vk::UniqueSampler sampler;
+
+			vk::UniqueDescriptorSetLayout cull_set_layout;
+			vk::UniqueDescriptorSetLayout build_set_layout;
+			vk::UniqueDescriptorPool descriptor_pool;
+			std::array<std::array<vk::DescriptorSet, max_views>, MAX_FRAMES_IN_FLIGHT> cull_sets;
+			std::array<std::array<std::array<vk::DescriptorSet, MAX_HIZ_LEVELS>, max_views>, MAX_FRAMES_IN_FLIGHT> build_sets;
+			// Target a set was last written with, so sets are only rewritten after a target was recreated
+			std::array<std::array<uint64_t, max_views>, MAX_FRAMES_IN_FLIGHT> bound_targets{};
+
+			vk::UniquePipelineLayout cull_layout;
+			vk::UniquePipeline cull_pipeline;
+			vk::UniquePipelineLayout build_layout;
+			vk::UniquePipeline build_pipeline;
+	};
+}
@@ -0,0 +1,155 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  ParticleSystem.hpp
+ *
+ *    Description:  GPU driven particle system for engine exhaust and debris
+ *
+ *        Version:  1.0
+ *        Created:  10/19/2026 03:48:20 PM
+ *       Revision:  none
+ *
+ *         Author:  Samuel Knoethig (), samuel@knoethig.net
+ *
+ * =====================================================================================
+ */
+#pragma once
+
+#include <vulkan/vulkan.hpp>
+
+#include <array>
+#include <vector>
+
+#include "AppGraphics.hpp"
+#include "ShaderManager.hpp"
+
+namespace SpaceAppVideo {
+	/**
+	 *	Describes where and how particles are spawned. Emitters with a rate spawn continuously,
+	 *	emitters passed to burst() spawn once
+	 */
+	struct Emitter {
+		glm::vec3 position{ 0 };
+		glm::vec3 velocity{ 0 };
+		// Radius of the sphere particles spawn in
+		float spread{ 0.1f };
+		// Maximum random deviation from velocity
+		float velocity_jitter{ 0.5f };
+		glm::vec4 color{ 1, 0.6, 0.2, 1 };
+		float lifetime{ 2 };
+		float size{ 0.02f };
+		// Particles per second
+		float rate{ 0 };
+
+		// Fractional particles carried over to the next frame
+		float accumulated{ 0 };
+	};
+
+	/**
+	 *	All particle state lives in device local structure of arrays buffers. Emission, integration,
+	 *	compaction of dead particles and back to front sorting run in compute shaders, drawing uses the
+	 *	instance count written by the GPU. The CPU only records a fixed number of dispatches per emitter and frame.
+	 *	It never reads the alive count back, but bounds it by everything emitted within the last lifetimes, so the
+	 *	simulation and the sort only cover the next power of two above that instead of the whole pool.
+	 *
+	 *	Simulation and drawing may be recorded for different queues. The buffers are exclusive and leave
+	 *	synchronising both, including ownership transfers, to the caller, see buffers()
+	 */
+	class ParticleSystem {
+		public:
+			// Has to be a power of two and a multiple of 512 for the sort
+			static constexpr uint32_t capacity{ 1 << 20 };
+
+			ParticleSystem( vk::PhysicalDevice phys_dev, vk::Device device, ShaderManager& shaders, vk::PipelineCache cache );
+
+			/**
+			 *	(Re)creates the pipeline used by record_draw, has to be called whenever the render pass changes
+			 */
+			void create_render_pipeline( vk::RenderPass render_pass );
+
+			/**
+			 *	Every buffer the simulation writes and the draw reads
+			 */
+			std::vector<vk::Buffer> buffers() const;
+
+			/**
+			 *	Spawns count particles with the next simulation step
+			 */
+			void burst( const Emitter& emitter, uint32_t count );
+
+			/**
+			 *	Records emission, simulation, compaction and sorting for one step of dt seconds.
+			 *	Has to be ordered after the last record_draw and before the next one
+			 */
+			void record_simulation( vk::CommandBuffer cmd, float dt, const Camera& camera );
+
+			/**
+			 *	Records the draw of all particles alive after the last simulation step, has to be inside the render pass
+			 */
+			void record_draw( vk::CommandBuffer cmd, const Camera& camera, float aspect );
+
+			std::vector<Emitter> emitters;
+
+		private:
+			struct Burst {
+				Emitter emitter;
+				uint32_t count;
+			};
+
+			// Particles spawned together, all of them are dead after expiry
+			struct Emission {
+				float expiry;
+				uint32_t count;
+			};
+			// Older emissions get merged beyond that, which only loosens the bound
+			static constexpr size_t max_emissions{ 256 };
+
+			void create_buffers();
+			void create_descriptors();
+			void create_compute_pipelines();
+			void record_emit( vk::CommandBuffer cmd, const Emitter& emitter, uint32_t count, const glm::vec4& camera_position );
+			/**
+			 *	Forgets expired emissions and returns the most particles that can still be alive
+			 */
+			uint32_t alive_bound( float dt );
+
+			vk::PhysicalDevice phys_dev;
+			vk::Device device;
+			ShaderManager& shaders;
+			vk::PipelineCache cache;
+
+			Buffer positions;
+			Buffer velocities;
+			Buffer colors;
+			Buffer alive_lists;
+			Buffer dead_list;
+			Buffer counters;
+			Buffer sort_keys;
+
+			vk::UniqueDescriptorSetLayout set_layout;
+			vk::UniqueDescriptorPool descriptor_pool;
+			vk::DescriptorSet descriptor_set;
+
+			vk::UniquePipelineLayout compute_layout;
+			vk::UniquePipeline init_pipeline;
+			vk::UniquePipeline emit_pipeline;
+			vk::UniquePipeline simulate_pipeline;
+			vk::UniquePipeline finish_pipeline;
+			vk::UniquePipeline sort_pipeline;
+
+			vk::UniquePipelineLayout render_layout;
+			vk::UniquePipeline render_pipeline;
+
+			std::vector<Burst> bursts;
+			bool initialised{ false };
+			uint32_t parity{ 0 };
+			uint32_t seed{ 0 };
+			// Offset into the alive lists of the list written by the last simulation step
+			uint32_t draw_offset{ 0 };
+
+			// Simulated seconds, the clock emissions expire on
+			float time{ 0 };
+			std::array<Emission, max_emissions> emissions;
+			size_t emission_count{ 0 };
+	};
+}
@@ -0,0 +1,64 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  PipelineVariants.hpp
+ *
+ *    Description:  Builds and caches graphics pipeline variants keyed by PipelineKey
+ *
+ *        Version:  1.0
+ *        Created:  10/19/2026 02:51:09 PM
+ *       Revision:  none
+ *
+ *         Author:  Samuel Knoethig (), samuel@knoethig.net
+ *
+ * =====================================================================================
+ */
+#pragma once
+
+#include <vulkan/vulkan.hpp>
+
+#include <filesystem>
+#include <unordered_map>
+#include <vector>
+
+#include "Materials.hpp"
+#include "ShaderManager.hpp"
+
+namespace SpaceAppVideo {
+	/**
+	 *	Builds pipeline variants of the basic vertex layout. All builds go through one pipeline cache,
+	 *	which can be persisted to disk, so precompiled variants are cheap to create at runtime.
+	 *	build() may be called from any thread
+	 */
+	class PipelineVariants {
+		public:
+			// Maps packed PipelineKeys to pipelines
+			using Table = std::unordered_map<uint32_t, vk::UniquePipeline>;
+
+			/**
+			 *	Creates the pipeline cache, initialised from cache_path if its data was written by the same device and driver
+			 */
+			PipelineVariants( vk::PhysicalDevice phys_dev, vk::Device device, ShaderManager& shaders,
+					std::filesystem::path cache_path, bool feedback_supported );
+
+			/**
+			 *	Builds all keys in one batch
+			 */
+			Table build( const std::vector<PipelineKey>& keys, vk::RenderPass render_pass, vk::PipelineLayout layout );
+
+			/**
+			 *	Writes the pipeline cache to the path given on construction
+			 */
+			void save_cache();
+
+			vk::PipelineCache pipeline_cache() const;
+
+		private:
+			vk::PhysicalDevice phys_dev;
+			vk::Device device;
+			ShaderManager& shaders;
+			std::filesystem::path cache_path;
+			bool feedback_supported;
+			vk::UniquePipelineCache cache;
+	};
+}
@@ -0,0 +1,208 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  QueueManager.hpp
+ *
+ *    Description:  Picks queue families, creates prioritised queues and schedules submissions across them
+ *
+ *        Version:  1.0
+ *        Created:  10/19/2026 11:04:17 PM
+ *       Revision:  none
+ *
+ *         Author:  Samuel Knoethig (), samuel@knoethig.net
+ *
+ * =====================================================================================
+ */
+#pragma once
+
+#include <vulkan/vulkan.hpp>
+
+#include <array>
+#include <optional>
+#include <vector>
+
+#include "AppGraphics.hpp"
+#include "FrameArena.hpp"
+
+namespace SpaceAppVideo {
+	enum class QueueRole {
+		Graphics,
+		Present,
+		Compute,
+		Transfer,
+	};
+
+	constexpr size_t queue_role_count{ 4 };
+
+	/**
+	 *	Decides which queue every role is submitted to. Compute and transfer get queues of their own with a lower
+	 *	priority than graphics if the device has any to spare, preferably from dedicated families, so their work
+	 *	fills the gaps graphics leaves. Roles without a queue of their own share the graphics one
+	 */
+	class QueueManager {
+		public:
+			/**
+			 *	Graphics and present preferably from the same family, compute and transfer from families without graphics support
+			 */
+			static QueueFamilyIndices find_families( vk::PhysicalDevice phys_dev, vk::SurfaceKHR surface );
+
+			QueueManager( vk::PhysicalDevice phys_dev, const QueueFamilyIndices& indices );
+
+			QueueManager( const QueueManager& ) = delete;
+			QueueManager& operator=( const QueueManager& ) = delete;
+
+			/**
+			 *	Has to be passed to device creation, the priorities are owned by the manager
+			 */
+			const std::vector<vk::DeviceQueueCreateInfo>& create_infos() const;
+			/**
+			 *	Fetches the queues from the device created with create_infos()
+			 */
+			void retrieve( vk::Device device );
+
+			vk::Queue queue( QueueRole role ) const;
+			uint32_t family( QueueRole role ) const;
+			/**
+			 *	True if work submitted for role can run at the same time as graphics work
+			 */
+			bool dedicated( QueueRole role ) const;
+
+		private:
+			struct Assignment {
+				uint32_t family;
+				uint32_t index;
+				vk::Queue queue;
+			};
+
+			std::array<Assignment, queue_role_count> assignments;
+			std::vector<std::vector<float>> priorities;
+			std::vector<vk::DeviceQueueCreateInfo> infos;
+	};
+
+	/**
+	 *	Records and submits the passes of one frame. Every pass runs on the queue of its role and declares the
+	 *	buffers it touches, the scheduler then adds what the declarations require between consecutive uses:
+	 *	a pipeline barrier on the same queue, a semaphore between different queues and a queue family ownership
+	 *	transfer for exclusive buffers changing families. The pass order is assumed to repeat every frame, so the
+	 *	last use of a buffer in a frame is followed by its first use in the next one.
+	 *	Consecutive passes on the same queue are submitted together. Nothing allocates once created
+	 */
+	class FrameScheduler {
+		public:
+			static constexpr size_t max_passes{ 8 };
+			static constexpr size_t max_buffers{ 16 };
+			static constexpr size_t max_pass_uses{ 16 };
+			static constexpr size_t max_external{ 8 };
+
+			using PassId = uint32_t;
+			using BufferId = uint32_t;
+
+			FrameScheduler( vk::Device device, const QueueManager& queues );
+
+			FrameScheduler( const FrameScheduler& ) = delete;
+			FrameScheduler& operator=( const FrameScheduler& ) = delete;
+
+			/**
+			 *	Exclusive buffers are moved between families by the scheduler, they must not be used outside of its passes
+			 */
+			BufferId add_buffer( vk::Buffer buffer, bool exclusive );
+
+			/**
+			 *	Starts the graph of frame. Has to be called after the fence passed to the last submit of frame was waited on
+			 */
+			void begin_frame( size_t frame );
+
+			/**
+			 *	record is called with a command buffer in the recording state during submit() and has to live until then
+			 */
+			template <typename F>
+			PassId add_pass( QueueRole role, F& record ){
+				return add_pass( role, &record, []( void* context, vk::CommandBuffer cmd ){ ( *static_cast<F*>( context ))( cmd ); });
+			}
+
+			void use( PassId pass, BufferId buffer, vk::PipelineStageFlags stages, vk::AccessFlags access );
+			void wait( PassId pass, vk::Semaphore semaphore, vk::PipelineStageFlags stages );
+			void signal( PassId pass, vk::Semaphore semaphore );
+
+			/**
+			 *	Records and submits every pass. fence is signalled by the last submission to the graphics queue
+			 */
+			void submit( vk::Fence fence );
+
+		private:
+			using Record = void (*)( void*, vk::CommandBuffer );
+
+			struct Use {
+				BufferId buffer;
+				vk::PipelineStageFlags stages;
+				vk::AccessFlags access;
+			};
+
+			struct Pass {
+				QueueRole role;
+				void* context;
+				Record record;
+				FixedVector<Use, max_pass_uses> uses;
+				FixedVector<vk::Semaphore, max_external> waits;
+				FixedVector<vk::PipelineStageFlags, max_external> wait_stages;
+				FixedVector<vk::Semaphore, max_external> signals;
+				uint32_t batch;
+			};
+
+			struct Batch {
+				vk::Queue queue;
+				FixedVector<vk::CommandBuffer, max_passes> cmds;
+				FixedVector<vk::Semaphore, 2 * max_external + max_buffers> waits;
+				FixedVector<vk::PipelineStageFlags, 2 * max_external + max_buffers> wait_stages;
+				FixedVector<vk::Semaphore, 2 * max_external + max_buffers> signals;
+			};
+
+			struct BufferState {
+				vk::Buffer buffer;
+				bool exclusive;
+				// Family a release was recorded for, which the next use still has to acquire
+				std::optional<uint32_t> released_to;
+				// Signalled by the last frame's final use, if the first use of this frame is on another queue
+				vk::Semaphore carried;
+			};
+
+			struct FrameResources {
+				std::array<vk::UniqueCommandPool, queue_role_count> pools;
+				std::array<std::vector<vk::UniqueCommandBuffer>, queue_role_count> cmds;
+				std::array<uint32_t, queue_role_count> cmds_used{};
+				std::array<vk::UniqueSemaphore, max_passes * max_passes> edges;
+				uint32_t edges_used{ 0 };
+				std::array<vk::UniqueFence, max_passes> fences;
+				uint32_t fences_used{ 0 };
+			};
+
+			// Previous (or next) use of buffer relative to pass, wrapping around into the last (or next) frame
+			struct Neighbour {
+				const Pass* pass;
+				const Use* use;
+				bool other_frame;
+			};
+
+			PassId add_pass( QueueRole role, void* context, Record record );
+			const Use* find_use( const Pass& pass, BufferId buffer ) const;
+			Neighbour previous_use( size_t pass, BufferId buffer ) const;
+			Neighbour next_use( size_t pass, BufferId buffer ) const;
+			void add_wait( Batch& batch, vk::Semaphore semaphore, vk::PipelineStageFlags stages );
+			void record( size_t pass, vk::CommandBuffer cmd, Batch& batch );
+
+			vk::Device device;
+			const QueueManager& queues;
+
+			std::vector<BufferState> buffers;
+			std::vector<FrameResources> frames;
+			// Alternates between submissions, so a carried semaphore is waited on before it is signalled again
+			std::array<std::array<vk::UniqueSemaphore, max_buffers>, 2> carry_semas;
+			uint64_t submissions{ 0 };
+
+			FrameResources* frame{ nullptr };
+			FixedVector<Pass, max_passes> passes;
+			FixedVector<Batch, max_passes> batches;
+			// Semaphore between two batches of the current frame, indexed by producer and consumer
+			std::array<std::array<vk::Semaphore, max_passes>, max_passes> edges;
+	};
+}
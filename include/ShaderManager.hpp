@@ -0,0 +1,89 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  ShaderManager.hpp
+ *
+ *    Description:  Loads, caches and hot-reloads SPIR-V shader modules
+ *
+ *        Version:  1.0
+ *        Created:  10/19/2026 01:31:08 PM
+ *       Revision:  none
+ *
+ *         Author:  Samuel Knoethig (), samuel@knoethig.net
+ *
+ * =====================================================================================
+ */
+#pragma once
+
+#include <vulkan/vulkan.hpp>
+
+#include <filesystem>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "FileWatcher.hpp"
+#include "Task.hpp"
+
+namespace SpaceAppVideo {
+	/**
+	 *	Owns all shader modules. Modules are keyed by the hash of their SPIR-V code,
+	 *	so identical code is only turned into a module once.
+	 *	Shaders are addressed by their file name inside the shader directory
+	 */
+	class ShaderManager {
+		public:
+			/**
+			 *	Starts reading every SPIR-V file in directory on pool, which has to outlive the manager
+			 */
+			ShaderManager( std::filesystem::path directory, ThreadPool& pool );
+			// Waits for reads that were never asked for
+			~ShaderManager();
+
+			/**
+			 *	Has to be called before the first call to get
+			 */
+			void set_device( vk::Device device );
+
+			/**
+			 *	Returns the module currently associated with the file, loads it if necessary.
+			 *	The module stays valid as long as the manager lives
+			 */
+			vk::ShaderModule get( const std::string& name );
+
+			/**
+			 *	Watches the shader directory and calls on_reload from a background thread whenever
+			 *	a shader changed its content
+			 */
+			void watch( std::function<void()> on_reload );
+
+			/**
+			 *	Additionally watches the glsl sources and recompiles them into the shader directory on change
+			 */
+			void watch_sources( const std::filesystem::path& source_dir, const std::filesystem::path& compiler );
+
+		private:
+			static std::vector<char> read_file( const std::filesystem::path& path );
+			static Task<std::vector<char>> preload( ThreadPool& pool, std::filesystem::path path );
+			static void discard( Task<std::vector<char>>& task );
+			static uint64_t hash( const std::vector<char>& code );
+
+			/**
+			 *	Creates the module for the code, if necessary, and associates it with name. Returns true if the content changed
+			 */
+			bool load( const std::string& name, const std::vector<char>& code );
+
+			std::filesystem::path directory;
+			vk::Device device;
+
+			std::mutex mutex;
+			std::unordered_map<std::string, Task<std::vector<char>>> preloaded;
+			std::unordered_map<std::string, uint64_t> files;
+			std::unordered_map<uint64_t, vk::UniqueShaderModule> modules;
+
+			// Declared last, so the watcher thread is stopped before anything else gets destroyed
+			FileWatcher watcher;
+	};
+}
@@ -0,0 +1,154 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  Snapshot.hpp
+ *
+ *    Description:  Binary snapshot format of the simulation state for replays and save games
+ *
+ *        Version:  1.0
+ *        Created:  10/19/2026 07:12:55 PM
+ *       Revision:  none
+ *
+ *         Author:  Samuel Knoethig (), samuel@knoethig.net
+ *
+ * =====================================================================================
+ */
+#pragma once
+
+#include <array>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+namespace SpaceAppSim {
+	struct EntityState {
+		uint32_t id;
+		glm::vec3 position;
+		// Quaternion, xyzw
+		glm::vec4 orientation;
+		glm::vec3 velocity;
+		uint32_t flags;
+	};
+
+	struct SimulationState {
+		uint64_t tick{ 0 };
+		std::vector<EntityState> entities;
+	};
+
+	/**
+	 *	Fields are quantised before encoding: positions to 1/1024, velocities to 1/256 and
+	 *	orientation components to 1/32767. A state read back is the quantised state, not the recorded one.
+	 *	Values are stored as 32 bit integers, so positions saturate at about ±2.1 million units and
+	 *	velocities at about ±8.4 million
+	 */
+	namespace Quantisation {
+		constexpr float position{ 1024 };
+		constexpr float velocity{ 256 };
+		constexpr float orientation{ 32767 };
+	}
+
+	/**
+	 *	Snapshot streams consist of a header, a sequence of frames and an index of frame offsets.
+	 *	Every keyframe_interval-th frame is a keyframe, the frames in between store the XOR of their quantised
+	 *	fields with a prediction from the previous two frames. Each field is stored as its own bit packed column,
+	 *	either dense or as a bitmap of changed entries, so idle entities cost almost nothing. All integers are little endian
+	 */
+	class SnapshotWriter {
+		public:
+			static constexpr uint32_t default_keyframe_interval{ 64 };
+
+			SnapshotWriter( const std::filesystem::path& path, uint32_t keyframe_interval = default_keyframe_interval );
+			~SnapshotWriter();
+
+			void write( const SimulationState& state );
+			/**
+			 *	Writes the frame index. Streams without one, e.g. after a crash, can still be read
+			 */
+			void close();
+
+			size_t bytes_written() const;
+
+		private:
+			std::ofstream file;
+			uint32_t keyframe_interval;
+			uint32_t frames_since_keyframe{ 0 };
+			std::vector<uint64_t> offsets;
+			uint64_t offset{ 0 };
+			// Quantised columns of the last two frames since the last keyframe
+			std::vector<std::vector<uint32_t>> previous;
+			std::vector<std::vector<uint32_t>> before_previous;
+			std::vector<uint8_t> buffer;
+	};
+
+	/**
+	 *	Memory maps a snapshot stream. Reading the frames in order only decodes one frame each,
+	 *	seeking decodes from the closest keyframe before the target
+	 */
+	class SnapshotReader {
+		public:
+			explicit SnapshotReader( const std::filesystem::path& path );
+			~SnapshotReader();
+
+			SnapshotReader( const SnapshotReader& ) = delete;
+			SnapshotReader& operator=( const SnapshotReader& ) = delete;
+
+			size_t frame_count() const;
+			uint64_t tick( size_t frame ) const;
+			SimulationState read( size_t frame );
+
+		private:
+			struct Frame {
+				uint64_t offset;
+				uint64_t tick;
+				bool keyframe;
+			};
+
+			void decode( size_t frame );
+
+			const uint8_t* data{ nullptr };
+			size_t size{ 0 };
+			std::vector<Frame> frames;
+
+			// Columns of the last decoded frame and the two before it since its keyframe
+			size_t current{ SIZE_MAX };
+			std::vector<std::vector<uint32_t>> columns;
+			std::vector<std::vector<uint32_t>> before_previous;
+			std::vector<std::vector<uint32_t>> previous;
+	};
+
+	/**
+	 *	Writes states on a background thread, record() only copies the state
+	 */
+	class SnapshotRecorder {
+		public:
+			SnapshotRecorder( const std::filesystem::path& path, uint32_t keyframe_interval = SnapshotWriter::default_keyframe_interval );
+			~SnapshotRecorder();
+
+			void record( const SimulationState& state );
+
+		private:
+			void run();
+
+			SnapshotWriter writer;
+			std::mutex mutex;
+			std::condition_variable cv;
+			std::deque<SimulationState> queue;
+			// Recycled states, so recording does not allocate in the steady state
+			std::vector<SimulationState> spare;
+			bool stopping{ false };
+			std::thread thread;
+	};
+
+	/**
+	 *	Writes a single keyframe, used for save games
+	 */
+	void save_snapshot( const std::filesystem::path& path, const SimulationState& state );
+	SimulationState load_snapshot( const std::filesystem::path& path );
+}
@@ -0,0 +1,158 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  Starfield.hpp
+ *
+ *    Description:  Procedural star and nebula background with an on disk sector cache
+ *
+ *        Version:  1.0
+ *        Created:  10/19/2026 05:02:41 PM
+ *       Revision:  none
+ *
+ *         Author:  Samuel Knoethig (), samuel@knoethig.net
+ *
+ * =====================================================================================
+ */
+#pragma once
+
+#include <vulkan/vulkan.hpp>
+
+#include <filesystem>
+#include <future>
+#include <map>
+#include <set>
+#include <span>
+#include <tuple>
+#include <vector>
+
+#include "AppGraphics.hpp"
+#include "ShaderManager.hpp"
+
+namespace SpaceAppVideo {
+	/**
+	 *	One entry of a star catalog, also used as per instance vertex data
+	 */
+	struct Star {
+		// Relative to the sector origin
+		glm::vec3 position;
+		uint8_t color[3];
+		// Absolute magnitude quantised to 7 bits. If the top bit is set this is a nebula cloud and the low bits are its radius
+		uint8_t magnitude;
+	};
+	static_assert( sizeof( Star ) == 16 );
+
+	using SectorCoord = glm::ivec3;
+
+	struct SectorCoordLess {
+		bool operator()( const SectorCoord& a, const SectorCoord& b ) const {
+			return std::tie( a.x, a.y, a.z ) < std::tie( b.x, b.y, b.z );
+		}
+	};
+
+	/**
+	 *	Star catalog of a single sector, memory mapped from the cache directory. A sector is split into
+	 *	chunks_per_axis³ chunks, the stars of each chunk are stored contiguously
+	 */
+	class StarCatalog {
+		public:
+			static constexpr float sector_size{ 4096 };
+			static constexpr uint32_t chunks_per_axis{ 4 };
+			static constexpr uint32_t chunk_count{ chunks_per_axis * chunks_per_axis * chunks_per_axis };
+			static constexpr float chunk_size{ sector_size / chunks_per_axis };
+
+			struct Chunk {
+				uint32_t first;
+				uint32_t count;
+				glm::vec3 min;
+				glm::vec3 max;
+			};
+
+			/**
+			 *	Maps the cached catalog of the sector, generating and writing it first if there is no valid one.
+			 *	Generation is deterministic in seed and sector and runs in parallel over chunks
+			 */
+			static StarCatalog load( const std::filesystem::path& cache_dir, uint64_t seed, SectorCoord sector );
+
+			StarCatalog( StarCatalog&& other );
+			StarCatalog& operator=( StarCatalog&& other );
+			~StarCatalog();
+
+			std::span<const Chunk> chunks() const;
+			std::span<const Star> stars() const;
+			SectorCoord sector() const;
+
+		private:
+			StarCatalog() = default;
+			bool map( const std::filesystem::path& file, uint64_t seed, SectorCoord sector );
+			void unmap();
+
+			void* data{ nullptr };
+			size_t size{ 0 };
+	};
+
+	/**
+	 *	Keeps the catalogs of all sectors around the camera resident on the GPU and draws them as camera relative
+	 *	billboards, one instanced draw per chunk inside the view frustum. Sectors one ring further out are generated
+	 *	into the cache in the background, so crossing a sector boundary only maps files that already exist
+	 */
+	class Starfield {
+		public:
+			// Sectors up to this distance from the camera sector are drawn
+			static constexpr int resident_radius{ 1 };
+			// Sectors up to this distance are generated ahead of time
+			static constexpr int prefetch_radius{ 2 };
+			// Maximum number of sectors loaded at the same time, every load itself runs on several threads
+			static constexpr size_t max_pending_loads{ 2 };
+
+			Starfield( vk::PhysicalDevice phys_dev, vk::Device device, ShaderManager& shaders, vk::PipelineCache cache,
+					std::filesystem::path cache_dir, uint64_t seed );
+			~Starfield();
+
+			/**
+			 *	(Re)creates the pipeline used by record_draw, has to be called whenever the render pass changes
+			 */
+			void create_render_pipeline( vk::RenderPass render_pass );
+
+			/**
+			 *	Starts loads around the camera and uploads finished ones. Has to be called once per frame
+			 *	after the fence of the frame was waited on
+			 */
+			void update( const Camera& camera );
+
+			/**
+			 *	Records the draws of all visible chunks, has to be inside the render pass
+			 */
+			void record_draw( vk::CommandBuffer cmd, const Camera& camera, vk::Extent2D extent );
+
+		private:
+			struct ResidentSector {
+				SectorCoord coord;
+				std::vector<StarCatalog::Chunk> chunks;
+				Buffer stars;
+			};
+
+			struct RetiredBuffer {
+				Buffer buffer;
+				uint64_t frame;
+			};
+
+			void upload( const StarCatalog& catalog );
+
+			vk::PhysicalDevice phys_dev;
+			vk::Device device;
+			ShaderManager& shaders;
+			vk::PipelineCache cache;
+			std::filesystem::path cache_dir;
+			uint64_t seed;
+
+			vk::UniquePipelineLayout layout;
+			vk::UniquePipeline pipeline;
+
+			std::vector<ResidentSector> resident;
+			std::vector<RetiredBuffer> retired;
+			std::map<SectorCoord, std::future<StarCatalog>, SectorCoordLess> pending;
+			// Sectors known to be in the cache directory
+			std::set<SectorCoord, SectorCoordLess> cached;
+			uint64_t frame{ 0 };
+	};
+}
@@ -0,0 +1,67 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  StartupTracer.hpp
+ *
+ *    Description:  Records the wall time of the phases between process start and the first frame
+ *
+ *        Version:  1.0
+ *        Created:  10/19/2026 12:14:03 PM
+ *       Revision:  none
+ *
+ *         Author:  Samuel Knoethig (), samuel@knoethig.net
+ *
+ * =====================================================================================
+ */
+#pragma once
+
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ *	Thread safe recorder for startup phases.
+ *	Phases are opened with trace() and closed when the returned scope is destroyed
+ */
+class StartupTracer {
+	public:
+		using Clock = std::chrono::steady_clock;
+
+		struct Phase {
+			std::string name;
+			Clock::time_point start;
+			Clock::time_point end;
+			std::thread::id thread;
+		};
+
+		class Scope {
+			public:
+				Scope( StartupTracer& tracer, size_t index );
+				Scope( const Scope& ) = delete;
+				Scope& operator=( const Scope& ) = delete;
+				~Scope();
+
+			private:
+				StartupTracer& tracer;
+				size_t index;
+		};
+
+		[[nodiscard]] Scope trace( std::string name );
+
+		/**
+		 *	Logs all recorded phases relative to the construction of the tracer, only the first call has an effect
+		 */
+		void report();
+
+	private:
+		void finish( size_t index );
+
+		std::mutex phases_mutex;
+		std::vector<Phase> phases;
+		Clock::time_point origin{ Clock::now() };
+		bool reported{ false };
+};
+
+extern StartupTracer startup_tracer;
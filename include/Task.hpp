@@ -0,0 +1,388 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  Task.hpp
+ *
+ *    Description:  Coroutine tasks and awaitables for thread pool hops, file reads and gpu completion
+ *
+ *        Version:  1.0
+ *        Created:  10/20/2026 07:14:52 AM
+ *       Revision:  none
+ *
+ *         Author:  Samuel Knoethig (), samuel@knoethig.net
+ *
+ * =====================================================================================
+ */
+#pragma once
+
+#include <vulkan/vulkan.hpp>
+
+#include <atomic>
+#include <condition_variable>
+#include <coroutine>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <filesystem>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <variant>
+#include <vector>
+
+namespace SpaceAppVideo {
+	template <typename T = void>
+	class Task;
+
+	namespace detail {
+		class PromiseBase {
+			public:
+				// Lazy, nothing runs before the task is started or awaited
+				std::suspend_always initial_suspend() noexcept { return {}; }
+
+				auto final_suspend() noexcept {
+					return FinalAwaiter{};
+				}
+
+				/**
+				 *	Registers the coroutine resumed on completion. Returns false if the task completed already
+				 */
+				bool set_continuation( std::coroutine_handle<> continuation ){
+					uintptr_t expected = nobody;
+					return state.compare_exchange_strong( expected, reinterpret_cast<uintptr_t>( continuation.address() ), std::memory_order_acq_rel );
+				}
+
+				bool completed_already() const {
+					return state.load( std::memory_order_acquire ) == completed;
+				}
+
+			private:
+				static constexpr uintptr_t nobody{ 0 };
+				static constexpr uintptr_t completed{ 1 };
+
+				struct FinalAwaiter {
+					bool await_ready() noexcept { return false; }
+					template <typename P>
+					std::coroutine_handle<> await_suspend( std::coroutine_handle<P> handle ) noexcept {
+						// Whoever awaits the task may have arrived while it ran on another thread
+						auto waiter = static_cast<PromiseBase&>( handle.promise() ).state.exchange( completed, std::memory_order_acq_rel );
+						if( waiter != nobody )
+							return std::coroutine_handle<>::from_address( reinterpret_cast<void*>( waiter ));
+						return std::noop_coroutine();
+					}
+					void await_resume() noexcept {}
+				};
+
+				// nobody, completed or the address of the awaiting coroutine
+				std::atomic<uintptr_t> state{ nobody };
+		};
+
+		template <typename T>
+		class Promise: public PromiseBase {
+			public:
+				Task<T> get_return_object();
+
+				template <typename U>
+				void return_value( U&& value ){
+					result.template emplace<1>( std::forward<U>( value ));
+				}
+
+				void unhandled_exception(){
+					result.template emplace<2>( std::current_exception() );
+				}
+
+				T take(){
+					if( result.index() == 2 )
+						std::rethrow_exception( std::get<2>( result ));
+					return std::move( std::get<1>( result ));
+				}
+
+			private:
+				std::variant<std::monostate, T, std::exception_ptr> result;
+		};
+
+		template <>
+		class Promise<void>: public PromiseBase {
+			public:
+				Task<void> get_return_object();
+
+				void return_void(){}
+
+				void unhandled_exception(){
+					exception = std::current_exception();
+				}
+
+				void take(){
+					if( exception )
+						std::rethrow_exception( exception );
+				}
+
+			private:
+				std::exception_ptr exception;
+		};
+
+		/**
+		 *	Starts running right away and frees itself once done
+		 */
+		struct Detached {
+			struct promise_type {
+				Detached get_return_object(){ return {}; }
+				std::suspend_never initial_suspend() noexcept { return {}; }
+				std::suspend_never final_suspend() noexcept { return {}; }
+				void return_void(){}
+				void unhandled_exception(){ std::terminate(); }
+			};
+		};
+	}
+
+	/**
+	 *	Result of a coroutine, which is run by co_await-ing the task from another coroutine or by sync_wait.
+	 *	start() runs it up to its first suspension right away, so several tasks can overlap before they are
+	 *	awaited. Exceptions are rethrown to whoever awaits the task.
+	 *	A task has to be awaited exactly once and a started task must not be destroyed before it completed
+	 */
+	template <typename T>
+	class Task {
+		public:
+			using promise_type = detail::Promise<T>;
+
+			Task() = default;
+			explicit Task( std::coroutine_handle<promise_type> handle ): handle( handle ){}
+			Task( Task&& other ) noexcept: handle( std::exchange( other.handle, {} )), started( other.started ){}
+			Task& operator=( Task&& other ) noexcept {
+				if( this != &other ){
+					if( handle )
+						handle.destroy();
+					handle = std::exchange( other.handle, {} );
+					started = other.started;
+				}
+				return *this;
+			}
+			~Task(){
+				if( handle )
+					handle.destroy();
+			}
+
+			Task( const Task& ) = delete;
+			Task& operator=( const Task& ) = delete;
+
+			bool valid() const {
+				return static_cast<bool>( handle );
+			}
+
+			/**
+			 *	Runs the coroutine on the calling thread until it first suspends, usually by hopping to a thread pool
+			 */
+			void start(){
+				if( !started ){
+					started = true;
+					handle.resume();
+				}
+			}
+
+			/**
+			 *	Awaits completion without taking the result
+			 */
+			auto ready(){
+				struct Awaiter {
+					Task& task;
+					bool await_ready(){ return task.started && task.handle.promise().completed_already(); }
+					std::coroutine_handle<> await_suspend( std::coroutine_handle<> awaiting ){ return task.suspend( awaiting ); }
+					void await_resume(){}
+				};
+				return Awaiter{ *this };
+			}
+
+			auto operator co_await() & {
+				struct Awaiter {
+					Task& task;
+					bool await_ready(){ return task.started && task.handle.promise().completed_already(); }
+					std::coroutine_handle<> await_suspend( std::coroutine_handle<> awaiting ){ return task.suspend( awaiting ); }
+					T await_resume(){ return task.handle.promise().take(); }
+				};
+				return Awaiter{ *this };
+			}
+
+			auto operator co_await() && {
+				return operator co_await();
+			}
+
+			/**
+			 *	Only valid once the task completed
+			 */
+			T result(){
+				return handle.promise().take();
+			}
+
+		private:
+			std::coroutine_handle<> suspend( std::coroutine_handle<> awaiting ){
+				if( !started ){
+					// Nobody else knows the task yet, it continues with awaiting once done
+					started = true;
+					handle.promise().set_continuation( awaiting );
+					return handle;
+				}
+
+				if( handle.promise().set_continuation( awaiting ))
+					return std::noop_coroutine();
+				return awaiting;
+			}
+
+			std::coroutine_handle<promise_type> handle;
+			bool started{ false };
+	};
+
+	namespace detail {
+		template <typename T>
+		Task<T> Promise<T>::get_return_object(){
+			return Task<T>( std::coroutine_handle<Promise<T>>::from_promise( *this ));
+		}
+
+		inline Task<void> Promise<void>::get_return_object(){
+			return Task<void>( std::coroutine_handle<Promise<void>>::from_promise( *this ));
+		}
+	}
+
+	/**
+	 *	Blocks the calling thread until task completed and returns its result. Meant for the edges of the
+	 *	program, where blocking code has to wait for a loading chain
+	 */
+	template <typename T>
+	T sync_wait( Task<T>& task ){
+		struct Signal {
+			std::mutex mutex;
+			std::condition_variable cv;
+			bool done{ false };
+		} signal;
+
+		[]( Task<T>& task, Signal& signal ) -> detail::Detached {
+			co_await task.ready();
+			// Notified under the lock, so signal outlives the notification
+			std::scoped_lock lock( signal.mutex );
+			signal.done = true;
+			signal.cv.notify_one();
+		}( task, signal );
+
+		std::unique_lock lock( signal.mutex );
+		signal.cv.wait( lock, [&]{ return signal.done; });
+		lock.unlock();
+
+		return task.result();
+	}
+
+	template <typename T>
+	T sync_wait( Task<T>&& task ){
+		return sync_wait( task );
+	}
+
+	/**
+	 *	Fixed number of worker threads resuming coroutines in the order they were scheduled
+	 */
+	class ThreadPool {
+		public:
+			explicit ThreadPool( size_t threads = std::max( 2u, std::thread::hardware_concurrency() ) - 1 );
+			// Finishes every scheduled coroutine first
+			~ThreadPool();
+
+			ThreadPool( const ThreadPool& ) = delete;
+			ThreadPool& operator=( const ThreadPool& ) = delete;
+
+			/**
+			 *	co_await-ing it continues the coroutine on one of the workers
+			 */
+			auto schedule(){
+				struct Awaiter {
+					ThreadPool& pool;
+					bool await_ready(){ return false; }
+					void await_suspend( std::coroutine_handle<> handle ){ pool.post( handle ); }
+					void await_resume(){}
+				};
+				return Awaiter{ *this };
+			}
+
+			void post( std::coroutine_handle<> handle );
+			size_t size() const;
+
+		private:
+			void run();
+
+			std::mutex mutex;
+			std::condition_variable cv;
+			std::deque<std::coroutine_handle<>> queue;
+			bool stopping{ false };
+			std::vector<std::thread> threads;
+	};
+
+	/**
+	 *	Resumes coroutines on a thread pool once a fence or a timeline semaphore value is signalled.
+	 *	One background thread polls everything waited on and sleeps in the driver while nothing is ready
+	 */
+	class GpuWaiter {
+		public:
+			GpuWaiter( vk::Device device, ThreadPool& pool );
+			// Waits for everything still pending, the device has to outlive it
+			~GpuWaiter();
+
+			GpuWaiter( const GpuWaiter& ) = delete;
+			GpuWaiter& operator=( const GpuWaiter& ) = delete;
+
+			/**
+			 *	co_await-ing it continues the coroutine on the pool once fence is signalled
+			 */
+			auto wait( vk::Fence fence ){
+				return Awaiter{ *this, { fence, {}, 0, {} }};
+			}
+
+			/**
+			 *	Same for a timeline semaphore reaching value, the device needs the timelineSemaphore feature
+			 */
+			auto wait( vk::Semaphore timeline, uint64_t value ){
+				return Awaiter{ *this, { {}, timeline, value, {} }};
+			}
+
+		private:
+			struct Pending {
+				vk::Fence fence;
+				vk::Semaphore semaphore;
+				uint64_t value;
+				std::coroutine_handle<> handle;
+			};
+
+			struct Awaiter {
+				GpuWaiter& waiter;
+				Pending pending;
+
+				bool await_ready(){ return waiter.signalled( pending ); }
+				void await_suspend( std::coroutine_handle<> handle ){
+					pending.handle = handle;
+					waiter.add( pending );
+				}
+				void await_resume(){}
+			};
+
+			bool signalled( const Pending& pending ) const;
+			void add( const Pending& pending );
+			void run();
+
+			vk::Device device;
+			ThreadPool& pool;
+
+			std::mutex mutex;
+			std::condition_variable cv;
+			std::vector<Pending> added;
+			bool stopping{ false };
+
+			// Only touched by the waiting thread
+			std::vector<Pending> pending;
+			std::vector<vk::Fence> fences;
+			std::vector<vk::Semaphore> semaphores;
+			std::vector<uint64_t> values;
+
+			std::thread thread;
+	};
+
+	/**
+	 *	Reads the whole file on one of pool's workers, the awaiting coroutine continues there
+	 */
+	Task<std::vector<char>> read_file( ThreadPool& pool, std::filesystem::path path );
+}
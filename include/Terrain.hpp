@@ -0,0 +1,215 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  Terrain.hpp
+ *
+ *    Description:  Planet surface as a cube-sphere quadtree with continuous distance dependent lod
+ *
+ *        Version:  1.0
+ *        Created:  10/20/2026 04:41:27 AM
+ *       Revision:  none
+ *
+ *         Author:  Samuel Knoethig (), samuel@knoethig.net
+ *
+ * =====================================================================================
+ */
+#pragma once
+
+#include <vulkan/vulkan.hpp>
+
+#include <array>
+#include <vector>
+
+#include "AppGraphics.hpp"
+#include "ShaderManager.hpp"
+
+namespace SpaceAppVideo {
+	struct Planet {
+		glm::dvec3 center;
+		double radius;
+		// Heights lie between 0 and this above the radius
+		float max_height;
+		uint32_t seed;
+	};
+
+	/**
+	 *	One drawn quadtree node, std430 layout. Has to match Patch in terrain.vert.glsl
+	 */
+	struct TerrainPatch {
+		// Relative to the camera
+		glm::vec3 center;
+		float morph_start;
+		// Unit vector from the planet center to center
+		glm::vec3 direction;
+		float morph_end;
+		// Cube face axes scaled to the patch and divided by the length of its cube space center
+		glm::vec3 axis_u;
+		// Part of the tile covered by the patch, less than 1 if the tile is an ancestor's
+		float tile_scale;
+		glm::vec3 axis_v;
+		uint32_t tile;
+		glm::vec2 tile_offset;
+		// 1 for a quadrant drawn at the lod of its parent, its vertices are snapped to the parent's grid
+		uint32_t shift;
+		float padding;
+	};
+	static_assert( sizeof( TerrainPatch ) == 80 );
+
+	/**
+	 *	Each face of a cube projected onto the sphere is the root of a quadtree. Every frame the tree is walked per view
+	 *	and nodes are selected by distance (CDLOD): a node within the range of its lod is split into its children, a
+	 *	child out of its range is drawn as a quadrant of its parent. All selected nodes are one instanced draw of the
+	 *	same grid, whose vertices morph towards the next coarser grid over the last third of the lod range, so there
+	 *	are neither seams nor pops.
+	 *
+	 *	Heights come from a compute pass evaluating noise on the sphere into tiles of a fixed pool. Tiles are looked
+	 *	up through a fixed size hash and replaced least recently used first. A node without a tile samples the part of
+	 *	its finest resident ancestor covering it and requests the next finer tile along the way, at most max_generated
+	 *	per frame. The six root tiles never leave the pool. Memory use does not depend on the planet's size
+	 */
+	class Terrain {
+		public:
+			// Grid cells per patch side, has to match the shaders
+			static constexpr uint32_t grid_size{ 32 };
+			static constexpr uint32_t tile_samples{ ( grid_size + 1 ) * ( grid_size + 1 )};
+			static constexpr uint32_t max_tiles{ 4096 };
+			// Tiles generated per frame at most
+			static constexpr uint32_t max_generated{ 64 };
+			// Patches drawn per view at most
+			static constexpr uint32_t max_patches{ 2048 };
+			static constexpr uint32_t max_views{ 4 };
+			// Deeper levels would need more than float precision for the cube coordinates in the shaders
+			static constexpr uint32_t max_depth{ 17 };
+			// Leaves are not split below this sample spacing in metres
+			static constexpr double min_spacing{ 1 };
+			// Range of the finest lod in leaf sizes, every coarser lod doubles it
+			static constexpr double lod_range{ 3 };
+			// Vertices start to morph at this fraction of the way from the previous lod's range to their own
+			static constexpr double morph_ratio{ 0.66 };
+
+			Terrain( vk::PhysicalDevice phys_dev, vk::Device device, ShaderManager& shaders, vk::PipelineCache cache, const Planet& planet );
+
+			/**
+			 *	(Re)creates the pipeline used by record_draw, has to be called whenever the render pass changes
+			 */
+			void create_render_pipeline( vk::RenderPass render_pass );
+
+			/**
+			 *	The tile pool, written by record_generation and read by record_draw
+			 */
+			vk::Buffer buffer() const;
+
+			/**
+			 *	Has to be called once frame's fence was waited on, before any select of the frame
+			 */
+			void begin_frame( size_t frame );
+
+			/**
+			 *	Selects the patches the view_index'th view draws this frame and requests the tiles they miss
+			 */
+			void select( size_t frame, uint32_t view_index, const Camera& camera, vk::Extent2D extent );
+
+			/**
+			 *	Generates the tiles requested this frame, outside of a render pass and before record_draw
+			 */
+			void record_generation( vk::CommandBuffer cmd, size_t frame );
+
+			/**
+			 *	Draws the patches selected for the view, has to be inside the render pass
+			 */
+			void record_draw( vk::CommandBuffer cmd, size_t frame, uint32_t view_index, const Camera& camera, vk::Extent2D extent );
+
+			uint32_t patch_count( uint32_t view_index ) const;
+
+		private:
+			struct Node {
+				uint32_t face;
+				uint32_t level;
+				uint32_t x;
+				uint32_t y;
+			};
+
+			struct TileJob {
+				// Face in the low byte, level above it
+				uint32_t face_level;
+				uint32_t x;
+				uint32_t y;
+				uint32_t slot;
+			};
+
+			struct HashEntry {
+				uint64_t key;
+				uint32_t slot;
+			};
+
+			struct Selection {
+				std::array<glm::vec4, 4> planes;
+				glm::dvec3 camera;
+				TerrainPatch* patches;
+				uint32_t count;
+			};
+
+			static constexpr uint32_t root_count{ 6 };
+			static constexpr uint32_t hash_size{ max_tiles * 2 };
+			static constexpr uint64_t empty_key{ UINT64_MAX };
+			static constexpr uint32_t no_slot{ UINT32_MAX };
+
+			static uint64_t key( const Node& node );
+
+			bool select_node( Selection& s, const Node& node );
+			void add_patch( Selection& s, const Node& node, uint32_t lod, uint32_t shift );
+			void bounds( const Node& node, const glm::dvec3& camera, glm::dvec3& min, glm::dvec3& max ) const;
+			glm::mat4 view_proj( const Camera& camera, vk::Extent2D extent ) const;
+
+			uint32_t find_tile( uint64_t key ) const;
+			uint32_t allocate_tile( const Node& node );
+			void touch( uint32_t slot );
+			void unlink( uint32_t slot );
+			void hash_insert( uint64_t key, uint32_t slot );
+			void hash_erase( uint64_t key );
+
+			void create_descriptors();
+			void create_generate_pipeline( vk::PipelineCache cache );
+
+			vk::PhysicalDevice phys_dev;
+			vk::Device device;
+			ShaderManager& shaders;
+			vk::PipelineCache cache;
+			Planet planet;
+
+			uint32_t depth;
+			// Distance up to which each lod is drawn and where its vertices start morphing, 0 is the finest
+			std::array<double, max_depth + 1> ranges;
+			std::array<double, max_depth + 1> morph_starts;
+
+			uint64_t frame_counter{ 0 };
+			std::array<uint32_t, max_views> patch_counts{};
+			TileJob* jobs{ nullptr };
+			uint32_t job_count{ 0 };
+
+			// Residency, nothing of it allocates after construction
+			std::vector<HashEntry> hash;
+			std::vector<uint64_t> tile_keys;
+			std::vector<uint64_t> tile_used;
+			// Least recently used list through the slots, max_tiles is its head. Root tiles are never part of it
+			std::vector<uint32_t> lru_prev;
+			std::vector<uint32_t> lru_next;
+			uint32_t unused_tiles{ root_count };
+
+			Buffer tiles;
+			// Per frame in flight and view, host visible
+			Buffer patches;
+			// Per frame in flight, host visible
+			Buffer job_buffer;
+			Buffer indices;
+
+			vk::UniqueDescriptorSetLayout descriptor_layout;
+			vk::UniqueDescriptorPool descriptor_pool;
+			vk::DescriptorSet descriptors;
+
+			vk::UniquePipelineLayout generate_layout;
+			vk::UniquePipeline generate_pipeline;
+			vk::UniquePipelineLayout draw_layout;
+			vk::UniquePipeline draw_pipeline;
+	};
+}
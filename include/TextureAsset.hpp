@@ -0,0 +1,102 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  TextureAsset.hpp
+ *
+ *    Description:  Block compressed texture files with precomputed mip chains
+ *
+ *        Version:  1.0
+ *        Created:  10/20/2026 02:13:40 AM
+ *       Revision:  none
+ *
+ *         Author:  Samuel Knoethig (), samuel@knoethig.net
+ *
+ * =====================================================================================
+ */
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <span>
+#include <vector>
+
+namespace SpaceAppVideo {
+	/**
+	 *	BC7:	RGBA colour, optionally sRGB
+	 *	BC5:	two channels, tangent space normals without z
+	 *	BC4:	one channel, masks and height maps
+	 */
+	enum class TextureCodec : uint32_t {
+		BC7,
+		BC5,
+		BC4,
+	};
+
+	/**
+	 *	Bytes per 4x4 block
+	 */
+	uint32_t block_bytes( TextureCodec codec );
+
+	struct TextureHeader {
+		char magic[4];
+		uint32_t version;
+		TextureCodec codec;
+		uint32_t srgb;
+		uint32_t width;
+		uint32_t height;
+		uint32_t mip_count;
+		uint32_t padding;
+	};
+	static_assert( sizeof( TextureHeader ) == 32 );
+
+	struct MipEntry {
+		// From the start of the file, page aligned
+		uint64_t offset;
+		uint64_t size;
+		uint32_t width;
+		uint32_t height;
+	};
+	static_assert( sizeof( MipEntry ) == 24 );
+
+	/**
+	 *	A header, a table of mip_count entries and the blocks of every mip, finest first, each starting on
+	 *	its own page so it can be faulted in or dropped on its own. Blocks are stored row by row, tightly
+	 *	packed like buffer to image copies expect them. All integers are little endian
+	 */
+	class TextureAsset {
+		public:
+			static constexpr uint32_t version{ 1 };
+			static constexpr uint64_t page_size{ 4096 };
+			static constexpr uint32_t max_mips{ 16 };
+
+			explicit TextureAsset( const std::filesystem::path& path );
+			TextureAsset( TextureAsset&& other );
+			TextureAsset& operator=( TextureAsset&& other );
+			~TextureAsset();
+
+			const TextureHeader& header() const;
+			const MipEntry& mip( uint32_t level ) const;
+			std::span<const uint8_t> data( uint32_t level ) const;
+			/**
+			 *	Asks the kernel to start reading the mip in, so copying it later does not block on the disk
+			 */
+			void prefetch( uint32_t level ) const;
+
+		private:
+			void unmap();
+
+			const uint8_t* mapping{ nullptr };
+			size_t size{ 0 };
+	};
+
+	struct MipData {
+		uint32_t width;
+		uint32_t height;
+		std::vector<uint8_t> blocks;
+	};
+
+	/**
+	 *	Writes mips, finest first, through a temporary file, so readers never see a partial asset
+	 */
+	void write_texture_asset( const std::filesystem::path& path, TextureCodec codec, bool srgb, std::span<const MipData> mips );
+}
@@ -0,0 +1,209 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  TextureStreamer.hpp
+ *
+ *    Description:  Sampled textures streamed mip by mip into a fixed video memory budget
+ *
+ *        Version:  1.0
+ *        Created:  10/20/2026 03:20:05 AM
+ *       Revision:  none
+ *
+ *         Author:  Samuel Knoethig (), samuel@knoethig.net
+ *
+ * =====================================================================================
+ */
+#pragma once
+
+#include <vulkan/vulkan.hpp>
+
+#include <array>
+#include <filesystem>
+#include <vector>
+
+#include "AppGraphics.hpp"
+#include "Metrics.hpp"
+#include "TextureAsset.hpp"
+
+namespace SpaceAppVideo {
+	/**
+	 *	Owns every sampled texture. Textures are memory mapped assets, their coarsest mips are always resident
+	 *	and finer ones are uploaded through a staging buffer once requested, coarse to fine and a bounded number
+	 *	of bytes per frame. Until a mip arrived the texture's sampler clamps the minimum lod to the finest
+	 *	resident one, so nothing ever samples missing data.
+	 *
+	 *	With sparse residency only resident mips are backed by memory. Pages come from a pool that never grows
+	 *	beyond the budget, when it runs dry the finest mips of the least recently requested textures are evicted.
+	 *	Without it whole mip chains are allocated when a texture is loaded and nothing is evicted.
+	 *
+	 *	Every texture is element id of the combined image sampler array at binding 0 of descriptor_set(),
+	 *	elements without a texture hold a black placeholder
+	 */
+	class TextureStreamer {
+		public:
+			static constexpr uint32_t max_textures{ 256 };
+			// Bytes uploaded per frame at most, mips larger than this arrive over several frames
+			static constexpr vk::DeviceSize staging_size{ 32 << 20 };
+			// Mips up to this size in either dimension are loaded with the texture and never evicted
+			static constexpr uint32_t resident_size{ 128 };
+			// Textures not requested for this many frames only keep their resident mips
+			static constexpr uint64_t request_frames{ 120 };
+			static constexpr uint32_t pages_per_block{ 256 };
+
+			using TextureId = uint32_t;
+
+			/**
+			 *	Whether sparse residency can be used with queue_family, the features have to be enabled on the device
+			 */
+			static bool sparse_supported( vk::PhysicalDevice phys_dev, uint32_t queue_family );
+
+			/**
+			 *	Textures are sampled by queues of sample_family and uploaded by a queue of upload_family. bind_queue has to
+			 *	support sparse binding if sparse is set. budget is the most device memory in bytes used for textures
+			 */
+			TextureStreamer( vk::PhysicalDevice phys_dev, vk::Device device, vk::Queue bind_queue, uint32_t sample_family,
+					uint32_t upload_family, bool sparse, vk::DeviceSize budget );
+
+			TextureStreamer( const TextureStreamer& ) = delete;
+			TextureStreamer& operator=( const TextureStreamer& ) = delete;
+
+			/**
+			 *	Maps the asset and creates its image, the resident mips follow with the next frames. Allocates
+			 */
+			TextureId load( const std::filesystem::path& path );
+
+			/**
+			 *	The finest mip of id needed this frame, called before begin_frame
+			 */
+			void request( TextureId id, uint32_t mip );
+			uint32_t resident_mip( TextureId id ) const;
+			uint32_t mip_count( TextureId id ) const;
+			vk::DeviceSize allocated_bytes() const;
+
+			vk::DescriptorSetLayout set_layout() const;
+			vk::DescriptorSet descriptor_set( size_t frame ) const;
+
+			/**
+			 *	Chooses this frame's uploads and evictions, copies the data to staging and updates the descriptor set of frame.
+			 *	Has to be called once frame's fence was waited on. Returns a semaphore record_uploads has to wait for at the
+			 *	transfer stage if memory was bound, a null handle otherwise
+			 */
+			vk::Semaphore begin_frame( size_t frame );
+
+			/**
+			 *	Records the copies chosen by begin_frame, before any draw of the frame samples a texture
+			 */
+			void record_uploads( vk::CommandBuffer cmd, size_t frame );
+			/**
+			 *	For the submission of record_uploads to signal if the draws are on another queue, they wait for it before sampling
+			 */
+			vk::Semaphore uploads_done( size_t frame ) const;
+
+		private:
+			struct Page {
+				uint32_t block;
+				uint32_t index;
+			};
+
+			struct Texture {
+				TextureAsset asset;
+				vk::Format format;
+				vk::UniqueImage image;
+				vk::UniqueImageView view;
+				// The whole image without sparse residency, only the mip tail with it
+				vk::UniqueDeviceMemory memory;
+				vk::SparseMemoryBind tail_bind;
+				bool sparse;
+				vk::Extent3D granularity;
+				// Mips from here on are part of the mip tail, which is bound as a whole
+				uint32_t tail_first;
+				// Mips from here on are never evicted
+				uint32_t resident_first;
+
+				// Finest mip that can be sampled, mip_count while there is none
+				uint32_t resident;
+				// Block rows of mip resident - 1 uploaded so far
+				uint32_t rows_uploaded{ 0 };
+				bool initialised{ false };
+				std::array<std::vector<Page>, TextureAsset::max_mips> pages;
+				// Frame counter a mip was evicted at, its pages are released once no frame in flight can sample it
+				std::array<uint64_t, TextureAsset::max_mips> evicted_at{};
+
+				uint32_t requested;
+				uint64_t requested_at{ 0 };
+				std::array<bool, MAX_FRAMES_IN_FLIGHT> stale;
+			};
+
+			struct Upload {
+				TextureId texture;
+				uint32_t mip;
+				uint32_t first_row;
+				uint32_t rows;
+				vk::DeviceSize offset;
+				bool initialise;
+			};
+
+			uint32_t target_mip( const Texture& t ) const;
+			bool needs_pages( const Texture& t, uint32_t mip ) const;
+			uint32_t tile_count( const Texture& t, uint32_t mip ) const;
+			bool bind_mip( TextureId id, uint32_t mip );
+			void unbind_mip( TextureId id, uint32_t mip );
+			void release_evicted();
+			void evict_for( TextureId id, uint32_t pages_needed );
+			void schedule_uploads( size_t frame );
+			void update_descriptors( size_t frame );
+			void add_image_bind( vk::Image image, const vk::SparseImageMemoryBind& bind );
+			void create_descriptors();
+
+			vk::PhysicalDevice phys_dev;
+			vk::Device device;
+			vk::Queue bind_queue;
+			// Both families share every image, so uploads need no ownership transfers
+			std::vector<uint32_t> queue_families;
+			// Where the upload queue's barriers end, a queue without graphics support leaves sampling to the semaphore
+			vk::PipelineStageFlags sampled_stages;
+			vk::AccessFlags sampled_access;
+			bool sparse;
+			vk::DeviceSize budget;
+			vk::DeviceSize allocated{ 0 };
+			uint64_t frame_counter{ 0 };
+
+			Metrics::Counter uploaded_metric;
+			Metrics::Gauge allocated_metric;
+
+			// One per lod, the minimum lod is how finer mips are hidden until they arrive
+			std::array<vk::UniqueSampler, TextureAsset::max_mips> samplers;
+
+			// Sparse pages, allocated in blocks up to the budget
+			vk::DeviceSize page_size{ 0 };
+			uint32_t page_memory_type{ 0 };
+			std::vector<vk::UniqueDeviceMemory> page_blocks;
+			std::vector<Page> free_pages;
+
+			std::vector<Texture> textures;
+
+			// Binds of the current frame, reserved for every page of the budget
+			std::vector<vk::SparseImageMemoryBind> image_binds;
+			std::vector<vk::SparseImageMemoryBindInfo> image_bind_infos;
+			std::vector<uint32_t> image_bind_first;
+			std::vector<vk::SparseImageOpaqueMemoryBindInfo> tail_binds;
+			std::array<vk::UniqueSemaphore, MAX_FRAMES_IN_FLIGHT> bind_semaphores;
+			std::array<vk::UniqueSemaphore, MAX_FRAMES_IN_FLIGHT> upload_semaphores;
+
+			std::array<Buffer, MAX_FRAMES_IN_FLIGHT> staging;
+			std::vector<Upload> uploads;
+			std::vector<TextureId> order;
+			std::vector<vk::ImageMemoryBarrier> barriers;
+			std::vector<vk::DescriptorImageInfo> image_infos;
+			std::vector<vk::WriteDescriptorSet> writes;
+
+			vk::UniqueImage placeholder;
+			vk::UniqueDeviceMemory placeholder_memory;
+			vk::UniqueImageView placeholder_view;
+			bool placeholder_cleared{ false };
+
+			vk::UniqueDescriptorSetLayout descriptor_layout;
+			vk::UniqueDescriptorPool descriptor_pool;
+			std::array<vk::DescriptorSet, MAX_FRAMES_IN_FLIGHT> descriptors;
+	};
+}
@@ -25,12 +25,55 @@
 #ifndef CFGOPTIONS
 #define CFGOPTIONS												\
 CFGOPTION( res, ::Config::Resolution, ::Config::Resolution{})	\
-CFGOPTION( fullscreen, bool, false )
+CFGOPTION( fullscreen, bool, false )							\
+CFGOPTION( present_strategy, ::Config::PresentStrategy, ::Config::PresentStrategy::MaxThroughput )	\
+CFGOPTION( record_replay, bool, false )									\
+CFGOPTION( capture, ::Config::CaptureMode, ::Config::CaptureMode::Off )	\
+CFGOPTION( view_layout, ::Config::ViewLayout, ::Config::ViewLayout::Single )	\
+CFGOPTION( tactical_map, bool, false )									\
+CFGOPTION( texture_budget, uint32_t, 2048 )							\
+CFGOPTION( dynamic_resolution, bool, false )							\
+CFGOPTION( gpu_budget_us, uint32_t, 0 )
 #endif //CFGOPTIONS
 
 namespace Config {
 	struct Resolution {
 		uint32_t x = 1920, y = 1080;
+
+		bool operator==( const Resolution& ) const = default;
+	};
+
+	/**
+	 *	How frames are paced and presented
+	 *	LowLatency:		one frame in flight, paced to the display, input sampled right before submission
+	 *	MaxThroughput:	as many frames as possible, no pacing
+	 *	PowerSaving:	vsynced, paced to the display
+	 */
+	enum class PresentStrategy {
+		LowLatency,
+		MaxThroughput,
+		PowerSaving,
+	};
+
+	/**
+	 *	Whether rendered frames are read back and written to ./capture
+	 *	Png:	one PNG file per frame
+	 *	Raw:	all frames appended to one file of raw pixels
+	 */
+	enum class CaptureMode {
+		Off,
+		Png,
+		Raw,
+	};
+
+	/**
+	 *	Windows the scene is rendered to
+	 *	Single:		one window
+	 *	Cockpit:	three windows side by side for three monitors, the outer ones turned to continue the middle one
+	 */
+	enum class ViewLayout {
+		Single,
+		Cockpit,
 	};
 
 	template <typename T>
@@ -55,11 +98,74 @@ namespace Config {
 			else if(( c == 'x' || c == 'X' ) && second == false ){
 				res.x = i;
 				i = 0;
+				second = true;
 			}
 		}
 		res.y = i;
 		return res;
 	}
+
+	template <>
+	inline std::string to_string<PresentStrategy>( const PresentStrategy& val ){
+		switch( val ){
+			case PresentStrategy::LowLatency:
+				return "LowLatency";
+			case PresentStrategy::MaxThroughput:
+				return "MaxThroughput";
+			case PresentStrategy::PowerSaving:
+				return "PowerSaving";
+		}
+		return "MaxThroughput";
+	}
+
+	template <>
+	inline PresentStrategy from_string<PresentStrategy>( const std::string& val ){
+		if( val == "LowLatency" )
+			return PresentStrategy::LowLatency;
+		if( val == "PowerSaving" )
+			return PresentStrategy::PowerSaving;
+		return PresentStrategy::MaxThroughput;
+	}
+
+	template <>
+	inline std::string to_string<CaptureMode>( const CaptureMode& val ){
+		switch( val ){
+			case CaptureMode::Off:
+				return "Off";
+			case CaptureMode::Png:
+				return "Png";
+			case CaptureMode::Raw:
+				return "Raw";
+		}
+		return "Off";
+	}
+
+	template <>
+	inline CaptureMode from_string<CaptureMode>( const std::string& val ){
+		if( val == "Png" )
+			return CaptureMode::Png;
+		if( val == "Raw" )
+			return CaptureMode::Raw;
+		return CaptureMode::Off;
+	}
+
+	template <>
+	inline std::string to_string<ViewLayout>( const ViewLayout& val ){
+		switch( val ){
+			case ViewLayout::Single:
+				return "Single";
+			case ViewLayout::Cockpit:
+				return "Cockpit";
+		}
+		return "Single";
+	}
+
+	template <>
+	inline ViewLayout from_string<ViewLayout>( const std::string& val ){
+		if( val == "Cockpit" )
+			return ViewLayout::Cockpit;
+		return ViewLayout::Single;
+	}
 }
 
 #include "Parser.hpp"
@@ -0,0 +1,185 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  View.hpp
+ *
+ *    Description:  One output of the renderer, a window or an offscreen target with its own camera
+ *
+ *        Version:  1.0
+ *        Created:  10/19/2026 10:12:48 PM
+ *       Revision:  none
+ *
+ *         Author:  Samuel Knoethig (), samuel@knoethig.net
+ *
+ * =====================================================================================
+ */
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+#include <vulkan/vulkan.hpp>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "AppGraphics.hpp"
+#include "FrameCapture.hpp"
+#include "OcclusionCulling.hpp"
+
+namespace SpaceAppVideo {
+	/**
+	 *	Where a view looks relative to the player camera
+	 */
+	struct ViewPlacement {
+		// Number of view widths the view is turned to the right, for monitors next to the main one
+		int column{ 0 };
+		// Looks down onto the player from above instead, for the tactical map
+		bool top_down{ false };
+	};
+
+	/**
+	 *	Owns everything that depends on an output: the surface and swapchain or the offscreen images,
+	 *	their views and framebuffers, the depth buffer and its pyramid and the semaphores to acquire and present them.
+	 *	The device, pipelines and scene resources belong to the renderer and are shared by all views.
+	 *
+	 *	With config.dynamic_resolution presenting views render into a scene image of the swapchain's size instead,
+	 *	only its top left render_extent() is drawn and record_upscale() stretches that onto the swapchain image.
+	 *	Changing the scale never reallocates anything
+	 */
+	class View {
+		public:
+			/**
+			 *	Presents to surface. window may be null for headless surfaces, it is destroyed with the view
+			 */
+			View( std::string name, GLFWwindow* window, vk::UniqueSurfaceKHR surface, ViewPlacement placement );
+			/**
+			 *	Renders into images that are left in ShaderReadOnlyOptimal, so they can be sampled
+			 */
+			View( std::string name, vk::Extent2D extent, ViewPlacement placement );
+			~View();
+
+			View( const View& ) = delete;
+			View& operator=( const View& ) = delete;
+
+			/**
+			 *	Format and color space the surface prefers, only valid for presenting views
+			 */
+			vk::SurfaceFormatKHR preferred_format( vk::PhysicalDevice phys_dev ) const;
+
+			/**
+			 *	(Re)creates the swapchain or offscreen images and everything depending on them. format has to be
+			 *	the one render_pass was created for with a DEPTH_FORMAT attachment after it, the device has to be
+			 *	idle if a target exists already. render_pass has to leave the image in TransferSrcOptimal if scaled()
+			 */
+			void create_target( vk::PhysicalDevice phys_dev, vk::Device device, const QueueFamilyIndices& queue_indices,
+					vk::Format format, vk::RenderPass render_pass );
+
+			/**
+			 *	Blocks while the window is minimised, a swapchain can not have a size of 0
+			 */
+			void wait_until_visible() const;
+
+			/**
+			 *	Picks the image to render to in frame. Returns false if the target is out of date and has to be recreated
+			 */
+			bool acquire( vk::Device device, size_t frame, vk::Fence frame_fence );
+
+			void follow( const Camera& player );
+			/**
+			 *	Fraction of the width and height rendered from now on, ignored unless scaled()
+			 */
+			void set_render_scale( float scale );
+			/**
+			 *	Copies the rendered part of the scene image onto the acquired image, filtered. Call after the render
+			 *	pass and before record_capture(), does nothing unless scaled()
+			 */
+			void record_upscale( vk::CommandBuffer cmd );
+			/**
+			 *	Copies the image rendered in frame for the capture, if enabled. Call after the render pass
+			 */
+			void record_capture( vk::CommandBuffer cmd, size_t frame, uint64_t frame_number );
+			void frame_retired( size_t frame );
+
+			bool presents() const;
+			bool scaled() const;
+			const std::string& name() const;
+			GLFWwindow* window() const;
+			vk::SurfaceKHR surface() const;
+			vk::Extent2D extent() const;
+			/**
+			 *	Part of the framebuffer that is drawn to, the whole extent unless scaled()
+			 */
+			vk::Extent2D render_extent() const;
+			vk::RenderPass render_pass() const;
+			vk::Framebuffer framebuffer() const;
+			const Camera& camera() const;
+			/**
+			 *	Depth buffer shared by every image of the view and the pyramid culling builds from it
+			 */
+			HizTarget hiz_target() const;
+
+			vk::SwapchainKHR swapchain() const;
+			uint32_t image_index() const;
+			// Signalled once the image of frame is acquired
+			vk::Semaphore image_available( size_t frame ) const;
+			// First stage writing the acquired image, which has to wait for image_available
+			vk::PipelineStageFlags image_write_stage() const;
+			// Has to be signalled by the submission rendering to the image of frame
+			vk::Semaphore render_finished( size_t frame ) const;
+
+		private:
+			vk::PresentModeKHR choose_present_mode( const SwapchainDetails& details ) const;
+			vk::Extent2D choose_extent( const SwapchainDetails& details ) const;
+			void create_swapchain( vk::PhysicalDevice phys_dev, vk::Device device, const QueueFamilyIndices& queue_indices, vk::Format format );
+			void create_offscreen_images( vk::PhysicalDevice phys_dev, vk::Device device, vk::Format format );
+			void create_depth( vk::PhysicalDevice phys_dev, vk::Device device );
+			void create_scene_image( vk::PhysicalDevice phys_dev, vk::Device device );
+
+			std::string view_name;
+			ViewPlacement placement;
+			Camera view_camera;
+
+			GLFWwindow* glfw_window{ nullptr };
+			vk::UniqueSurfaceKHR view_surface;
+			vk::UniqueSwapchainKHR view_swapchain;
+			// Owned by the swapchain for presenting views
+			std::vector<vk::Image> images;
+			// Only used by offscreen views, one image per frame in flight
+			std::vector<vk::UniqueImage> offscreen_images;
+			std::vector<vk::UniqueDeviceMemory> offscreen_memory;
+			vk::Format format;
+			vk::Extent2D target_extent;
+			vk::ImageUsageFlags usage;
+			std::vector<vk::UniqueImageView> image_views;
+			vk::RenderPass target_render_pass;
+			std::vector<vk::UniqueFramebuffer> framebuffers;
+
+			// Only used by scaled views, drawn instead of the swapchain images
+			vk::UniqueImage scene_image;
+			vk::UniqueDeviceMemory scene_memory;
+			vk::UniqueImageView scene_view;
+			vk::UniqueFramebuffer scene_framebuffer;
+			vk::Extent2D scaled_extent;
+
+			// Only one frame renders at a time, so every image shares them
+			vk::UniqueImage depth_image;
+			vk::UniqueDeviceMemory depth_memory;
+			vk::UniqueImageView depth_view;
+			uint64_t hiz_id{ 0 };
+			vk::UniqueImage hiz_image;
+			vk::UniqueDeviceMemory hiz_memory;
+			vk::UniqueImageView hiz_view;
+			std::vector<vk::UniqueImageView> hiz_levels;
+			vk::Extent2D hiz_extent;
+			// Fence of the frame that last rendered to each image
+			std::vector<vk::Fence> inflight_imgs;
+			uint32_t current_image{ 0 };
+
+			std::vector<vk::UniqueSemaphore> img_available_sema;
+			std::vector<vk::UniqueSemaphore> img_ready_sema;
+
+			// Only created if config.capture is set
+			std::unique_ptr<FrameCapture> frame_capture;
+	};
+}
@@ -1,9 +1,74 @@
 #version 450
 #extension GL_ARB_separate_shader_objects : enable
 
+// Has to match SpaceAppVideo::ShaderFeature
+const uint FEATURE_VERTEX_COLOR = 1;
+const uint FEATURE_EMISSIVE = 2;
+const uint FEATURE_TRANSLUCENT = 4;
+const uint FEATURE_LIT = 8;
+
+layout( constant_id = 0 ) const uint features = FEATURE_VERTEX_COLOR;
+
+struct Light {
+	vec4 position_radius;
+	vec4 color_intensity;
+};
+
+layout( std430, set = 0, binding = 0 ) readonly buffer Lights { Light lights[]; };
+layout( std430, set = 0, binding = 1 ) readonly buffer ClusterCounts { uint counts[]; };
+layout( std430, set = 0, binding = 2 ) readonly buffer ClusterLights { uint indices[]; };
+
+// Has to match ClusteredLighting::max_lights_per_cluster
+const uint max_lights_per_cluster = 128;
+const vec3 ambient = vec3( 0.05 );
+
+layout( push_constant ) uniform Params {
+	mat4 view;
+	vec4 projection;
+	vec4 slicing;
+	uvec4 grid;
+};
+
 layout( location = 0 ) in vec3 fragColor;
+layout( location = 1 ) in vec3 fragWorld;
 layout(location = 0) out vec4 outColor;
 
+vec3 shade( vec3 albedo ) {
+	vec3 eye = -transpose( mat3( view )) * view[3].xyz;
+	vec3 n = normalize( cross( dFdx( fragWorld ), dFdy( fragWorld )));
+	// There are no vertex normals, every face is lit from the side it is seen from
+	if( dot( n, eye - fragWorld ) < 0.0 )
+		n = -n;
+
+	float depth = -( view * vec4( fragWorld, 1.0 )).z;
+	uvec3 c = uvec3(
+			min( uvec2( gl_FragCoord.xy * slicing.zw ), grid.xy - 1 ),
+			uint( clamp( log( depth ) * slicing.x - slicing.y, 0.0, float( grid.z - 1 ))));
+	uint cluster = grid.w + c.x + grid.x * ( c.y + grid.y * c.z );
+
+	vec3 light = ambient;
+	uint count = counts[cluster];
+	for( uint i = 0; i < count; ++i ){
+		Light l = lights[indices[cluster * max_lights_per_cluster + i]];
+		vec3 to_light = l.position_radius.xyz - fragWorld;
+		float dist = length( to_light );
+		// Inverse square, windowed to reach 0 at the radius
+		float window = clamp( 1.0 - pow( dist / l.position_radius.w, 4.0 ), 0.0, 1.0 );
+		float attenuation = window * window / ( dist * dist + 1.0 );
+		light += l.color_intensity.rgb * l.color_intensity.w * attenuation * max( dot( n, to_light / dist ), 0.0 );
+	}
+
+	return albedo * light;
+}
+
 void main() {
-	outColor = vec4( fragColor, 1.0 );
+	vec3 color = ( features & FEATURE_VERTEX_COLOR ) != 0 ? fragColor : vec3( 0.5 );
+
+	if(( features & FEATURE_LIT ) != 0 )
+		color = shade( color );
+
+	if(( features & FEATURE_EMISSIVE ) != 0 )
+		color *= 2.0;
+
+	outColor = vec4( color, ( features & FEATURE_TRANSLUCENT ) != 0 ? 0.5 : 1.0 );
 }
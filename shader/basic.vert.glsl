@@ -4,8 +4,30 @@ layout( location = 0 ) in vec3 position;
 layout( location = 1 ) in vec3 inColor;
 
 layout( location = 0 ) out vec3 fragColor;
+layout( location = 1 ) out vec3 fragWorld;
+
+// Has to match SpaceAppVideo::ClusterParams
+layout( push_constant ) uniform Params {
+	mat4 view;
+	vec4 projection;
+	vec4 slicing;
+	uvec4 grid;
+};
+
+// Has to match SpaceAppVideo::CullInstance
+struct Instance {
+	vec3 position;
+	float radius;
+};
+
+// Filled by occlusion_cull.comp.glsl, the indirect draw's first instance points at the list of its phase
+layout( std430, set = 1, binding = 0 ) readonly buffer Instances { Instance instances[]; };
+layout( std430, set = 1, binding = 1 ) readonly buffer DrawLists { uint draw_list[]; };
 
 void main() {
-    gl_Position = vec4( position, 1.0 );
+	vec3 world = position + instances[draw_list[gl_InstanceIndex]].position;
+	vec4 v = view * vec4( world, 1.0 );
+	gl_Position = vec4( v.x * projection.x, v.y * projection.y, v.z * projection.z + projection.w, -v.z );
 	fragColor = inColor;
+	fragWorld = world;
 }
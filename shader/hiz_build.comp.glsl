@@ -0,0 +1,32 @@
+#version 450
+
+// Reduces one level of the depth pyramid into the next. Depth is reversed, so the farthest depth is the minimum.
+// Levels are halved and rounded down, each texel takes every source texel it overlaps so nothing is lost at odd sizes
+
+layout( local_size_x = 8, local_size_y = 8 ) in;
+
+layout( set = 0, binding = 0 ) uniform sampler2D source;
+layout( r32f, set = 0, binding = 1 ) uniform writeonly image2D target;
+
+// Texels of source that were drawn to, the depth buffer is only partly covered with dynamic resolution
+layout( push_constant ) uniform BuildParams {
+	ivec2 src_size;
+} params;
+
+void main() {
+	ivec2 dst = ivec2( gl_GlobalInvocationID.xy );
+	ivec2 dst_size = imageSize( target );
+	if( any( greaterThanEqual( dst, dst_size )))
+		return;
+
+	ivec2 src_size = params.src_size;
+	ivec2 first = dst * src_size / dst_size;
+	ivec2 last = min(( ( dst + 1 ) * src_size + dst_size - 1 ) / dst_size - 1, src_size - 1 );
+
+	float farthest = 1.0;
+	for( int y = first.y; y <= last.y; ++y )
+		for( int x = first.x; x <= last.x; ++x )
+			farthest = min( farthest, texelFetch( source, ivec2( x, y ), 0 ).r );
+
+	imageStore( target, dst, vec4( farthest ));
+}
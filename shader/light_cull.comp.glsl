@@ -0,0 +1,71 @@
+#version 450
+
+// Lists the lights touching each cluster of one view. One invocation per cluster, the lights are
+// transformed into view space once per batch and shared by the whole workgroup
+
+layout( local_size_x = 128 ) in;
+
+struct Light {
+	vec4 position_radius;
+	vec4 color_intensity;
+};
+
+layout( std430, set = 0, binding = 0 ) readonly buffer Lights { Light lights[]; };
+layout( std430, set = 0, binding = 1 ) writeonly buffer ClusterCounts { uint counts[]; };
+layout( std430, set = 0, binding = 2 ) writeonly buffer ClusterLights { uint indices[]; };
+
+// Has to match ClusteredLighting::max_lights_per_cluster
+const uint max_lights_per_cluster = 128;
+
+layout( push_constant ) uniform Params {
+	mat4 view;
+	vec4 projection;
+	vec4 slicing;
+	uvec4 grid;
+	uint light_count;
+};
+
+shared vec4 batch[gl_WorkGroupSize.x];
+
+void main() {
+	uint cluster = gl_GlobalInvocationID.x;
+	bool active = cluster < grid.x * grid.y * grid.z;
+
+	uvec3 c = uvec3( cluster % grid.x, ( cluster / grid.x ) % grid.y, cluster / ( grid.x * grid.y ));
+
+	// Inverse of slice = log( depth ) * slicing.x - slicing.y
+	float near = exp(( c.z + slicing.y ) / slicing.x );
+	float far = c.z + 1 == grid.z ? 3.0e38 : exp(( c.z + 1 + slicing.y ) / slicing.x );
+
+	// View space x and y at depth d are ndc * d / P, the tile is widest at the far end of the slice
+	vec2 a = ( vec2( c.xy ) / vec2( grid.xy ) * 2.0 - 1.0 ) / projection.xy;
+	vec2 b = ( vec2( c.xy + 1 ) / vec2( grid.xy ) * 2.0 - 1.0 ) / projection.xy;
+	vec2 lo = min( min( a * near, a * far ), min( b * near, b * far ));
+	vec2 hi = max( max( a * near, a * far ), max( b * near, b * far ));
+	vec3 box_min = vec3( lo, -far );
+	vec3 box_max = vec3( hi, -near );
+
+	uint base = ( grid.w + cluster ) * max_lights_per_cluster;
+	uint count = 0;
+
+	for( uint first = 0; first < light_count; first += gl_WorkGroupSize.x ){
+		uint i = first + gl_LocalInvocationID.x;
+		if( i < light_count ){
+			vec4 l = lights[i].position_radius;
+			batch[gl_LocalInvocationID.x] = vec4(( view * vec4( l.xyz, 1.0 )).xyz, l.w );
+		}
+		barrier();
+
+		uint n = min( gl_WorkGroupSize.x, light_count - first );
+		for( uint j = 0; active && j < n && count < max_lights_per_cluster; ++j ){
+			vec4 l = batch[j];
+			vec3 d = clamp( l.xyz, box_min, box_max ) - l.xyz;
+			if( dot( d, d ) <= l.w * l.w )
+				indices[base + count++] = first + j;
+		}
+		barrier();
+	}
+
+	if( active )
+		counts[grid.w + cluster] = count;
+}
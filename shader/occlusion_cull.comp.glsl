@@ -0,0 +1,133 @@
+#version 450
+
+// Tests one instance per invocation against the frustum of a view and, in the late phase, against the depth
+// pyramid built from what the early phase drew. Visible instances are appended to the draw list of the phase
+
+layout( local_size_x = 64 ) in;
+
+struct Instance {
+	vec3 position;
+	float radius;
+};
+
+struct DrawCommand {
+	uint vertex_count;
+	uint instance_count;
+	uint first_vertex;
+	uint first_instance;
+};
+
+layout( std430, set = 0, binding = 0 ) readonly buffer Instances { Instance instances[]; };
+layout( std430, set = 0, binding = 1 ) writeonly buffer DrawLists { uint draw_list[]; };
+layout( std430, set = 0, binding = 2 ) buffer DrawCommands { DrawCommand commands[]; };
+layout( std430, set = 0, binding = 3 ) buffer Visibility { uint visible[]; };
+layout( std430, set = 0, binding = 4 ) buffer Stats { uint stats[]; };
+layout( set = 0, binding = 5 ) uniform sampler2D pyramid;
+
+layout( push_constant ) uniform Params {
+	mat4 view;
+	vec4 projection;	// P[0][0], P[1][1], z_near
+	vec2 pyramid_size;
+	uint instance_count;
+	uint phase;
+	uint view_index;
+	uint level_count;
+};
+
+// Has to match OcclusionCulling::max_instances
+const uint max_instances = 16384;
+
+const uint stat_frustum_culled = 0;
+const uint stat_occluded = 1;
+const uint stat_early = 2;
+const uint stat_late = 3;
+
+bool in_frustum( vec3 c, float r ) {
+	// The side planes pass through the eye, in view space the camera looks along -z and the far plane is at infinity
+	vec2 p = abs( projection.xy );
+	vec2 side = ( -c.z - p * abs( c.xy )) * inversesqrt( p * p + 1.0 );
+	return side.x > -r && side.y > -r && -c.z + r > projection.z;
+}
+
+// Screen space bounds of a sphere in front of the near plane as uv min and max, 2D Polyhedral Bounds of a Clipped,
+// Perspective-Projected 3D Sphere (Mara and McGuire 2013)
+vec4 project_sphere( vec3 c, float r ) {
+	vec2 cx = vec2( c.x, -c.z );
+	vec2 vx = vec2( sqrt( dot( cx, cx ) - r * r ), r );
+	vec2 min_x = mat2( vx.x, vx.y, -vx.y, vx.x ) * cx;
+	vec2 max_x = mat2( vx.x, -vx.y, vx.y, vx.x ) * cx;
+
+	vec2 cy = vec2( c.y, -c.z );
+	vec2 vy = vec2( sqrt( dot( cy, cy ) - r * r ), r );
+	vec2 min_y = mat2( vy.x, vy.y, -vy.y, vy.x ) * cy;
+	vec2 max_y = mat2( vy.x, -vy.y, vy.y, vy.x ) * cy;
+
+	vec4 ndc = vec4( min_x.x / min_x.y * projection.x, min_y.x / min_y.y * projection.y,
+			max_x.x / max_x.y * projection.x, max_y.x / max_y.y * projection.y );
+	// The projection flips y, so the corners are sorted again
+	vec4 bounds = vec4( min( ndc.xy, ndc.zw ), max( ndc.xy, ndc.zw ));
+	return clamp( bounds * 0.5 + 0.5, 0.0, 1.0 );
+}
+
+bool occluded( vec3 c, float r ) {
+	// Spheres reaching through the near plane cover too much of the screen to be worth testing
+	if( -c.z - r <= projection.z )
+		return false;
+
+	vec4 bounds = project_sphere( c, r );
+	vec2 size = ( bounds.zw - bounds.xy ) * pyramid_size;
+
+	// At this level the bounds cover at most two texels in each direction
+	float level = ceil( log2( max( max( size.x, size.y ), 1.0 )));
+	if( level >= float( level_count ))
+		return false;
+
+	ivec2 level_size = textureSize( pyramid, int( level ));
+	ivec2 lo = clamp( ivec2( bounds.xy * vec2( level_size )), ivec2( 0 ), level_size - 1 );
+	ivec2 hi = clamp( ivec2( bounds.zw * vec2( level_size )), ivec2( 0 ), level_size - 1 );
+
+	float farthest = min(
+			min( texelFetch( pyramid, lo, int( level )).r, texelFetch( pyramid, ivec2( hi.x, lo.y ), int( level )).r ),
+			min( texelFetch( pyramid, ivec2( lo.x, hi.y ), int( level )).r, texelFetch( pyramid, hi, int( level )).r ));
+
+	// Reversed depth of the sphere's nearest point, anything nearer than all occluders is kept
+	float nearest = projection.z / ( -c.z - r );
+	return nearest < farthest;
+}
+
+void append( uint i, uint list ) {
+	uint command = view_index * 2 + list;
+	uint n = atomicAdd( commands[command].instance_count, 1 );
+	draw_list[command * max_instances + n] = i;
+	atomicAdd( stats[view_index * 4 + stat_early + list], 1 );
+}
+
+void main() {
+	uint i = gl_GlobalInvocationID.x;
+	if( i >= instance_count )
+		return;
+
+	Instance instance = instances[i];
+	vec3 c = ( view * vec4( instance.position, 1.0 )).xyz;
+	bool frustum = in_frustum( c, instance.radius );
+	uint slot = view_index * max_instances + i;
+	bool was_visible = visible[slot] != 0;
+
+	if( phase == 0 ){
+		if( was_visible && frustum )
+			append( i, 0 );
+		return;
+	}
+
+	bool now_visible = frustum && !occluded( c, instance.radius );
+	if( !frustum )
+		atomicAdd( stats[view_index * 4 + stat_frustum_culled], 1 );
+	else if( !now_visible )
+		atomicAdd( stats[view_index * 4 + stat_occluded], 1 );
+
+	// Everything visible last frame and inside the frustum was drawn early already
+	if( now_visible && !was_visible )
+		append( i, 1 );
+
+	visible[slot] = now_visible ? 1 : 0;
+}
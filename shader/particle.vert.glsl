@@ -0,0 +1,36 @@
+#version 450
+
+// Expands every alive particle into a camera facing quad, drawn as a 4 vertex triangle strip per instance
+
+layout( std430, set = 0, binding = 0 ) readonly buffer Positions { vec4 positions[]; };		// xyz, remaining life
+layout( std430, set = 0, binding = 1 ) readonly buffer Velocities { vec4 velocities[]; };	// xyz, size
+layout( std430, set = 0, binding = 2 ) readonly buffer Colors { uint colors[]; };
+layout( std430, set = 0, binding = 3 ) readonly buffer AliveLists { uint alive[]; };
+
+layout( push_constant ) uniform Params {
+	mat4 view_proj;
+	vec4 camera_right;
+	vec4 camera_up;
+	uint alive_offset;
+};
+
+layout( location = 0 ) out vec4 fragColor;
+layout( location = 1 ) out vec2 fragUV;
+
+void main() {
+	uint idx = alive[alive_offset + gl_InstanceIndex];
+	vec4 p = positions[idx];
+	float size = velocities[idx].w;
+
+	vec2 corner = vec2( gl_VertexIndex & 1, gl_VertexIndex >> 1 ) * 2.0 - 1.0;
+	vec3 world = p.xyz + ( camera_right.xyz * corner.x + camera_up.xyz * corner.y ) * size;
+
+	gl_Position = view_proj * vec4( world, 1.0 );
+
+	vec4 color = unpackUnorm4x8( colors[idx] );
+	// Fade out during the last second
+	color.a *= clamp( p.w, 0.0, 1.0 );
+
+	fragColor = color;
+	fragUV = corner;
+}
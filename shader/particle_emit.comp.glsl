@@ -0,0 +1,80 @@
+#version 450
+
+// Takes emit_count particles from the dead list and appends them to the current alive list
+
+layout( local_size_x = 256 ) in;
+
+layout( std430, set = 0, binding = 0 ) buffer Positions { vec4 positions[]; };		// xyz, remaining life
+layout( std430, set = 0, binding = 1 ) buffer Velocities { vec4 velocities[]; };	// xyz, size
+layout( std430, set = 0, binding = 2 ) buffer Colors { uint colors[]; };			// rgba8
+layout( std430, set = 0, binding = 3 ) buffer AliveLists { uint alive[]; };
+layout( std430, set = 0, binding = 4 ) buffer DeadList { uint dead[]; };
+layout( std430, set = 0, binding = 5 ) buffer Counters {
+	int alive_count[2];
+	int dead_count;
+	int capacity;
+	uint vertex_count;
+	uint instance_count;
+	uint first_vertex;
+	uint first_instance;
+};
+
+layout( push_constant ) uniform Params {
+	vec4 emitter_position;	// xyz, spread
+	vec4 emitter_velocity;	// xyz, velocity jitter
+	vec4 emitter_color;
+	vec4 camera_position;	// xyz, dt
+	uint emit_count;
+	uint parity;
+	uint seed;
+	float lifetime;
+	uint sort_k;
+	uint sort_j;
+	float size;
+};
+
+uint hash( uint x ){
+	x ^= x >> 16;
+	x *= 0x7feb352dU;
+	x ^= x >> 15;
+	x *= 0x846ca68bU;
+	x ^= x >> 16;
+	return x;
+}
+
+float rand( inout uint state ){
+	state = hash( state );
+	return float( state ) / 4294967295.0;
+}
+
+vec3 rand_dir( inout uint state ){
+	float z = rand( state ) * 2.0 - 1.0;
+	float phi = rand( state ) * 6.28318530718;
+	float r = sqrt( 1.0 - z * z );
+	return vec3( r * cos( phi ), r * sin( phi ), z );
+}
+
+void main() {
+	uint i = gl_GlobalInvocationID.x;
+	if( i >= emit_count )
+		return;
+
+	int slot = atomicAdd( dead_count, -1 ) - 1;
+	if( slot < 0 ){
+		// Pool exhausted
+		atomicAdd( dead_count, 1 );
+		return;
+	}
+
+	uint idx = dead[slot];
+	uint state = hash( seed ^ hash( i ));
+
+	positions[idx] = vec4(
+			emitter_position.xyz + rand_dir( state ) * emitter_position.w * rand( state ),
+			lifetime * ( 0.5 + 0.5 * rand( state )));
+	velocities[idx] = vec4( emitter_velocity.xyz + rand_dir( state ) * emitter_velocity.w * rand( state ), size );
+	colors[idx] = packUnorm4x8( emitter_color );
+
+	int alive_slot = atomicAdd( alive_count[parity], 1 );
+	alive[parity * uint( capacity ) + uint( alive_slot )] = idx;
+}
@@ -0,0 +1,34 @@
+#version 450
+
+// Writes the indirect draw arguments and resets the list that was just consumed
+
+layout( local_size_x = 1 ) in;
+
+layout( std430, set = 0, binding = 5 ) buffer Counters {
+	int alive_count[2];
+	int dead_count;
+	int capacity;
+	uint vertex_count;
+	uint instance_count;
+	uint first_vertex;
+	uint first_instance;
+};
+
+layout( push_constant ) uniform Params {
+	vec4 emitter_position;
+	vec4 emitter_velocity;
+	vec4 emitter_color;
+	vec4 camera_position;
+	uint emit_count;
+	uint parity;
+	uint seed;
+	float lifetime;
+	uint sort_k;
+	uint sort_j;
+	float size;
+};
+
+void main() {
+	instance_count = uint( alive_count[1 - parity] );
+	alive_count[parity] = 0;
+}
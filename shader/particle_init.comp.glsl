@@ -0,0 +1,52 @@
+#version 450
+
+// Puts every particle on the dead list, emit_count holds the capacity
+
+layout( local_size_x = 256 ) in;
+
+layout( std430, set = 0, binding = 0 ) buffer Positions { vec4 positions[]; };
+layout( std430, set = 0, binding = 4 ) buffer DeadList { uint dead[]; };
+layout( std430, set = 0, binding = 5 ) buffer Counters {
+	int alive_count[2];
+	int dead_count;
+	int capacity;
+	// VkDrawIndirectCommand
+	uint vertex_count;
+	uint instance_count;
+	uint first_vertex;
+	uint first_instance;
+};
+
+layout( push_constant ) uniform Params {
+	vec4 emitter_position;
+	vec4 emitter_velocity;
+	vec4 emitter_color;
+	vec4 camera_position;
+	uint emit_count;
+	uint parity;
+	uint seed;
+	float lifetime;
+	uint sort_k;
+	uint sort_j;
+	float size;
+};
+
+void main() {
+	uint i = gl_GlobalInvocationID.x;
+	if( i >= emit_count )
+		return;
+
+	dead[i] = i;
+	positions[i] = vec4( 0.0 );
+
+	if( i == 0 ){
+		alive_count[0] = 0;
+		alive_count[1] = 0;
+		dead_count = int( emit_count );
+		capacity = int( emit_count );
+		vertex_count = 4;
+		instance_count = 0;
+		first_vertex = 0;
+		first_instance = 0;
+	}
+}
@@ -0,0 +1,67 @@
+#version 450
+
+// Integrates the current alive list. Survivors get compacted into the other alive list together with
+// their sort key, dead particles go back onto the dead list
+
+layout( local_size_x = 256 ) in;
+
+layout( std430, set = 0, binding = 0 ) buffer Positions { vec4 positions[]; };		// xyz, remaining life
+layout( std430, set = 0, binding = 1 ) buffer Velocities { vec4 velocities[]; };	// xyz, size
+layout( std430, set = 0, binding = 3 ) buffer AliveLists { uint alive[]; };
+layout( std430, set = 0, binding = 4 ) buffer DeadList { uint dead[]; };
+layout( std430, set = 0, binding = 5 ) buffer Counters {
+	int alive_count[2];
+	int dead_count;
+	int capacity;
+	uint vertex_count;
+	uint instance_count;
+	uint first_vertex;
+	uint first_instance;
+};
+layout( std430, set = 0, binding = 6 ) buffer SortKeys { uint sort_keys[]; };
+
+layout( push_constant ) uniform Params {
+	vec4 emitter_position;
+	vec4 emitter_velocity;
+	vec4 emitter_color;
+	vec4 camera_position;	// xyz, dt
+	uint emit_count;
+	uint parity;
+	uint seed;
+	float lifetime;
+	uint sort_k;
+	uint sort_j;
+	float size;
+};
+
+void main() {
+	uint i = gl_GlobalInvocationID.x;
+	if( i >= uint( alive_count[parity] ))
+		return;
+
+	uint idx = alive[parity * uint( capacity ) + i];
+	float dt = camera_position.w;
+
+	vec4 p = positions[idx];
+	vec4 v = velocities[idx];
+
+	p.w -= dt;
+	if( p.w <= 0.0 ){
+		positions[idx].w = 0.0;
+		dead[atomicAdd( dead_count, 1 )] = idx;
+		return;
+	}
+
+	// Slight drag, so exhaust slows down after leaving the nozzle
+	v.xyz *= exp( -0.5 * dt );
+	p.xyz += v.xyz * dt;
+
+	positions[idx] = p;
+	velocities[idx] = v;
+
+	uint next = 1 - parity;
+	uint slot = uint( atomicAdd( alive_count[next], 1 ));
+	alive[next * uint( capacity ) + slot] = idx;
+	// Positive floats keep their order when compared as unsigned integers
+	sort_keys[slot] = floatBitsToUint( distance( p.xyz, camera_position.xyz ));
+}
@@ -0,0 +1,102 @@
+#version 450
+
+// Bitonic sort of the compacted alive list by descending camera distance, so particles blend back to front.
+// sort_j == 0:		pads the keys behind the last alive particle
+// sort_j > 256:	one global compare and swap step
+// otherwise:		all steps from sort_j down to 1 in shared memory, on blocks of 512 elements
+
+layout( local_size_x = 256 ) in;
+
+layout( std430, set = 0, binding = 3 ) buffer AliveLists { uint alive[]; };
+layout( std430, set = 0, binding = 5 ) buffer Counters {
+	int alive_count[2];
+	int dead_count;
+	int capacity;
+	uint vertex_count;
+	uint instance_count;
+	uint first_vertex;
+	uint first_instance;
+};
+layout( std430, set = 0, binding = 6 ) buffer SortKeys { uint sort_keys[]; };
+
+layout( push_constant ) uniform Params {
+	vec4 emitter_position;
+	vec4 emitter_velocity;
+	vec4 emitter_color;
+	vec4 camera_position;
+	uint emit_count;
+	uint parity;
+	uint seed;
+	float lifetime;
+	uint sort_k;
+	uint sort_j;
+	float size;
+};
+
+shared uint local_keys[512];
+shared uint local_values[512];
+
+bool out_of_order( uint lower_key, uint upper_key, uint lower ){
+	bool descending = ( lower & sort_k ) == 0;
+	return descending ? lower_key < upper_key : lower_key > upper_key;
+}
+
+void main() {
+	uint offset = ( 1 - parity ) * uint( capacity );
+
+	if( sort_j == 0 ){
+		uint i = gl_GlobalInvocationID.x;
+		if( i >= uint( alive_count[1 - parity] ) && i < uint( capacity ))
+			sort_keys[i] = 0;
+		return;
+	}
+
+	if( sort_j > 256 ){
+		uint i = gl_GlobalInvocationID.x;
+		uint l = i ^ sort_j;
+		if( l <= i || l >= uint( capacity ))
+			return;
+
+		uint key_i = sort_keys[i];
+		uint key_l = sort_keys[l];
+		if( out_of_order( key_i, key_l, i )){
+			sort_keys[i] = key_l;
+			sort_keys[l] = key_i;
+
+			uint value = alive[offset + i];
+			alive[offset + i] = alive[offset + l];
+			alive[offset + l] = value;
+		}
+		return;
+	}
+
+	uint base = gl_WorkGroupID.x * 512;
+	uint t = gl_LocalInvocationID.x;
+
+	local_keys[t] = sort_keys[base + t];
+	local_keys[t + 256] = sort_keys[base + t + 256];
+	local_values[t] = alive[offset + base + t];
+	local_values[t + 256] = alive[offset + base + t + 256];
+	barrier();
+
+	for( uint j = sort_j; j > 0; j >>= 1 ){
+		uint i = 2 * j * ( t / j ) + ( t % j );
+		uint l = i + j;
+
+		if( out_of_order( local_keys[i], local_keys[l], base + i )){
+			uint key = local_keys[i];
+			local_keys[i] = local_keys[l];
+			local_keys[l] = key;
+
+			uint value = local_values[i];
+			local_values[i] = local_values[l];
+			local_values[l] = value;
+		}
+		barrier();
+	}
+
+	sort_keys[base + t] = local_keys[t];
+	sort_keys[base + t + 256] = local_keys[t + 256];
+	alive[offset + base + t] = local_values[t];
+	alive[offset + base + t + 256] = local_values[t + 256];
+}
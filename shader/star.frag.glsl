@@ -0,0 +1,14 @@
+#version 450
+
+layout( location = 0 ) in vec4 fragColor;
+layout( location = 1 ) in vec2 fragUV;
+
+layout( location = 0 ) out vec4 outColor;
+
+void main() {
+	float falloff = max( 1.0 - dot( fragUV, fragUV ), 0.0 );
+	float alpha = fragColor.a * falloff * falloff;
+
+	// Blended additively
+	outColor = vec4( fragColor.rgb * alpha, alpha );
+}
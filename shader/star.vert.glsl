@@ -0,0 +1,54 @@
+#version 450
+
+// Expands every catalog entry into a quad. Stars are screen space sprites sized by their apparent brightness,
+// nebula clouds are camera facing billboards in world space
+
+layout( location = 0 ) in vec3 inPosition;
+layout( location = 1 ) in uvec4 inColor;	// rgb, quantised magnitude or nebula radius
+
+layout( push_constant ) uniform Params {
+	mat4 view_proj;
+	vec4 sector_offset;
+	vec4 camera_right;
+	vec4 camera_up;
+	vec2 pixel_size;
+};
+
+layout( location = 0 ) out vec4 fragColor;
+layout( location = 1 ) out vec2 fragUV;
+
+// Have to match Starfield.cpp
+const float magnitude_min = -8.0;
+const float magnitude_scale = 5.25;
+const uint nebula_flag = 0x80u;
+const float nebula_radius_step = 4.0;
+
+// Distance at which a star of absolute magnitude 0 is shown at full brightness
+const float reference_distance = 3000.0;
+
+void main() {
+	vec2 corner = vec2( gl_VertexIndex & 1, gl_VertexIndex >> 1 ) * 2.0 - 1.0;
+	vec3 position = inPosition + sector_offset.xyz;
+	vec3 color = vec3( inColor.rgb ) / 255.0;
+
+	if(( inColor.a & nebula_flag ) != 0u ){
+		float radius = float( inColor.a & ~nebula_flag ) * nebula_radius_step;
+		vec3 world = position + ( camera_right.xyz * corner.x + camera_up.xyz * corner.y ) * radius;
+
+		gl_Position = view_proj * vec4( world, 1.0 );
+		fragColor = vec4( color, 0.04 );
+	} else {
+		float magnitude = float( inColor.a ) / magnitude_scale + magnitude_min;
+		float dist = max( length( position ), 1.0 );
+		float intensity = pow( 10.0, -0.4 * magnitude ) * ( reference_distance * reference_distance ) / ( dist * dist );
+
+		// Size in pixels, the offset is scaled by w so it stays constant after the perspective divide
+		float size = clamp( 1.0 + sqrt( intensity ), 1.5, 5.0 );
+		vec4 center = view_proj * vec4( position, 1.0 );
+
+		gl_Position = center + vec4( corner * pixel_size * 0.5 * size * center.w, 0.0, 0.0 );
+		fragColor = vec4( color, clamp( pow( intensity, 0.35 ), 0.0, 1.0 ));
+	}
+
+	fragUV = corner;
+}
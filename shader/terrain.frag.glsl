@@ -0,0 +1,42 @@
+#version 450
+
+// Colours the surface by height and slope and lights it by the sun
+
+layout( location = 0 ) in vec3 fragPosition;
+layout( location = 1 ) in vec3 fragUp;
+layout( location = 2 ) in float fragHeight;
+
+layout( push_constant ) uniform Params {
+	mat4 view_proj;
+	vec4 sun;	// direction towards the sun, maximum height
+	float radius;
+};
+
+layout( location = 0 ) out vec4 outColor;
+
+const vec3 lowland = vec3( 0.20, 0.30, 0.12 );
+const vec3 highland = vec3( 0.42, 0.36, 0.25 );
+const vec3 rock = vec3( 0.30, 0.28, 0.26 );
+const vec3 snow = vec3( 0.90, 0.92, 0.95 );
+const float ambient = 0.03;
+
+void main() {
+	// Flat normal of the triangle, turned away from the planet
+	vec3 up = normalize( fragUp );
+	vec3 normal = normalize( cross( dFdx( fragPosition ), dFdy( fragPosition )));
+	if( dot( normal, up ) < 0.0 )
+		normal = -normal;
+
+	float slope = 1.0 - dot( normal, up );
+	float altitude = clamp( fragHeight / sun.w, 0.0, 1.0 );
+
+	vec3 albedo = mix( lowland, highland, smoothstep( 0.1, 0.45, altitude ));
+	albedo = mix( albedo, rock, smoothstep( 0.15, 0.35, slope ));
+	albedo = mix( albedo, snow, smoothstep( 0.6, 0.75, altitude ) * ( 1.0 - smoothstep( 0.3, 0.5, slope )));
+
+	// Slopes facing the sun on the night side stay dark
+	float day = smoothstep( -0.1, 0.1, dot( up, sun.xyz ));
+	float diffuse = max( dot( normal, sun.xyz ), 0.0 ) * day;
+
+	outColor = vec4( albedo * ( diffuse + ambient ), 1.0 );
+}
@@ -0,0 +1,86 @@
+#version 450
+
+// Places the grid of one patch on the sphere. Vertices snap to the grid of the patch's lod, morph towards the next
+// coarser one with distance and are displaced by the height tile. Positions are relative to the camera and built
+// from small offsets to the patch center, so their precision does not depend on the size of the planet
+
+struct Patch {
+	vec3 center;
+	float morph_start;
+	vec3 direction;
+	float morph_end;
+	vec3 axis_u;
+	float tile_scale;
+	vec3 axis_v;
+	uint tile;
+	vec2 tile_offset;
+	uint shift;
+	float padding;
+};
+
+layout( std430, set = 0, binding = 0 ) readonly buffer Patches { Patch patches[]; };
+layout( std430, set = 0, binding = 1 ) readonly buffer Tiles { float heights[]; };
+
+layout( push_constant ) uniform Params {
+	mat4 view_proj;
+	vec4 sun;
+	float radius;
+};
+
+layout( location = 0 ) out vec3 fragPosition;
+layout( location = 1 ) out vec3 fragUp;
+layout( location = 2 ) out float fragHeight;
+
+// Has to match Terrain::grid_size
+const uint grid_size = 32;
+
+// Point on the sphere at grid position g of the patch and its direction from the planet center
+vec3 surface( Patch p, vec2 g, out vec3 dir ) {
+	vec3 local = ( g.x - 0.5 ) * p.axis_u + ( g.y - 0.5 ) * p.axis_v;
+
+	// Scale projecting direction + local onto the unit sphere, s - 1 is computed without cancellation
+	float e = 2.0 * dot( p.direction, local ) + dot( local, local );
+	float len = sqrt( 1.0 + e );
+	float s = 1.0 / len;
+	float s_minus_1 = -e / ( len * ( 1.0 + len ));
+
+	dir = s * ( p.direction + local );
+	return p.center + radius * ( s_minus_1 * p.direction + s * local );
+}
+
+float height( Patch p, vec2 g ) {
+	vec2 t = ( p.tile_offset + g * p.tile_scale ) * grid_size;
+	vec2 i = min( floor( t ), vec2( grid_size - 1 ));
+	vec2 f = t - i;
+
+	uint row = grid_size + 1;
+	uint base = p.tile * row * row + uint( i.y ) * row + uint( i.x );
+	float bottom = mix( heights[base], heights[base + 1], f.x );
+	float top = mix( heights[base + row], heights[base + row + 1], f.x );
+	return mix( bottom, top, f.y );
+}
+
+void main() {
+	Patch p = patches[gl_InstanceIndex];
+
+	// Quadrants drawn at their parent's lod only use every second vertex, the others collapse onto them
+	uvec2 v = uvec2( gl_VertexIndex % ( grid_size + 1 ), gl_VertexIndex / ( grid_size + 1 ));
+	v = ( v >> p.shift ) << p.shift;
+	float cells = float( grid_size >> p.shift );
+	vec2 g = vec2( v ) / float( grid_size );
+
+	// Odd vertices slide onto their even neighbour, at the end of the range the grid is the next coarser lod's
+	vec3 dir;
+	float distance = length( surface( p, g, dir ));
+	float morph = clamp(( distance - p.morph_start ) / ( p.morph_end - p.morph_start ), 0.0, 1.0 );
+	g -= fract( g * cells * 0.5 ) * 2.0 / cells * morph;
+
+	vec3 position = surface( p, g, dir );
+	float h = height( p, g );
+	position += h * dir;
+
+	gl_Position = view_proj * vec4( position, 1.0 );
+	fragPosition = position;
+	fragUp = dir;
+	fragHeight = h;
+}
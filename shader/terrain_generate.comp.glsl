@@ -0,0 +1,118 @@
+#version 450
+
+// Evaluates the heights of one tile per workgroup layer. A height only depends on the direction from the planet
+// center, so samples shared by neighbouring tiles or by tiles of different levels are the same everywhere
+
+layout( local_size_x = 8, local_size_y = 8 ) in;
+
+struct Job {
+	uint face_level;	// face in the low byte, level above it
+	uint x;
+	uint y;
+	uint slot;
+};
+
+layout( std430, set = 0, binding = 1 ) writeonly buffer Tiles { float heights[]; };
+layout( std430, set = 0, binding = 2 ) readonly buffer Jobs { Job jobs[]; };
+
+layout( push_constant ) uniform Params {
+	float max_height;
+	uint seed;
+	uint first_job;
+};
+
+// Has to match Terrain::grid_size
+const uint grid_size = 32;
+// Features of the coarsest octave per planet radius
+const float base_frequency = 2.0;
+// The same for every level, so coarse tiles agree with fine ones where their samples meet. Finer octaves
+// would exceed float precision of the noise coordinates
+const uint octaves = 14;
+
+// Have to match Terrain.cpp
+const vec3 face_normal[6] = vec3[]( vec3( 1, 0, 0 ), vec3( -1, 0, 0 ), vec3( 0, 1, 0 ), vec3( 0, -1, 0 ), vec3( 0, 0, 1 ), vec3( 0, 0, -1 ));
+const vec3 face_u[6] = vec3[]( vec3( 0, 0, -1 ), vec3( 0, 0, 1 ), vec3( 1, 0, 0 ), vec3( 1, 0, 0 ), vec3( 1, 0, 0 ), vec3( -1, 0, 0 ));
+const vec3 face_v[6] = vec3[]( vec3( 0, 1, 0 ), vec3( 0, 1, 0 ), vec3( 0, 0, -1 ), vec3( 0, 0, 1 ), vec3( 0, 1, 0 ), vec3( 0, 1, 0 ));
+
+uvec3 pcg3d( uvec3 v ) {
+	v = v * 1664525u + 1013904223u;
+	v.x += v.y * v.z;
+	v.y += v.z * v.x;
+	v.z += v.x * v.y;
+	v ^= v >> 16u;
+	v.x += v.y * v.z;
+	v.y += v.z * v.x;
+	v.z += v.x * v.y;
+	return v;
+}
+
+float gradient( ivec3 cell, vec3 offset ) {
+	uvec3 h = pcg3d( uvec3( cell ) + seed );
+	vec3 g = vec3( h & 0xffffu ) / 32767.5 - 1.0;
+	return dot( g, offset );
+}
+
+// Gradient noise, roughly between -1 and 1
+float noise( vec3 p ) {
+	vec3 i = floor( p );
+	vec3 f = p - i;
+	vec3 w = f * f * f * ( f * ( f * 6.0 - 15.0 ) + 10.0 );
+	ivec3 c = ivec3( i );
+
+	float x00 = mix( gradient( c, f ), gradient( c + ivec3( 1, 0, 0 ), f - vec3( 1, 0, 0 )), w.x );
+	float x10 = mix( gradient( c + ivec3( 0, 1, 0 ), f - vec3( 0, 1, 0 )), gradient( c + ivec3( 1, 1, 0 ), f - vec3( 1, 1, 0 )), w.x );
+	float x01 = mix( gradient( c + ivec3( 0, 0, 1 ), f - vec3( 0, 0, 1 )), gradient( c + ivec3( 1, 0, 1 ), f - vec3( 1, 0, 1 )), w.x );
+	float x11 = mix( gradient( c + ivec3( 0, 1, 1 ), f - vec3( 0, 1, 1 )), gradient( c + ivec3( 1, 1, 1 ), f - vec3( 1, 1, 1 )), w.x );
+	return mix( mix( x00, x10, w.y ), mix( x01, x11, w.y ), w.z );
+}
+
+// Continents and plains
+float fbm( vec3 p ) {
+	float sum = 0.0, amplitude = 0.5, total = 0.0;
+	for( uint o = 0; o < octaves; ++o ){
+		sum += amplitude * noise( p );
+		total += amplitude;
+		amplitude *= 0.5;
+		p = p * 2.0 + vec3( 17.3, -5.1, 9.7 );
+	}
+	return sum / total;
+}
+
+// Sharp mountain crests, between 0 and 1
+float ridged( vec3 p ) {
+	float sum = 0.0, amplitude = 0.5, total = 0.0;
+	for( uint o = 0; o < octaves; ++o ){
+		float r = 1.0 - abs( noise( p ));
+		sum += amplitude * r * r;
+		total += amplitude;
+		amplitude *= 0.5;
+		p = p * 2.0 + vec3( -11.9, 3.3, 23.1 );
+	}
+	return sum / total;
+}
+
+float terrain_height( vec3 dir ) {
+	vec3 p = dir * base_frequency;
+	float base = clamp( fbm( p ) + 0.5, 0.0, 1.0 );
+	float mountains = ridged( p * 3.0 + vec3( 31.7 )) * smoothstep( 0.5, 0.75, base );
+	return max_height * clamp( 0.35 * base + 0.65 * mountains, 0.0, 1.0 );
+}
+
+void main() {
+	uvec2 s = gl_GlobalInvocationID.xy;
+	if( s.x > grid_size || s.y > grid_size )
+		return;
+
+	Job job = jobs[first_job + gl_WorkGroupID.z];
+	uint face = job.face_level & 0xffu;
+	uint level = job.face_level >> 8;
+
+	// Exact for every level of the quadtree, so tiles meet on the same samples
+	float scale = 2.0 / float( grid_size << level );
+	float u = float( job.x * grid_size + s.x ) * scale - 1.0;
+	float v = float( job.y * grid_size + s.y ) * scale - 1.0;
+	vec3 dir = normalize( face_normal[face] + u * face_u[face] + v * face_v[face] );
+
+	uint row = grid_size + 1;
+	heights[job.slot * row * row + s.y * row + s.x] = terrain_height( dir );
+}
@@ -0,0 +1,117 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  AllocationCounter.cpp
+ *
+ *    Description:  Source file defining things from AllocationCounter.hpp
+ *
+ *        Version:  1.0
+ *        Created:  10/19/2026 09:41:27 PM
+ *       Revision:  none
+ *
+ *         Author:  Samuel Knoethig (), samuel@knoethig.net
+ *
+ * =====================================================================================
+ */
+
+#include "AllocationCounter.hpp"
+
+#include <cassert>
+#include <cstdlib>
+#include <new>
+
+namespace {
+	thread_local uint64_t allocation_count{ 0 };
+	thread_local int allow_depth{ 0 };
+}
+
+uint64_t Debug::allocations(){
+	return allocation_count;
+}
+
+Debug::AllowAllocations::AllowAllocations(){
+	++allow_depth;
+}
+
+Debug::AllowAllocations::~AllowAllocations(){
+	--allow_depth;
+}
+
+Debug::NoAllocations::NoAllocations( bool enabled ): enabled( enabled ), start( allocation_count ){}
+
+Debug::NoAllocations::~NoAllocations(){
+	assert(( !enabled || allocation_count == start ) && "Heap allocation in a scope that must not allocate" );
+}
+
+#ifndef NDEBUG
+
+namespace {
+	void* counted_alloc( std::size_t size ){
+		if( allow_depth == 0 )
+			++allocation_count;
+		return std::malloc( size ? size : 1 );
+	}
+
+	void* counted_aligned_alloc( std::size_t size, std::align_val_t alignment ){
+		if( allow_depth == 0 )
+			++allocation_count;
+		auto align = static_cast<std::size_t>( alignment );
+		// aligned_alloc wants a multiple of the alignment
+		return std::aligned_alloc( align, ( size + align - 1 ) / align * align );
+	}
+}
+
+void* operator new( std::size_t size ){
+	if( void* p = counted_alloc( size ))
+		return p;
+	throw std::bad_alloc();
+}
+
+void* operator new[]( std::size_t size ){
+	if( void* p = counted_alloc( size ))
+		return p;
+	throw std::bad_alloc();
+}
+
+void* operator new( std::size_t size, const std::nothrow_t& ) noexcept {
+	return counted_alloc( size );
+}
+
+void* operator new[]( std::size_t size, const std::nothrow_t& ) noexcept {
+	return counted_alloc( size );
+}
+
+void* operator new( std::size_t size, std::align_val_t alignment ){
+	if( void* p = counted_aligned_alloc( size, alignment ))
+		return p;
+	throw std::bad_alloc();
+}
+
+void* operator new[]( std::size_t size, std::align_val_t alignment ){
+	if( void* p = counted_aligned_alloc( size, alignment ))
+		return p;
+	throw std::bad_alloc();
+}
+
+void* operator new( std::size_t size, std::align_val_t alignment, const std::nothrow_t& ) noexcept {
+	return counted_aligned_alloc( size, alignment );
+}
+
+void* operator new[]( std::size_t size, std::align_val_t alignment, const std::nothrow_t& ) noexcept {
+	return counted_aligned_alloc( size, alignment );
+}
+
+void operator delete( void* p ) noexcept { std::free( p ); }
+void operator delete[]( void* p ) noexcept { std::free( p ); }
+void operator delete( void* p, std::size_t ) noexcept { std::free( p ); }
+void operator delete[]( void* p, std::size_t ) noexcept { std::free( p ); }
+void operator delete( void* p, const std::nothrow_t& ) noexcept { std::free( p ); }
+void operator delete[]( void* p, const std::nothrow_t& ) noexcept { std::free( p ); }
+void operator delete( void* p, std::align_val_t ) noexcept { std::free( p ); }
+void operator delete[]( void* p, std::align_val_t ) noexcept { std::free( p ); }
+void operator delete( void* p, std::size_t, std::align_val_t ) noexcept { std::free( p ); }
+void operator delete[]( void* p, std::size_t, std::align_val_t ) noexcept { std::free( p ); }
+void operator delete( void* p, std::align_val_t, const std::nothrow_t& ) noexcept { std::free( p ); }
+void operator delete[]( void* p, std::align_val_t, const std::nothrow_t& ) noexcept { std::free( p ); }
+
+#endif //NDEBUG
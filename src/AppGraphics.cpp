@@ -16,14 +16,148 @@
 
 #include "AppGraphics.hpp"
 
+#include <cmath>
+#include <fstream>
+#include <set>
+
+#include <glm/gtc/matrix_transform.hpp>
+
 using namespace SpaceAppVideo;
 
 bool QueueFamilyIndices::complete(){
 	return graphics.has_value() && present.has_value();
 }
 
-SwapchainDetails::SwapchainDetails( vk::PhysicalDevice phys_dev, vk::UniqueSurfaceKHR& surf ){
-	capabilities = phys_dev.getSurfaceCapabilitiesKHR( *surf );
-	formats = phys_dev.getSurfaceFormatsKHR( *surf );
-	present_modes = phys_dev.getSurfacePresentModesKHR( *surf );
+uint32_t SpaceAppVideo::find_mem_type( vk::PhysicalDevice phys_dev, uint32_t type_filter, vk::MemoryPropertyFlags flags ){
+	auto memprops = phys_dev.getMemoryProperties();
+
+	for( uint32_t memIndex = 0; memIndex < memprops.memoryTypeCount; ++memIndex ){
+		if(( type_filter & ( 1 << memIndex )) && (( memprops.memoryTypes[memIndex].propertyFlags & flags ) == flags ))
+			return memIndex;
+	}
+
+	throw std::runtime_error( "No memory available" );
+}
+
+Buffer SpaceAppVideo::create_buffer( vk::PhysicalDevice phys_dev, vk::Device device, vk::DeviceSize size, vk::BufferUsageFlags usage,
+		vk::MemoryPropertyFlags flags, std::vector<uint32_t> queue_families ){
+	Buffer result;
+	result.size = size;
+
+	std::set<uint32_t> unique_families{ queue_families.begin(), queue_families.end() };
+	queue_families.assign( unique_families.begin(), unique_families.end() );
+
+	vk::BufferCreateInfo buf_cr_inf(
+			{},
+			size,
+			usage,
+			queue_families.size() > 1 ? vk::SharingMode::eConcurrent : vk::SharingMode::eExclusive,
+			queue_families.size() > 1 ? queue_families.size() : 0,
+			queue_families.size() > 1 ? queue_families.data() : nullptr
+		);
+
+	result.buffer = device.createBufferUnique( buf_cr_inf );
+
+	auto memreqs = device.getBufferMemoryRequirements( *result.buffer );
+
+	vk::MemoryAllocateInfo mem_alloc_inf(
+			memreqs.size,
+			find_mem_type( phys_dev, memreqs.memoryTypeBits, flags )
+		);
+
+	result.memory = device.allocateMemoryUnique( mem_alloc_inf );
+	device.bindBufferMemory( *result.buffer, *result.memory, 0 );
+
+	if( flags & vk::MemoryPropertyFlagBits::eHostVisible )
+		result.mapped = device.mapMemory( *result.memory, 0, size, {} );
+
+	return result;
+}
+
+glm::mat4 Camera::view() const {
+	return glm::lookAt( position, position + forward, up );
+}
+
+glm::mat4 Camera::projection( float aspect ) const {
+	float f = 1 / std::tan( fov / 2 );
+
+	glm::mat4 proj( 0 );
+	proj[0][0] = f / aspect;
+	proj[1][1] = -f;
+	proj[2][3] = -1;
+	proj[3][2] = z_near;
+	return proj;
+}
+
+glm::vec3 Camera::right() const {
+	return glm::normalize( glm::cross( forward, up ));
+}
+
+SwapchainDetails::SwapchainDetails( vk::PhysicalDevice phys_dev, vk::SurfaceKHR surf ){
+	capabilities = phys_dev.getSurfaceCapabilitiesKHR( surf );
+	formats = phys_dev.getSurfaceFormatsKHR( surf );
+	present_modes = phys_dev.getSurfacePresentModesKHR( surf );
+}
+
+constexpr uint32_t device_cache_magic{ 0x43564453 }; // "SDVC"
+constexpr uint32_t device_cache_version{ 1 };
+
+DeviceCache::DeviceCache( std::filesystem::path path, uint64_t ext_hash ): path( std::move( path )), ext_hash( ext_hash ){
+	std::ifstream file( this->path, std::ios::binary );
+	if( !file.is_open() )
+		return;
+
+	uint32_t magic, version;
+	uint64_t file_ext_hash, count;
+	file.read( reinterpret_cast<char*>( &magic ), sizeof( magic ));
+	file.read( reinterpret_cast<char*>( &version ), sizeof( version ));
+	file.read( reinterpret_cast<char*>( &file_ext_hash ), sizeof( file_ext_hash ));
+	file.read( reinterpret_cast<char*>( &count ), sizeof( count ));
+
+	// Different extensions are requested, all results are stale
+	if( !file || magic != device_cache_magic || version != device_cache_version || file_ext_hash != ext_hash )
+		return;
+
+	for( uint64_t i = 0; i < count; ++i ){
+		UUID uuid;
+		Entry entry;
+		file.read( reinterpret_cast<char*>( uuid.data() ), uuid.size() );
+		file.read( reinterpret_cast<char*>( &entry.driver_version ), sizeof( entry.driver_version ));
+		file.read( reinterpret_cast<char*>( &entry.score ), sizeof( entry.score ));
+		if( !file )
+			break;
+		entries[uuid] = entry;
+	}
+}
+
+std::optional<DeviceCache::Entry> DeviceCache::find( const UUID& uuid, uint32_t driver_version ) const {
+	auto it = entries.find( uuid );
+	if( it == entries.end() || it->second.driver_version != driver_version )
+		return {};
+	return it->second;
+}
+
+void DeviceCache::store( const UUID& uuid, Entry entry ){
+	entries[uuid] = entry;
+	dirty = true;
+}
+
+void DeviceCache::write(){
+	if( !dirty )
+		return;
+
+	std::ofstream file( path, std::ios::binary | std::ios::trunc );
+	uint64_t count = entries.size();
+	file.write( reinterpret_cast<const char*>( &device_cache_magic ), sizeof( device_cache_magic ));
+	file.write( reinterpret_cast<const char*>( &device_cache_version ), sizeof( device_cache_version ));
+	file.write( reinterpret_cast<const char*>( &ext_hash ), sizeof( ext_hash ));
+	file.write( reinterpret_cast<const char*>( &count ), sizeof( count ));
+
+	for( auto& [uuid, entry]: entries ){
+		file.write( reinterpret_cast<const char*>( uuid.data() ), uuid.size() );
+		file.write( reinterpret_cast<const char*>( &entry.driver_version ), sizeof( entry.driver_version ));
+		file.write( reinterpret_cast<const char*>( &entry.score ), sizeof( entry.score ));
+	}
+
+	dirty = false;
 }
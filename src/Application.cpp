@@ -17,53 +17,139 @@
 #include "Util.hpp"
 #include "Application.hpp"
 
+#include "StartupTracer.hpp"
+#include "AllocationCounter.hpp"
+
+#include <glm/gtc/quaternion.hpp>
+
 #include <set>
-#include <fstream>
+#include <future>
 #include <string.h>
 
 namespace fs = std::filesystem;
 
+// Number of frames the input latency is averaged over before it gets logged
+constexpr uint64_t latency_report_interval{ 1000 };
+// Frames after which draw_frame must not allocate anymore in debug builds
+constexpr uint64_t steady_state_frames{ 16 };
+// Time step of a frame in headless mode
+constexpr float headless_frame_time{ 1.0f / 60 };
+
 void SpaceApplication::operator()(){
-	init_window();
 	init_vk();
 	main_loop();
 	cleanup();
 }
 
+void SpaceApplication::run_headless( uint64_t frames ){
+	headless = true;
+	frame_limit = frames;
+	operator()();
+}
+
+void SpaceApplication::watch_config( Config::ConfigStore& store ){
+	config_store = &store;
+	config_store->watch();
+}
+
 void SpaceApplication::init_window(){
+	auto trace = startup_tracer.trace( "Create window" );
 	logger << LogChannel::Video << LogLevel::Info << "Started creating window";
 
-	glfwInit();
 	glfwWindowHint( GLFW_CLIENT_API, GLFW_NO_API );
-	window = glfwCreateWindow(
-			config.res.x,
-			config.res.y,
-			"SpaceApp", nullptr, nullptr );
 
+	// The main window comes first, the cockpit layout adds one to its left and one to its right
+	std::vector<int> columns{ 0 };
+	if( config.view_layout == Config::ViewLayout::Cockpit )
+		columns = { 0, -1, 1 };
+
+	for( int column: columns ){
+		GLFWwindow* window = glfwCreateWindow(
+				config.res.x,
+				config.res.y,
+				"SpaceApp", nullptr, nullptr );
+		if( !window )
+			throw std::runtime_error( "Failed to create window" );
+
+		if( columns.size() > 1 )
+			glfwSetWindowPos( window, ( column + 1 ) * config.res.x, 0 );
 
+		windows.push_back( window );
+	}
 }
 
 void SpaceApplication::init_vk(){
 	logger << LogChannel::Video << LogLevel::Info << "Started initialising Vulkan";
 
-	create_instance();
-	create_surface();
+	auto& registry = Metrics::registry();
+	metrics.frame_time_us = registry.histogram( "frame.time_us" );
+	metrics.draw_calls = registry.gauge( "frame.draw_calls" );
+	metrics.swapchain_recreations = registry.counter( "swapchain.recreations" );
+	metrics.frame_arena_peak_bytes = registry.gauge( "frame_arena.peak_bytes" );
+	metrics.culling_visible = registry.gauge( "culling.visible_instances" );
+	metrics.render_scale_percent = registry.gauge( "frame.render_scale_percent" );
+	metrics.gpu_time_us = registry.histogram( "frame.gpu_time_us" );
+	if( registry.exported() )
+		logger << LogChannel::Default << LogLevel::Info << "Exporting metrics to shared memory " << registry.segment_name();
+	else
+		logger << LogChannel::Default << LogLevel::Warning << "Could not create shared memory " << registry.segment_name() << ", metrics are not exported";
+
+	// Has to happen on the main thread and before the instance extensions can be queried
+	if( !headless ){
+		auto trace = startup_tracer.trace( "Init glfw" );
+		glfwInit();
+	}
+
+	thread_pool = std::make_unique<SpaceAppVideo::ThreadPool>();
+	shader_manager = std::make_unique<SpaceAppVideo::ShaderManager>( "res/shader", *thread_pool );
+
+	// Window creation is bound to the main thread, so the instance gets created on a worker instead
+	auto instance_created = std::async( std::launch::async, [this]{ create_instance(); });
+	if( !headless )
+		init_window();
+	instance_created.get();
+
+	create_views();
 	choose_physical_dev({});
 	create_device();
-	graphics_queue = device->getQueue( queue_indices.graphics.value(), 0 );
-	present_queue = device->getQueue( queue_indices.present.value(), 0 );
-	create_swapchain();
-	create_image_views();
+	shader_manager->set_device( *device );
+	gpu_waiter = std::make_unique<SpaceAppVideo::GpuWaiter>( *device, *thread_pool );
+	queue_manager->retrieve( *device );
+	present_queue = queue_manager->queue( SpaceAppVideo::QueueRole::Present );
 	create_render_pass();
-	create_pipeline();
-	create_framebuffers();
-	create_command_pool();
-	create_vertex_buffers();
-	alloc_command_buffers();
+	// Decides whether views get scene images, so before their targets are created
+	create_dynamic_resolution();
+	create_pipeline_variants();
+	create_lighting();
+	create_culling();
+
+	// Only the command buffers depend on the pipeline, everything else can be created in the meantime
+	auto pipeline_created = std::async( std::launch::async, [this]{ create_pipeline(); });
+	create_view_targets();
+	auto vertices_uploaded = upload_vertex_buffers();
+	vertices_uploaded.start();
 	create_semaphores();
+	pipeline_created.get();
+
+	create_particle_system();
+	create_starfield();
+	create_textures();
+	create_terrain();
+	create_scheduler();
+	configure_present_strategy();
+
+	// Nothing may be drawn before the copy arrived
+	SpaceAppVideo::sync_wait( vertices_uploaded );
+
+	shader_manager->watch( [this]{ rebuild_pipelines(); });
+#ifdef SHADER_SOURCE_DIR
+	shader_manager->watch_sources( SHADER_SOURCE_DIR, GLSLANG_VALIDATOR );
+#endif
 }
 
 void SpaceApplication::create_instance(){
+	auto trace = startup_tracer.trace( "Create instance" );
+
 	vk::ApplicationInfo appinfo( "SpaceApp", VK_MAKE_VERSION( 0, 1, 0 ), "SpaceEngine", VK_MAKE_VERSION( 0, 1, 0 ), VK_API_VERSION_1_2 );
 #ifndef NDEBUG
 
@@ -76,28 +162,33 @@ void SpaceApplication::create_instance(){
 			lmsg << "\n\t" << l.layerName;
 	}
 
+	auto av_exts = vk::enumerateInstanceExtensionProperties();
+	{
+		Logger::LoggerHelper lmsg = logger << LogChannel::Video << LogLevel::Verbose;
+		lmsg << "Available instance extensions:";
+
+		for( auto& l: av_exts )
+			lmsg << "\n\t" << l.extensionName;
+	}
+
 	const std::vector<const char*> layers = {
 		"VK_LAYER_KHRONOS_validation",
 		"VK_LAYER_MANGOHUD_overlay",
 //		"VK_LAYER_LUNARG_api_dump",
 	};
-#elif //NDEBUG
+#else //NDEBUG
 	const std::vector<const char*> layers;
 #endif //NDEBUG
-	uint32_t glfwExtensionCount = 0;
-	const char** glfwExtensions;
-
-	glfwExtensions = glfwGetRequiredInstanceExtensions( &glfwExtensionCount );
+	std::vector<const char*> extensions;
+	if( headless ){
+		extensions = { VK_KHR_SURFACE_EXTENSION_NAME, VK_EXT_HEADLESS_SURFACE_EXTENSION_NAME };
+	} else {
+		uint32_t glfwExtensionCount = 0;
+		const char** glfwExtensions;
 
-	const std::vector<const char*> extensions( glfwExtensions, glfwExtensions + glfwExtensionCount );
+		glfwExtensions = glfwGetRequiredInstanceExtensions( &glfwExtensionCount );
 
-	auto av_exts = vk::enumerateInstanceExtensionProperties();
-	{
-		Logger::LoggerHelper lmsg = logger << LogChannel::Video << LogLevel::Verbose;
-		lmsg << "Available instance extensions:";
-
-		for( auto& l: av_exts )
-			lmsg << "\n\t" << l.extensionName;
+		extensions.assign( glfwExtensions, glfwExtensions + glfwExtensionCount );
 	}
 
 	vk::InstanceCreateInfo instance_cr_inf( {}, &appinfo, layers.size(), layers.data(), extensions.size(), extensions.data() );
@@ -107,16 +198,43 @@ void SpaceApplication::create_instance(){
 	logger << LogChannel::Video << LogLevel::Info << "Created instance";
 }
 
-void SpaceApplication::create_surface(){
-	VkSurfaceKHR temp;
-	glfwCreateWindowSurface( *instance, window, nullptr, &temp );
-	surface = vk::UniqueSurfaceKHR{ temp, *instance };
-	logger << LogChannel::Video << LogLevel::Info << "Created surface";
-}
+void SpaceApplication::create_views(){
+	auto trace = startup_tracer.trace( "Create views" );
 
-static std::set<std::string> get_missing_dev_extensions( vk::PhysicalDevice dev, const std::vector<const char*>& extensions ){
-	auto available_exts = dev.enumerateDeviceExtensionProperties();
+	if( headless ){
+		auto create_headless_surface = reinterpret_cast<PFN_vkCreateHeadlessSurfaceEXT>( instance->getProcAddr( "vkCreateHeadlessSurfaceEXT" ));
+		if( !create_headless_surface )
+			throw std::runtime_error( "VK_EXT_headless_surface not available" );
 
+		VkSurfaceKHR temp;
+		VkHeadlessSurfaceCreateInfoEXT cr_inf{ VK_STRUCTURE_TYPE_HEADLESS_SURFACE_CREATE_INFO_EXT, nullptr, 0 };
+		if( create_headless_surface( *instance, &cr_inf, nullptr, &temp ) != VK_SUCCESS )
+			throw std::runtime_error( "Failed to create headless surface" );
+
+		views.push_back( std::make_unique<SpaceAppVideo::View>( "main", nullptr, vk::UniqueSurfaceKHR{ temp, *instance }, SpaceAppVideo::ViewPlacement{} ));
+	} else {
+		const char* names[] = { "main", "left", "right" };
+		const int columns[] = { 0, -1, 1 };
+
+		for( size_t i = 0; i < windows.size(); ++i ){
+			VkSurfaceKHR temp;
+			if( glfwCreateWindowSurface( *instance, windows[i], nullptr, &temp ) != VK_SUCCESS )
+				throw std::runtime_error( "Failed to create window surface" );
+
+			views.push_back( std::make_unique<SpaceAppVideo::View>( names[i], windows[i], vk::UniqueSurfaceKHR{ temp, *instance },
+						SpaceAppVideo::ViewPlacement{ columns[i], false }));
+		}
+		// Owned by the views now
+		windows.clear();
+	}
+
+	if( config.tactical_map )
+		views.push_back( std::make_unique<SpaceAppVideo::View>( "tactical", vk::Extent2D{ 1024, 1024 }, SpaceAppVideo::ViewPlacement{ 0, true }));
+
+	logger << LogChannel::Video << LogLevel::Info << "Created " << views.size() << " view(s)";
+}
+
+static std::set<std::string> get_missing_dev_extensions( const std::vector<vk::ExtensionProperties>& available_exts, const std::vector<const char*>& extensions ){
 	std::set<std::string> req_exts{ extensions.begin(), extensions.end() };
 
 	for( auto& ext: available_exts ){
@@ -126,98 +244,139 @@ static std::set<std::string> get_missing_dev_extensions( vk::PhysicalDevice dev,
 	return req_exts;
 }
 
-void SpaceApplication::choose_physical_dev( const std::vector<vk::ExtensionProperties>& required_exts ){
-	auto physical_devs{ instance->enumeratePhysicalDevices() };
+/**
+ *	Scores a device on everything that does not depend on the surface, 0 means unsuitable
+ */
+static uint64_t rate_physical_dev( vk::PhysicalDevice phys_dev, const vk::PhysicalDeviceProperties& properties,
+		const std::vector<vk::ExtensionProperties>& required_exts, const std::vector<const char*>& dev_exts ){
+	std::vector<vk::ExtensionProperties> exts = phys_dev.enumerateDeviceExtensionProperties();
 
-	size_t best_score = 0;
-	std::string best_name;
+	for( auto& ext: required_exts ){
+		if( std::find( exts.begin(), exts.end(), ext ) == exts.end())
+			return 0;
+	}
 
-	for( auto& phys_dev: physical_devs ){
-		size_t score = 0;
-		std::vector<vk::ExtensionProperties> exts = phys_dev.enumerateDeviceExtensionProperties();
+	if( !get_missing_dev_extensions( exts, dev_exts ).empty() )
+		return 0;
 
-		bool supported = true;
-		for( auto& ext: required_exts ){
-			if( std::find( exts.begin(), exts.end(), ext ) == exts.end()){
-				supported = false;
-			}
-		}
+	uint64_t score = 1;
+	if( properties.deviceType == vk::PhysicalDeviceType::eDiscreteGpu )
+		score += 50000;
+	else if( properties.deviceType == vk::PhysicalDeviceType::eIntegratedGpu )
+		score += 5000;
 
-		if( !supported )
-			continue;
+	score += properties.limits.maxImageDimension2D;
 
-		auto qfindices = find_queue_families( phys_dev );
-		if( !qfindices.complete() )
-			continue;
+	return score;
+}
 
-		if( !get_missing_dev_extensions( phys_dev, dev_exts ).empty() )
-			continue;
+void SpaceApplication::choose_physical_dev( const std::vector<vk::ExtensionProperties>& required_exts ){
+	auto trace = startup_tracer.trace( "Choose physical device" );
 
-		SpaceAppVideo::SwapchainDetails swapchain_details( phys_dev, surface );
-		if( swapchain_details.formats.empty() || swapchain_details.present_modes.empty() )
-			continue;
+	auto physical_devs{ instance->enumeratePhysicalDevices() };
 
+	// FNV-1a over all requested extensions, so the cache gets invalidated if they change
+	uint64_t ext_hash = 14695981039346656037ull;
+	auto hash_str = [&ext_hash]( const char* str ){
+		for( ; *str; ++str )
+			ext_hash = ( ext_hash ^ static_cast<uint8_t>( *str )) * 1099511628211ull;
+		ext_hash = ( ext_hash ^ 0xff ) * 1099511628211ull;
+	};
+	for( auto& ext: dev_exts )
+		hash_str( ext );
+	for( auto& ext: required_exts )
+		hash_str( ext.extensionName );
 
-		auto properties = phys_dev.getProperties();
-		if( properties.deviceType == vk::PhysicalDeviceType::eDiscreteGpu )
-			score += 50000;
-		else if( properties.deviceType == vk::PhysicalDeviceType::eIntegratedGpu )
-			score += 5000;
+	SpaceAppVideo::DeviceCache cache( "./device.cache", ext_hash );
 
-		score += properties.limits.maxImageDimension2D;
+	struct Candidate {
+		uint64_t score;
+		vk::PhysicalDevice dev;
+		std::string name;
+	};
+	std::vector<Candidate> candidates;
+
+	for( auto& phys_dev: physical_devs ){
+		auto props_chain = phys_dev.getProperties2<vk::PhysicalDeviceProperties2, vk::PhysicalDeviceIDProperties>();
+		auto& properties = props_chain.get<vk::PhysicalDeviceProperties2>().properties;
+		auto& id_properties = props_chain.get<vk::PhysicalDeviceIDProperties>();
+
+		SpaceAppVideo::DeviceCache::UUID uuid;
+		std::copy( id_properties.deviceUUID.begin(), id_properties.deviceUUID.end(), uuid.begin() );
+
+		uint64_t score;
+		if( auto cached = cache.find( uuid, properties.driverVersion )){
+			score = cached->score;
+		} else {
+			score = rate_physical_dev( phys_dev, properties, required_exts, dev_exts );
+			cache.store( uuid, { properties.driverVersion, score });
+		}
 
-		logger << LogChannel::Video << LogLevel::Verbose << "Found suitable physical device " <<
+		if( score == 0 )
+			continue;
+
+		logger << LogChannel::Video << LogLevel::Verbose << "Found physical device " <<
 			properties.deviceName << " with score " << score;
 
-		if( score > best_score ){
-			swapchain_support = swapchain_details;
-			best_name = std::string( properties.deviceName );
-			best_score = score;
-			this->phys_dev = phys_dev;
-		}
+		candidates.push_back({ score, phys_dev, std::string( properties.deviceName )});
 	}
 
-	logger << LogChannel::Video << LogLevel::Info << "Chose physical device " << best_name << " with score of " << best_score;
-}
+	cache.write();
 
-SpaceAppVideo::QueueFamilyIndices SpaceApplication::find_queue_families( vk::PhysicalDevice phys_dev ){
-	SpaceAppVideo::QueueFamilyIndices indices;
+	std::sort( candidates.begin(), candidates.end(), []( auto& a, auto& b ){ return a.score > b.score; });
 
-	auto qfprops = phys_dev.getQueueFamilyProperties();
+	// The surface dependent checks only have to run until the first device passes them
+	for( auto& candidate: candidates ){
+		auto qfindices = find_queue_families( candidate.dev );
+		if( !qfindices.complete() )
+			continue;
 
-	for( size_t i = 0; i < qfprops.size(); ++i ){
-		if( qfprops[i].queueFlags & vk::QueueFlagBits::eGraphics )
-			indices.graphics = i;
+		// Every other presenting view is checked against the chosen device once its swapchain is created
+		SpaceAppVideo::SwapchainDetails swapchain_details( candidate.dev, views.front()->surface() );
+		if( swapchain_details.formats.empty() || swapchain_details.present_modes.empty() )
+			continue;
 
-		if( phys_dev.getSurfaceSupportKHR( i, *surface ))
-			indices.present = i;
+		phys_dev = candidate.dev;
 
-		if( indices.complete())
-			break;
+		logger << LogChannel::Video << LogLevel::Info << "Chose physical device " << candidate.name << " with score of " << candidate.score;
+		return;
 	}
 
-	return indices;
+	throw std::runtime_error( "No suitable physical device found" );
+}
+
+SpaceAppVideo::QueueFamilyIndices SpaceApplication::find_queue_families( vk::PhysicalDevice phys_dev ){
+	return SpaceAppVideo::QueueManager::find_families( phys_dev, views.front()->surface() );
 }
 
 void SpaceApplication::create_device(){
-	queue_indices = find_queue_families( phys_dev );
+	auto trace = startup_tracer.trace( "Create device" );
 
-	std::vector<vk::DeviceQueueCreateInfo> dev_q_cr_infs;
-	std::set<uint32_t> unique_families{ queue_indices.graphics.value(), queue_indices.present.value() };
+	queue_indices = find_queue_families( phys_dev );
+	queue_manager = std::make_unique<SpaceAppVideo::QueueManager>( phys_dev, queue_indices );
+	auto& dev_q_cr_infs = queue_manager->create_infos();
 
-	const float priorities[] = { 1.0f };
+	sparse_textures = SpaceAppVideo::TextureStreamer::sparse_supported( phys_dev, *queue_indices.graphics );
 
-	for( auto qf: unique_families ){
-		dev_q_cr_infs.push_back({ {}, qf, 1, priorities });
+	vk::PhysicalDeviceFeatures features;
+	features.sparseBinding = sparse_textures;
+	features.sparseResidencyImage2D = sparse_textures;
+
+	std::vector<const char*> enabled_exts{ dev_exts };
+	auto available_exts = phys_dev.enumerateDeviceExtensionProperties();
+	for( auto& ext: optional_dev_exts ){
+		if( std::find_if( available_exts.begin(), available_exts.end(), [ext]( auto& e ){ return strcmp( e.extensionName, ext ) == 0; }) != available_exts.end() )
+			enabled_exts.push_back( ext );
 	}
 
-	vk::PhysicalDeviceFeatures features;
+	pipeline_feedback_supported = std::find_if( enabled_exts.begin(), enabled_exts.end(),
+			[]( auto e ){ return strcmp( e, VK_EXT_PIPELINE_CREATION_FEEDBACK_EXTENSION_NAME ) == 0; }) != enabled_exts.end();
 
 	vk::DeviceCreateInfo dev_cr_inf(
 			{},
 			dev_q_cr_infs.size(), dev_q_cr_infs.data(),
 			0, nullptr,
-			dev_exts.size(), dev_exts.data(),
+			enabled_exts.size(), enabled_exts.data(),
 			&features
 		);
 
@@ -225,133 +384,52 @@ void SpaceApplication::create_device(){
 	logger << LogChannel::Video << LogLevel::Info << "Created a logical device";
 }
 
-void SpaceApplication::create_swapchain(){
-	vk::SurfaceFormatKHR format = choose_swapchain_surface_format();
-	vk::PresentModeKHR present_mode = choose_swapchain_present_mode();
-	vk::Extent2D extent = choose_swapchain_extent();
+void SpaceApplication::create_view_targets(){
+	auto trace = startup_tracer.trace( "Create view targets" );
 
-	uint32_t image_count = swapchain_support.capabilities.minImageCount + 1;
-	if( swapchain_support.capabilities.maxImageCount > 0 && swapchain_support.capabilities.maxImageCount < image_count )
-		image_count = swapchain_support.capabilities.maxImageCount;
-
-	vk::SwapchainCreateInfoKHR cr_inf(
-			{},
-			*surface,
-			image_count,
-			format.format,
-			format.colorSpace,
-			extent,
-			1,
-			vk::ImageUsageFlagBits::eColorAttachment,
-			vk::SharingMode::eExclusive,
-			{},
-			nullptr,
-			swapchain_support.capabilities.currentTransform,
-			vk::CompositeAlphaFlagBitsKHR::eOpaque,
-			present_mode,
-			true,
-			{} );
-
-	uint32_t queue_family_indices[] = { queue_indices.graphics.value(), queue_indices.present.value() };
-	if( queue_indices.graphics != queue_indices.present ){
-		cr_inf.imageSharingMode = vk::SharingMode::eConcurrent;
-		cr_inf.queueFamilyIndexCount = 2;
-		cr_inf.pQueueFamilyIndices = queue_family_indices;
-	}
+	for( auto& view: views )
+		view->create_target( phys_dev, *device, queue_indices, render_format,
+				!view->presents() ? *offscreen_render_pass : dynamic_resolution ? *scaled_render_pass : *render_pass );
 
-	swapchain = device->createSwapchainKHRUnique( cr_inf );
-	logger << LogChannel::Video << LogLevel::Info << "Successfully created a swapchain";
-
-	swapchain_imgs = device->getSwapchainImagesKHR( *swapchain );
-	swapchain_img_fmt = format.format;
-	swapchain_img_size = extent;
-}
-
-vk::SurfaceFormatKHR SpaceApplication::choose_swapchain_surface_format(){
-	for( const auto& format: swapchain_support.formats ){
-		if( format.format == vk::Format::eB8G8R8A8Srgb && format.colorSpace == vk::ColorSpaceKHR::eSrgbNonlinear )
-			return format;
-	}
-
-	logger << LogChannel::Video << LogLevel::Warning <<
-		"Preferred surfaceformat/colorspace not available. Falling back to " <<
-		vk::to_string( swapchain_support.formats[0].format ) << " / " <<
-		vk::to_string( swapchain_support.formats[0].format );
-
-	return swapchain_support.formats[0];
-}
-
-vk::PresentModeKHR SpaceApplication::choose_swapchain_present_mode(){
-	for( const auto& mode: swapchain_support.present_modes ){
-		if( mode == vk::PresentModeKHR::eMailbox )
-			return mode;
-	}
-	logger << LogChannel::Video << LogLevel::Warning <<
-		"Preferred presentmode not available. Falling back to FIFO";
-	return vk::PresentModeKHR::eFifo;
+	auto extent = views.front()->extent();
+	config.res = { extent.width, extent.height };
 }
 
-vk::Extent2D SpaceApplication::choose_swapchain_extent(){
-	if( swapchain_support.capabilities.currentExtent.width != std::numeric_limits<uint32_t>::max() ){
-		config.res.x = swapchain_support.capabilities.currentExtent.width;
-		config.res.y = swapchain_support.capabilities.currentExtent.height;
-		return swapchain_support.capabilities.currentExtent;
-	}
-
-	if( !config.fullscreen ){
-		int width, height;
-		glfwGetFramebufferSize( window, &width, &height );
-		config.res.x = width;
-		config.res.y = height;
-	}
-
-	vk::Extent2D window_size{ config.res.x, config.res.y };
-	window_size.width = std::max( swapchain_support.capabilities.minImageExtent.width,
-			std::min( swapchain_support.capabilities.maxImageExtent.width, window_size.width ));
-	window_size.height = std::max( swapchain_support.capabilities.minImageExtent.height,
-			std::min( swapchain_support.capabilities.maxImageExtent.height, window_size.height ));
-
-	return window_size;
-}
-
-void SpaceApplication::create_image_views(){
-	swapchain_img_views.clear();
-
-	for( size_t i = 0; i < swapchain_imgs.size(); ++i ){
-		vk::ImageViewCreateInfo cr_inf;
-		cr_inf.image = swapchain_imgs[i];
-		cr_inf.viewType = vk::ImageViewType::e2D;
-		cr_inf.format = swapchain_img_fmt;
-		cr_inf.components = vk::ComponentMapping(
-				vk::ComponentSwizzle::eIdentity,
-				vk::ComponentSwizzle::eIdentity,
-				vk::ComponentSwizzle::eIdentity,
-				vk::ComponentSwizzle::eIdentity );
-		cr_inf.subresourceRange = vk::ImageSubresourceRange(
-				vk::ImageAspectFlagBits::eColor,
-				0, 1,
-				0, 1);
-
-		swapchain_img_views.push_back( device->createImageViewUnique( cr_inf ));
-	}
+void SpaceApplication::create_render_pass(){
+	auto trace = startup_tracer.trace( "Create render pass" );
 
-	logger << LogChannel::Video << LogLevel::Info << "Created " << swapchain_imgs.size() << " image views";
-}
+	// Every view has to render in the same format, so pipelines can be shared
+	render_format = views.front()->preferred_format( phys_dev ).format;
 
-void SpaceApplication::create_render_pass(){
-	vk::AttachmentDescription attachment_description(
-			{},
-			swapchain_img_fmt,
-			vk::SampleCountFlagBits::e1,
-			vk::AttachmentLoadOp::eClear,
-			vk::AttachmentStoreOp::eStore,
-			vk::AttachmentLoadOp::eDontCare,
-			vk::AttachmentStoreOp::eDontCare,
-			vk::ImageLayout::eUndefined,
-			vk::ImageLayout::ePresentSrcKHR
-		);
+	// The early pass leaves depth readable for building the occlusion pyramid, the late pass loads both and
+	// finishes the image. Depth is not needed after it
+	std::array<vk::AttachmentDescription, 2> attachment_descriptions{
+		vk::AttachmentDescription(
+				{},
+				render_format,
+				vk::SampleCountFlagBits::e1,
+				vk::AttachmentLoadOp::eClear,
+				vk::AttachmentStoreOp::eStore,
+				vk::AttachmentLoadOp::eDontCare,
+				vk::AttachmentStoreOp::eDontCare,
+				vk::ImageLayout::eUndefined,
+				vk::ImageLayout::eColorAttachmentOptimal
+			),
+		vk::AttachmentDescription(
+				{},
+				SpaceAppVideo::DEPTH_FORMAT,
+				vk::SampleCountFlagBits::e1,
+				vk::AttachmentLoadOp::eClear,
+				vk::AttachmentStoreOp::eStore,
+				vk::AttachmentLoadOp::eDontCare,
+				vk::AttachmentStoreOp::eDontCare,
+				vk::ImageLayout::eUndefined,
+				vk::ImageLayout::eDepthStencilReadOnlyOptimal
+			),
+	};
 
 	vk::AttachmentReference attachment_reference( 0, vk::ImageLayout::eColorAttachmentOptimal );
+	vk::AttachmentReference depth_reference( 1, vk::ImageLayout::eDepthStencilAttachmentOptimal );
 
 	std::vector attachment_references{ attachment_reference };
 	vk::SubpassDescription subpass_description(
@@ -360,385 +438,730 @@ void SpaceApplication::create_render_pass(){
 			{},
 			attachment_references,
 			{},
-			{},
+			&depth_reference,
 			{}
 		);
 
-	vk::SubpassDependency sub_dependency(
-			VK_SUBPASS_EXTERNAL, 0,
-			vk::PipelineStageFlagBits::eColorAttachmentOutput, vk::PipelineStageFlagBits::eColorAttachmentOutput,
-			{}, vk::AccessFlagBits::eColorAttachmentWrite,
-			{}
-		);
+	// The same for every pass, so they stay compatible. The pyramid is built between the passes and the next
+	// frame's early pass must not clear depth while it is read
+	auto attachment_stages = vk::PipelineStageFlagBits::eColorAttachmentOutput |
+		vk::PipelineStageFlagBits::eEarlyFragmentTests | vk::PipelineStageFlagBits::eLateFragmentTests;
+	auto attachment_access = vk::AccessFlagBits::eColorAttachmentRead | vk::AccessFlagBits::eColorAttachmentWrite |
+		vk::AccessFlagBits::eDepthStencilAttachmentRead | vk::AccessFlagBits::eDepthStencilAttachmentWrite;
+	std::array<vk::SubpassDependency, 2> sub_dependencies{
+		vk::SubpassDependency(
+				VK_SUBPASS_EXTERNAL, 0,
+				attachment_stages | vk::PipelineStageFlagBits::eComputeShader, attachment_stages,
+				vk::AccessFlagBits::eColorAttachmentWrite | vk::AccessFlagBits::eDepthStencilAttachmentWrite, attachment_access,
+				{}
+			),
+		vk::SubpassDependency(
+				0, VK_SUBPASS_EXTERNAL,
+				attachment_stages, attachment_stages | vk::PipelineStageFlagBits::eComputeShader,
+				vk::AccessFlagBits::eColorAttachmentWrite | vk::AccessFlagBits::eDepthStencilAttachmentWrite,
+				attachment_access | vk::AccessFlagBits::eShaderRead,
+				{}
+			),
+	};
 
 	vk::RenderPassCreateInfo render_pass_info(
 			{},
-			1, &attachment_description,
+			attachment_descriptions.size(), attachment_descriptions.data(),
 			1, &subpass_description,
-			1, &sub_dependency
+			sub_dependencies.size(), sub_dependencies.data()
 		);
 
+	early_render_pass = device->createRenderPassUnique( render_pass_info );
+
+	auto& color = attachment_descriptions[0];
+	color.loadOp = vk::AttachmentLoadOp::eLoad;
+	color.initialLayout = vk::ImageLayout::eColorAttachmentOptimal;
+	color.finalLayout = vk::ImageLayout::ePresentSrcKHR;
+	auto& depth = attachment_descriptions[1];
+	depth.loadOp = vk::AttachmentLoadOp::eLoad;
+	depth.storeOp = vk::AttachmentStoreOp::eDontCare;
+	depth.initialLayout = vk::ImageLayout::eDepthStencilReadOnlyOptimal;
+	depth.finalLayout = vk::ImageLayout::eDepthStencilAttachmentOptimal;
 	render_pass = device->createRenderPassUnique( render_pass_info );
-	logger << LogChannel::Video << LogLevel::Info << "Created a render pass";
-}
 
-vk::UniqueShaderModule SpaceApplication::create_shader_module( const fs::path& path ){
-	std::ifstream code_file( path, std::ios::ate | std::ios::binary );
+	// Offscreen views are sampled from afterwards instead
+	color.finalLayout = vk::ImageLayout::eShaderReadOnlyOptimal;
+	offscreen_render_pass = device->createRenderPassUnique( render_pass_info );
 
-	if( !code_file.is_open()){
-		logger << LogChannel::Video << LogLevel::Error << "Could not open file: " << path;
-		throw std::runtime_error( "Could not open file" );
-	}
+	color.finalLayout = vk::ImageLayout::eTransferSrcOptimal;
+	scaled_render_pass = device->createRenderPassUnique( render_pass_info );
+
+	logger << LogChannel::Video << LogLevel::Info << "Created render passes";
+}
 
-	size_t file_size = ( size_t )code_file.tellg();
-	std::vector<char> code( file_size );
+void SpaceApplication::recreate_view( SpaceAppVideo::View& view ){
+	Debug::AllowAllocations allow_allocations;
 
-	code_file.seekg( 0 );
-	code_file.read( code.data(), file_size );
+	view.wait_until_visible();
 
-	code_file.close();
+	device->waitIdle();
 
-	vk::ShaderModuleCreateInfo cr_inf( vk::ShaderModuleCreateFlags{}, code.size(), reinterpret_cast<const uint32_t*>( code.data() ));
+	// The format stays the same, so render passes and pipelines are still valid
+	view.create_target( phys_dev, *device, queue_indices, render_format, view.render_pass() );
+	metrics.swapchain_recreations.add();
+	if( &view == views.front().get() ){
+		auto extent = view.extent();
+		config.res = { extent.width, extent.height };
+	}
 
-	return device->createShaderModuleUnique( cr_inf );
+	logger << LogChannel::Video << LogLevel::Info << "Recreated view " << view.name();
 }
 
 void SpaceApplication::recreate_swapchain(){
-	swapchain_support = { phys_dev, surface };
+	for( auto& view: views )
+		recreate_view( *view );
+}
+
+void SpaceApplication::create_pipeline_variants(){
+	pipeline_variants = std::make_unique<SpaceAppVideo::PipelineVariants>( phys_dev, *device, *shader_manager, "./pipeline.cache", pipeline_feedback_supported );
+}
+
+void SpaceApplication::create_pipeline(){
+	auto trace = startup_tracer.trace( "Create pipeline" );
 
-	int width = 0, height = 0;
-	glfwGetFramebufferSize(window, &width, &height);
-	while (width == 0 || height == 0) {
-		glfwGetFramebufferSize(window, &width, &height);
-		glfwWaitEvents();
+	std::scoped_lock lock( pipeline_mutex );
+
+	if( !pipeline_layout ){
+		std::array<vk::DescriptorSetLayout, 2> set_layouts{ lighting->set_layout(), culling->set_layout() };
+		vk::PushConstantRange push_range( vk::ShaderStageFlagBits::eVertex | vk::ShaderStageFlagBits::eFragment, 0, sizeof( SpaceAppVideo::ClusterParams ));
+		vk::PipelineLayoutCreateInfo pipeline_layout_info(
+				{},
+				set_layouts.size(), set_layouts.data(),
+				1, &push_range
+			);
+
+		pipeline_layout = device->createPipelineLayoutUnique( pipeline_layout_info );
 	}
 
-	device->waitIdle();
+	// Everything any material can ask for, so no variant has to be built mid-flight
+	pipelines = pipeline_variants->build( SpaceAppVideo::material_permutations(), *render_pass, *pipeline_layout );
 
-	create_swapchain();
-	create_image_views();
-	create_render_pass();
-	create_pipeline();
-	create_framebuffers();
-	alloc_command_buffers();
+	// Anything built in the background is outdated now
+	pending_pipelines.clear();
+	pipelines_pending = false;
 
-	logger << LogChannel::Video << LogLevel::Info << "Recreated swapchain";
+	logger << LogChannel::Video << LogLevel::Info << "Created " << pipelines.size() << " pipeline variants";
 }
 
-void SpaceApplication::create_pipeline(){
-	auto vert = create_shader_module( "res/shader/basic.vert.glsl.spv" );
-	auto frag = create_shader_module( "res/shader/basic.frag.glsl.spv" );
+vk::Pipeline SpaceApplication::get_pipeline( SpaceAppVideo::PipelineKey key ){
+	std::scoped_lock lock( pipeline_mutex );
 
-	logger << LogChannel::Video << LogLevel::Info << "Created shader modules";
+	if( auto it = pipelines.find( key.pack() ); it != pipelines.end() )
+		return *it->second;
 
-	std::vector<vk::PipelineShaderStageCreateInfo> stage_infos{
-			{ {}, vk::ShaderStageFlagBits::eVertex, *vert, "main", {} },
-			{ {}, vk::ShaderStageFlagBits::eFragment, *frag, "main", {} },
-		};
+	logger << LogChannel::Video << LogLevel::Warning << "Pipeline variant " << key.pack() << " was not precompiled, building it now";
 
-	auto bindings = SpaceAppVideo::Vertex::getBindingDesc();
-	auto attribs = SpaceAppVideo::Vertex::getAttribDescs();
+	auto built = pipeline_variants->build({ key }, *render_pass, *pipeline_layout );
+	auto& pipeline = pipelines[key.pack()] = std::move( built.begin()->second );
 
-	vk::PipelineVertexInputStateCreateInfo vertex_input_info(
-			{},
-			bindings,
-			attribs
-		);
+	return *pipeline;
+}
 
-	vk::PipelineInputAssemblyStateCreateInfo input_assembly_info(
-			{},
-			vk::PrimitiveTopology::eTriangleList,
-			VK_FALSE
-		);
+void SpaceApplication::rebuild_pipelines(){
+	std::vector<SpaceAppVideo::PipelineKey> keys;
+	{
+		std::scoped_lock lock( pipeline_mutex );
+		for( auto& [key, pipeline]: pipelines )
+			keys.push_back( SpaceAppVideo::PipelineKey::unpack( key ));
+	}
 
-	vk::Viewport viewport(
-			0, 0,
-			(float)swapchain_img_size.width, (float)swapchain_img_size.height,
-			0, 1
-		);
+	try {
+		// Compiled without the lock, the render thread keeps drawing with the old pipelines meanwhile
+		auto rebuilt = pipeline_variants->build( keys, *render_pass, *pipeline_layout );
+
+		std::scoped_lock lock( pipeline_mutex );
+		pending_pipelines = std::move( rebuilt );
+		pipelines_pending = true;
+		logger << LogChannel::Video << LogLevel::Info << "Rebuilt pipelines in the background";
+	} catch( std::exception& e ){
+		logger << LogChannel::Video << LogLevel::Error << "Failed to rebuild pipelines, keeping the old ones: " << e.what();
+	}
+}
 
-	vk::Rect2D scissor(
-			{},
-			swapchain_img_size
-		);
+void SpaceApplication::swap_pending_pipelines(){
+	SpaceAppVideo::FixedVector<vk::Fence, SpaceAppVideo::MAX_FRAMES_IN_FLIGHT> fences;
+	for( auto& f: inflight_fences )
+		fences.push_back( *f );
 
-	std::vector viewports{ viewport };
-	std::vector scissors{ scissor };
-	vk::PipelineViewportStateCreateInfo viewport_state_info(
-			{},
-			viewports,
-			scissors
-		);
+	// The command buffers in flight reference the old pipelines
+	if( vk::Result::eSuccess != device->waitForFences( fences.size(), fences.data(), VK_TRUE, UINT64_MAX ))
+		throw std::runtime_error( "Wait for fence failed" );
 
-	vk::PipelineRasterizationStateCreateInfo rasterization_state_info(
-			{},
-			VK_FALSE,
-			VK_FALSE,
-			vk::PolygonMode::eFill,
-			vk::CullModeFlagBits::eBack,
-			vk::FrontFace::eClockwise,
-			VK_FALSE,
-			0,
-			0,
-			0,
-			1
-		);
+	std::scoped_lock lock( pipeline_mutex );
 
-	vk::PipelineMultisampleStateCreateInfo multisample_state_info(
-			{},
-			vk::SampleCountFlagBits::e1,
-			VK_FALSE,
-			1,
-			nullptr,
-			VK_FALSE,
-			VK_FALSE
-		);
+	pipelines = std::move( pending_pipelines );
+	pending_pipelines.clear();
+	pipelines_pending = false;
+}
 
-	vk::PipelineColorBlendAttachmentState color_blend_attachment(
-			VK_FALSE,
-			vk::BlendFactor::eOne,
-			vk::BlendFactor::eZero,
-			vk::BlendOp::eAdd,
-			vk::BlendFactor::eOne,
-			vk::BlendFactor::eZero,
-			vk::BlendOp::eAdd,
-			vk::ColorComponentFlagBits::eR | vk::ColorComponentFlagBits::eG | vk::ColorComponentFlagBits::eB | vk::ColorComponentFlagBits::eA
-		);
+SpaceAppVideo::Task<> SpaceApplication::upload_vertex_buffers(){
+	auto trace = startup_tracer.trace( "Upload vertex buffers" );
 
-	std::vector color_blend_attachments{ color_blend_attachment };
-	vk::PipelineColorBlendStateCreateInfo color_blend_info(
-			{},
-			VK_FALSE,
-			vk::LogicOp::eCopy,
-			color_blend_attachments,
-			{ 0, 0, 0, 0 } //TODO may not work
-		);
+	vk::DeviceSize size = sizeof( vertices[0] ) * vertices.size();
+	auto staging = SpaceAppVideo::create_buffer( phys_dev, *device, size, vk::BufferUsageFlagBits::eTransferSrc,
+			vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent );
+	memcpy( staging.mapped, vertices.data(), size );
 
-	vk::PipelineLayoutCreateInfo pipeline_layout_info(
-			{},
-			{},
-			{}
-		);
+	vertex_buffer = SpaceAppVideo::create_buffer( phys_dev, *device, size,
+			vk::BufferUsageFlagBits::eVertexBuffer | vk::BufferUsageFlagBits::eTransferDst, vk::MemoryPropertyFlagBits::eDeviceLocal );
 
-	pipeline_layout = device->createPipelineLayoutUnique( pipeline_layout_info );
+	auto graphics = SpaceAppVideo::QueueRole::Graphics;
+	auto cmd_pool = device->createCommandPoolUnique({ vk::CommandPoolCreateFlagBits::eTransient, queue_manager->family( graphics )});
+	auto cmds = device->allocateCommandBuffersUnique({ *cmd_pool, vk::CommandBufferLevel::ePrimary, 1 });
+	vk::CommandBuffer cmd = *cmds[0];
 
-	vk::GraphicsPipelineCreateInfo pipeline_create_info(
-			{},
-			stage_infos,
-			&vertex_input_info,
-			&input_assembly_info,
-			nullptr,
-			&viewport_state_info,
-			&rasterization_state_info,
-			&multisample_state_info,
-			nullptr,
-			&color_blend_info,
-			nullptr,
-			*pipeline_layout,
-			*render_pass,
-			0,
-			vk::Pipeline{},
-			-1
-		);
+	cmd.begin( vk::CommandBufferBeginInfo( vk::CommandBufferUsageFlagBits::eOneTimeSubmit ));
+	cmd.copyBuffer( *staging.buffer, *vertex_buffer.buffer, vk::BufferCopy( 0, 0, size ));
+	// Every later submission on the queue reads the vertices
+	vk::MemoryBarrier barrier( vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eVertexAttributeRead );
+	cmd.pipelineBarrier( vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eVertexInput, {}, barrier, {}, {} );
+	cmd.end();
 
-	std::vector pipeline_create_infos{ pipeline_create_info };
-	pipelines = device->createGraphicsPipelinesUnique( {}, pipeline_create_infos ).value;
+	// Submitted from the thread that started the task, the queue is only used from there during startup
+	auto fence = device->createFenceUnique({});
+	queue_manager->queue( graphics ).submit( vk::SubmitInfo( 0, nullptr, nullptr, 1, &cmd ), *fence );
 
-	logger << LogChannel::Video << LogLevel::Info << "Created a pipeline";
+	// The rest of startup continues meanwhile, staging and command buffer are freed on the pool once the copy is done
+	co_await gpu_waiter->wait( *fence );
 }
 
-void SpaceApplication::create_framebuffers(){
-	swapchain_framebuffers.resize( swapchain_img_views.size() );
+void SpaceApplication::create_particle_system(){
+	auto trace = startup_tracer.trace( "Create particle system" );
 
-	for( size_t i = 0; i < swapchain_img_views.size(); ++i ){
-		std::vector<vk::ImageView> attachments{ *swapchain_img_views[i] };
+	particles = std::make_unique<SpaceAppVideo::ParticleSystem>( phys_dev, *device, *shader_manager, pipeline_variants->pipeline_cache() );
+	particles->create_render_pipeline( *render_pass );
 
-		vk::FramebufferCreateInfo frame_cr_inf(
-				{},
-				*render_pass,
-				attachments,
-				swapchain_img_size.width,
-				swapchain_img_size.height,
-				1
-			);
+	// Exhaust of the placeholder ship
+	SpaceAppVideo::Emitter exhaust;
+	exhaust.position = { 0, 0.5f, 0 };
+	exhaust.velocity = { 0, 1.5f, 0 };
+	exhaust.rate = 50000;
+	particles->emitters.push_back( exhaust );
+}
 
-		swapchain_framebuffers[i] = device->createFramebufferUnique( frame_cr_inf );
-	}
-	logger << LogChannel::Video << LogLevel::Info << "Created framebuffers";
+void SpaceApplication::create_textures(){
+	auto trace = startup_tracer.trace( "Create textures" );
+
+	// Memory binds go through the graphics queue, whose family sparse support was checked for. The copies run on the transfer queue
+	textures = std::make_unique<SpaceAppVideo::TextureStreamer>( phys_dev, *device, queue_manager->queue( SpaceAppVideo::QueueRole::Graphics ),
+			queue_manager->family( SpaceAppVideo::QueueRole::Graphics ), queue_manager->family( SpaceAppVideo::QueueRole::Transfer ),
+			sparse_textures, vk::DeviceSize( config.texture_budget ) << 20 );
+
+	// Written by texture_packer
+	std::filesystem::path dir( "textures" );
+	if( !std::filesystem::is_directory( dir ))
+		return;
+
+	std::vector<std::filesystem::path> files;
+	for( auto& entry: std::filesystem::directory_iterator( dir ))
+		if( entry.path().extension() == ".stex" )
+			files.push_back( entry.path() );
+	// Ids stay the same between runs
+	std::sort( files.begin(), files.end() );
+
+	for( auto& file: files )
+		texture_ids.push_back( textures->load( file ));
 }
 
-void SpaceApplication::create_command_pool(){
-	vk::CommandPoolCreateInfo cmd_cr_inf(
-			{},
-			queue_indices.graphics.value()
-		);
+void SpaceApplication::create_lighting(){
+	auto trace = startup_tracer.trace( "Create lighting" );
 
-	command_pool = device->createCommandPoolUnique( cmd_cr_inf );
+	lighting = std::make_unique<SpaceAppVideo::ClusteredLighting>( phys_dev, *device, *shader_manager, pipeline_variants->pipeline_cache() );
 
-	logger << LogChannel::Video << LogLevel::Info << "Created command pool";
+	// Glow of the placeholder ship's engine, just in front of the exhaust
+	lighting->add({ { 0, 0.6f, -0.5f }, 20, { 1, 0.5f, 0.2f }, 4 });
 }
 
-void SpaceApplication::create_vertex_buffers(){
-	vk::BufferCreateInfo buf_cr_inf(
-			{},
-			sizeof( vertices[0] ) * vertices.size(),
-			vk::BufferUsageFlagBits::eVertexBuffer,
-			vk::SharingMode::eExclusive,
-			0,
-			nullptr
-		);
+void SpaceApplication::create_culling(){
+	auto trace = startup_tracer.trace( "Create occlusion culling" );
 
-	vertex_buffer = device->createBufferUnique( buf_cr_inf );
+	culling = std::make_unique<SpaceAppVideo::OcclusionCulling>( phys_dev, *device, *shader_manager, pipeline_variants->pipeline_cache() );
 
-	auto memreqs = device->getBufferMemoryRequirements( *vertex_buffer );
+	float radius = 0;
+	for( auto& vertex: vertices )
+		radius = std::max( radius, glm::length( vertex.pos ));
 
-	vk::MemoryAllocateInfo mem_alloc_inf(
-			memreqs.size,
-			find_mem_type( memreqs.memoryTypeBits, vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent )
-		);
+	// There are no ship meshes yet, the placeholder ship and a fleet of copies behind it stand in for them
+	constexpr int fleet_x{ 16 }, fleet_y{ 8 }, fleet_z{ 16 };
+	constexpr float spacing{ 3 };
+	std::vector<SpaceAppVideo::CullInstance> instances{ { glm::vec3( 0 ), radius }};
+	for( int z = 0; z < fleet_z; ++z )
+		for( int y = 0; y < fleet_y; ++y )
+			for( int x = 0; x < fleet_x; ++x ){
+				glm::vec3 position( x - ( fleet_x - 1 ) / 2.0f, y - ( fleet_y - 1 ) / 2.0f, z + 1.5f );
+				instances.push_back({ position * spacing, radius });
+			}
 
-	vertex_buffer_memory = device->allocateMemoryUnique( mem_alloc_inf );
-	device->bindBufferMemory( *vertex_buffer, *vertex_buffer_memory, 0 );
+	culling->set_instances( instances, vertices.size() );
+}
+
+void SpaceApplication::create_starfield(){
+	auto trace = startup_tracer.trace( "Create starfield" );
 
-	auto data = device->mapMemory( *vertex_buffer_memory, 0, buf_cr_inf.size, {} );
-	memcpy( data, vertices.data(), static_cast<size_t>( vertices.size() ) * sizeof( SpaceAppVideo::Vertex ));
-	device->unmapMemory( *vertex_buffer_memory );
+	starfield = std::make_unique<SpaceAppVideo::Starfield>( phys_dev, *device, *shader_manager, pipeline_variants->pipeline_cache(), "./star_cache", galaxy_seed );
+	starfield->create_render_pipeline( *render_pass );
+	starfield->update( camera );
 }
 
-uint32_t SpaceApplication::find_mem_type( uint32_t type_filter, vk::MemoryPropertyFlags flags ){
-	auto memprops = phys_dev.getMemoryProperties();
+void SpaceApplication::create_terrain(){
+	auto trace = startup_tracer.trace( "Create terrain" );
+
+	// Placeholder planet right below the start position, its highest mountains stay beneath the camera
+	SpaceAppVideo::Planet planet{ { 0, -608000, 0 }, 600000, 6000, 0x7e44a1 };
+	terrain = std::make_unique<SpaceAppVideo::Terrain>( phys_dev, *device, *shader_manager, pipeline_variants->pipeline_cache(), planet );
+	terrain->create_render_pipeline( *render_pass );
+}
 
-	for( auto memIndex = 0; auto&& m: memprops.memoryTypes ){
-		if(( type_filter & ( 1 << memIndex )) && (( m.propertyFlags & flags ) == flags ))
-			return memIndex;
-		++memIndex;
+void SpaceApplication::create_scheduler(){
+	auto trace = startup_tracer.trace( "Create frame scheduler" );
+
+	scheduler = std::make_unique<SpaceAppVideo::FrameScheduler>( *device, *queue_manager );
+
+	// Exclusive, the scheduler moves them between the compute and graphics families every frame
+	for( auto buffer: particles->buffers() )
+		particle_buffers.push_back( scheduler->add_buffer( buffer, true ));
+	for( auto buffer: lighting->buffers() )
+		light_buffers.push_back( scheduler->add_buffer( buffer, true ));
+	terrain_tiles = scheduler->add_buffer( terrain->buffer(), true );
+}
+
+void SpaceApplication::create_dynamic_resolution(){
+	if( !config.dynamic_resolution )
+		return;
+
+	// Scene images are blitted onto the swapchain in the render format
+	auto features = phys_dev.getFormatProperties( render_format ).optimalTilingFeatures;
+	auto blit_features = vk::FormatFeatureFlagBits::eBlitSrc | vk::FormatFeatureFlagBits::eBlitDst | vk::FormatFeatureFlagBits::eSampledImageFilterLinear;
+	if(( features & blit_features ) != blit_features || !SpaceAppVideo::DynamicResolution::supported( phys_dev, queue_indices.graphics.value() )){
+		logger << LogChannel::Video << LogLevel::Warning << "Dynamic resolution is not supported by the device, rendering at full resolution";
+		config.dynamic_resolution = false;
+		return;
 	}
 
-	throw std::runtime_error( "No memory available" );
+	dynamic_resolution = std::make_unique<SpaceAppVideo::DynamicResolution>( phys_dev, *device, queue_indices.graphics.value(), gpu_budget() );
 }
 
-void SpaceApplication::alloc_command_buffers(){
-	vk::CommandBufferAllocateInfo alloc_inf(
-			*command_pool,
-			vk::CommandBufferLevel::ePrimary,
-			swapchain_framebuffers.size()
-		);
+std::chrono::microseconds SpaceApplication::gpu_budget() const {
+	if( config.gpu_budget_us > 0 )
+		return std::chrono::microseconds( config.gpu_budget_us );
 
-	command_buffers = device->allocateCommandBuffersUnique( alloc_inf );
+	// A locked framerate needs every frame done within the refresh interval, 60Hz is assumed without a display
+	int refresh_rate = 60;
+	if( !headless )
+		if( auto mode = glfwGetVideoMode( glfwGetPrimaryMonitor() ); mode && mode->refreshRate > 0 )
+			refresh_rate = mode->refreshRate;
+	return std::chrono::microseconds( 1000000 / refresh_rate );
+}
+
+void SpaceApplication::record_commands( vk::CommandBuffer cmd, const SpaceAppVideo::ArenaVector<SpaceAppVideo::View*>& drawn,
+		const SpaceAppVideo::ArenaVector<SpaceAppVideo::ClusterParams>& cluster_params, size_t frame_slot ){
+	std::array<vk::ClearValue, 2> clear_values{
+		vk::ClearValue{ std::array<float, 4>{ 0, 0, 0, 1 }},
+		vk::ClearDepthStencilValue( 0, 0 ),
+	};
+	vk::Buffer buffer{ *vertex_buffer.buffer };
+	vk::DeviceSize offset{ 0 };
+	vk::Pipeline lit_pipeline = get_pipeline( SpaceAppVideo::material_key( vertices_material ));
+	int64_t draw_calls = 0;
+
+	// Everything scaling with the resolution is measured
+	if( dynamic_resolution )
+		dynamic_resolution->record_begin( cmd, frame_slot );
+
+	for( uint32_t i = 0; i < drawn.size(); ++i ){
+		auto view = drawn[i];
+		auto extent = view->render_extent();
+		auto hiz = view->hiz_target();
+		std::array<vk::DescriptorSet, 2> descriptor_sets{ lighting->descriptor_set(), culling->descriptor_set( frame_slot, i )};
+
+		auto draw_instances = [&]( uint32_t phase ){
+			cmd.bindPipeline( vk::PipelineBindPoint::eGraphics, lit_pipeline );
+			cmd.bindDescriptorSets( vk::PipelineBindPoint::eGraphics, *pipeline_layout, 0, descriptor_sets, {} );
+			cmd.pushConstants( *pipeline_layout, vk::ShaderStageFlagBits::eVertex | vk::ShaderStageFlagBits::eFragment,
+					0, sizeof( SpaceAppVideo::ClusterParams ), &cluster_params[i] );
+			cmd.bindVertexBuffers( 0, buffer, offset );
+			culling->record_draw( cmd, i, phase );
+			++draw_calls;
+		};
+
+		culling->record_early( cmd, frame_slot, i, view->camera(), extent, hiz );
+
+		// Everything visible last frame, the depth it leaves is what the rest is culled against
+		vk::RenderPassBeginInfo early_begin_info(
+				*early_render_pass,
+				view->framebuffer(),
+				{{ 0, 0 }, extent },
+				clear_values.size(), clear_values.data()
+			);
+
+		cmd.beginRenderPass( early_begin_info, vk::SubpassContents::eInline );
+		cmd.setViewport( 0, vk::Viewport( 0, 0, (float)extent.width, (float)extent.height, 0, 1 ));
+		cmd.setScissor( 0, vk::Rect2D( {}, extent ));
+
+		starfield->record_draw( cmd, view->camera(), extent );
+		terrain->record_draw( cmd, frame_slot, i, view->camera(), extent );
+		draw_instances( 0 );
+		// Stars and terrain
+		draw_calls += 2;
 
-	for( size_t i = 0; i < command_buffers.size(); ++i ){
-		vk::CommandBufferBeginInfo cb_begin_info( {}, {} );
+		cmd.endRenderPass();
 
-		command_buffers[i]->begin( cb_begin_info );
+		culling->record_late( cmd, frame_slot, i, hiz );
 
-		std::vector<vk::ClearValue> clear_colors{{std::array<float, 4>{ 0, 0, 0, 1 }}};
-		vk::RenderPassBeginInfo r_begin_info(
-				*render_pass,
-				*swapchain_framebuffers[i],
-				{{ 0, 0 }, swapchain_img_size },
-				clear_colors
+		vk::RenderPassBeginInfo late_begin_info(
+				view->render_pass(),
+				view->framebuffer(),
+				{{ 0, 0 }, extent },
+				0, nullptr
 			);
 
-		command_buffers[i]->beginRenderPass( r_begin_info, vk::SubpassContents::eInline );
-		command_buffers[i]->bindPipeline( vk::PipelineBindPoint::eGraphics, *pipelines[0] );
-		std::vector<vk::Buffer> buffers{ *vertex_buffer };
-		std::vector<vk::DeviceSize> offsets{ 0 };
-		command_buffers[i]->bindVertexBuffers( 0, buffers, offsets );
+		cmd.beginRenderPass( late_begin_info, vk::SubpassContents::eInline );
+		cmd.setViewport( 0, vk::Viewport( 0, 0, (float)extent.width, (float)extent.height, 0, 1 ));
+		cmd.setScissor( 0, vk::Rect2D( {}, extent ));
 
+		draw_instances( 1 );
+		// Blended, so nothing is drawn behind them afterwards
+		particles->record_draw( cmd, view->camera(), (float)extent.width / extent.height );
+		++draw_calls;
 
-		command_buffers[i]->draw( vertices.size(), 1, 0, 0 );
+		cmd.endRenderPass();
 
-		command_buffers[i]->endRenderPass();
-		command_buffers[i]->end();
+		view->record_upscale( cmd );
+		view->record_capture( cmd, frame_slot, frame_number );
 	}
+
+	if( dynamic_resolution )
+		dynamic_resolution->record_end( cmd, frame_slot );
+
+	metrics.draw_calls.set( draw_calls );
 }
 
 void SpaceApplication::create_semaphores(){
-	img_available_sema.clear();
-	img_ready_sema.clear();
+	auto trace = startup_tracer.trace( "Create synchronisation primitives" );
+
 	inflight_fences.clear();
-	inflight_imgs.clear();
 
-	vk::SemaphoreCreateInfo sema_cr_inf( vk::SemaphoreCreateFlags{} );
 	vk::FenceCreateInfo fence_cr_inf( vk::FenceCreateFlagBits::eSignaled );
 
 	for( size_t i = 0; i < SpaceAppVideo::MAX_FRAMES_IN_FLIGHT; ++i ){
-		img_available_sema.push_back( device->createSemaphoreUnique( sema_cr_inf ));
-		img_ready_sema.push_back( device->createSemaphoreUnique( sema_cr_inf ));
 		inflight_fences.push_back( device->createFenceUnique( fence_cr_inf ));
 	}
-	inflight_imgs.resize( swapchain_imgs.size() );
+}
+
+void SpaceApplication::configure_present_strategy(){
+	std::chrono::nanoseconds refresh_interval{ 0 };
+
+	if( headless ){
+		// Nothing to pace against, frames are rendered as fast as possible
+	} else if( auto mode = glfwGetVideoMode( glfwGetPrimaryMonitor() ); mode && mode->refreshRate > 0 )
+		refresh_interval = std::chrono::nanoseconds( 1000000000 / mode->refreshRate );
+
+	switch( config.present_strategy ){
+		case Config::PresentStrategy::LowLatency:
+			frames_in_flight = 1;
+			frame_pacer.set_interval( refresh_interval );
+			break;
+		case Config::PresentStrategy::MaxThroughput:
+			frames_in_flight = SpaceAppVideo::MAX_FRAMES_IN_FLIGHT;
+			frame_pacer.set_interval( {} );
+			break;
+		case Config::PresentStrategy::PowerSaving:
+			frames_in_flight = SpaceAppVideo::MAX_FRAMES_IN_FLIGHT;
+			frame_pacer.set_interval( refresh_interval );
+			break;
+	}
+
+	logger << LogChannel::Video << LogLevel::Info << "Using present strategy " << Config::to_string( config.present_strategy ) <<
+		" with " << frames_in_flight << " frame(s) in flight";
 }
 
 void SpaceApplication::main_loop(){
 	logger << LogChannel::Default << LogLevel::Info << "Entering main loop";
 
-	while( !glfwWindowShouldClose( window )){
-		glfwPollEvents();
-		draw_frame();
+	if( config.record_replay )
+		replay_recorder = std::make_unique<SpaceAppSim::SnapshotRecorder>( "./replay.snap" );
+
+	auto window_closed = [this]{
+		return std::any_of( views.begin(), views.end(), []( auto& view ){ return view->window() && glfwWindowShouldClose( view->window() ); });
+	};
+
+	while( headless ? frame_number < frame_limit : !window_closed() ){
+		{
+			Debug::NoAllocations no_allocations( frame_number >= steady_state_frames );
+			draw_frame();
+		}
+
+		if( replay_recorder )
+			record_replay();
+
+		if( config_store && config_store->reload_pending() )
+			apply_config_reload();
+
+		if( input_latency.frames == latency_report_interval ){
+			logger << LogChannel::Video << LogLevel::Verbose << "Input to present latency over " << input_latency.frames <<
+				" frames: avg " << input_latency.average_ms() << "ms, max " << input_latency.max_ms() << "ms";
+			input_latency.reset();
+
+			auto& stats = culling->stats();
+			logger << LogChannel::Video << LogLevel::Verbose << "Occlusion culling tested " << stats.tested << " instances: " <<
+				stats.frustum_culled << " outside the frustum, " << stats.occluded << " occluded, " <<
+				stats.early << " drawn early, " << stats.late << " drawn late";
+
+			if( dynamic_resolution )
+				logger << LogChannel::Video << LogLevel::Verbose << "Rendering at " << dynamic_resolution->scale() * 100 <<
+					"% resolution, gpu time " << dynamic_resolution->gpu_time().count() << "us of " << gpu_budget().count() << "us";
+		}
 	}
 
 	device->waitIdle();
 }
 
+void SpaceApplication::record_replay(){
+	// There is no simulation yet, the camera stands in for the player ship
+	glm::quat orientation = glm::quat_cast( glm::mat3( camera.right(), camera.up, -camera.forward ));
+
+	++replay_state.tick;
+	replay_state.entities.assign( 1, { 0, camera.position, { orientation.x, orientation.y, orientation.z, orientation.w }, glm::vec3( 0 ), 0 });
+
+	replay_recorder->record( replay_state );
+}
+
+void SpaceApplication::apply_config_reload(){
+	using Config::Option;
+
+	auto changed = config_store->apply_reload( config );
+
+	if( changed[static_cast<size_t>( Option::record_replay )] ){
+		if( config.record_replay && !replay_recorder )
+			replay_recorder = std::make_unique<SpaceAppSim::SnapshotRecorder>( "./replay.snap" );
+		else if( !config.record_replay )
+			replay_recorder.reset();
+	}
+
+	if( changed[static_cast<size_t>( Option::gpu_budget_us )] && dynamic_resolution )
+		dynamic_resolution->set_budget( gpu_budget() );
+
+	// Both are baked into the swapchain
+	if( changed[static_cast<size_t>( Option::present_strategy )] || changed[static_cast<size_t>( Option::capture )] ){
+		recreate_swapchain();
+		configure_present_strategy();
+	}
+}
+
+void SpaceApplication::precompile_pipelines(){
+	// Runs as a build step, possibly without a display. A headless surface chooses the device and format instead of a window
+	headless = true;
+
+	thread_pool = std::make_unique<SpaceAppVideo::ThreadPool>();
+	shader_manager = std::make_unique<SpaceAppVideo::ShaderManager>( "res/shader", *thread_pool );
+
+	create_instance();
+	create_views();
+	choose_physical_dev({});
+	create_device();
+	shader_manager->set_device( *device );
+	queue_manager->retrieve( *device );
+	create_render_pass();
+	create_pipeline_variants();
+	// Only for the descriptor set layouts the pipeline layout is made of
+	create_lighting();
+	create_culling();
+	create_pipeline();
+
+	pipeline_variants->save_cache();
+	views.clear();
+}
+
 void SpaceApplication::cleanup(){
+	pipeline_variants->save_cache();
+
 	logger << LogChannel::Video << LogLevel::Info << "Started cleaning up window";
 
-	glfwDestroyWindow( window );
-	glfwTerminate();
+	// Destroys the windows as well
+	views.clear();
+
+	if( !headless )
+		glfwTerminate();
+}
+
+void SpaceApplication::poll_input(){
+	if( !headless )
+		glfwPollEvents();
+	input_sampled = SpaceAppVideo::Clock::now();
 }
 
 void SpaceApplication::draw_frame(){
 	static size_t current_frame = 0;
-	if( vk::Result::eSuccess != device->waitForFences( 1, &*inflight_fences[current_frame], VK_TRUE, UINT64_MAX ))
+
+	if( pipelines_pending )
+		swap_pending_pipelines();
+
+	vk::Fence frame_fence = *inflight_fences[current_frame];
+	if( vk::Result::eSuccess != device->waitForFences( 1, &frame_fence, VK_TRUE, UINT64_MAX ))
 		throw std::runtime_error( "Wait for fence failed" );
 
-	auto imgres = device->acquireNextImageKHR( *swapchain, UINT64_MAX, *img_available_sema[current_frame], {} );
+	// The copies recorded with the fence's last submission are complete now
+	for( auto& view: views )
+		view->frame_retired( current_frame );
 
-	if( imgres.result == vk::Result::eErrorOutOfDateKHR ){
-		recreate_swapchain();
+	auto& arena = frame_arenas[current_frame];
+	arena.reset();
+
+	starfield->update( camera );
+
+	// Sample input as late as possible, so the frame reflects the most recent state
+	frame_pacer.wait();
+	poll_input();
+
+	auto drawn = arena.vector<SpaceAppVideo::View*>( views.size() );
+	for( auto& view: views ){
+		view->follow( camera );
+
+		if( view->acquire( *device, current_frame, frame_fence ))
+			drawn.push_back( view.get() );
+		else
+			recreate_view( *view );
+	}
+
+	// Every swapchain is being recreated, e.g. while minimised. Still counts as a frame, so the pacer keeps
+	// its deadlines moving and headless runs reach their frame limit
+	if( drawn.empty() ){
+		frame_pacer.frame_presented();
+		++frame_number;
 		return;
 	}
-	auto img = imgres.value;
-
-	if( inflight_imgs[img] != vk::Fence{} )
-		if( vk::Result::eSuccess != device->waitForFences( 1, &inflight_imgs[img], VK_TRUE, UINT64_MAX ))
-			throw std::runtime_error( "Wait for fence failed" );
-
-	std::vector wait_semas{ *img_available_sema[current_frame] };
-	std::vector<vk::Flags<vk::PipelineStageFlagBits>> wait_stages{ vk::PipelineStageFlagBits::eColorAttachmentOutput };
-	std::vector cmd_bufs{ *command_buffers[img] };
-	std::vector signal_semas{ *img_ready_sema[current_frame] };
-
-	vk::SubmitInfo sub_inf(
-			wait_semas,
-			wait_stages,
-			cmd_bufs,
-			signal_semas
-		);
 
-	if( vk::Result::eSuccess != device->resetFences( 1, &*inflight_fences[current_frame] ))
+	// Measured two frames ago at most, the views keep their size if nothing changed
+	if( dynamic_resolution ){
+		dynamic_resolution->begin_frame( current_frame );
+		for( auto view: drawn )
+			view->set_render_scale( dynamic_resolution->scale() );
+
+		metrics.render_scale_percent.set( static_cast<int64_t>( dynamic_resolution->scale() * 100 ));
+		metrics.gpu_time_us.record( dynamic_resolution->gpu_time().count() );
+	}
+
+	auto now = SpaceAppVideo::Clock::now();
+	float dt = headless ? headless_frame_time : std::chrono::duration<float>( now - last_frame ).count();
+	last_frame = now;
+	metrics.frame_time_us.record( static_cast<uint64_t>( dt * 1e6f ));
+
+	scheduler->begin_frame( current_frame );
+
+	// Lights are culled for every view at once, each gets its own range of clusters
+	auto cluster_params = arena.vector<SpaceAppVideo::ClusterParams>( drawn.size() );
+	for( uint32_t i = 0; i < drawn.size(); ++i )
+		cluster_params.push_back( lighting->params( drawn[i]->camera(), drawn[i]->render_extent(), i ));
+
+	// Patches are chosen per view, the tiles they miss are generated once for all of them
+	terrain->begin_frame( current_frame );
+	for( uint32_t i = 0; i < drawn.size(); ++i )
+		terrain->select( current_frame, i, drawn[i]->camera(), drawn[i]->render_extent() );
+	culling->begin_frame( current_frame );
+	metrics.culling_visible.set( culling->stats().early + culling->stats().late );
+
+	// Simulated once, every view draws the same particles. On a compute queue of its own the simulation and the
+	// light culling fill the gaps graphics leaves instead of being serialised with it
+	// Nothing textured reports the detail it needs yet, so every texture is wanted at full resolution
+	for( auto id: texture_ids )
+		textures->request( id, 0 );
+	vk::Semaphore texture_binds = textures->begin_frame( current_frame );
+
+	auto simulate = [&]( vk::CommandBuffer cmd ){ particles->record_simulation( cmd, dt, camera ); };
+	auto cull_lights = [&]( vk::CommandBuffer cmd ){ lighting->record_culling( cmd, current_frame, { cluster_params.data(), cluster_params.size() }); };
+	auto upload_textures = [&]( vk::CommandBuffer cmd ){ textures->record_uploads( cmd, current_frame ); };
+	auto generate_terrain = [&]( vk::CommandBuffer cmd ){ terrain->record_generation( cmd, current_frame ); };
+	auto render = [&]( vk::CommandBuffer cmd ){ record_commands( cmd, drawn, cluster_params, current_frame ); };
+
+	auto compute_role = queue_manager->dedicated( SpaceAppVideo::QueueRole::Compute ) ?
+		SpaceAppVideo::QueueRole::Compute : SpaceAppVideo::QueueRole::Graphics;
+	auto simulation_pass = scheduler->add_pass( compute_role, simulate );
+	auto light_pass = scheduler->add_pass( compute_role, cull_lights );
+	auto texture_pass = scheduler->add_pass( SpaceAppVideo::QueueRole::Transfer, upload_textures );
+	auto terrain_pass = scheduler->add_pass( compute_role, generate_terrain );
+	// Every view goes into the same command buffer and submission
+	auto draw_pass = scheduler->add_pass( SpaceAppVideo::QueueRole::Graphics, render );
+
+	for( auto buffer: particle_buffers ){
+		scheduler->use( simulation_pass, buffer, vk::PipelineStageFlagBits::eComputeShader,
+				vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite );
+		scheduler->use( draw_pass, buffer, vk::PipelineStageFlagBits::eDrawIndirect | vk::PipelineStageFlagBits::eVertexShader,
+				vk::AccessFlagBits::eIndirectCommandRead | vk::AccessFlagBits::eShaderRead );
+	}
+
+	if( texture_binds )
+		scheduler->wait( texture_pass, texture_binds, vk::PipelineStageFlagBits::eTransfer );
+	// Textures are images, which the scheduler does not track, so the draws wait for the uploads explicitly
+	if( queue_manager->dedicated( SpaceAppVideo::QueueRole::Transfer )){
+		scheduler->signal( texture_pass, textures->uploads_done( current_frame ));
+		scheduler->wait( draw_pass, textures->uploads_done( current_frame ),
+				vk::PipelineStageFlagBits::eVertexShader | vk::PipelineStageFlagBits::eFragmentShader );
+	}
+
+	// The light buffer gets the changed lights copied in, the cluster lists are written by the culling
+	scheduler->use( light_pass, light_buffers[0], vk::PipelineStageFlagBits::eTransfer | vk::PipelineStageFlagBits::eComputeShader,
+			vk::AccessFlagBits::eTransferWrite | vk::AccessFlagBits::eShaderRead );
+	for( size_t i = 1; i < light_buffers.size(); ++i )
+		scheduler->use( light_pass, light_buffers[i], vk::PipelineStageFlagBits::eComputeShader, vk::AccessFlagBits::eShaderWrite );
+	for( auto buffer: light_buffers )
+		scheduler->use( draw_pass, buffer, vk::PipelineStageFlagBits::eFragmentShader, vk::AccessFlagBits::eShaderRead );
+
+	// Generated tiles may replace ones the last frame drew
+	scheduler->use( terrain_pass, terrain_tiles, vk::PipelineStageFlagBits::eComputeShader, vk::AccessFlagBits::eShaderWrite );
+	scheduler->use( draw_pass, terrain_tiles, vk::PipelineStageFlagBits::eVertexShader, vk::AccessFlagBits::eShaderRead );
+
+	auto present_waits = arena.vector<vk::Semaphore>( drawn.size() );
+	auto present_swapchains = arena.vector<vk::SwapchainKHR>( drawn.size() );
+	auto present_images = arena.vector<uint32_t>( drawn.size() );
+	auto present_views = arena.vector<SpaceAppVideo::View*>( drawn.size() );
+
+	for( auto view: drawn ){
+		if( !view->presents() )
+			continue;
+
+		scheduler->wait( draw_pass, view->image_available( current_frame ), view->image_write_stage() );
+		scheduler->signal( draw_pass, view->render_finished( current_frame ));
+
+		present_waits.push_back( view->render_finished( current_frame ));
+		present_swapchains.push_back( view->swapchain() );
+		present_images.push_back( view->image_index() );
+		present_views.push_back( view );
+	}
+
+	if( vk::Result::eSuccess != device->resetFences( 1, &frame_fence ))
 		throw std::runtime_error( "Reset fence failed" );
 
-	graphics_queue.submit( { sub_inf }, *inflight_fences[current_frame] );
+	scheduler->submit( frame_fence );
 
-	std::vector swapchains{ *swapchain };
-	std::vector indices{ img };
-	vk::PresentInfoKHR pres_inf( signal_semas, swapchains, indices, {} );
+	if( !present_views.empty() ){
+		auto present_results = arena.allocate<vk::Result>( present_views.size() );
+		vk::PresentInfoKHR pres_inf(
+				present_waits.size(), present_waits.data(),
+				present_swapchains.size(), present_swapchains.data(),
+				present_images.data(), present_results.data()
+			);
 
-	try {
-		switch( present_queue.presentKHR( pres_inf )){
-			case vk::Result::eErrorOutOfDateKHR:
-			case vk::Result::eSuboptimalKHR:
-				recreate_swapchain();
-				break;
-			default:
-				break;
+		// Out of date swapchains are handled per view below, their results are written either way
+		auto result = present_queue.presentKHR( &pres_inf );
+		if( result != vk::Result::eSuccess && result != vk::Result::eSuboptimalKHR && result != vk::Result::eErrorOutOfDateKHR )
+			throw std::runtime_error( "Failed to present" );
+
+		for( size_t i = 0; i < present_views.size(); ++i ){
+			if( present_results[i] == vk::Result::eErrorOutOfDateKHR || present_results[i] == vk::Result::eSuboptimalKHR )
+				recreate_view( *present_views[i] );
 		}
-	} catch( vk::OutOfDateKHRError& e ){
-		recreate_swapchain();
 	}
 
+	input_latency.record( SpaceAppVideo::Clock::now() - input_sampled );
+	metrics.frame_arena_peak_bytes.set( arena.peak() );
+	startup_tracer.report();
+	frame_pacer.frame_presented();
 
-	current_frame = ( current_frame + 1 ) % SpaceAppVideo::MAX_FRAMES_IN_FLIGHT;
+	++frame_number;
+	current_frame = ( current_frame + 1 ) % frames_in_flight;
 }
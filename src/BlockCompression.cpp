@@ -0,0 +1,272 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  BlockCompression.cpp
+ *
+ *    Description:  Implementation of the block encoders
+ *
+ *        Version:  1.0
+ *        Created:  10/20/2026 02:31:52 AM
+ *       Revision:  none
+ *
+ *         Author:  Samuel Knoethig (), samuel@knoethig.net
+ *
+ * =====================================================================================
+ */
+
+#include "BlockCompression.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <future>
+#include <string.h>
+#include <thread>
+
+using namespace SpaceAppVideo;
+
+namespace {
+	// Interpolation weights of 4 bit BC7 indices, out of 64
+	constexpr int bc7_weights[16]{ 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+	/**
+	 *	Writes bits least significant first, like BC7 expects them
+	 */
+	struct BitWriter {
+		uint8_t* out;
+		uint32_t position{ 0 };
+
+		void put( uint32_t value, uint32_t count ){
+			for( uint32_t i = 0; i < count; ++i, ++position )
+				if( value & ( 1u << i ))
+					out[position / 8] |= 1 << ( position % 8 );
+		}
+	};
+
+	struct Bc7Candidate {
+		uint32_t error{ UINT32_MAX };
+		std::array<uint8_t, 4> q0, q1;
+		uint8_t p0, p1;
+		std::array<uint8_t, 16> indices;
+	};
+
+	/**
+	 *	Quantises both float endpoints with every combination of p-bits and keeps the best result in best
+	 */
+	void bc7_quantise( const uint8_t rgba[64], const float e0[4], const float e1[4], Bc7Candidate& best ){
+		for( uint8_t pb = 0; pb < 4; ++pb ){
+			Bc7Candidate c;
+			c.p0 = pb & 1;
+			c.p1 = pb >> 1;
+
+			int a[4], b[4];
+			for( int ch = 0; ch < 4; ++ch ){
+				c.q0[ch] = static_cast<uint8_t>( std::clamp( std::lround(( e0[ch] - c.p0 ) / 2 ), 0l, 127l ));
+				c.q1[ch] = static_cast<uint8_t>( std::clamp( std::lround(( e1[ch] - c.p1 ) / 2 ), 0l, 127l ));
+				a[ch] = ( c.q0[ch] << 1 ) | c.p0;
+				b[ch] = ( c.q1[ch] << 1 ) | c.p1;
+			}
+
+			int palette[16][4];
+			for( int i = 0; i < 16; ++i )
+				for( int ch = 0; ch < 4; ++ch )
+					palette[i][ch] = (( 64 - bc7_weights[i] ) * a[ch] + bc7_weights[i] * b[ch] + 32 ) >> 6;
+
+			c.error = 0;
+			for( int p = 0; p < 16; ++p ){
+				uint32_t best_error = UINT32_MAX;
+				for( int i = 0; i < 16; ++i ){
+					uint32_t error = 0;
+					for( int ch = 0; ch < 4; ++ch ){
+						int d = palette[i][ch] - rgba[p * 4 + ch];
+						error += d * d;
+					}
+					if( error < best_error ){
+						best_error = error;
+						c.indices[p] = i;
+					}
+				}
+				c.error += best_error;
+			}
+
+			if( c.error < best.error )
+				best = c;
+		}
+	}
+}
+
+void SpaceAppVideo::encode_bc4( const uint8_t values[16], uint8_t out[8] ){
+	uint8_t lo = 255, hi = 0;
+	for( int i = 0; i < 16; ++i ){
+		lo = std::min( lo, values[i] );
+		hi = std::max( hi, values[i] );
+	}
+
+	// hi > lo selects the eight step ramp: index 0 is hi, 1 is lo and 2 to 7 lie in between
+	out[0] = hi;
+	out[1] = lo;
+
+	uint64_t bits = 0;
+	if( hi != lo ){
+		int range = hi - lo;
+		for( int i = 0; i < 16; ++i ){
+			int step = (( hi - values[i] ) * 7 + range / 2 ) / range;
+			uint64_t index = step == 0 ? 0 : step == 7 ? 1 : step + 1;
+			bits |= index << ( 3 * i );
+		}
+	}
+
+	for( int i = 0; i < 6; ++i )
+		out[2 + i] = static_cast<uint8_t>( bits >> ( 8 * i ));
+}
+
+void SpaceAppVideo::encode_bc5( const uint8_t rg[32], uint8_t out[16] ){
+	uint8_t red[16], green[16];
+	for( int i = 0; i < 16; ++i ){
+		red[i] = rg[i * 2];
+		green[i] = rg[i * 2 + 1];
+	}
+
+	encode_bc4( red, out );
+	encode_bc4( green, out + 8 );
+}
+
+void SpaceAppVideo::encode_bc7( const uint8_t rgba[64], uint8_t out[16] ){
+	float mean[4]{};
+	for( int p = 0; p < 16; ++p )
+		for( int ch = 0; ch < 4; ++ch )
+			mean[ch] += rgba[p * 4 + ch] / 16.0f;
+
+	float cov[4][4]{};
+	for( int p = 0; p < 16; ++p )
+		for( int i = 0; i < 4; ++i )
+			for( int j = 0; j < 4; ++j )
+				cov[i][j] += ( rgba[p * 4 + i] - mean[i] ) * ( rgba[p * 4 + j] - mean[j] );
+
+	// Principal axis by power iteration, started along the diagonal so grey blocks converge at once
+	float axis[4]{ 1, 1, 1, 1 };
+	for( int iteration = 0; iteration < 8; ++iteration ){
+		float next[4]{};
+		for( int i = 0; i < 4; ++i )
+			for( int j = 0; j < 4; ++j )
+				next[i] += cov[i][j] * axis[j];
+
+		float length = std::sqrt( next[0] * next[0] + next[1] * next[1] + next[2] * next[2] + next[3] * next[3] );
+		if( length < 1e-6f )
+			break;
+		for( int i = 0; i < 4; ++i )
+			axis[i] = next[i] / length;
+	}
+
+	float tmin = 0, tmax = 0;
+	for( int p = 0; p < 16; ++p ){
+		float t = 0;
+		for( int ch = 0; ch < 4; ++ch )
+			t += ( rgba[p * 4 + ch] - mean[ch] ) * axis[ch];
+		tmin = std::min( tmin, t );
+		tmax = std::max( tmax, t );
+	}
+
+	float e0[4], e1[4];
+	for( int ch = 0; ch < 4; ++ch ){
+		e0[ch] = std::clamp( mean[ch] + tmin * axis[ch], 0.0f, 255.0f );
+		e1[ch] = std::clamp( mean[ch] + tmax * axis[ch], 0.0f, 255.0f );
+	}
+
+	Bc7Candidate best;
+	bc7_quantise( rgba, e0, e1, best );
+
+	// Least squares refit of the endpoints to the chosen indices
+	for( int refit = 0; refit < 2; ++refit ){
+		float a00 = 0, a01 = 0, a11 = 0;
+		float b0[4]{}, b1[4]{};
+		for( int p = 0; p < 16; ++p ){
+			float w = bc7_weights[best.indices[p]] / 64.0f;
+			a00 += ( 1 - w ) * ( 1 - w );
+			a01 += ( 1 - w ) * w;
+			a11 += w * w;
+			for( int ch = 0; ch < 4; ++ch ){
+				b0[ch] += ( 1 - w ) * rgba[p * 4 + ch];
+				b1[ch] += w * rgba[p * 4 + ch];
+			}
+		}
+
+		float det = a00 * a11 - a01 * a01;
+		if( std::abs( det ) < 1e-6f )
+			break;
+
+		for( int ch = 0; ch < 4; ++ch ){
+			e0[ch] = std::clamp(( a11 * b0[ch] - a01 * b1[ch] ) / det, 0.0f, 255.0f );
+			e1[ch] = std::clamp(( a00 * b1[ch] - a01 * b0[ch] ) / det, 0.0f, 255.0f );
+		}
+		bc7_quantise( rgba, e0, e1, best );
+	}
+
+	// The most significant bit of the first index is implicitly 0
+	if( best.indices[0] >= 8 ){
+		std::swap( best.q0, best.q1 );
+		std::swap( best.p0, best.p1 );
+		for( auto& i: best.indices )
+			i = 15 - i;
+	}
+
+	memset( out, 0, 16 );
+	BitWriter bits{ out };
+	bits.put( 1 << 6, 7 );
+	for( int ch = 0; ch < 4; ++ch ){
+		bits.put( best.q0[ch], 7 );
+		bits.put( best.q1[ch], 7 );
+	}
+	bits.put( best.p0, 1 );
+	bits.put( best.p1, 1 );
+	bits.put( best.indices[0], 3 );
+	for( int p = 1; p < 16; ++p )
+		bits.put( best.indices[p], 4 );
+}
+
+std::vector<uint8_t> SpaceAppVideo::compress( TextureCodec codec, const uint8_t* rgba, uint32_t width, uint32_t height ){
+	uint32_t blocks_x = ( width + 3 ) / 4;
+	uint32_t blocks_y = ( height + 3 ) / 4;
+	uint32_t size = block_bytes( codec );
+	std::vector<uint8_t> out( size_t( blocks_x ) * blocks_y * size );
+
+	auto encode_row = [&]( uint32_t by ){
+		for( uint32_t bx = 0; bx < blocks_x; ++bx ){
+			uint8_t block[64];
+			for( uint32_t p = 0; p < 16; ++p ){
+				uint32_t x = std::min( bx * 4 + p % 4, width - 1 );
+				uint32_t y = std::min( by * 4 + p / 4, height - 1 );
+				memcpy( block + p * 4, rgba + ( size_t( y ) * width + x ) * 4, 4 );
+			}
+
+			uint8_t* dst = out.data() + ( size_t( by ) * blocks_x + bx ) * size;
+			if( codec == TextureCodec::BC7 ){
+				encode_bc7( block, dst );
+			} else if( codec == TextureCodec::BC5 ){
+				uint8_t rg[32];
+				for( int p = 0; p < 16; ++p ){
+					rg[p * 2] = block[p * 4];
+					rg[p * 2 + 1] = block[p * 4 + 1];
+				}
+				encode_bc5( rg, dst );
+			} else {
+				uint8_t red[16];
+				for( int p = 0; p < 16; ++p )
+					red[p] = block[p * 4];
+				encode_bc4( red, dst );
+			}
+		}
+	};
+
+	uint32_t thread_count = std::clamp( std::thread::hardware_concurrency(), 1u, blocks_y );
+	std::vector<std::future<void>> workers;
+	for( uint32_t t = 0; t < thread_count; ++t )
+		workers.push_back( std::async( std::launch::async, [&, t]{
+			for( uint32_t by = t; by < blocks_y; by += thread_count )
+				encode_row( by );
+		}));
+	for( auto& w: workers )
+		w.get();
+
+	return out;
+}
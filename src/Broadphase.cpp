@@ -0,0 +1,509 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  Broadphase.cpp
+ *
+ *    Description:  Implementation of the hash grid and dynamic tree broadphases
+ *
+ *        Version:  1.0
+ *        Created:  10/19/2026 06:14:37 PM
+ *       Revision:  none
+ *
+ *         Author:  Samuel Knoethig (), samuel@knoethig.net
+ *
+ * =====================================================================================
+ */
+
+#include "Broadphase.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+
+using namespace SpaceAppPhysics;
+
+static void emit_pair( uint32_t a, uint32_t b, PairBatch& batch, const PairCallback& callback ){
+	batch.first[batch.count] = a;
+	batch.second[batch.count] = b;
+
+	if( ++batch.count == PairBatch::capacity ){
+		callback( batch );
+		batch.count = 0;
+	}
+}
+
+static void flush( PairBatch& batch, const PairCallback& callback ){
+	if( batch.count > 0 )
+		callback( batch );
+	batch.count = 0;
+}
+
+/*
+ *	SpatialHashGrid
+ */
+
+// Cell coordinates are packed into 21 bits per axis
+static constexpr int32_t cell_bias{ 1 << 20 };
+static constexpr uint64_t empty_cell{ UINT64_MAX };
+
+static uint64_t pack_cell( int64_t x, int64_t y, int64_t z ){
+	auto wrap = []( int64_t v ){ return static_cast<uint64_t>( v + cell_bias ) & (( 1ull << 21 ) - 1 ); };
+	return wrap( x ) | ( wrap( y ) << 21 ) | ( wrap( z ) << 42 );
+}
+
+static uint64_t mix( uint64_t v ){
+	v ^= v >> 33;
+	v *= 0xff51afd7ed558ccdull;
+	v ^= v >> 33;
+	return v;
+}
+
+SpatialHashGrid::SpatialHashGrid( float cell_size ): cell_size( cell_size ){}
+
+ProxyId SpatialHashGrid::create_proxy( const AABB& box, uint32_t user_data ){
+	ProxyId id;
+	if( free_list.empty() ){
+		id = proxies.size();
+		proxies.push_back({ box, user_data, true });
+	} else {
+		id = free_list.back();
+		free_list.pop_back();
+		proxies[id] = { box, user_data, true };
+	}
+
+	++alive_count;
+	return id;
+}
+
+void SpatialHashGrid::destroy_proxy( ProxyId proxy ){
+	proxies[proxy].alive = false;
+	free_list.push_back( proxy );
+	--alive_count;
+}
+
+void SpatialHashGrid::move_proxy( ProxyId proxy, const AABB& box, glm::vec3 ){
+	// The grid is rebuilt every query, so there is nothing to gain from the displacement
+	proxies[proxy].box = box;
+}
+
+size_t SpatialHashGrid::proxy_count() const {
+	return alive_count;
+}
+
+uint64_t SpatialHashGrid::cell_key( glm::vec3 position ) const {
+	return pack_cell(
+			static_cast<int64_t>( std::floor( position.x / cell_size )),
+			static_cast<int64_t>( std::floor( position.y / cell_size )),
+			static_cast<int64_t>( std::floor( position.z / cell_size )));
+}
+
+const SpatialHashGrid::CellRange* SpatialHashGrid::find_cell( uint64_t cell ) const {
+	size_t mask = table.size() - 1;
+	for( size_t i = mix( cell ) & mask;; i = ( i + 1 ) & mask ){
+		if( table[i].cell == cell )
+			return &table[i];
+		if( table[i].cell == empty_cell )
+			return nullptr;
+	}
+}
+
+void SpatialHashGrid::find_pairs( const PairCallback& callback ){
+	entries.clear();
+	oversized.clear();
+
+	// Boxes up to one cell in size overlap only if their centers lie in neighbouring cells
+	float max_extent = cell_size * 0.5f;
+	for( ProxyId id = 0; id < proxies.size(); ++id ){
+		auto& p = proxies[id];
+		if( !p.alive )
+			continue;
+
+		glm::vec3 half = ( p.box.max - p.box.min ) * 0.5f;
+		if( half.x > max_extent || half.y > max_extent || half.z > max_extent )
+			oversized.push_back( id );
+		else
+			entries.push_back({ cell_key( p.box.min + half ), id });
+	}
+
+	std::sort( entries.begin(), entries.end(), []( auto& a, auto& b ){ return a.cell < b.cell || ( a.cell == b.cell && a.proxy < b.proxy ); });
+
+	// Open addressing table from cell to its range in entries, at most half full
+	size_t cells = 0;
+	for( size_t i = 0; i < entries.size(); ++i )
+		if( i == 0 || entries[i].cell != entries[i - 1].cell )
+			++cells;
+
+	table.assign( std::bit_ceil( std::max<size_t>( cells * 2, 16 )), { empty_cell, 0, 0 });
+	size_t mask = table.size() - 1;
+	for( uint32_t i = 0; i < entries.size(); ){
+		uint32_t end = i;
+		while( end < entries.size() && entries[end].cell == entries[i].cell )
+			++end;
+
+		size_t slot = mix( entries[i].cell ) & mask;
+		while( table[slot].cell != empty_cell )
+			slot = ( slot + 1 ) & mask;
+		table[slot] = { entries[i].cell, i, end - i };
+
+		i = end;
+	}
+
+	PairBatch batch;
+	auto test = [&]( ProxyId a, ProxyId b ){
+		if( proxies[a].box.overlaps( proxies[b].box ))
+			emit_pair( proxies[a].user_data, proxies[b].user_data, batch, callback );
+	};
+
+	constexpr uint64_t axis_mask{ ( 1ull << 21 ) - 1 };
+	for( uint32_t i = 0; i < entries.size(); ){
+		uint64_t cell = entries[i].cell;
+		uint32_t end = i;
+		while( end < entries.size() && entries[end].cell == cell )
+			++end;
+
+		for( uint32_t a = i; a < end; ++a )
+			for( uint32_t b = a + 1; b < end; ++b )
+				test( entries[a].proxy, entries[b].proxy );
+
+		// Only the half of the neighbours following this cell, the other half finds the pair from their side
+		int64_t x = static_cast<int64_t>( cell & axis_mask ) - cell_bias;
+		int64_t y = static_cast<int64_t>(( cell >> 21 ) & axis_mask ) - cell_bias;
+		int64_t z = static_cast<int64_t>(( cell >> 42 ) & axis_mask ) - cell_bias;
+		for( int dz = 0; dz <= 1; ++dz )
+			for( int dy = dz ? -1 : 0; dy <= 1; ++dy )
+				for( int dx = ( dz || dy ) ? -1 : 1; dx <= 1; ++dx ){
+					auto neighbour = find_cell( pack_cell( x + dx, y + dy, z + dz ));
+					if( !neighbour )
+						continue;
+
+					for( uint32_t a = i; a < end; ++a )
+						for( uint32_t b = neighbour->first; b < neighbour->first + neighbour->count; ++b )
+							test( entries[a].proxy, entries[b].proxy );
+				}
+
+		i = end;
+	}
+
+	for( size_t a = 0; a < oversized.size(); ++a ){
+		for( size_t b = a + 1; b < oversized.size(); ++b )
+			test( oversized[a], oversized[b] );
+		for( auto& e: entries )
+			test( oversized[a], e.proxy );
+	}
+
+	flush( batch, callback );
+}
+
+/*
+ *	DynamicTree
+ */
+
+DynamicTree::DynamicTree( float margin, float displacement_factor ): margin( margin ), displacement_factor( displacement_factor ){}
+
+uint32_t DynamicTree::alloc_node(){
+	if( free_nodes == null_node ){
+		nodes.push_back({});
+		free_nodes = nodes.size() - 1;
+		nodes.back().parent = null_node;
+	}
+
+	uint32_t node = free_nodes;
+	free_nodes = nodes[node].parent;
+	nodes[node] = { {}, null_node, null_node, null_node, 0, 0 };
+	return node;
+}
+
+void DynamicTree::free_node( uint32_t node ){
+	// Free nodes are chained through their parent index
+	nodes[node].parent = free_nodes;
+	nodes[node].height = -1;
+	free_nodes = node;
+}
+
+ProxyId DynamicTree::create_proxy( const AABB& box, uint32_t user_data ){
+	uint32_t leaf = alloc_node();
+	nodes[leaf].box = { box.min - margin, box.max + margin };
+	nodes[leaf].user_data = user_data;
+
+	insert_leaf( leaf );
+	++leaf_count;
+	return leaf;
+}
+
+void DynamicTree::destroy_proxy( ProxyId proxy ){
+	remove_leaf( proxy );
+	free_node( proxy );
+	--leaf_count;
+}
+
+void DynamicTree::move_proxy( ProxyId proxy, const AABB& box, glm::vec3 displacement ){
+	if( nodes[proxy].box.contains( box ))
+		return;
+
+	AABB fat{ box.min - margin, box.max + margin };
+	glm::vec3 d = displacement * displacement_factor;
+	for( int i = 0; i < 3; ++i ){
+		if( d[i] < 0 )
+			fat.min[i] += d[i];
+		else
+			fat.max[i] += d[i];
+	}
+
+	remove_leaf( proxy );
+	nodes[proxy].box = fat;
+	insert_leaf( proxy );
+}
+
+size_t DynamicTree::proxy_count() const {
+	return leaf_count;
+}
+
+uint32_t DynamicTree::find_best_sibling( const AABB& box ){
+	// Branch and bound over the tree, the cost of a sibling is the surface area of the new parent plus
+	// the growth of all ancestors
+	float area = box.surface_area();
+	uint32_t best = root;
+	float best_cost = AABB::merge( nodes[root].box, box ).surface_area();
+
+	auto& stack = sibling_stack;
+	stack.clear();
+	stack.push_back({ root, 0 });
+	while( !stack.empty() ){
+		auto [node, inherited] = stack.back();
+		stack.pop_back();
+
+		auto& n = nodes[node];
+		float combined = AABB::merge( n.box, box ).surface_area();
+		float cost = combined + inherited;
+		if( cost < best_cost ){
+			best = node;
+			best_cost = cost;
+		}
+
+		if( n.leaf() )
+			continue;
+
+		float child_inherited = inherited + combined - n.box.surface_area();
+		// Lower bound of any sibling below this node
+		if( area + child_inherited < best_cost ){
+			stack.push_back({ n.child1, child_inherited });
+			stack.push_back({ n.child2, child_inherited });
+		}
+	}
+
+	return best;
+}
+
+void DynamicTree::insert_leaf( uint32_t leaf ){
+	if( root == null_node ){
+		root = leaf;
+		nodes[leaf].parent = null_node;
+		return;
+	}
+
+	uint32_t sibling = find_best_sibling( nodes[leaf].box );
+	uint32_t old_parent = nodes[sibling].parent;
+
+	uint32_t parent = alloc_node();
+	nodes[parent].parent = old_parent;
+	nodes[parent].box = AABB::merge( nodes[leaf].box, nodes[sibling].box );
+	nodes[parent].child1 = sibling;
+	nodes[parent].child2 = leaf;
+	nodes[parent].height = nodes[sibling].height + 1;
+	nodes[sibling].parent = parent;
+	nodes[leaf].parent = parent;
+
+	if( old_parent == null_node )
+		root = parent;
+	else if( nodes[old_parent].child1 == sibling )
+		nodes[old_parent].child1 = parent;
+	else
+		nodes[old_parent].child2 = parent;
+
+	refit_and_rotate( old_parent );
+}
+
+void DynamicTree::remove_leaf( uint32_t leaf ){
+	if( leaf == root ){
+		root = null_node;
+		return;
+	}
+
+	uint32_t parent = nodes[leaf].parent;
+	uint32_t grandparent = nodes[parent].parent;
+	uint32_t sibling = nodes[parent].child1 == leaf ? nodes[parent].child2 : nodes[parent].child1;
+
+	nodes[sibling].parent = grandparent;
+	if( grandparent == null_node )
+		root = sibling;
+	else if( nodes[grandparent].child1 == parent )
+		nodes[grandparent].child1 = sibling;
+	else
+		nodes[grandparent].child2 = sibling;
+
+	free_node( parent );
+	refit_and_rotate( grandparent );
+}
+
+void DynamicTree::refit_and_rotate( uint32_t node ){
+	while( node != null_node ){
+		auto& n = nodes[node];
+		n.box = AABB::merge( nodes[n.child1].box, nodes[n.child2].box );
+		n.height = 1 + std::max( nodes[n.child1].height, nodes[n.child2].height );
+
+		rotate( node );
+		node = n.parent;
+	}
+}
+
+void DynamicTree::rotate( uint32_t a ){
+	// Considers swapping a child of a with a grandchild on the other side and applies the swap that
+	// shrinks the surface area of the affected child the most. The box of a itself does not change
+	uint32_t b = nodes[a].child1;
+	uint32_t c = nodes[a].child2;
+
+	enum class Swap { None, BF, BG, CD, CE } best = Swap::None;
+	float best_diff = 0;
+
+	if( !nodes[c].leaf() ){
+		uint32_t f = nodes[c].child1;
+		uint32_t g = nodes[c].child2;
+		float area = nodes[c].box.surface_area();
+
+		if( float diff = AABB::merge( nodes[b].box, nodes[g].box ).surface_area() - area; diff < best_diff ){
+			best = Swap::BF;
+			best_diff = diff;
+		}
+		if( float diff = AABB::merge( nodes[b].box, nodes[f].box ).surface_area() - area; diff < best_diff ){
+			best = Swap::BG;
+			best_diff = diff;
+		}
+	}
+
+	if( !nodes[b].leaf() ){
+		uint32_t d = nodes[b].child1;
+		uint32_t e = nodes[b].child2;
+		float area = nodes[b].box.surface_area();
+
+		if( float diff = AABB::merge( nodes[c].box, nodes[e].box ).surface_area() - area; diff < best_diff ){
+			best = Swap::CD;
+			best_diff = diff;
+		}
+		if( float diff = AABB::merge( nodes[c].box, nodes[d].box ).surface_area() - area; diff < best_diff ){
+			best = Swap::CE;
+			best_diff = diff;
+		}
+	}
+
+	// Swaps the direct child x of a with the grandchild y below its sibling p
+	auto swap = [&]( uint32_t x, uint32_t p, uint32_t y ){
+		if( nodes[a].child1 == x )
+			nodes[a].child1 = y;
+		else
+			nodes[a].child2 = y;
+
+		if( nodes[p].child1 == y )
+			nodes[p].child1 = x;
+		else
+			nodes[p].child2 = x;
+
+		nodes[x].parent = p;
+		nodes[y].parent = a;
+
+		nodes[p].box = AABB::merge( nodes[nodes[p].child1].box, nodes[nodes[p].child2].box );
+		nodes[p].height = 1 + std::max( nodes[nodes[p].child1].height, nodes[nodes[p].child2].height );
+		nodes[a].height = 1 + std::max( nodes[nodes[a].child1].height, nodes[nodes[a].child2].height );
+	};
+
+	switch( best ){
+		case Swap::BF:
+			swap( b, c, nodes[c].child1 );
+			break;
+		case Swap::BG:
+			swap( b, c, nodes[c].child2 );
+			break;
+		case Swap::CD:
+			swap( c, b, nodes[b].child1 );
+			break;
+		case Swap::CE:
+			swap( c, b, nodes[b].child2 );
+			break;
+		case Swap::None:
+			break;
+	}
+}
+
+void DynamicTree::find_pairs( const PairCallback& callback ){
+	if( root == null_node )
+		return;
+
+	// Self collision of the tree, starting with all pairs within the root
+	PairBatch batch;
+	auto& stack = pair_stack;
+	stack.clear();
+	stack.push_back({ root, root });
+	while( !stack.empty() ){
+		auto [a, b] = stack.back();
+		stack.pop_back();
+
+		auto& na = nodes[a];
+		auto& nb = nodes[b];
+
+		if( a == b ){
+			if( !na.leaf() ){
+				stack.push_back({ na.child1, na.child1 });
+				stack.push_back({ na.child2, na.child2 });
+				stack.push_back({ na.child1, na.child2 });
+			}
+			continue;
+		}
+
+		if( !na.box.overlaps( nb.box ))
+			continue;
+
+		if( na.leaf() && nb.leaf() )
+			emit_pair( na.user_data, nb.user_data, batch, callback );
+		else if( nb.leaf() || ( !na.leaf() && na.box.surface_area() > nb.box.surface_area() )){
+			stack.push_back({ na.child1, b });
+			stack.push_back({ na.child2, b });
+		} else {
+			stack.push_back({ a, nb.child1 });
+			stack.push_back({ a, nb.child2 });
+		}
+	}
+
+	flush( batch, callback );
+}
+
+void DynamicTree::query( const AABB& box, const std::function<void( uint32_t )>& callback ) const {
+	if( root == null_node )
+		return;
+
+	std::vector<uint32_t> stack{ root };
+	while( !stack.empty() ){
+		auto& n = nodes[stack.back()];
+		stack.pop_back();
+
+		if( !n.box.overlaps( box ))
+			continue;
+
+		if( n.leaf() )
+			callback( n.user_data );
+		else {
+			stack.push_back( n.child1 );
+			stack.push_back( n.child2 );
+		}
+	}
+}
+
+float DynamicTree::cost() const {
+	float sum = 0;
+	for( auto& n: nodes )
+		if( n.height > 0 )
+			sum += n.box.surface_area();
+	return sum;
+}
+
+int DynamicTree::height() const {
+	return root == null_node ? 0 : nodes[root].height;
+}
@@ -0,0 +1,227 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  ClusteredLighting.cpp
+ *
+ *    Description:  Source file defining things from ClusteredLighting.hpp
+ *
+ *        Version:  1.0
+ *        Created:  10/20/2026 12:21:09 AM
+ *       Revision:  none
+ *
+ *         Author:  Samuel Knoethig (), samuel@knoethig.net
+ *
+ * =====================================================================================
+ */
+
+#include "Util.hpp"
+#include "ClusteredLighting.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+using namespace SpaceAppVideo;
+
+namespace {
+	// Has to match light_cull.comp.glsl
+	struct CullParams {
+		ClusterParams view;
+		uint32_t light_count;
+	};
+
+	constexpr uint32_t workgroup_size{ 128 };
+	constexpr uint32_t binding_count{ 3 };
+}
+
+ClusteredLighting::ClusteredLighting( vk::PhysicalDevice phys_dev, vk::Device device, ShaderManager& shaders, vk::PipelineCache cache ):
+		phys_dev( phys_dev ), device( device ), shaders( shaders ){
+	lights.reserve( max_lights );
+	index_to_id.reserve( max_lights );
+	id_to_index.reserve( max_lights );
+	free_ids.reserve( max_lights );
+	dirty.reserve( max_lights );
+	dirty_flags.assign( max_lights, false );
+	regions.reserve( max_lights );
+
+	auto storage = vk::BufferUsageFlagBits::eStorageBuffer;
+	auto local = vk::MemoryPropertyFlagBits::eDeviceLocal;
+
+	light_buffer = create_buffer( phys_dev, device, max_lights * sizeof( Light ), storage | vk::BufferUsageFlagBits::eTransferDst, local );
+	for( auto& s: staging )
+		s = create_buffer( phys_dev, device, max_lights * sizeof( Light ), vk::BufferUsageFlagBits::eTransferSrc,
+				vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent );
+	cluster_counts = create_buffer( phys_dev, device, max_views * clusters_per_view * sizeof( uint32_t ), storage, local );
+	cluster_lights = create_buffer( phys_dev, device, max_views * clusters_per_view * max_lights_per_cluster * sizeof( uint32_t ), storage, local );
+
+	create_descriptors();
+	create_pipeline( cache );
+
+	logger << LogChannel::Video << LogLevel::Info << "Created clustered lighting for " << max_lights << " lights in " <<
+		grid_x << "x" << grid_y << "x" << grid_z << " clusters per view";
+}
+
+ClusteredLighting::LightId ClusteredLighting::add( const Light& light ){
+	if( lights.size() == max_lights )
+		throw std::runtime_error( "Too many lights" );
+
+	LightId id;
+	if( !free_ids.empty() ){
+		id = free_ids.back();
+		free_ids.pop_back();
+	} else {
+		id = id_to_index.size();
+		id_to_index.push_back( 0 );
+	}
+
+	id_to_index[id] = lights.size();
+	index_to_id.push_back( id );
+	lights.push_back( light );
+	mark_dirty( lights.size() - 1 );
+
+	return id;
+}
+
+void ClusteredLighting::update( LightId id, const Light& light ){
+	auto index = id_to_index[id];
+	lights[index] = light;
+	mark_dirty( index );
+}
+
+void ClusteredLighting::remove( LightId id ){
+	// The last light fills the gap, so the live lights stay contiguous
+	auto index = id_to_index[id];
+	auto last = lights.size() - 1;
+
+	if( index != last ){
+		lights[index] = lights[last];
+		index_to_id[index] = index_to_id[last];
+		id_to_index[index_to_id[index]] = index;
+		mark_dirty( index );
+	}
+
+	lights.pop_back();
+	index_to_id.pop_back();
+	free_ids.push_back( id );
+}
+
+uint32_t ClusteredLighting::count() const {
+	return lights.size();
+}
+
+void ClusteredLighting::mark_dirty( uint32_t index ){
+	if( dirty_flags[index] )
+		return;
+
+	dirty_flags[index] = true;
+	dirty.push_back( index );
+}
+
+vk::DescriptorSetLayout ClusteredLighting::set_layout() const {
+	return *descriptor_layout;
+}
+
+vk::DescriptorSet ClusteredLighting::descriptor_set() const {
+	return descriptors;
+}
+
+std::vector<vk::Buffer> ClusteredLighting::buffers() const {
+	return { *light_buffer.buffer, *cluster_counts.buffer, *cluster_lights.buffer };
+}
+
+void ClusteredLighting::create_descriptors(){
+	std::vector<vk::DescriptorSetLayoutBinding> bindings;
+	for( uint32_t i = 0; i < binding_count; ++i )
+		bindings.emplace_back( i, vk::DescriptorType::eStorageBuffer, 1, vk::ShaderStageFlagBits::eCompute | vk::ShaderStageFlagBits::eFragment );
+
+	descriptor_layout = device.createDescriptorSetLayoutUnique({ {}, bindings });
+
+	vk::DescriptorPoolSize pool_size( vk::DescriptorType::eStorageBuffer, binding_count );
+	descriptor_pool = device.createDescriptorPoolUnique({ {}, 1, 1, &pool_size });
+
+	descriptors = device.allocateDescriptorSets({ *descriptor_pool, 1, &*descriptor_layout })[0];
+
+	const Buffer* buffers[binding_count] = { &light_buffer, &cluster_counts, &cluster_lights };
+
+	std::vector<vk::DescriptorBufferInfo> buffer_infos;
+	for( auto b: buffers )
+		buffer_infos.emplace_back( *b->buffer, 0, VK_WHOLE_SIZE );
+
+	std::vector<vk::WriteDescriptorSet> writes;
+	for( uint32_t i = 0; i < binding_count; ++i )
+		writes.emplace_back( descriptors, i, 0, 1, vk::DescriptorType::eStorageBuffer, nullptr, &buffer_infos[i] );
+
+	device.updateDescriptorSets( writes, {} );
+}
+
+void ClusteredLighting::create_pipeline( vk::PipelineCache cache ){
+	vk::PushConstantRange push_range( vk::ShaderStageFlagBits::eCompute, 0, sizeof( CullParams ));
+	cull_layout = device.createPipelineLayoutUnique({ {}, 1, &*descriptor_layout, 1, &push_range });
+
+	vk::ComputePipelineCreateInfo cr_inf(
+			{},
+			{ {}, vk::ShaderStageFlagBits::eCompute, shaders.get( "light_cull.comp.glsl.spv" ), "main" },
+			*cull_layout
+		);
+	cull_pipeline = std::move( device.createComputePipelinesUnique( cache, cr_inf ).value[0] );
+}
+
+ClusterParams ClusteredLighting::params( const Camera& camera, vk::Extent2D extent, uint32_t view_index ) const {
+	if( view_index >= max_views )
+		throw std::runtime_error( "Too many lit views" );
+
+	auto proj = camera.projection( (float)extent.width / extent.height );
+	float log_range = std::log( slice_depth / camera.z_near );
+
+	return {
+		camera.view(),
+		glm::vec4( proj[0][0], proj[1][1], proj[2][2], proj[3][2] ),
+		glm::vec4(
+				grid_z / log_range,
+				grid_z * std::log( camera.z_near ) / log_range,
+				(float)grid_x / extent.width,
+				(float)grid_y / extent.height ),
+		glm::uvec4( grid_x, grid_y, grid_z, view_index * clusters_per_view ),
+	};
+}
+
+void ClusteredLighting::record_culling( vk::CommandBuffer cmd, size_t frame, std::span<const ClusterParams> views ){
+	if( !dirty.empty() ){
+		// Sorted, so neighbouring lights end up in one copy
+		std::sort( dirty.begin(), dirty.end() );
+
+		auto staged = static_cast<Light*>( staging[frame].mapped );
+		regions.clear();
+		for( size_t i = 0; i < dirty.size(); ++i ){
+			auto index = dirty[i];
+			dirty_flags[index] = false;
+			// Removed lights only have to leave the live range
+			if( index >= lights.size() )
+				continue;
+
+			staged[i] = lights[index];
+			vk::DeviceSize src = i * sizeof( Light ), dst = index * sizeof( Light );
+			if( !regions.empty() && regions.back().srcOffset + regions.back().size == src && regions.back().dstOffset + regions.back().size == dst )
+				regions.back().size += sizeof( Light );
+			else
+				regions.push_back({ src, dst, sizeof( Light )});
+		}
+		dirty.clear();
+
+		if( !regions.empty() ){
+			cmd.copyBuffer( *staging[frame].buffer, *light_buffer.buffer, regions.size(), regions.data() );
+
+			vk::MemoryBarrier barrier( vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eShaderRead );
+			cmd.pipelineBarrier( vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eComputeShader, {}, barrier, {}, {} );
+		}
+	}
+
+	cmd.bindPipeline( vk::PipelineBindPoint::eCompute, *cull_pipeline );
+	cmd.bindDescriptorSets( vk::PipelineBindPoint::eCompute, *cull_layout, 0, descriptors, {} );
+
+	for( auto& view: views ){
+		CullParams params{ view, count() };
+		cmd.pushConstants( *cull_layout, vk::ShaderStageFlagBits::eCompute, 0, sizeof( params ), &params );
+		cmd.dispatch(( clusters_per_view + workgroup_size - 1 ) / workgroup_size, 1, 1 );
+	}
+}
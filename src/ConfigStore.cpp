@@ -0,0 +1,427 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  ConfigStore.cpp
+ *
+ *    Description:  Source file defining things from ConfigStore.hpp
+ *
+ *        Version:  1.0
+ *        Created:  10/19/2026 08:51:17 PM
+ *       Revision:  none
+ *
+ *         Author:  Samuel Knoethig (), samuel@knoethig.net
+ *
+ * =====================================================================================
+ */
+
+#include "Util.hpp"
+#include "ConfigStore.hpp"
+
+#include <charconv>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <type_traits>
+
+using namespace Config;
+namespace fs = std::filesystem;
+
+namespace {
+	constexpr char cache_magic[4]{ 'S', 'F', 'C', 'F' };
+	constexpr uint32_t cache_version{ 1 };
+
+	constexpr uint64_t fnv_offset{ 14695981039346656037ull };
+	constexpr uint64_t fnv_prime{ 1099511628211ull };
+
+	constexpr uint64_t fnv1a( std::string_view str, uint64_t hash = fnv_offset ){
+		for( char c: str )
+			hash = ( hash ^ static_cast<uint8_t>( c )) * fnv_prime;
+		return hash;
+	}
+
+	// Changes whenever an option is added, removed, renamed or changes its type, which invalidates every cache
+	constexpr uint64_t layout_hash{ fnv1a(
+		#define CFGOPTION( name, type, def ) #name " " #type ";"
+		CFGOPTIONS
+		#undef CFGOPTION
+	)};
+
+	#define CFGOPTION( name, type, def ) static_assert( std::is_trivially_copyable_v<type>, "Option " #name " can not be cached" );
+	CFGOPTIONS
+	#undef CFGOPTION
+
+	std::string_view trim( std::string_view str ){
+		while( !str.empty() && isspace( static_cast<unsigned char>( str.front() )))
+			str.remove_prefix( 1 );
+		while( !str.empty() && isspace( static_cast<unsigned char>( str.back() )))
+			str.remove_suffix( 1 );
+		return str;
+	}
+
+	/**
+	 *	Splits a line into name and value, returns false for empty lines and comments.
+	 *	value_start is the offset of the value in line
+	 */
+	bool split_line( std::string_view line, std::string_view& name, std::string_view& value, size_t& value_start ){
+		if( auto comment = line.find( '#' ); comment != std::string_view::npos )
+			line = line.substr( 0, comment );
+
+		auto separator = line.find_first_of( "=:" );
+		if( separator == std::string_view::npos )
+			return false;
+
+		name = trim( line.substr( 0, separator ));
+		value_start = separator + 1;
+		while( value_start < line.size() && isspace( static_cast<unsigned char>( line[value_start] )))
+			++value_start;
+		value = trim( line.substr( value_start ));
+		return !name.empty();
+	}
+
+	bool parse_value( std::string_view text, Resolution& out ){
+		auto x = text.find_first_of( "xX" );
+		if( x == std::string_view::npos )
+			return false;
+
+		Resolution res;
+		auto first = trim( text.substr( 0, x ));
+		auto second = trim( text.substr( x + 1 ));
+		if( std::from_chars( first.data(), first.data() + first.size(), res.x ).ptr != first.data() + first.size() || first.empty() )
+			return false;
+		if( std::from_chars( second.data(), second.data() + second.size(), res.y ).ptr != second.data() + second.size() || second.empty() )
+			return false;
+
+		out = res;
+		return true;
+	}
+
+	template <typename T>
+	bool parse_value( std::string_view text, T& out ){
+		if constexpr( std::is_same_v<T, bool> ){
+			if( text == "true" || text == "1" )
+				out = true;
+			else if( text == "false" || text == "0" )
+				out = false;
+			else
+				return false;
+			return true;
+		} else if constexpr( std::is_arithmetic_v<T> ){
+			return !text.empty() && std::from_chars( text.data(), text.data() + text.size(), out ).ptr == text.data() + text.size();
+		} else {
+			// Enums parse anything, only a value that is written back the same way was valid
+			T val = from_string<T>( std::string( text ));
+			if( to_string( val ) != text )
+				return false;
+			out = val;
+			return true;
+		}
+	}
+
+	template <typename T>
+	std::string format_value( const T& val ){
+		if constexpr( std::is_same_v<T, bool> )
+			return val ? "true" : "false";
+		else if constexpr( std::is_arithmetic_v<T> )
+			return std::to_string( val );
+		else
+			return to_string( val );
+	}
+
+	bool less_equal( const Resolution& a, const Resolution& b ){
+		return a.x <= b.x && a.y <= b.y;
+	}
+
+	template <typename T>
+	bool less_equal( const T& a, const T& b ){
+		return a <= b;
+	}
+
+	bool read_file( const fs::path& path, std::string& text ){
+		std::ifstream file( path, std::ios::binary );
+		if( !file )
+			return false;
+		std::stringstream stream;
+		stream << file.rdbuf();
+		text = stream.str();
+		return true;
+	}
+
+	uint64_t modification_time( const fs::path& path ){
+		std::error_code ec;
+		auto time = fs::last_write_time( path, ec );
+		return ec ? 0 : static_cast<uint64_t>( time.time_since_epoch().count() );
+	}
+}
+
+Values Values::from( const Config& config ){
+	Values values;
+	#define CFGOPTION( name, type, def ) values.name = config.name;
+	CFGOPTIONS
+	#undef CFGOPTION
+	return values;
+}
+
+void Values::apply( Config& config ) const {
+	#define CFGOPTION( name, type, def ) config.name = name;
+	CFGOPTIONS
+	#undef CFGOPTION
+}
+
+ConfigStore::ConfigStore( const fs::path& path, const fs::path& cache_path ): path( path ), cache_path( cache_path ){}
+
+void ConfigStore::load( Config& config ){
+	std::error_code ec;
+	uint64_t size = fs::file_size( path, ec );
+	if( ec ){
+		logger << LogChannel::Config << LogLevel::Warning << "No config at " << path.string() << ", using defaults";
+		std::scoped_lock lock( mutex );
+		on_disk = Values::from( config );
+		return;
+	}
+
+	CacheKey key{ modification_time( path ), size, 0 };
+
+	CacheKey cached_key;
+	Values values;
+	bool cached = read_cache( cached_key, values );
+
+	if( cached && cached_key.mtime == key.mtime && cached_key.size == key.size ){
+		logger << LogChannel::Config << LogLevel::Verbose << "Loaded config from cache";
+	} else {
+		std::string text;
+		if( !read_file( path, text ))
+			throw std::runtime_error( "Could not read " + path.string() );
+		key.hash = fnv1a( text );
+
+		// Only touched, the cache is still valid
+		if( cached && cached_key.hash == key.hash && cached_key.size == key.size ){
+			logger << LogChannel::Config << LogLevel::Verbose << "Loaded config from cache, file was touched";
+		} else {
+			values = parse( text );
+			logger << LogChannel::Config << LogLevel::Verbose << "Parsed config";
+		}
+		write_cache( key, values );
+	}
+
+	values.apply( config );
+
+	std::scoped_lock lock( mutex );
+	on_disk = values;
+}
+
+Values ConfigStore::parse( const std::string& text ) const {
+	Values values;
+
+	std::istringstream stream( text );
+	std::string line;
+	size_t line_number = 0;
+	while( std::getline( stream, line )){
+		++line_number;
+
+		std::string_view name, value;
+		size_t value_start;
+		if( !split_line( line, name, value, value_start ))
+			continue;
+
+		bool found = false;
+		for_each_field( [&]( auto field ){
+			using F = decltype( field );
+			using T = typename F::Type;
+
+			if( field.name != name )
+				return;
+			found = true;
+
+			T parsed;
+			if( !parse_value( value, parsed )){
+				logger << LogChannel::Config << LogLevel::Error << path.string() << ":" << line_number << ": invalid value '" <<
+					std::string( value ) << "' for " << std::string( name ) << ", using " << format_value( values.*field.member );
+				return;
+			}
+
+			if constexpr( requires { F::Traits::min; F::Traits::max; }){
+				if( !less_equal( F::Traits::min, parsed ) || !less_equal( parsed, F::Traits::max )){
+					logger << LogChannel::Config << LogLevel::Error << path.string() << ":" << line_number << ": " << std::string( name ) <<
+						" has to be between " << format_value( F::Traits::min ) << " and " << format_value( F::Traits::max ) <<
+						", using " << format_value( values.*field.member );
+					return;
+				}
+			}
+
+			values.*field.member = parsed;
+		});
+
+		if( !found )
+			logger << LogChannel::Config << LogLevel::Warning << path.string() << ":" << line_number << ": unknown option " << std::string( name );
+	}
+
+	return values;
+}
+
+void ConfigStore::write( const Config& config ){
+	Values values = Values::from( config );
+
+	std::scoped_lock lock( mutex );
+
+	bool exists = fs::exists( path );
+	OptionSet changed;
+	for_each_field( [&]( auto field ){
+		using F = decltype( field );
+		if( !exists || ( !edited[static_cast<size_t>( F::id )] && !( values.*field.member == on_disk.*field.member )))
+			changed.set( static_cast<size_t>( F::id ));
+	});
+
+	if( changed.none() )
+		return;
+
+	std::string text;
+	if( exists && !read_file( path, text ))
+		throw std::runtime_error( "Could not read " + path.string() );
+
+	std::ostringstream out;
+	OptionSet written;
+	std::istringstream stream( text );
+	std::string line;
+	while( std::getline( stream, line )){
+		std::string_view name, value;
+		size_t value_start;
+		if( split_line( line, name, value, value_start )){
+			for_each_field( [&]( auto field ){
+				using F = decltype( field );
+				size_t id = static_cast<size_t>( F::id );
+				if( field.name != name || !changed[id] || written[id] )
+					return;
+
+				// Keeps the separator, its spacing and a trailing comment
+				auto comment = line.find( '#', value_start );
+				std::string rest = comment == std::string::npos ? "" : " " + line.substr( comment );
+				line = line.substr( 0, value_start ) + format_value( values.*field.member ) + rest;
+				written.set( id );
+			});
+		}
+		out << line << '\n';
+	}
+
+	for_each_field( [&]( auto field ){
+		using F = decltype( field );
+		size_t id = static_cast<size_t>( F::id );
+		if( changed[id] && !written[id] )
+			out << field.name << " = " << format_value( values.*field.member ) << '\n';
+	});
+
+	std::string result = out.str();
+	fs::path temp = path;
+	temp += ".tmp";
+	{
+		std::ofstream file( temp, std::ios::binary | std::ios::trunc );
+		file << result;
+		if( !file )
+			throw std::runtime_error( "Could not write " + temp.string() );
+	}
+
+	// Set before the rename, so the watcher sees nothing changed
+	for_each_field( [&]( auto field ){
+		if( changed[static_cast<size_t>( decltype( field )::id )] )
+			on_disk.*field.member = values.*field.member;
+	});
+
+	fs::rename( temp, path );
+
+	write_cache({ modification_time( path ), result.size(), fnv1a( result )}, on_disk );
+
+	logger << LogChannel::Config << LogLevel::Info << "Wrote " << changed.count() << " changed option(s) to " << path.string();
+}
+
+bool ConfigStore::read_cache( CacheKey& key, Values& values ) const {
+	std::ifstream file( cache_path, std::ios::binary );
+	if( !file )
+		return false;
+
+	char magic[4];
+	uint32_t version;
+	uint64_t layout;
+	file.read( magic, sizeof( magic ));
+	file.read( reinterpret_cast<char*>( &version ), sizeof( version ));
+	file.read( reinterpret_cast<char*>( &layout ), sizeof( layout ));
+	file.read( reinterpret_cast<char*>( &key ), sizeof( key ));
+
+	if( !file || memcmp( magic, cache_magic, sizeof( magic )) != 0 || version != cache_version || layout != layout_hash )
+		return false;
+
+	for_each_field( [&]( auto field ){
+		file.read( reinterpret_cast<char*>( &( values.*field.member )), sizeof( values.*field.member ));
+	});
+
+	return static_cast<bool>( file );
+}
+
+void ConfigStore::write_cache( const CacheKey& key, const Values& values ) const {
+	std::ofstream file( cache_path, std::ios::binary | std::ios::trunc );
+	file.write( cache_magic, sizeof( cache_magic ));
+	file.write( reinterpret_cast<const char*>( &cache_version ), sizeof( cache_version ));
+	file.write( reinterpret_cast<const char*>( &layout_hash ), sizeof( layout_hash ));
+	file.write( reinterpret_cast<const char*>( &key ), sizeof( key ));
+
+	for_each_field( [&]( auto field ){
+		file.write( reinterpret_cast<const char*>( &( values.*field.member )), sizeof( values.*field.member ));
+	});
+
+	if( !file )
+		logger << LogChannel::Config << LogLevel::Warning << "Could not write config cache " << cache_path.string();
+}
+
+void ConfigStore::watch(){
+	fs::path directory = path.parent_path().empty() ? fs::path( "." ) : path.parent_path();
+	watcher.watch( directory, [this]( const fs::path& changed ){
+		if( changed.filename() == path.filename() )
+			reload();
+	});
+}
+
+bool ConfigStore::reload_pending() const {
+	return pending_flag;
+}
+
+void ConfigStore::reload(){
+	std::string text;
+	if( !read_file( path, text ))
+		return;
+
+	Values values = parse( text );
+
+	std::scoped_lock lock( mutex );
+	for_each_field( [&]( auto field ){
+		using F = decltype( field );
+		size_t id = static_cast<size_t>( F::id );
+		if( values.*field.member == on_disk.*field.member )
+			return;
+
+		if constexpr( F::Traits::runtime_safe ){
+			pending.*field.member = values.*field.member;
+			pending_options.set( id );
+			logger << LogChannel::Config << LogLevel::Info << "Reloading " << std::string( field.name ) << " = " << format_value( values.*field.member );
+		} else {
+			edited.set( id );
+			logger << LogChannel::Config << LogLevel::Warning << "Changed " << std::string( field.name ) << " only takes effect after a restart";
+		}
+		on_disk.*field.member = values.*field.member;
+	});
+
+	pending_flag = pending_options.any();
+}
+
+OptionSet ConfigStore::apply_reload( Config& config ){
+	std::scoped_lock lock( mutex );
+
+	Values values = Values::from( config );
+	for_each_field( [&]( auto field ){
+		if( pending_options[static_cast<size_t>( decltype( field )::id )] )
+			values.*field.member = pending.*field.member;
+	});
+	values.apply( config );
+
+	OptionSet applied = pending_options;
+	pending_options.reset();
+	pending_flag = false;
+	return applied;
+}
@@ -0,0 +1,108 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  DynamicResolution.cpp
+ *
+ *    Description:  Source file defining things from DynamicResolution.hpp
+ *
+ *        Version:  1.0
+ *        Created:  10/20/2026 09:12:40 AM
+ *       Revision:  none
+ *
+ *         Author:  Samuel Knoethig (), samuel@knoethig.net
+ *
+ * =====================================================================================
+ */
+
+#include "Util.hpp"
+#include "DynamicResolution.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace SpaceAppVideo;
+
+namespace {
+	// The scale aims for this fraction of the budget, the rest absorbs spikes the smoothing hides
+	constexpr double target_fraction{ 0.85 };
+	// The scale only grows again while the time stays below this fraction of the budget
+	constexpr double raise_fraction{ 0.75 };
+	// Weight of the newest measurement in the moving average
+	constexpr double smoothing{ 0.2 };
+	// Largest change of the scale per frame, dropping quickly matters more than recovering quickly
+	constexpr float max_step_down{ 0.1f };
+	constexpr float max_step_up{ 0.02f };
+}
+
+bool DynamicResolution::supported( vk::PhysicalDevice phys_dev, uint32_t queue_family ){
+	auto families = phys_dev.getQueueFamilyProperties();
+	return queue_family < families.size() && families[queue_family].timestampValidBits > 0 &&
+		phys_dev.getProperties().limits.timestampPeriod > 0;
+}
+
+DynamicResolution::DynamicResolution( vk::PhysicalDevice phys_dev, vk::Device device, uint32_t queue_family, std::chrono::microseconds budget ):
+		device( device ), budget_us( budget.count() ){
+	timestamp_period = phys_dev.getProperties().limits.timestampPeriod;
+	uint32_t valid_bits = phys_dev.getQueueFamilyProperties()[queue_family].timestampValidBits;
+	timestamp_mask = valid_bits >= 64 ? ~uint64_t( 0 ) : ( uint64_t( 1 ) << valid_bits ) - 1;
+
+	// Two per frame in flight, the begin and the end of the measured commands
+	query_pool = device.createQueryPoolUnique({ {}, vk::QueryType::eTimestamp, 2 * MAX_FRAMES_IN_FLIGHT });
+
+	logger << LogChannel::Video << LogLevel::Info << "Created dynamic resolution with a gpu budget of " << budget.count() << "us";
+}
+
+void DynamicResolution::set_budget( std::chrono::microseconds budget ){
+	budget_us = budget.count();
+}
+
+void DynamicResolution::begin_frame( size_t frame ){
+	if( !written[frame] )
+		return;
+	written[frame] = false;
+
+	std::array<uint64_t, 2> timestamps;
+	auto result = device.getQueryPoolResults( *query_pool, frame * 2, 2, sizeof( timestamps ), timestamps.data(),
+			sizeof( uint64_t ), vk::QueryResultFlagBits::e64 );
+	// Can not happen after the fence, but a missing measurement is no reason to stop rendering
+	if( result != vk::Result::eSuccess )
+		return;
+
+	uint64_t ticks = ( timestamps[1] - timestamps[0] ) & timestamp_mask;
+	double measured_us = ticks * timestamp_period / 1000.0;
+
+	// The time is roughly proportional to the area. Normalised to full resolution, measurements taken at
+	// different scales can be averaged and the scale that would hit the target follows from a square root
+	double recorded = recorded_scales[frame];
+	double full_us = measured_us / ( recorded * recorded );
+	smoothed_full_us = smoothed_full_us == 0 ? full_us : smoothed_full_us + smoothing * ( full_us - smoothed_full_us );
+
+	double predicted_us = smoothed_full_us * current_scale * current_scale;
+	float wanted = static_cast<float>( std::sqrt( budget_us * target_fraction / std::max( smoothed_full_us, 1.0 )));
+
+	if( predicted_us > budget_us * target_fraction )
+		current_scale = std::max( wanted, current_scale - max_step_down );
+	else if( predicted_us < budget_us * raise_fraction )
+		current_scale = std::min( wanted, current_scale + max_step_up );
+
+	current_scale = std::clamp( current_scale, min_scale, max_scale );
+}
+
+void DynamicResolution::record_begin( vk::CommandBuffer cmd, size_t frame ){
+	cmd.resetQueryPool( *query_pool, frame * 2, 2 );
+	cmd.writeTimestamp( vk::PipelineStageFlagBits::eTopOfPipe, *query_pool, frame * 2 );
+}
+
+void DynamicResolution::record_end( vk::CommandBuffer cmd, size_t frame ){
+	cmd.writeTimestamp( vk::PipelineStageFlagBits::eBottomOfPipe, *query_pool, frame * 2 + 1 );
+	written[frame] = true;
+	recorded_scales[frame] = current_scale;
+}
+
+float DynamicResolution::scale() const {
+	return current_scale;
+}
+
+std::chrono::microseconds DynamicResolution::gpu_time() const {
+	return std::chrono::microseconds( static_cast<int64_t>( smoothed_full_us * current_scale * current_scale ));
+}
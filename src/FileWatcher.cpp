@@ -0,0 +1,112 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  FileWatcher.cpp
+ *
+ *    Description:  inotify implementation of the file watcher
+ *
+ *        Version:  1.0
+ *        Created:  10/19/2026 01:14:52 PM
+ *       Revision:  none
+ *
+ *         Author:  Samuel Knoethig (), samuel@knoethig.net
+ *
+ * =====================================================================================
+ */
+
+#include "Util.hpp"
+#include "FileWatcher.hpp"
+
+#include <sys/inotify.h>
+#include <sys/eventfd.h>
+#include <poll.h>
+#include <unistd.h>
+#include <limits.h>
+
+#include <vector>
+
+FileWatcher::FileWatcher(){
+	inotify_fd = inotify_init1( IN_NONBLOCK | IN_CLOEXEC );
+	stop_fd = eventfd( 0, EFD_NONBLOCK | EFD_CLOEXEC );
+
+	if( inotify_fd < 0 || stop_fd < 0 )
+		logger << LogChannel::Default << LogLevel::Warning << "Could not initialise inotify, file watching is disabled";
+}
+
+FileWatcher::~FileWatcher(){
+	stop();
+
+	if( inotify_fd >= 0 )
+		close( inotify_fd );
+	if( stop_fd >= 0 )
+		close( stop_fd );
+}
+
+void FileWatcher::watch( const std::filesystem::path& directory, Callback callback ){
+	if( inotify_fd < 0 )
+		return;
+
+	int wd = inotify_add_watch( inotify_fd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO );
+	if( wd < 0 ){
+		logger << LogChannel::Default << LogLevel::Warning << "Could not watch " << directory.string();
+		return;
+	}
+
+	{
+		std::scoped_lock lock( watches_mutex );
+		watches[wd] = { directory, std::move( callback )};
+	}
+
+	if( !thread.joinable() )
+		thread = std::thread( &FileWatcher::run, this );
+}
+
+void FileWatcher::stop(){
+	if( !thread.joinable() )
+		return;
+
+	uint64_t one = 1;
+	if( write( stop_fd, &one, sizeof( one )) != sizeof( one ))
+		logger << LogChannel::Default << LogLevel::Error << "Could not signal file watcher to stop";
+
+	thread.join();
+}
+
+void FileWatcher::run(){
+	std::vector<char> buffer( 16 * ( sizeof( inotify_event ) + NAME_MAX + 1 ));
+
+	pollfd fds[2] = {
+		{ inotify_fd, POLLIN, 0 },
+		{ stop_fd, POLLIN, 0 },
+	};
+
+	while( true ){
+		if( poll( fds, 2, -1 ) < 0 )
+			continue;
+
+		if( fds[1].revents & POLLIN )
+			return;
+
+		ssize_t len;
+		while(( len = read( inotify_fd, buffer.data(), buffer.size() )) > 0 ){
+			for( char* ptr = buffer.data(); ptr < buffer.data() + len; ){
+				auto event = reinterpret_cast<const inotify_event*>( ptr );
+				ptr += sizeof( inotify_event ) + event->len;
+
+				if( event->len == 0 )
+					continue;
+
+				Watch watch;
+				{
+					std::scoped_lock lock( watches_mutex );
+					auto it = watches.find( event->wd );
+					if( it == watches.end() )
+						continue;
+					watch = it->second;
+				}
+
+				watch.callback( watch.directory / event->name );
+			}
+		}
+	}
+}
@@ -0,0 +1,350 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  FrameCapture.cpp
+ *
+ *    Description:  Source file defining things from FrameCapture.hpp
+ *
+ *        Version:  1.0
+ *        Created:  10/19/2026 08:03:41 PM
+ *       Revision:  none
+ *
+ *         Author:  Samuel Knoethig (), samuel@knoethig.net
+ *
+ * =====================================================================================
+ */
+
+#include "Util.hpp"
+#include "FrameCapture.hpp"
+
+#include <array>
+#include <cstdio>
+
+using namespace SpaceAppVideo;
+
+namespace {
+	constexpr uint8_t png_signature[8]{ 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+	// Largest payload of a stored deflate block
+	constexpr size_t max_stored_block{ 65535 };
+
+	std::array<uint32_t, 256> make_crc_table(){
+		std::array<uint32_t, 256> table;
+		for( uint32_t n = 0; n < 256; ++n ){
+			uint32_t c = n;
+			for( int k = 0; k < 8; ++k )
+				c = c & 1 ? 0xedb88320u ^ ( c >> 1 ) : c >> 1;
+			table[n] = c;
+		}
+		return table;
+	}
+
+	const std::array<uint32_t, 256> crc_table{ make_crc_table() };
+
+	uint32_t crc32( const uint8_t* data, size_t size, uint32_t crc = 0 ){
+		crc = ~crc;
+		for( size_t i = 0; i < size; ++i )
+			crc = crc_table[( crc ^ data[i] ) & 0xff] ^ ( crc >> 8 );
+		return ~crc;
+	}
+
+	void put_be32( std::vector<uint8_t>& out, uint32_t val ){
+		out.push_back( val >> 24 );
+		out.push_back( val >> 16 );
+		out.push_back( val >> 8 );
+		out.push_back( val );
+	}
+
+	/**
+	 *	Appends a chunk whose data is already at the end of out, starting at data_start - 8
+	 *	where length and type have been reserved
+	 */
+	void finish_chunk( std::vector<uint8_t>& out, size_t data_start ){
+		uint32_t length = out.size() - data_start;
+		out[data_start - 8] = length >> 24;
+		out[data_start - 7] = length >> 16;
+		out[data_start - 6] = length >> 8;
+		out[data_start - 5] = length;
+		put_be32( out, crc32( out.data() + data_start - 4, length + 4 ));
+	}
+
+	size_t begin_chunk( std::vector<uint8_t>& out, const char type[4] ){
+		out.insert( out.end(), 4, 0 );
+		for( int i = 0; i < 4; ++i )
+			out.push_back( type[i] );
+		return out.size();
+	}
+}
+
+FrameCapture::FrameCapture( vk::PhysicalDevice phys_dev, vk::Device device, vk::Extent2D extent, vk::Format format,
+		Config::CaptureMode mode, const std::filesystem::path& directory, size_t ring_size ):
+			device( device ), extent( extent ), mode( mode ), directory( directory ), in_flight( MAX_FRAMES_IN_FLIGHT, nullptr ){
+	if( !supported( format ))
+		throw std::runtime_error( "Frame capture does not support swapchain format " + vk::to_string( format ));
+
+	bgra = format == vk::Format::eB8G8R8A8Srgb || format == vk::Format::eB8G8R8A8Unorm;
+
+	std::filesystem::create_directories( directory );
+
+	vk::DeviceSize size = static_cast<vk::DeviceSize>( extent.width ) * extent.height * 4;
+	for( size_t i = 0; i < ring_size; ++i ){
+		auto slot = std::make_unique<Slot>();
+
+		// Cached memory makes the encoder's reads fast, but needs an explicit invalidate
+		try {
+			slot->buffer = create_buffer( phys_dev, device, size, vk::BufferUsageFlagBits::eTransferDst,
+					vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCached );
+			slot->coherent = false;
+		} catch( std::runtime_error& e ){
+			slot->buffer = create_buffer( phys_dev, device, size, vk::BufferUsageFlagBits::eTransferDst,
+					vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent );
+			slot->coherent = true;
+		}
+
+		slots.push_back( std::move( slot ));
+	}
+	queue.reserve( ring_size );
+
+	thread = std::thread( [this]{ run(); });
+
+	logger << LogChannel::Video << LogLevel::Info << "Capturing " << extent.width << "x" << extent.height << " frames as " <<
+		Config::to_string( mode ) << " to " << directory.string() << " with " << ring_size << " readback buffers";
+
+	if( mode == Config::CaptureMode::Raw )
+		logger << LogChannel::Video << LogLevel::Info << "Convert with: ffmpeg -f rawvideo -pix_fmt " << ( bgra ? "bgra" : "rgba" ) <<
+			" -s " << extent.width << "x" << extent.height << " -i <file> capture.mp4";
+}
+
+FrameCapture::~FrameCapture(){
+	{
+		std::scoped_lock lock( mutex );
+		// The device is idle, so everything still in flight is complete
+		for( auto& slot: in_flight )
+			if( slot ){
+				slot->state = SlotState::Encoding;
+				queue.push_back( slot );
+				slot = nullptr;
+			}
+		stopping = true;
+	}
+	cv.notify_one();
+	thread.join();
+
+	logger << LogChannel::Video << LogLevel::Info << "Captured " << captured() << " frames, dropped " << dropped();
+}
+
+bool FrameCapture::supported( vk::Format format ){
+	switch( format ){
+		case vk::Format::eB8G8R8A8Srgb:
+		case vk::Format::eB8G8R8A8Unorm:
+		case vk::Format::eR8G8B8A8Srgb:
+		case vk::Format::eR8G8B8A8Unorm:
+			return true;
+		default:
+			return false;
+	}
+}
+
+bool FrameCapture::record_copy( vk::CommandBuffer cmd, vk::Image image, size_t frame_slot, uint64_t frame_number, vk::ImageLayout layout ){
+	Slot* slot = nullptr;
+	for( size_t i = 0; i < slots.size() && !slot; ++i ){
+		auto& candidate = *slots[( next_slot + i ) % slots.size()];
+		if( candidate.state.load( std::memory_order_acquire ) == SlotState::Free ){
+			slot = &candidate;
+			next_slot = ( next_slot + i + 1 ) % slots.size();
+		}
+	}
+
+	if( !slot ){
+		++dropped_frames;
+		return false;
+	}
+
+	slot->state = SlotState::Recorded;
+	slot->frame_number = frame_number;
+	in_flight[frame_slot] = slot;
+
+	vk::ImageSubresourceRange range( vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1 );
+
+	vk::ImageMemoryBarrier to_transfer(
+			vk::AccessFlagBits::eColorAttachmentWrite,
+			vk::AccessFlagBits::eTransferRead,
+			layout,
+			vk::ImageLayout::eTransferSrcOptimal,
+			VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED,
+			image, range
+		);
+	cmd.pipelineBarrier( vk::PipelineStageFlagBits::eColorAttachmentOutput, vk::PipelineStageFlagBits::eTransfer, {}, {}, {}, to_transfer );
+
+	vk::BufferImageCopy region(
+			0, 0, 0,
+			vk::ImageSubresourceLayers( vk::ImageAspectFlagBits::eColor, 0, 0, 1 ),
+			{ 0, 0, 0 },
+			{ extent.width, extent.height, 1 }
+		);
+	cmd.copyImageToBuffer( image, vk::ImageLayout::eTransferSrcOptimal, *slot->buffer.buffer, region );
+
+	vk::ImageMemoryBarrier to_present(
+			vk::AccessFlagBits::eTransferRead,
+			{},
+			vk::ImageLayout::eTransferSrcOptimal,
+			layout,
+			VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED,
+			image, range
+		);
+	vk::BufferMemoryBarrier to_host(
+			vk::AccessFlagBits::eTransferWrite,
+			vk::AccessFlagBits::eHostRead,
+			VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED,
+			*slot->buffer.buffer, 0, VK_WHOLE_SIZE
+		);
+	cmd.pipelineBarrier( vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eBottomOfPipe | vk::PipelineStageFlagBits::eHost,
+			{}, {}, to_host, to_present );
+
+	return true;
+}
+
+void FrameCapture::frame_retired( size_t frame_slot ){
+	Slot* slot = in_flight[frame_slot];
+	if( !slot )
+		return;
+	in_flight[frame_slot] = nullptr;
+
+	{
+		std::scoped_lock lock( mutex );
+		slot->state = SlotState::Encoding;
+		queue.push_back( slot );
+	}
+	cv.notify_one();
+}
+
+uint64_t FrameCapture::captured() const {
+	return captured_frames;
+}
+
+uint64_t FrameCapture::dropped() const {
+	return dropped_frames;
+}
+
+void FrameCapture::run(){
+	std::unique_lock lock( mutex );
+	while( true ){
+		cv.wait( lock, [this]{ return stopping || !queue.empty(); });
+		if( queue.empty() )
+			return;
+
+		Slot* slot = queue.front();
+		queue.erase( queue.begin() );
+
+		lock.unlock();
+		encode( *slot );
+		slot->state.store( SlotState::Free, std::memory_order_release );
+		lock.lock();
+	}
+}
+
+void FrameCapture::encode( Slot& slot ){
+	if( !slot.coherent )
+		device.invalidateMappedMemoryRanges( vk::MappedMemoryRange( *slot.buffer.memory, 0, VK_WHOLE_SIZE ));
+
+	auto pixels = static_cast<const uint8_t*>( slot.buffer.mapped );
+
+	try {
+		if( mode == Config::CaptureMode::Png )
+			write_png( pixels, slot.frame_number );
+		else
+			write_raw( pixels, slot.frame_number );
+		++captured_frames;
+	} catch( std::exception& e ){
+		logger << LogChannel::Video << LogLevel::Error << "Failed to write frame " << slot.frame_number << ": " << e.what();
+	}
+}
+
+/**
+ *	Writes an 8 bit RGB PNG with stored deflate blocks. Compressing would cost more than the copy itself
+ *	and the files are meant for image comparisons, not for keeping
+ */
+void FrameCapture::write_png( const uint8_t* pixels, uint64_t frame_number ){
+	size_t row_size = 1 + static_cast<size_t>( extent.width ) * 3;
+	size_t raw_size = row_size * extent.height;
+
+	scratch.clear();
+	scratch.reserve( raw_size + raw_size / max_stored_block * 5 + 128 );
+	scratch.insert( scratch.end(), std::begin( png_signature ), std::end( png_signature ));
+
+	size_t chunk = begin_chunk( scratch, "IHDR" );
+	put_be32( scratch, extent.width );
+	put_be32( scratch, extent.height );
+	scratch.push_back( 8 );		// Bit depth
+	scratch.push_back( 2 );		// Truecolor
+	scratch.push_back( 0 );		// Deflate
+	scratch.push_back( 0 );		// Adaptive filtering
+	scratch.push_back( 0 );		// No interlace
+	finish_chunk( scratch, chunk );
+
+	chunk = begin_chunk( scratch, "IDAT" );
+	// zlib header: deflate with 32K window, no dictionary, fastest
+	scratch.push_back( 0x78 );
+	scratch.push_back( 0x01 );
+
+	uint32_t adler_a = 1, adler_b = 0;
+	size_t written = 0, block_left = 0;
+	auto put_byte = [&]( uint8_t byte ){
+		if( block_left == 0 ){
+			block_left = std::min( max_stored_block, raw_size - written );
+			scratch.push_back( written + block_left == raw_size ? 1 : 0 );
+			scratch.push_back( block_left & 0xff );
+			scratch.push_back( block_left >> 8 );
+			scratch.push_back( ~block_left & 0xff );
+			scratch.push_back(( ~block_left >> 8 ) & 0xff );
+		}
+		scratch.push_back( byte );
+		adler_a = ( adler_a + byte ) % 65521;
+		adler_b = ( adler_b + adler_a ) % 65521;
+		--block_left;
+		++written;
+	};
+
+	// Alpha of swapchain images is meaningless, so only RGB is kept
+	int r = bgra ? 2 : 0, b = bgra ? 0 : 2;
+	for( uint32_t y = 0; y < extent.height; ++y ){
+		put_byte( 0 );
+		const uint8_t* row = pixels + static_cast<size_t>( y ) * extent.width * 4;
+		for( uint32_t x = 0; x < extent.width; ++x ){
+			put_byte( row[x * 4 + r] );
+			put_byte( row[x * 4 + 1] );
+			put_byte( row[x * 4 + b] );
+		}
+	}
+
+	put_be32( scratch, ( adler_b << 16 ) | adler_a );
+	finish_chunk( scratch, chunk );
+
+	chunk = begin_chunk( scratch, "IEND" );
+	finish_chunk( scratch, chunk );
+
+	char name[32];
+	snprintf( name, sizeof( name ), "frame_%06llu.png", static_cast<unsigned long long>( frame_number ));
+
+	std::ofstream file( directory / name, std::ios::binary | std::ios::trunc );
+	file.write( reinterpret_cast<const char*>( scratch.data() ), scratch.size() );
+	if( !file )
+		throw std::runtime_error( "Could not write " + ( directory / name ).string() );
+}
+
+/**
+ *	Appends the mapped memory as is, the file is named after the first frame, so
+ *	captures with different sizes after a swapchain recreation do not get mixed
+ */
+void FrameCapture::write_raw( const uint8_t* pixels, uint64_t frame_number ){
+	if( !raw_file.is_open() ){
+		auto path = directory / ( "frames_" + std::to_string( frame_number ) + "_" +
+				std::to_string( extent.width ) + "x" + std::to_string( extent.height ) + ".raw" );
+		raw_file.open( path, std::ios::binary | std::ios::trunc );
+		if( !raw_file )
+			throw std::runtime_error( "Could not open " + path.string() );
+	}
+
+	raw_file.write( reinterpret_cast<const char*>( pixels ), static_cast<std::streamsize>( extent.width ) * extent.height * 4 );
+	if( !raw_file )
+		throw std::runtime_error( "Could not append frame to raw capture" );
+}
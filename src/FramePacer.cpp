@@ -0,0 +1,92 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  FramePacer.cpp
+ *
+ *    Description:  Implementation of the frame pacer and latency counter
+ *
+ *        Version:  1.0
+ *        Created:  10/19/2026 11:52:40 AM
+ *       Revision:  none
+ *
+ *         Author:  Samuel Knoethig (), samuel@knoethig.net
+ *
+ * =====================================================================================
+ */
+
+#include "FramePacer.hpp"
+
+#include <thread>
+
+using namespace SpaceAppVideo;
+using namespace std::chrono;
+
+void FramePacer::set_interval( Clock::duration interval ){
+	this->interval = interval;
+	next_deadline = Clock::now() + interval;
+	frame_start = Clock::now();
+}
+
+bool FramePacer::enabled() const {
+	return interval != Clock::duration::zero();
+}
+
+void FramePacer::wait(){
+	if( !enabled() ){
+		frame_start = Clock::now();
+		return;
+	}
+
+	auto wake_up = next_deadline - duration_cast<Clock::duration>( nanoseconds( static_cast<int64_t>( predicted_work ))) - safety_margin;
+
+	if( wake_up - Clock::now() > spin_threshold )
+		std::this_thread::sleep_until( wake_up - spin_threshold );
+
+	while( Clock::now() < wake_up )
+		std::this_thread::yield();
+
+	frame_start = Clock::now();
+}
+
+void FramePacer::frame_presented(){
+	auto now = Clock::now();
+	double work = duration_cast<nanoseconds>( now - frame_start ).count();
+
+	// Rise fast, decay slow, missing a deadline is worse than sleeping a bit too short
+	double alpha = work > predicted_work ? 0.5 : 0.05;
+	predicted_work += alpha * ( work - predicted_work );
+
+	if( !enabled() )
+		return;
+
+	next_deadline += interval;
+	// Missed the deadline, resynchronise instead of trying to catch up
+	if( next_deadline < now )
+		next_deadline = now + interval;
+}
+
+void LatencyCounter::record( Clock::duration latency ){
+	++frames;
+	last = latency;
+	total += latency;
+	if( latency > max )
+		max = latency;
+}
+
+void LatencyCounter::reset(){
+	*this = LatencyCounter{};
+}
+
+double LatencyCounter::average_ms() const {
+	if( frames == 0 )
+		return 0;
+	return duration<double, std::milli>( total ).count() / frames;
+}
+
+double LatencyCounter::max_ms() const {
+	return duration<double, std::milli>( max ).count();
+}
+
+double LatencyCounter::last_ms() const {
+	return duration<double, std::milli>( last ).count();
+}
@@ -0,0 +1,88 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  Materials.cpp
+ *
+ *    Description:  Expands the material declarations from Materials.hpp
+ *
+ *        Version:  1.0
+ *        Created:  10/19/2026 02:37:50 PM
+ *       Revision:  none
+ *
+ *         Author:  Samuel Knoethig (), samuel@knoethig.net
+ *
+ * =====================================================================================
+ */
+
+#include "Materials.hpp"
+
+#include <cstddef>
+#include <set>
+
+using namespace SpaceAppVideo;
+
+namespace {
+	struct MaterialDecl {
+		PipelineKey key;
+		uint16_t optional_features;
+	};
+
+	constexpr MaterialDecl material_decls[] = {
+		#define MATERIAL( name, program, cull, front, blend, features, optional ) {	\
+			{																		\
+				ShaderProgram::program,												\
+				CullMode::cull,														\
+				FrontFace::front,													\
+				BlendMode::blend,													\
+				[]{ using namespace ShaderFeature; return static_cast<uint16_t>( features ); }()	\
+			},																		\
+			[]{ using namespace ShaderFeature; return static_cast<uint16_t>( optional ); }()		\
+		},
+		MATERIALS
+		#undef MATERIAL
+	};
+}
+
+PipelineKey SpaceAppVideo::material_key( Material material ){
+	return material_decls[static_cast<size_t>( material )].key;
+}
+
+std::vector<PipelineKey> SpaceAppVideo::material_permutations(){
+	std::set<uint32_t> keys;
+
+	for( auto& decl: material_decls ){
+		// Iterates over all subsets of the optional feature bits
+		uint16_t subset = 0;
+		do {
+			PipelineKey key = decl.key;
+			key.features |= subset;
+			keys.insert( key.pack() );
+
+			subset = ( subset - decl.optional_features ) & decl.optional_features;
+		} while( subset != 0 );
+	}
+
+	std::vector<PipelineKey> result;
+	for( auto k: keys )
+		result.push_back( PipelineKey::unpack( k ));
+
+	return result;
+}
+
+const char* SpaceAppVideo::vertex_shader( ShaderProgram program ){
+	switch( program ){
+		#define SHADER_PROGRAM( name, vert, frag ) case ShaderProgram::name: return vert;
+		SHADER_PROGRAMS
+		#undef SHADER_PROGRAM
+	}
+	return nullptr;
+}
+
+const char* SpaceAppVideo::fragment_shader( ShaderProgram program ){
+	switch( program ){
+		#define SHADER_PROGRAM( name, vert, frag ) case ShaderProgram::name: return frag;
+		SHADER_PROGRAMS
+		#undef SHADER_PROGRAM
+	}
+	return nullptr;
+}
@@ -0,0 +1,129 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  Metrics.cpp
+ *
+ *    Description:  Source file defining things from Metrics.hpp
+ *
+ *        Version:  1.0
+ *        Created:  10/20/2026 08:03:19 AM
+ *       Revision:  none
+ *
+ *         Author:  Samuel Knoethig (), samuel@knoethig.net
+ *
+ * =====================================================================================
+ */
+
+#include "Metrics.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <new>
+#include <stdexcept>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+using namespace Metrics;
+
+Registry::Registry(): Registry( segment_for( getpid() )){}
+
+Registry::Registry( std::string segment_name ): name( std::move( segment_name )){
+	int fd = shm_open( name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644 );
+	if( fd < 0 && errno == EEXIST ){
+		// Left behind by a crashed process, either it had the same pid or the name was chosen explicitly
+		shm_unlink( name.c_str() );
+		fd = shm_open( name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644 );
+	}
+	if( fd >= 0 ){
+		void* memory = MAP_FAILED;
+		if( ftruncate( fd, sizeof( Segment )) == 0 )
+			memory = mmap( nullptr, sizeof( Segment ), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 );
+		close( fd );
+
+		if( memory != MAP_FAILED ){
+			segment = new ( memory ) Segment{};
+			shared = true;
+		} else
+			shm_unlink( name.c_str() );
+	}
+
+	if( !segment )
+		segment = new Segment{};
+
+	segment->version = segment_version;
+	segment->pid = getpid();
+	segment->magic.store( segment_magic, std::memory_order_release );
+}
+
+Registry::~Registry(){
+	if( shared ){
+		munmap( segment, sizeof( Segment ));
+		shm_unlink( name.c_str() );
+	} else
+		delete segment;
+}
+
+MetricSlot& Registry::find_or_add( std::string_view metric_name, Kind kind ){
+	std::scoped_lock lock( mutex );
+
+	metric_name = metric_name.substr( 0, name_length - 1 );
+
+	uint32_t count = segment->metric_count.load( std::memory_order_relaxed );
+	for( uint32_t i = 0; i < count; ++i ){
+		auto& slot = segment->metrics[i];
+		if( metric_name == slot.name ){
+			if( slot.kind != kind )
+				throw std::runtime_error( "Metric " + std::string( metric_name ) + " was registered with another kind" );
+			return slot;
+		}
+	}
+
+	if( count == max_metrics )
+		throw std::runtime_error( "Too many metrics" );
+
+	auto& slot = segment->metrics[count];
+	std::copy( metric_name.begin(), metric_name.end(), slot.name );
+	slot.name[metric_name.size()] = '\0';
+	slot.kind = kind;
+
+	if( kind == Kind::Histogram ){
+		uint32_t histograms = std::count_if( segment->metrics.begin(), segment->metrics.begin() + count,
+				[]( auto& m ){ return m.kind == Kind::Histogram; });
+		if( histograms == max_histograms )
+			throw std::runtime_error( "Too many histograms" );
+		slot.histogram = histograms;
+	}
+
+	// Readers only look at slots below the count
+	segment->metric_count.store( count + 1, std::memory_order_release );
+	return slot;
+}
+
+Counter Registry::counter( std::string_view metric_name ){
+	return Counter( &find_or_add( metric_name, Kind::Counter ));
+}
+
+Gauge Registry::gauge( std::string_view metric_name ){
+	return Gauge( &find_or_add( metric_name, Kind::Gauge ));
+}
+
+Histogram Registry::histogram( std::string_view metric_name ){
+	auto& slot = find_or_add( metric_name, Kind::Histogram );
+	return Histogram( &segment->histograms[slot.histogram] );
+}
+
+bool Registry::exported() const {
+	return shared;
+}
+
+const char* Registry::segment_name() const {
+	return name.c_str();
+}
+
+Registry& Metrics::registry(){
+	static Registry instance;
+	return instance;
+}
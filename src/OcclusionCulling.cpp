@@ -0,0 +1,313 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  OcclusionCulling.cpp
+ *
+ *    Description:  Source file defining things from OcclusionCulling.hpp
+ *
+ *        Version:  1.0
+ *        Created:  10/20/2026 06:02:36 AM
+ *       Revision:  none
+ *
+ *         Author:  Samuel Knoethig (), samuel@knoethig.net
+ *
+ * =====================================================================================
+ */
+
+#include "Util.hpp"
+#include "OcclusionCulling.hpp"
+#include "AllocationCounter.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+using namespace SpaceAppVideo;
+
+namespace {
+	// Has to match occlusion_cull.comp.glsl
+	constexpr uint32_t workgroup_size{ 64 };
+	constexpr uint32_t stat_count{ 4 };
+	// Has to match hiz_build.comp.glsl
+	constexpr uint32_t build_group_size{ 8 };
+
+	constexpr uint32_t buffer_bindings{ 5 };
+	constexpr uint32_t pyramid_binding{ 5 };
+
+	constexpr auto draw_stages = vk::PipelineStageFlagBits::eDrawIndirect | vk::PipelineStageFlagBits::eVertexShader;
+}
+
+OcclusionCulling::OcclusionCulling( vk::PhysicalDevice phys_dev, vk::Device device, ShaderManager& shaders, vk::PipelineCache cache ):
+		phys_dev( phys_dev ), device( device ), shaders( shaders ){
+	instances.reserve( max_instances );
+
+	auto storage = vk::BufferUsageFlagBits::eStorageBuffer;
+	auto local = vk::MemoryPropertyFlagBits::eDeviceLocal;
+	auto host = vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent;
+
+	instance_buffer = create_buffer( phys_dev, device, MAX_FRAMES_IN_FLIGHT * max_instances * sizeof( CullInstance ), storage, host );
+	draw_lists = create_buffer( phys_dev, device, max_views * 2 * max_instances * sizeof( uint32_t ), storage, local );
+	draw_commands = create_buffer( phys_dev, device, max_views * 2 * sizeof( vk::DrawIndirectCommand ),
+			storage | vk::BufferUsageFlagBits::eIndirectBuffer | vk::BufferUsageFlagBits::eTransferDst, local );
+	visibility = create_buffer( phys_dev, device, max_views * max_instances * sizeof( uint32_t ),
+			storage | vk::BufferUsageFlagBits::eTransferDst, local );
+	stats_buffer = create_buffer( phys_dev, device, MAX_FRAMES_IN_FLIGHT * max_views * stat_count * sizeof( uint32_t ), storage, host );
+	std::memset( stats_buffer.mapped, 0, stats_buffer.size );
+
+	// Levels are read texel by texel, never filtered
+	vk::SamplerCreateInfo sampler_info(
+			{},
+			vk::Filter::eNearest, vk::Filter::eNearest, vk::SamplerMipmapMode::eNearest,
+			vk::SamplerAddressMode::eClampToEdge, vk::SamplerAddressMode::eClampToEdge, vk::SamplerAddressMode::eClampToEdge,
+			0, false, 1, false, vk::CompareOp::eNever,
+			0, VK_LOD_CLAMP_NONE
+		);
+	sampler = device.createSamplerUnique( sampler_info );
+
+	create_descriptors();
+	create_pipelines( cache );
+
+	logger << LogChannel::Video << LogLevel::Info << "Created occlusion culling for " << max_instances << " instances in " <<
+		max_views << " views";
+}
+
+void OcclusionCulling::set_instances( std::span<const CullInstance> new_instances, uint32_t new_vertex_count ){
+	if( new_instances.size() > max_instances )
+		throw std::runtime_error( "Too many culled instances" );
+
+	instances.assign( new_instances.begin(), new_instances.end() );
+	vertex_count = new_vertex_count;
+	stale_frames = MAX_FRAMES_IN_FLIGHT;
+}
+
+uint32_t OcclusionCulling::count() const {
+	return instances.size();
+}
+
+vk::DescriptorSetLayout OcclusionCulling::set_layout() const {
+	return *cull_set_layout;
+}
+
+vk::DescriptorSet OcclusionCulling::descriptor_set( size_t frame, uint32_t view_index ) const {
+	return cull_sets[frame][view_index];
+}
+
+const OcclusionStats& OcclusionCulling::stats() const {
+	return last_stats;
+}
+
+void OcclusionCulling::create_descriptors(){
+	auto compute = vk::ShaderStageFlagBits::eCompute;
+	auto drawn = compute | vk::ShaderStageFlagBits::eVertex;
+
+	std::vector<vk::DescriptorSetLayoutBinding> bindings;
+	for( uint32_t i = 0; i < buffer_bindings; ++i )
+		bindings.emplace_back( i, vk::DescriptorType::eStorageBuffer, 1, i < 2 ? drawn : compute );
+	bindings.emplace_back( pyramid_binding, vk::DescriptorType::eCombinedImageSampler, 1, compute );
+	cull_set_layout = device.createDescriptorSetLayoutUnique({ {}, bindings });
+
+	std::array<vk::DescriptorSetLayoutBinding, 2> build_bindings{
+		vk::DescriptorSetLayoutBinding( 0, vk::DescriptorType::eCombinedImageSampler, 1, compute ),
+		vk::DescriptorSetLayoutBinding( 1, vk::DescriptorType::eStorageImage, 1, compute ),
+	};
+	build_set_layout = device.createDescriptorSetLayoutUnique({ {}, build_bindings });
+
+	constexpr uint32_t cull_count{ MAX_FRAMES_IN_FLIGHT * max_views };
+	constexpr uint32_t build_count{ cull_count * MAX_HIZ_LEVELS };
+	std::array<vk::DescriptorPoolSize, 3> pool_sizes{
+		vk::DescriptorPoolSize( vk::DescriptorType::eStorageBuffer, cull_count * buffer_bindings ),
+		vk::DescriptorPoolSize( vk::DescriptorType::eCombinedImageSampler, cull_count + build_count ),
+		vk::DescriptorPoolSize( vk::DescriptorType::eStorageImage, build_count ),
+	};
+	descriptor_pool = device.createDescriptorPoolUnique({ {}, cull_count + build_count, pool_sizes });
+
+	std::vector<vk::DescriptorSetLayout> cull_layouts( cull_count, *cull_set_layout );
+	auto sets = device.allocateDescriptorSets({ *descriptor_pool, cull_layouts });
+	std::vector<vk::DescriptorSetLayout> build_layouts( build_count, *build_set_layout );
+	auto level_sets = device.allocateDescriptorSets({ *descriptor_pool, build_layouts });
+
+	// The pyramid is written once a view's target is known
+	std::vector<vk::DescriptorBufferInfo> buffer_infos;
+	buffer_infos.reserve( cull_count * buffer_bindings );
+	std::vector<vk::WriteDescriptorSet> writes;
+	for( size_t frame = 0; frame < MAX_FRAMES_IN_FLIGHT; ++frame )
+		for( uint32_t view = 0; view < max_views; ++view ){
+			auto set = sets[frame * max_views + view];
+			cull_sets[frame][view] = set;
+			for( uint32_t level = 0; level < MAX_HIZ_LEVELS; ++level )
+				build_sets[frame][view][level] = level_sets[( frame * max_views + view ) * MAX_HIZ_LEVELS + level];
+
+			buffer_infos.emplace_back( *instance_buffer.buffer, frame * max_instances * sizeof( CullInstance ), max_instances * sizeof( CullInstance ));
+			buffer_infos.emplace_back( *draw_lists.buffer, 0, VK_WHOLE_SIZE );
+			buffer_infos.emplace_back( *draw_commands.buffer, 0, VK_WHOLE_SIZE );
+			buffer_infos.emplace_back( *visibility.buffer, 0, VK_WHOLE_SIZE );
+			buffer_infos.emplace_back( *stats_buffer.buffer, frame * max_views * stat_count * sizeof( uint32_t ),
+					max_views * stat_count * sizeof( uint32_t ));
+
+			for( uint32_t i = 0; i < buffer_bindings; ++i )
+				writes.emplace_back( set, i, 0, 1, vk::DescriptorType::eStorageBuffer, nullptr, &buffer_infos[buffer_infos.size() - buffer_bindings + i] );
+		}
+
+	device.updateDescriptorSets( writes, {} );
+}
+
+void OcclusionCulling::create_pipelines( vk::PipelineCache cache ){
+	vk::PushConstantRange push_range( vk::ShaderStageFlagBits::eCompute, 0, sizeof( CullParams ));
+	cull_layout = device.createPipelineLayoutUnique({ {}, 1, &*cull_set_layout, 1, &push_range });
+	// Size of the part of the source level that is read
+	vk::PushConstantRange build_range( vk::ShaderStageFlagBits::eCompute, 0, sizeof( glm::ivec2 ));
+	build_layout = device.createPipelineLayoutUnique({ {}, 1, &*build_set_layout, 1, &build_range });
+
+	vk::ComputePipelineCreateInfo cull_info(
+			{},
+			{ {}, vk::ShaderStageFlagBits::eCompute, shaders.get( "occlusion_cull.comp.glsl.spv" ), "main" },
+			*cull_layout
+		);
+	cull_pipeline = std::move( device.createComputePipelinesUnique( cache, cull_info ).value[0] );
+
+	vk::ComputePipelineCreateInfo build_info(
+			{},
+			{ {}, vk::ShaderStageFlagBits::eCompute, shaders.get( "hiz_build.comp.glsl.spv" ), "main" },
+			*build_layout
+		);
+	build_pipeline = std::move( device.createComputePipelinesUnique( cache, build_info ).value[0] );
+}
+
+void OcclusionCulling::update_target( size_t frame, uint32_t view_index, const HizTarget& target ){
+	if( bound_targets[frame][view_index] == target.id )
+		return;
+
+	// Only after a view was created or resized
+	Debug::AllowAllocations allow;
+	bound_targets[frame][view_index] = target.id;
+
+	std::vector<vk::DescriptorImageInfo> image_infos;
+	image_infos.reserve( 1 + 2 * target.level_count );
+	std::vector<vk::WriteDescriptorSet> writes;
+
+	image_infos.emplace_back( *sampler, target.pyramid, vk::ImageLayout::eGeneral );
+	writes.emplace_back( cull_sets[frame][view_index], pyramid_binding, 0, 1, vk::DescriptorType::eCombinedImageSampler, &image_infos.back() );
+
+	for( uint32_t level = 0; level < target.level_count; ++level ){
+		auto set = build_sets[frame][view_index][level];
+		if( level == 0 )
+			image_infos.emplace_back( *sampler, target.depth, vk::ImageLayout::eDepthStencilReadOnlyOptimal );
+		else
+			image_infos.emplace_back( *sampler, target.levels[level - 1], vk::ImageLayout::eGeneral );
+		writes.emplace_back( set, 0, 0, 1, vk::DescriptorType::eCombinedImageSampler, &image_infos.back() );
+
+		image_infos.emplace_back( nullptr, target.levels[level], vk::ImageLayout::eGeneral );
+		writes.emplace_back( set, 1, 0, 1, vk::DescriptorType::eStorageImage, &image_infos.back() );
+	}
+
+	device.updateDescriptorSets( writes, {} );
+}
+
+void OcclusionCulling::begin_frame( size_t frame ){
+	if( stale_frames > 0 ){
+		std::memcpy( static_cast<CullInstance*>( instance_buffer.mapped ) + frame * max_instances, instances.data(),
+				instances.size() * sizeof( CullInstance ));
+		frame_counts[frame] = instances.size();
+		--stale_frames;
+	}
+
+	auto counters = static_cast<uint32_t*>( stats_buffer.mapped ) + frame * max_views * stat_count;
+	last_stats = { frame_counts[frame] * frame_views[frame] };
+	for( uint32_t view = 0; view < frame_views[frame]; ++view ){
+		auto c = counters + view * stat_count;
+		last_stats.frustum_culled += c[0];
+		last_stats.occluded += c[1];
+		last_stats.early += c[2];
+		last_stats.late += c[3];
+	}
+
+	std::fill( counters, counters + max_views * stat_count, 0 );
+	frame_views[frame] = 0;
+}
+
+void OcclusionCulling::record_early( vk::CommandBuffer cmd, size_t frame, uint32_t view_index, const Camera& camera, vk::Extent2D extent,
+		const HizTarget& target ){
+	if( view_index >= max_views )
+		throw std::runtime_error( "Too many culled views" );
+
+	update_target( frame, view_index, target );
+	frame_views[frame] = std::max( frame_views[frame], view_index + 1 );
+
+	if( !visibility_cleared ){
+		// Nothing was visible before the first frame, so every instance is drawn late once
+		cmd.fillBuffer( *visibility.buffer, 0, VK_WHOLE_SIZE, 0 );
+		visibility_cleared = true;
+	}
+
+	// Last frame's draws and late culling are done with the commands, lists and the pyramid. Its contents are
+	// rebuilt in record_late before they are read again
+	vk::MemoryBarrier barrier(
+			vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite | vk::AccessFlagBits::eIndirectCommandRead | vk::AccessFlagBits::eTransferWrite,
+			vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite | vk::AccessFlagBits::eTransferWrite
+		);
+	vk::ImageMemoryBarrier pyramid_barrier(
+			{}, vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite,
+			vk::ImageLayout::eUndefined, vk::ImageLayout::eGeneral,
+			VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED,
+			target.image, { vk::ImageAspectFlagBits::eColor, 0, target.level_count, 0, 1 }
+		);
+	cmd.pipelineBarrier( vk::PipelineStageFlagBits::eComputeShader | vk::PipelineStageFlagBits::eTransfer | draw_stages,
+			vk::PipelineStageFlagBits::eTransfer | vk::PipelineStageFlagBits::eComputeShader, {}, barrier, {}, pyramid_barrier );
+
+	std::array<vk::DrawIndirectCommand, 2> commands;
+	for( uint32_t phase = 0; phase < 2; ++phase )
+		commands[phase] = { vertex_count, 0, 0, ( view_index * 2 + phase ) * max_instances };
+	cmd.updateBuffer( *draw_commands.buffer, view_index * sizeof( commands ), sizeof( commands ), commands.data() );
+
+	vk::MemoryBarrier update_barrier( vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite );
+	cmd.pipelineBarrier( vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eComputeShader, {}, update_barrier, {}, {} );
+
+	auto proj = camera.projection( (float)extent.width / extent.height );
+	auto& p = params[view_index];
+	p = {
+		camera.view(),
+		glm::vec4( proj[0][0], proj[1][1], camera.z_near, 0 ),
+		glm::vec2( target.extent.width, target.extent.height ),
+		frame_counts[frame], 0, view_index, target.level_count,
+	};
+
+	cmd.bindPipeline( vk::PipelineBindPoint::eCompute, *cull_pipeline );
+	cmd.bindDescriptorSets( vk::PipelineBindPoint::eCompute, *cull_layout, 0, cull_sets[frame][view_index], {} );
+	cmd.pushConstants( *cull_layout, vk::ShaderStageFlagBits::eCompute, 0, sizeof( p ), &p );
+	cmd.dispatch(( p.instance_count + workgroup_size - 1 ) / workgroup_size, 1, 1 );
+
+	vk::MemoryBarrier draw_barrier( vk::AccessFlagBits::eShaderWrite, vk::AccessFlagBits::eIndirectCommandRead | vk::AccessFlagBits::eShaderRead );
+	cmd.pipelineBarrier( vk::PipelineStageFlagBits::eComputeShader, draw_stages, {}, draw_barrier, {}, {} );
+}
+
+void OcclusionCulling::record_late( vk::CommandBuffer cmd, size_t frame, uint32_t view_index, const HizTarget& target ){
+	// Each level is the farthest depth of the texels it covers in the level before
+	cmd.bindPipeline( vk::PipelineBindPoint::eCompute, *build_pipeline );
+	vk::MemoryBarrier level_barrier( vk::AccessFlagBits::eShaderWrite, vk::AccessFlagBits::eShaderRead );
+	for( uint32_t level = 0; level < target.level_count; ++level ){
+		uint32_t width = std::max( target.extent.width >> level, 1u );
+		uint32_t height = std::max( target.extent.height >> level, 1u );
+		glm::ivec2 source_size = level == 0 ?
+			glm::ivec2( target.drawn.width, target.drawn.height ) :
+			glm::ivec2( std::max( target.extent.width >> ( level - 1 ), 1u ), std::max( target.extent.height >> ( level - 1 ), 1u ));
+
+		cmd.bindDescriptorSets( vk::PipelineBindPoint::eCompute, *build_layout, 0, build_sets[frame][view_index][level], {} );
+		cmd.pushConstants( *build_layout, vk::ShaderStageFlagBits::eCompute, 0, sizeof( source_size ), &source_size );
+		cmd.dispatch(( width + build_group_size - 1 ) / build_group_size, ( height + build_group_size - 1 ) / build_group_size, 1 );
+		cmd.pipelineBarrier( vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eComputeShader, {}, level_barrier, {}, {} );
+	}
+
+	auto& p = params[view_index];
+	p.phase = 1;
+
+	cmd.bindPipeline( vk::PipelineBindPoint::eCompute, *cull_pipeline );
+	cmd.bindDescriptorSets( vk::PipelineBindPoint::eCompute, *cull_layout, 0, cull_sets[frame][view_index], {} );
+	cmd.pushConstants( *cull_layout, vk::ShaderStageFlagBits::eCompute, 0, sizeof( p ), &p );
+	cmd.dispatch(( p.instance_count + workgroup_size - 1 ) / workgroup_size, 1, 1 );
+
+	vk::MemoryBarrier draw_barrier( vk::AccessFlagBits::eShaderWrite, vk::AccessFlagBits::eIndirectCommandRead | vk::AccessFlagBits::eShaderRead );
+	cmd.pipelineBarrier( vk::PipelineStageFlagBits::eComputeShader, draw_stages, {}, draw_barrier, {}, {} );
+}
+
+void OcclusionCulling::record_draw( vk::CommandBuffer cmd, uint32_t view_index, uint32_t phase ){
+	cmd.drawIndirect( *draw_commands.buffer, ( view_index * 2 + phase ) * sizeof( vk::DrawIndirectCommand ), 1, sizeof( vk::DrawIndirectCommand ));
+}
@@ -0,0 +1,374 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  ParticleSystem.cpp
+ *
+ *    Description:  Implementation of the GPU particle system
+ *
+ *        Version:  1.0
+ *        Created:  10/19/2026 04:10:57 PM
+ *       Revision:  none
+ *
+ *         Author:  Samuel Knoethig (), samuel@knoethig.net
+ *
+ * =====================================================================================
+ */
+
+#include "Util.hpp"
+#include "ParticleSystem.hpp"
+
+#include <bit>
+#include <cmath>
+
+using namespace SpaceAppVideo;
+
+namespace {
+	// Has to match the push constants in the particle compute shaders
+	struct ComputeParams {
+		glm::vec4 emitter_position;
+		glm::vec4 emitter_velocity;
+		glm::vec4 emitter_color;
+		glm::vec4 camera_position;
+		uint32_t emit_count;
+		uint32_t parity;
+		uint32_t seed;
+		float lifetime;
+		uint32_t sort_k;
+		uint32_t sort_j;
+		float size;
+	};
+
+	// Has to match the push constants in particle.vert.glsl
+	struct DrawParams {
+		glm::mat4 view_proj;
+		glm::vec4 camera_right;
+		glm::vec4 camera_up;
+		uint32_t alive_offset;
+	};
+
+	constexpr uint32_t workgroup_size{ 256 };
+	constexpr uint32_t binding_count{ 7 };
+}
+
+static void compute_barrier( vk::CommandBuffer cmd ){
+	vk::MemoryBarrier barrier(
+			vk::AccessFlagBits::eShaderWrite,
+			vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite
+		);
+
+	cmd.pipelineBarrier( vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eComputeShader, {}, barrier, {}, {} );
+}
+
+ParticleSystem::ParticleSystem( vk::PhysicalDevice phys_dev, vk::Device device, ShaderManager& shaders, vk::PipelineCache cache ):
+	phys_dev( phys_dev ), device( device ), shaders( shaders ), cache( cache ){
+
+	create_buffers();
+	create_descriptors();
+	create_compute_pipelines();
+
+	logger << LogChannel::Video << LogLevel::Info << "Created particle system with " << capacity << " particles";
+}
+
+std::vector<vk::Buffer> ParticleSystem::buffers() const {
+	return { *positions.buffer, *velocities.buffer, *colors.buffer, *alive_lists.buffer, *dead_list.buffer, *counters.buffer, *sort_keys.buffer };
+}
+
+void ParticleSystem::create_buffers(){
+	auto storage = vk::BufferUsageFlagBits::eStorageBuffer;
+	auto local = vk::MemoryPropertyFlagBits::eDeviceLocal;
+
+	positions = create_buffer( phys_dev, device, capacity * sizeof( glm::vec4 ), storage, local );
+	velocities = create_buffer( phys_dev, device, capacity * sizeof( glm::vec4 ), storage, local );
+	colors = create_buffer( phys_dev, device, capacity * sizeof( uint32_t ), storage, local );
+	alive_lists = create_buffer( phys_dev, device, 2 * capacity * sizeof( uint32_t ), storage, local );
+	dead_list = create_buffer( phys_dev, device, capacity * sizeof( uint32_t ), storage, local );
+	// Counters followed by a VkDrawIndirectCommand
+	counters = create_buffer( phys_dev, device, 4 * sizeof( int32_t ) + sizeof( vk::DrawIndirectCommand ),
+			storage | vk::BufferUsageFlagBits::eIndirectBuffer, local );
+	sort_keys = create_buffer( phys_dev, device, capacity * sizeof( uint32_t ), storage, local );
+}
+
+void ParticleSystem::create_descriptors(){
+	std::vector<vk::DescriptorSetLayoutBinding> bindings;
+	for( uint32_t i = 0; i < binding_count; ++i )
+		bindings.emplace_back( i, vk::DescriptorType::eStorageBuffer, 1, vk::ShaderStageFlagBits::eCompute | vk::ShaderStageFlagBits::eVertex );
+
+	set_layout = device.createDescriptorSetLayoutUnique({ {}, bindings });
+
+	vk::DescriptorPoolSize pool_size( vk::DescriptorType::eStorageBuffer, binding_count );
+	descriptor_pool = device.createDescriptorPoolUnique({ {}, 1, 1, &pool_size });
+
+	descriptor_set = device.allocateDescriptorSets({ *descriptor_pool, 1, &*set_layout })[0];
+
+	const Buffer* buffers[binding_count] = { &positions, &velocities, &colors, &alive_lists, &dead_list, &counters, &sort_keys };
+
+	std::vector<vk::DescriptorBufferInfo> buffer_infos;
+	for( auto b: buffers )
+		buffer_infos.emplace_back( *b->buffer, 0, VK_WHOLE_SIZE );
+
+	std::vector<vk::WriteDescriptorSet> writes;
+	for( uint32_t i = 0; i < binding_count; ++i )
+		writes.emplace_back( descriptor_set, i, 0, 1, vk::DescriptorType::eStorageBuffer, nullptr, &buffer_infos[i] );
+
+	device.updateDescriptorSets( writes, {} );
+}
+
+void ParticleSystem::create_compute_pipelines(){
+	vk::PushConstantRange push_range( vk::ShaderStageFlagBits::eCompute, 0, sizeof( ComputeParams ));
+	compute_layout = device.createPipelineLayoutUnique({ {}, 1, &*set_layout, 1, &push_range });
+
+	auto create = [this]( const char* shader ){
+		vk::ComputePipelineCreateInfo cr_inf(
+				{},
+				{ {}, vk::ShaderStageFlagBits::eCompute, shaders.get( shader ), "main" },
+				*compute_layout
+			);
+		return std::move( device.createComputePipelinesUnique( cache, cr_inf ).value[0] );
+	};
+
+	init_pipeline = create( "particle_init.comp.glsl.spv" );
+	emit_pipeline = create( "particle_emit.comp.glsl.spv" );
+	simulate_pipeline = create( "particle_simulate.comp.glsl.spv" );
+	finish_pipeline = create( "particle_finish.comp.glsl.spv" );
+	sort_pipeline = create( "particle_sort.comp.glsl.spv" );
+}
+
+void ParticleSystem::create_render_pipeline( vk::RenderPass render_pass ){
+	if( !render_layout ){
+		vk::PushConstantRange push_range( vk::ShaderStageFlagBits::eVertex, 0, sizeof( DrawParams ));
+		render_layout = device.createPipelineLayoutUnique({ {}, 1, &*set_layout, 1, &push_range });
+	}
+
+	std::vector<vk::PipelineShaderStageCreateInfo> stage_infos{
+			{ {}, vk::ShaderStageFlagBits::eVertex, shaders.get( "particle.vert.glsl.spv" ), "main", {} },
+			{ {}, vk::ShaderStageFlagBits::eFragment, shaders.get( "particle.frag.glsl.spv" ), "main", {} },
+		};
+
+	// Quads are generated from gl_VertexIndex
+	vk::PipelineVertexInputStateCreateInfo vertex_input_info;
+
+	vk::PipelineInputAssemblyStateCreateInfo input_assembly_info(
+			{},
+			vk::PrimitiveTopology::eTriangleStrip,
+			VK_FALSE
+		);
+
+	vk::PipelineViewportStateCreateInfo viewport_state_info(
+			{},
+			1, nullptr,
+			1, nullptr
+		);
+
+	std::vector dynamic_states{ vk::DynamicState::eViewport, vk::DynamicState::eScissor };
+	vk::PipelineDynamicStateCreateInfo dynamic_state_info(
+			{},
+			dynamic_states
+		);
+
+	vk::PipelineRasterizationStateCreateInfo rasterization_state_info(
+			{},
+			VK_FALSE,
+			VK_FALSE,
+			vk::PolygonMode::eFill,
+			vk::CullModeFlagBits::eNone,
+			vk::FrontFace::eClockwise,
+			VK_FALSE,
+			0,
+			0,
+			0,
+			1
+		);
+
+	vk::PipelineMultisampleStateCreateInfo multisample_state_info(
+			{},
+			vk::SampleCountFlagBits::e1,
+			VK_FALSE,
+			1,
+			nullptr,
+			VK_FALSE,
+			VK_FALSE
+		);
+
+	// Premultiplied alpha
+	vk::PipelineColorBlendAttachmentState color_blend_attachment(
+			VK_TRUE,
+			vk::BlendFactor::eOne,
+			vk::BlendFactor::eOneMinusSrcAlpha,
+			vk::BlendOp::eAdd,
+			vk::BlendFactor::eOne,
+			vk::BlendFactor::eOneMinusSrcAlpha,
+			vk::BlendOp::eAdd,
+			vk::ColorComponentFlagBits::eR | vk::ColorComponentFlagBits::eG | vk::ColorComponentFlagBits::eB | vk::ColorComponentFlagBits::eA
+		);
+
+	vk::PipelineColorBlendStateCreateInfo color_blend_info(
+			{},
+			VK_FALSE,
+			vk::LogicOp::eCopy,
+			1, &color_blend_attachment,
+			{ 0, 0, 0, 0 }
+		);
+
+	// Hidden by opaque geometry, but sorted instead of writing depth
+	vk::PipelineDepthStencilStateCreateInfo depth_stencil_info(
+			{},
+			VK_TRUE,
+			VK_FALSE,
+			vk::CompareOp::eGreater
+		);
+
+	vk::GraphicsPipelineCreateInfo pipeline_create_info(
+			{},
+			stage_infos,
+			&vertex_input_info,
+			&input_assembly_info,
+			nullptr,
+			&viewport_state_info,
+			&rasterization_state_info,
+			&multisample_state_info,
+			&depth_stencil_info,
+			&color_blend_info,
+			&dynamic_state_info,
+			*render_layout,
+			render_pass,
+			0,
+			vk::Pipeline{},
+			-1
+		);
+
+	render_pipeline = std::move( device.createGraphicsPipelinesUnique( cache, pipeline_create_info ).value[0] );
+}
+
+void ParticleSystem::burst( const Emitter& emitter, uint32_t count ){
+	bursts.push_back({ emitter, count });
+}
+
+void ParticleSystem::record_emit( vk::CommandBuffer cmd, const Emitter& emitter, uint32_t count, const glm::vec4& camera_position ){
+	if( count == 0 )
+		return;
+
+	ComputeParams params{
+		glm::vec4( emitter.position, emitter.spread ),
+		glm::vec4( emitter.velocity, emitter.velocity_jitter ),
+		emitter.color,
+		camera_position,
+		count,
+		parity,
+		seed++,
+		emitter.lifetime,
+		0,
+		0,
+		emitter.size,
+	};
+
+	cmd.pushConstants( *compute_layout, vk::ShaderStageFlagBits::eCompute, 0, sizeof( params ), &params );
+	cmd.dispatch(( count + workgroup_size - 1 ) / workgroup_size, 1, 1 );
+
+	if( emission_count == max_emissions ){
+		// The two oldest become one that lives as long as the longer of them
+		emissions[1] = { std::max( emissions[0].expiry, emissions[1].expiry ), emissions[0].count + emissions[1].count };
+		std::copy( emissions.begin() + 1, emissions.end(), emissions.begin() );
+		--emission_count;
+	}
+	emissions[emission_count++] = { time + emitter.lifetime, count };
+}
+
+uint32_t ParticleSystem::alive_bound( float dt ){
+	uint64_t bound = 0;
+	size_t kept = 0;
+	for( size_t i = 0; i < emission_count; ++i ){
+		// A frame late, particles die in the simulation step after their life ran out
+		if( emissions[i].expiry + dt < time )
+			continue;
+		bound += emissions[i].count;
+		emissions[kept++] = emissions[i];
+	}
+	emission_count = kept;
+
+	return static_cast<uint32_t>( std::min<uint64_t>( bound, capacity ));
+}
+
+void ParticleSystem::record_simulation( vk::CommandBuffer cmd, float dt, const Camera& camera ){
+	ComputeParams params{};
+	params.camera_position = glm::vec4( camera.position, dt );
+	params.parity = parity;
+	time += dt;
+
+	cmd.bindDescriptorSets( vk::PipelineBindPoint::eCompute, *compute_layout, 0, descriptor_set, {} );
+
+	if( !initialised ){
+		params.emit_count = capacity;
+		cmd.bindPipeline( vk::PipelineBindPoint::eCompute, *init_pipeline );
+		cmd.pushConstants( *compute_layout, vk::ShaderStageFlagBits::eCompute, 0, sizeof( params ), &params );
+		cmd.dispatch( capacity / workgroup_size, 1, 1 );
+		compute_barrier( cmd );
+		initialised = true;
+	}
+
+	cmd.bindPipeline( vk::PipelineBindPoint::eCompute, *emit_pipeline );
+	for( auto& emitter: emitters ){
+		emitter.accumulated += emitter.rate * dt;
+		auto count = static_cast<uint32_t>( emitter.accumulated );
+		emitter.accumulated -= count;
+
+		record_emit( cmd, emitter, count, params.camera_position );
+	}
+	for( auto& b: bursts )
+		record_emit( cmd, b.emitter, b.count, params.camera_position );
+	bursts.clear();
+	compute_barrier( cmd );
+
+	// Everything past the alive count returns right away, so covering the bound is enough. The sort works on
+	// blocks of 2 * workgroup_size elements
+	uint32_t alive = alive_bound( dt );
+	uint32_t sort_size = std::max( std::bit_ceil( alive ), 2 * workgroup_size );
+
+	cmd.bindPipeline( vk::PipelineBindPoint::eCompute, *simulate_pipeline );
+	cmd.pushConstants( *compute_layout, vk::ShaderStageFlagBits::eCompute, 0, sizeof( params ), &params );
+	cmd.dispatch( std::max(( alive + workgroup_size - 1 ) / workgroup_size, 1u ), 1, 1 );
+	compute_barrier( cmd );
+
+	cmd.bindPipeline( vk::PipelineBindPoint::eCompute, *finish_pipeline );
+	cmd.dispatch( 1, 1, 1 );
+	compute_barrier( cmd );
+
+	cmd.bindPipeline( vk::PipelineBindPoint::eCompute, *sort_pipeline );
+	cmd.dispatch( sort_size / workgroup_size, 1, 1 );
+	compute_barrier( cmd );
+
+	for( uint32_t k = 2; k <= sort_size; k <<= 1 ){
+		params.sort_k = k;
+
+		uint32_t j = k >> 1;
+		for( ; j > workgroup_size; j >>= 1 ){
+			params.sort_j = j;
+			cmd.pushConstants( *compute_layout, vk::ShaderStageFlagBits::eCompute, 0, sizeof( params ), &params );
+			cmd.dispatch( sort_size / workgroup_size, 1, 1 );
+			compute_barrier( cmd );
+		}
+
+		// The remaining steps stay inside blocks of 2 * workgroup_size elements
+		params.sort_j = j;
+		cmd.pushConstants( *compute_layout, vk::ShaderStageFlagBits::eCompute, 0, sizeof( params ), &params );
+		cmd.dispatch( sort_size / ( 2 * workgroup_size ), 1, 1 );
+		compute_barrier( cmd );
+	}
+
+	draw_offset = ( 1 - parity ) * capacity;
+	parity = 1 - parity;
+}
+
+void ParticleSystem::record_draw( vk::CommandBuffer cmd, const Camera& camera, float aspect ){
+	DrawParams params{
+		camera.projection( aspect ) * camera.view(),
+		glm::vec4( camera.right(), 0 ),
+		glm::vec4( glm::normalize( glm::cross( camera.right(), camera.forward )), 0 ),
+		draw_offset,
+	};
+
+	cmd.bindPipeline( vk::PipelineBindPoint::eGraphics, *render_pipeline );
+	cmd.bindDescriptorSets( vk::PipelineBindPoint::eGraphics, *render_layout, 0, descriptor_set, {} );
+	cmd.pushConstants( *render_layout, vk::ShaderStageFlagBits::eVertex, 0, sizeof( params ), &params );
+	// The instance count was written by the simulation
+	cmd.drawIndirect( *counters.buffer, 4 * sizeof( int32_t ), 1, sizeof( vk::DrawIndirectCommand ));
+}
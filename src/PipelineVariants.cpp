@@ -0,0 +1,279 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  PipelineVariants.cpp
+ *
+ *    Description:  Implementation of the pipeline variant builder
+ *
+ *        Version:  1.0
+ *        Created:  10/19/2026 03:04:33 PM
+ *       Revision:  none
+ *
+ *         Author:  Samuel Knoethig (), samuel@knoethig.net
+ *
+ * =====================================================================================
+ */
+
+#include "Util.hpp"
+#include "PipelineVariants.hpp"
+#include "AppGraphics.hpp"
+
+#include <fstream>
+#include <string.h>
+
+using namespace SpaceAppVideo;
+
+/**
+ *	Checks the header of serialized pipeline cache data against the device (VkPipelineCacheHeaderVersionOne)
+ */
+static bool cache_data_compatible( const std::vector<char>& data, const vk::PhysicalDeviceProperties& props ){
+	constexpr size_t header_size = 16 + VK_UUID_SIZE;
+	if( data.size() < header_size )
+		return false;
+
+	uint32_t header[4];
+	memcpy( header, data.data(), sizeof( header ));
+
+	return header[1] == VK_PIPELINE_CACHE_HEADER_VERSION_ONE
+		&& header[2] == props.vendorID
+		&& header[3] == props.deviceID
+		&& memcmp( data.data() + 16, props.pipelineCacheUUID.data(), VK_UUID_SIZE ) == 0;
+}
+
+PipelineVariants::PipelineVariants( vk::PhysicalDevice phys_dev, vk::Device device, ShaderManager& shaders,
+		std::filesystem::path cache_path, bool feedback_supported ):
+	phys_dev( phys_dev ), device( device ), shaders( shaders ), cache_path( std::move( cache_path )), feedback_supported( feedback_supported ){
+
+	std::vector<char> data;
+	if( std::ifstream file( this->cache_path, std::ios::ate | std::ios::binary ); file.is_open() ){
+		data.resize( file.tellg() );
+		file.seekg( 0 );
+		file.read( data.data(), data.size() );
+	}
+
+	if( !data.empty() && !cache_data_compatible( data, phys_dev.getProperties() )){
+		logger << LogChannel::Video << LogLevel::Info << "Pipeline cache was written by a different device or driver, discarding it";
+		data.clear();
+	}
+
+	cache = device.createPipelineCacheUnique({ {}, data.size(), data.data() });
+	logger << LogChannel::Video << LogLevel::Info << "Created pipeline cache with " << data.size() << " bytes of initial data";
+}
+
+void PipelineVariants::save_cache(){
+	auto data = device.getPipelineCacheData( *cache );
+
+	std::ofstream file( cache_path, std::ios::binary | std::ios::trunc );
+	file.write( reinterpret_cast<const char*>( data.data() ), data.size() );
+
+	logger << LogChannel::Video << LogLevel::Info << "Wrote " << data.size() << " bytes of pipeline cache";
+}
+
+vk::PipelineCache PipelineVariants::pipeline_cache() const {
+	return *cache;
+}
+
+static vk::CullModeFlags to_vk( CullMode mode ){
+	switch( mode ){
+		case CullMode::Front:
+			return vk::CullModeFlagBits::eFront;
+		case CullMode::Back:
+			return vk::CullModeFlagBits::eBack;
+		default:
+			return vk::CullModeFlagBits::eNone;
+	}
+}
+
+static vk::PipelineColorBlendAttachmentState blend_state( BlendMode mode ){
+	auto all_components = vk::ColorComponentFlagBits::eR | vk::ColorComponentFlagBits::eG | vk::ColorComponentFlagBits::eB | vk::ColorComponentFlagBits::eA;
+
+	switch( mode ){
+		case BlendMode::Alpha:
+			return {
+				VK_TRUE,
+				vk::BlendFactor::eSrcAlpha,
+				vk::BlendFactor::eOneMinusSrcAlpha,
+				vk::BlendOp::eAdd,
+				vk::BlendFactor::eOne,
+				vk::BlendFactor::eOneMinusSrcAlpha,
+				vk::BlendOp::eAdd,
+				all_components
+			};
+		case BlendMode::Additive:
+			return {
+				VK_TRUE,
+				vk::BlendFactor::eOne,
+				vk::BlendFactor::eOne,
+				vk::BlendOp::eAdd,
+				vk::BlendFactor::eOne,
+				vk::BlendFactor::eOne,
+				vk::BlendOp::eAdd,
+				all_components
+			};
+		default:
+			return {
+				VK_FALSE,
+				vk::BlendFactor::eOne,
+				vk::BlendFactor::eZero,
+				vk::BlendOp::eAdd,
+				vk::BlendFactor::eOne,
+				vk::BlendFactor::eZero,
+				vk::BlendOp::eAdd,
+				all_components
+			};
+	}
+}
+
+PipelineVariants::Table PipelineVariants::build( const std::vector<PipelineKey>& keys, vk::RenderPass render_pass, vk::PipelineLayout layout ){
+	Table result;
+	if( keys.empty() )
+		return result;
+
+	auto bindings = Vertex::getBindingDesc();
+	auto attribs = Vertex::getAttribDescs();
+
+	vk::PipelineVertexInputStateCreateInfo vertex_input_info(
+			{},
+			bindings,
+			attribs
+		);
+
+	vk::PipelineInputAssemblyStateCreateInfo input_assembly_info(
+			{},
+			vk::PrimitiveTopology::eTriangleList,
+			VK_FALSE
+		);
+
+	// Viewport and scissor are dynamic, so pipelines stay valid across swapchain resizes
+	vk::PipelineViewportStateCreateInfo viewport_state_info(
+			{},
+			1, nullptr,
+			1, nullptr
+		);
+
+	std::vector dynamic_states{ vk::DynamicState::eViewport, vk::DynamicState::eScissor };
+	vk::PipelineDynamicStateCreateInfo dynamic_state_info(
+			{},
+			dynamic_states
+		);
+
+	vk::PipelineMultisampleStateCreateInfo multisample_state_info(
+			{},
+			vk::SampleCountFlagBits::e1,
+			VK_FALSE,
+			1,
+			nullptr,
+			VK_FALSE,
+			VK_FALSE
+		);
+
+	vk::SpecializationMapEntry feature_entry( 0, 0, sizeof( uint32_t ));
+
+	// Per variant state, sized up front so the create infos can point into them
+	struct Variant {
+		uint32_t features;
+		vk::SpecializationInfo specialization;
+		std::array<vk::PipelineShaderStageCreateInfo, 2> stages;
+		vk::PipelineRasterizationStateCreateInfo rasterization;
+		vk::PipelineColorBlendAttachmentState blend_attachment;
+		vk::PipelineColorBlendStateCreateInfo blend;
+		vk::PipelineDepthStencilStateCreateInfo depth;
+		vk::PipelineCreationFeedbackEXT feedback;
+		std::array<vk::PipelineCreationFeedbackEXT, 2> stage_feedbacks;
+		vk::PipelineCreationFeedbackCreateInfoEXT feedback_info;
+	};
+	std::vector<Variant> variants( keys.size() );
+	std::vector<vk::GraphicsPipelineCreateInfo> create_infos;
+	create_infos.reserve( keys.size() );
+
+	for( size_t i = 0; i < keys.size(); ++i ){
+		auto& key = keys[i];
+		auto& v = variants[i];
+
+		v.features = key.features;
+		v.specialization = vk::SpecializationInfo( 1, &feature_entry, sizeof( v.features ), &v.features );
+
+		v.stages = {
+			vk::PipelineShaderStageCreateInfo( {}, vk::ShaderStageFlagBits::eVertex, shaders.get( vertex_shader( key.program )), "main", &v.specialization ),
+			vk::PipelineShaderStageCreateInfo( {}, vk::ShaderStageFlagBits::eFragment, shaders.get( fragment_shader( key.program )), "main", &v.specialization ),
+		};
+
+		v.rasterization = vk::PipelineRasterizationStateCreateInfo(
+				{},
+				VK_FALSE,
+				VK_FALSE,
+				vk::PolygonMode::eFill,
+				to_vk( key.cull_mode ),
+				key.front_face == FrontFace::Clockwise ? vk::FrontFace::eClockwise : vk::FrontFace::eCounterClockwise,
+				VK_FALSE,
+				0,
+				0,
+				0,
+				1
+			);
+
+		v.blend_attachment = blend_state( key.blend_mode );
+		v.blend = vk::PipelineColorBlendStateCreateInfo(
+				{},
+				VK_FALSE,
+				vk::LogicOp::eCopy,
+				1, &v.blend_attachment,
+				{ 0, 0, 0, 0 }
+			);
+
+		// Reversed depth, blended surfaces are tested but hide nothing behind them
+		v.depth = vk::PipelineDepthStencilStateCreateInfo(
+				{},
+				VK_TRUE,
+				key.blend_mode == BlendMode::Opaque,
+				vk::CompareOp::eGreater
+			);
+
+		vk::GraphicsPipelineCreateInfo pipeline_create_info(
+				{},
+				v.stages,
+				&vertex_input_info,
+				&input_assembly_info,
+				nullptr,
+				&viewport_state_info,
+				&v.rasterization,
+				&multisample_state_info,
+				&v.depth,
+				&v.blend,
+				&dynamic_state_info,
+				layout,
+				render_pass,
+				0,
+				vk::Pipeline{},
+				-1
+			);
+
+		if( feedback_supported ){
+			v.feedback_info = vk::PipelineCreationFeedbackCreateInfoEXT( &v.feedback, v.stage_feedbacks.size(), v.stage_feedbacks.data() );
+			pipeline_create_info.pNext = &v.feedback_info;
+		}
+
+		create_infos.push_back( pipeline_create_info );
+	}
+
+	auto pipelines = device.createGraphicsPipelinesUnique( *cache, create_infos ).value;
+
+	size_t cache_hits = 0;
+	uint64_t duration = 0;
+	for( size_t i = 0; i < keys.size(); ++i ){
+		auto& feedback = variants[i].feedback;
+		if( feedback_supported && ( feedback.flags & vk::PipelineCreationFeedbackFlagBitsEXT::eValid )){
+			if( feedback.flags & vk::PipelineCreationFeedbackFlagBitsEXT::eApplicationPipelineCacheHit )
+				++cache_hits;
+			duration += feedback.duration;
+		}
+
+		result[keys[i].pack()] = std::move( pipelines[i] );
+	}
+
+	if( feedback_supported )
+		logger << LogChannel::Video << LogLevel::Verbose << "Built " << keys.size() << " pipeline variants in " << duration / 1000 <<
+			"us, " << cache_hits << " pipeline cache hits";
+
+	return result;
+}
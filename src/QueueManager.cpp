@@ -0,0 +1,381 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  QueueManager.cpp
+ *
+ *    Description:  Source file defining things from QueueManager.hpp
+ *
+ *        Version:  1.0
+ *        Created:  10/19/2026 11:04:17 PM
+ *       Revision:  none
+ *
+ *         Author:  Samuel Knoethig (), samuel@knoethig.net
+ *
+ * =====================================================================================
+ */
+
+#include "Util.hpp"
+#include "QueueManager.hpp"
+
+#include <map>
+
+using namespace SpaceAppVideo;
+
+namespace {
+	// Graphics has to win whenever the GPU is contended, the rest only fills the gaps it leaves
+	constexpr float graphics_priority{ 1.0f };
+	constexpr float compute_priority{ 0.5f };
+	constexpr float transfer_priority{ 0.25f };
+
+	size_t role_index( QueueRole role ){
+		return static_cast<size_t>( role );
+	}
+}
+
+QueueFamilyIndices QueueManager::find_families( vk::PhysicalDevice phys_dev, vk::SurfaceKHR surface ){
+	QueueFamilyIndices indices;
+
+	auto qfprops = phys_dev.getQueueFamilyProperties();
+
+	for( uint32_t i = 0; i < qfprops.size(); ++i ){
+		auto flags = qfprops[i].queueFlags;
+		bool graphics = static_cast<bool>( flags & vk::QueueFlagBits::eGraphics );
+		bool compute = static_cast<bool>( flags & vk::QueueFlagBits::eCompute );
+
+		if( !indices.graphics && graphics )
+			indices.graphics = i;
+
+		// Presenting from the graphics family avoids an ownership transfer of every swapchain image
+		if( phys_dev.getSurfaceSupportKHR( i, surface ) && ( !indices.present || ( graphics && indices.present != indices.graphics )))
+			indices.present = i;
+
+		// A family without graphics support is most likely backed by dedicated async compute hardware
+		if( !indices.compute && compute && !graphics )
+			indices.compute = i;
+
+		// Neither graphics nor compute usually means a copy engine
+		if( !indices.transfer && ( flags & vk::QueueFlagBits::eTransfer ) && !graphics && !compute )
+			indices.transfer = i;
+	}
+
+	if( !indices.compute )
+		indices.compute = indices.graphics;
+	if( !indices.transfer )
+		indices.transfer = indices.compute;
+
+	return indices;
+}
+
+QueueManager::QueueManager( vk::PhysicalDevice phys_dev, const QueueFamilyIndices& indices ){
+	auto qfprops = phys_dev.getQueueFamilyProperties();
+
+	std::map<uint32_t, std::vector<float>> family_priorities;
+
+	// share_existing reuses the family's first queue instead of creating one, if there is one already
+	auto assign = [&]( QueueRole role, uint32_t family, float priority, bool share_existing ){
+		auto& prios = family_priorities[family];
+
+		if(( share_existing && !prios.empty() ) || prios.size() == qfprops[family].queueCount ){
+			assignments[role_index( role )] = { family, 0, {} };
+			return;
+		}
+
+		assignments[role_index( role )] = { family, static_cast<uint32_t>( prios.size() ), {} };
+		prios.push_back( priority );
+	};
+
+	assign( QueueRole::Graphics, indices.graphics.value(), graphics_priority, false );
+	assign( QueueRole::Present, indices.present.value(), graphics_priority, true );
+	// A second queue of the graphics family still runs concurrently on most hardware
+	assign( QueueRole::Compute, indices.compute.value(), compute_priority, false );
+	assign( QueueRole::Transfer, indices.transfer.value(), transfer_priority, false );
+
+	for( auto& [family, prios]: family_priorities ){
+		priorities.push_back( prios );
+		infos.emplace_back( vk::DeviceQueueCreateFlags{}, family, priorities.back().size(), nullptr );
+	}
+	// Only taken once priorities stopped growing
+	for( size_t i = 0; i < infos.size(); ++i )
+		infos[i].pQueuePriorities = priorities[i].data();
+
+	for( auto role: { QueueRole::Compute, QueueRole::Transfer })
+		logger << LogChannel::Video << LogLevel::Info << ( role == QueueRole::Compute ? "Compute" : "Transfer" ) <<
+			" work is submitted to " << ( dedicated( role ) ? "a dedicated queue" : "the graphics queue" ) <<
+			" of family " << family( role );
+}
+
+const std::vector<vk::DeviceQueueCreateInfo>& QueueManager::create_infos() const {
+	return infos;
+}
+
+void QueueManager::retrieve( vk::Device device ){
+	for( auto& a: assignments )
+		a.queue = device.getQueue( a.family, a.index );
+}
+
+vk::Queue QueueManager::queue( QueueRole role ) const {
+	return assignments[role_index( role )].queue;
+}
+
+uint32_t QueueManager::family( QueueRole role ) const {
+	return assignments[role_index( role )].family;
+}
+
+bool QueueManager::dedicated( QueueRole role ) const {
+	auto& a = assignments[role_index( role )];
+	auto& graphics = assignments[role_index( QueueRole::Graphics )];
+	return a.family != graphics.family || a.index != graphics.index;
+}
+
+FrameScheduler::FrameScheduler( vk::Device device, const QueueManager& queues ): device( device ), queues( queues ){
+	buffers.reserve( max_buffers );
+	frames.resize( MAX_FRAMES_IN_FLIGHT );
+
+	for( auto& f: frames ){
+		for( auto role: { QueueRole::Graphics, QueueRole::Compute, QueueRole::Transfer }){
+			auto i = role_index( role );
+			f.pools[i] = device.createCommandPoolUnique({ vk::CommandPoolCreateFlagBits::eTransient, queues.family( role )});
+			f.cmds[i] = device.allocateCommandBuffersUnique({ *f.pools[i], vk::CommandBufferLevel::ePrimary, max_passes });
+		}
+		for( auto& s: f.edges )
+			s = device.createSemaphoreUnique({});
+		for( auto& fence: f.fences )
+			fence = device.createFenceUnique({});
+	}
+
+	for( auto& set: carry_semas )
+		for( auto& s: set )
+			s = device.createSemaphoreUnique({});
+}
+
+FrameScheduler::BufferId FrameScheduler::add_buffer( vk::Buffer buffer, bool exclusive ){
+	if( buffers.size() == max_buffers )
+		throw std::runtime_error( "Too many buffers in the frame scheduler" );
+
+	buffers.push_back({ buffer, exclusive, std::nullopt, {} });
+	return buffers.size() - 1;
+}
+
+void FrameScheduler::begin_frame( size_t frame_slot ){
+	frame = &frames[frame_slot];
+
+	if( frame->fences_used > 0 ){
+		FixedVector<vk::Fence, max_passes> fences;
+		for( uint32_t i = 0; i < frame->fences_used; ++i )
+			fences.push_back( *frame->fences[i] );
+
+		if( vk::Result::eSuccess != device.waitForFences( fences.size(), fences.data(), VK_TRUE, UINT64_MAX ))
+			throw std::runtime_error( "Wait for fence failed" );
+		if( vk::Result::eSuccess != device.resetFences( fences.size(), fences.data() ))
+			throw std::runtime_error( "Reset fence failed" );
+	}
+	frame->fences_used = 0;
+
+	for( auto role: { QueueRole::Graphics, QueueRole::Compute, QueueRole::Transfer }){
+		device.resetCommandPool( *frame->pools[role_index( role )], {} );
+		frame->cmds_used[role_index( role )] = 0;
+	}
+	frame->edges_used = 0;
+
+	passes.clear();
+	batches.clear();
+}
+
+FrameScheduler::PassId FrameScheduler::add_pass( QueueRole role, void* context, Record record ){
+	if( role == QueueRole::Present )
+		throw std::runtime_error( "Passes can not be submitted to the present queue" );
+
+	Pass pass{};
+	pass.role = role;
+	pass.context = context;
+	pass.record = record;
+	passes.push_back( pass );
+
+	return passes.size() - 1;
+}
+
+void FrameScheduler::use( PassId pass, BufferId buffer, vk::PipelineStageFlags stages, vk::AccessFlags access ){
+	passes[pass].uses.push_back({ buffer, stages, access });
+}
+
+void FrameScheduler::wait( PassId pass, vk::Semaphore semaphore, vk::PipelineStageFlags stages ){
+	passes[pass].waits.push_back( semaphore );
+	passes[pass].wait_stages.push_back( stages );
+}
+
+void FrameScheduler::signal( PassId pass, vk::Semaphore semaphore ){
+	passes[pass].signals.push_back( semaphore );
+}
+
+const FrameScheduler::Use* FrameScheduler::find_use( const Pass& pass, BufferId buffer ) const {
+	for( auto& u: pass.uses )
+		if( u.buffer == buffer )
+			return &u;
+	return nullptr;
+}
+
+FrameScheduler::Neighbour FrameScheduler::previous_use( size_t pass, BufferId buffer ) const {
+	for( size_t i = passes.size(); i-- > 0; ){
+		// Walks backwards from pass, then wraps around to the end of the last frame, ending at pass itself
+		size_t p = ( pass + i ) % passes.size();
+		if( auto u = find_use( passes[p], buffer ))
+			return { &passes[p], u, p >= pass };
+	}
+	throw std::runtime_error( "Buffer is not used by the pass" );
+}
+
+FrameScheduler::Neighbour FrameScheduler::next_use( size_t pass, BufferId buffer ) const {
+	for( size_t i = 1; i <= passes.size(); ++i ){
+		size_t p = ( pass + i ) % passes.size();
+		if( auto u = find_use( passes[p], buffer ))
+			return { &passes[p], u, p <= pass };
+	}
+	throw std::runtime_error( "Buffer is not used by the pass" );
+}
+
+void FrameScheduler::add_wait( Batch& batch, vk::Semaphore semaphore, vk::PipelineStageFlags stages ){
+	for( size_t i = 0; i < batch.waits.size(); ++i ){
+		if( batch.waits[i] == semaphore ){
+			batch.wait_stages[i] |= stages;
+			return;
+		}
+	}
+	batch.waits.push_back( semaphore );
+	batch.wait_stages.push_back( stages );
+}
+
+void FrameScheduler::record( size_t pass_index, vk::CommandBuffer cmd, Batch& batch ){
+	auto& pass = passes[pass_index];
+	auto family = queues.family( pass.role );
+	auto queue = queues.queue( pass.role );
+
+	// Uses on the same queue only need one global barrier
+	vk::MemoryBarrier memory_barrier;
+	FixedVector<vk::BufferMemoryBarrier, max_pass_uses> buffer_barriers;
+	vk::PipelineStageFlags src_stages, dst_stages;
+
+	// Everything the previous use of each buffer requires before this pass may touch it
+	for( auto& u: pass.uses ){
+		auto& state = buffers[u.buffer];
+		auto prev = previous_use( pass_index, u.buffer );
+		auto prev_family = queues.family( prev.pass->role );
+
+		if( queues.queue( prev.pass->role ) == queue ){
+			memory_barrier.srcAccessMask |= prev.use->access;
+			memory_barrier.dstAccessMask |= u.access;
+			src_stages |= prev.use->stages;
+			dst_stages |= u.stages;
+			continue;
+		}
+
+		if( !prev.other_frame ){
+			auto& producer = batches[prev.pass->batch];
+			auto& sema = edges[prev.pass->batch][pass.batch];
+			if( !sema ){
+				if( frame->edges_used == frame->edges.size() )
+					throw std::runtime_error( "Frame scheduler ran out of semaphores" );
+				sema = *frame->edges[frame->edges_used++];
+				producer.signals.push_back( sema );
+			}
+			add_wait( batch, sema, u.stages );
+		} else if( state.carried ){
+			add_wait( batch, state.carried, u.stages );
+			state.carried = vk::Semaphore{};
+		}
+
+		// The semaphore wait covers the memory dependency, only the acquire half of the transfer is left
+		if( state.exclusive && state.released_to == family ){
+			buffer_barriers.push_back({ {}, u.access, prev_family, family, state.buffer, 0, VK_WHOLE_SIZE });
+			src_stages |= u.stages;
+			dst_stages |= u.stages;
+			state.released_to.reset();
+		}
+	}
+
+	if( src_stages )
+		cmd.pipelineBarrier( src_stages, dst_stages, {},
+				1, &memory_barrier, buffer_barriers.size(), buffer_barriers.data(), 0, nullptr );
+
+	pass.record( pass.context, cmd );
+
+	// Releases for buffers whose next use is on another family and semaphores for uses in the next frame
+	buffer_barriers.clear();
+	src_stages = {};
+	for( auto& u: pass.uses ){
+		auto& state = buffers[u.buffer];
+		auto next = next_use( pass_index, u.buffer );
+		auto next_family = queues.family( next.pass->role );
+
+		if( queues.queue( next.pass->role ) == queue )
+			continue;
+
+		if( state.exclusive && next_family != family ){
+			buffer_barriers.push_back({ u.access, {}, family, next_family, state.buffer, 0, VK_WHOLE_SIZE });
+			src_stages |= u.stages;
+			state.released_to = next_family;
+		}
+
+		if( next.other_frame ){
+			state.carried = *carry_semas[submissions % 2][u.buffer];
+			batch.signals.push_back( state.carried );
+		}
+	}
+
+	if( !buffer_barriers.empty() )
+		cmd.pipelineBarrier( src_stages, vk::PipelineStageFlagBits::eBottomOfPipe, {},
+				0, nullptr, buffer_barriers.size(), buffer_barriers.data(), 0, nullptr );
+}
+
+void FrameScheduler::submit( vk::Fence fence ){
+	for( auto& row: edges )
+		row.fill( vk::Semaphore{} );
+
+	for( auto& pass: passes ){
+		auto queue = queues.queue( pass.role );
+		if( batches.empty() || batches[batches.size() - 1].queue != queue ){
+			Batch batch{};
+			batch.queue = queue;
+			batches.push_back( batch );
+		}
+		pass.batch = batches.size() - 1;
+
+		auto& batch = batches[pass.batch];
+		for( size_t i = 0; i < pass.waits.size(); ++i )
+			add_wait( batch, pass.waits[i], pass.wait_stages[i] );
+		for( auto s: pass.signals )
+			batch.signals.push_back( s );
+	}
+
+	for( size_t i = 0; i < passes.size(); ++i ){
+		auto role = role_index( passes[i].role );
+		vk::CommandBuffer cmd = *frame->cmds[role][frame->cmds_used[role]++];
+
+		cmd.begin( vk::CommandBufferBeginInfo( vk::CommandBufferUsageFlagBits::eOneTimeSubmit ));
+		record( i, cmd, batches[passes[i].batch] );
+		cmd.end();
+
+		batches[passes[i].batch].cmds.push_back( cmd );
+	}
+
+	vk::Queue graphics = queues.queue( QueueRole::Graphics );
+	size_t last_graphics = batches.size();
+	for( size_t i = 0; i < batches.size(); ++i )
+		if( batches[i].queue == graphics )
+			last_graphics = i;
+
+	for( size_t i = 0; i < batches.size(); ++i ){
+		auto& batch = batches[i];
+
+		vk::SubmitInfo sub_inf(
+				batch.waits.size(), batch.waits.data(), batch.wait_stages.data(),
+				batch.cmds.size(), batch.cmds.data(),
+				batch.signals.size(), batch.signals.data()
+			);
+
+		// Every other batch gets a fence of its own, so its command buffers are known to be done by begin_frame
+		vk::Fence batch_fence = i == last_graphics ? fence : *frame->fences[frame->fences_used++];
+		batch.queue.submit( sub_inf, batch_fence );
+	}
+
+	++submissions;
+}
@@ -0,0 +1,199 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  ShaderManager.cpp
+ *
+ *    Description:  Implementation of the shader manager
+ *
+ *        Version:  1.0
+ *        Created:  10/19/2026 01:44:26 PM
+ *       Revision:  none
+ *
+ *         Author:  Samuel Knoethig (), samuel@knoethig.net
+ *
+ * =====================================================================================
+ */
+
+#include "Util.hpp"
+#include "ShaderManager.hpp"
+#include "StartupTracer.hpp"
+
+#include <cerrno>
+#include <fstream>
+
+#include <spawn.h>
+#include <sys/wait.h>
+
+extern char** environ;
+
+using namespace SpaceAppVideo;
+namespace fs = std::filesystem;
+
+namespace {
+	/**
+	 *	Runs compiler on source without a shell, so nothing in the file names is ever interpreted.
+	 *	Returns whether it exited successfully
+	 */
+	bool compile( const fs::path& compiler, const fs::path& source, const fs::path& output ){
+		std::string compiler_arg = compiler.string(), source_arg = source.string(), output_arg = output.string();
+		std::string warnings{ "-w" }, vulkan{ "-V" }, output_flag{ "-o" };
+		std::vector<char*> argv{ compiler_arg.data(), warnings.data(), vulkan.data(), source_arg.data(), output_flag.data(), output_arg.data(), nullptr };
+
+		pid_t pid;
+		if( posix_spawnp( &pid, compiler_arg.c_str(), nullptr, nullptr, argv.data(), environ ) != 0 )
+			return false;
+
+		int status;
+		while( waitpid( pid, &status, 0 ) < 0 ){
+			if( errno != EINTR )
+				return false;
+		}
+		return WIFEXITED( status ) && WEXITSTATUS( status ) == 0;
+	}
+}
+
+ShaderManager::ShaderManager( fs::path directory, ThreadPool& pool ): directory( std::move( directory )){
+	std::error_code ec;
+	for( auto& entry: fs::directory_iterator( this->directory, ec )){
+		if( entry.path().extension() != ".spv" )
+			continue;
+
+		auto& task = preloaded[entry.path().filename().string()] = preload( pool, entry.path() );
+		task.start();
+	}
+}
+
+ShaderManager::~ShaderManager(){
+	for( auto& [name, task]: preloaded )
+		discard( task );
+}
+
+void ShaderManager::discard( Task<std::vector<char>>& task ){
+	// A running read must not be destroyed, its result is thrown away once it completed
+	try {
+		sync_wait( task );
+	} catch( std::exception& e ){}
+}
+
+Task<std::vector<char>> ShaderManager::preload( ThreadPool& pool, fs::path path ){
+	co_await pool.schedule();
+	auto trace = startup_tracer.trace( "Load " + path.string() );
+	co_return co_await SpaceAppVideo::read_file( pool, path );
+}
+
+void ShaderManager::set_device( vk::Device device ){
+	this->device = device;
+}
+
+std::vector<char> ShaderManager::read_file( const fs::path& path ){
+	std::ifstream code_file( path, std::ios::ate | std::ios::binary );
+
+	if( !code_file.is_open()){
+		logger << LogChannel::Video << LogLevel::Error << "Could not open file: " << path;
+		throw std::runtime_error( "Could not open file" );
+	}
+
+	size_t file_size = ( size_t )code_file.tellg();
+	std::vector<char> code( file_size );
+
+	code_file.seekg( 0 );
+	code_file.read( code.data(), file_size );
+
+	return code;
+}
+
+uint64_t ShaderManager::hash( const std::vector<char>& code ){
+	// FNV-1a
+	uint64_t h = 14695981039346656037ull;
+	for( auto c: code )
+		h = ( h ^ static_cast<uint8_t>( c )) * 1099511628211ull;
+	return h;
+}
+
+bool ShaderManager::load( const std::string& name, const std::vector<char>& code ){
+	// SPIR-V is a stream of words, anything else is a partially written file
+	if( code.empty() || code.size() % sizeof( uint32_t ) != 0 )
+		return false;
+
+	auto h = hash( code );
+
+	if( auto it = files.find( name ); it != files.end() && it->second == h )
+		return false;
+
+	if( !modules.contains( h )){
+		vk::ShaderModuleCreateInfo cr_inf( vk::ShaderModuleCreateFlags{}, code.size(), reinterpret_cast<const uint32_t*>( code.data() ));
+		modules[h] = device.createShaderModuleUnique( cr_inf );
+	}
+
+	files[name] = h;
+	return true;
+}
+
+vk::ShaderModule ShaderManager::get( const std::string& name ){
+	std::unique_lock lock( mutex );
+
+	if( auto it = files.find( name ); it != files.end() )
+		return *modules[it->second];
+
+	std::vector<char> code;
+	if( auto it = preloaded.find( name ); it != preloaded.end() ){
+		auto task = std::move( it->second );
+		preloaded.erase( it );
+
+		lock.unlock();
+		code = sync_wait( task );
+		lock.lock();
+	} else {
+		code = read_file( directory / name );
+	}
+
+	load( name, code );
+	logger << LogChannel::Video << LogLevel::Info << "Created shader module " << name;
+
+	return *modules[files.at( name )];
+}
+
+void ShaderManager::watch( std::function<void()> on_reload ){
+	watcher.watch( directory, [this, on_reload]( const fs::path& path ){
+			if( path.extension() != ".spv" )
+				return;
+
+			bool changed;
+			Task<std::vector<char>> outdated;
+			try {
+				auto code = read_file( path );
+
+				std::scoped_lock lock( mutex );
+				if( auto it = preloaded.find( path.filename().string() ); it != preloaded.end() ){
+					outdated = std::move( it->second );
+					preloaded.erase( it );
+				}
+				changed = load( path.filename().string(), code );
+			} catch( std::exception& e ){
+				logger << LogChannel::Video << LogLevel::Warning << "Could not reload " << path.string() << ": " << e.what();
+				changed = false;
+			}
+
+			if( outdated.valid() )
+				discard( outdated );
+
+			if( changed ){
+				logger << LogChannel::Video << LogLevel::Info << "Reloaded shader " << path.filename().string();
+				on_reload();
+			}
+		});
+}
+
+void ShaderManager::watch_sources( const fs::path& source_dir, const fs::path& compiler ){
+	if( !fs::is_directory( source_dir ))
+		return;
+
+	watcher.watch( source_dir, [this, compiler]( const fs::path& path ){
+			if( path.extension() != ".glsl" )
+				return;
+
+			auto output = directory / ( path.filename().string() + ".spv" );
+			if( !compile( compiler, path, output ))
+				logger << LogChannel::Video << LogLevel::Error << "Failed to compile " << path.string();
+		});
+}
@@ -0,0 +1,540 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  Snapshot.cpp
+ *
+ *    Description:  Encoding and decoding of simulation snapshots
+ *
+ *        Version:  1.0
+ *        Created:  10/19/2026 07:31:20 PM
+ *       Revision:  none
+ *
+ *         Author:  Samuel Knoethig (), samuel@knoethig.net
+ *
+ * =====================================================================================
+ */
+
+#include "Snapshot.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <stdexcept>
+#include <string.h>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace SpaceAppSim;
+
+namespace {
+	constexpr char stream_magic[4]{ 'S', 'F', 'S', 'N' };
+	constexpr char index_magic[4]{ 'S', 'F', 'I', 'X' };
+	constexpr uint32_t stream_version{ 1 };
+
+	constexpr size_t stream_header_size{ 16 };
+	// payload size, type, 3 bytes padding, tick, entity count
+	constexpr size_t frame_header_size{ 20 };
+
+	constexpr uint8_t frame_keyframe{ 0 };
+	constexpr uint8_t frame_delta{ 1 };
+
+	constexpr uint8_t column_sparse{ 0x80 };
+
+	// id, position xyz, orientation xyzw, velocity xyz, flags
+	constexpr size_t column_count{ 12 };
+
+	// Columns that are predicted by linear extrapolation, the others by their previous value
+	bool extrapolated( size_t column ){
+		return column >= 1 && column <= 10;
+	}
+
+	template<typename T>
+	void put( std::vector<uint8_t>& out, T value ){
+		for( size_t i = 0; i < sizeof( T ); ++i )
+			out.push_back( static_cast<uint8_t>( static_cast<uint64_t>( value ) >> ( 8 * i )));
+	}
+
+	template<typename T>
+	T get( const uint8_t* p ){
+		uint64_t value = 0;
+		for( size_t i = 0; i < sizeof( T ); ++i )
+			value |= static_cast<uint64_t>( p[i] ) << ( 8 * i );
+		return static_cast<T>( value );
+	}
+
+	class BitWriter {
+		public:
+			explicit BitWriter( std::vector<uint8_t>& out ): out( out ){}
+
+			void write( uint32_t value, uint32_t width ){
+				acc |= static_cast<uint64_t>( value ) << bits;
+				bits += width;
+				while( bits >= 8 ){
+					out.push_back( static_cast<uint8_t>( acc ));
+					acc >>= 8;
+					bits -= 8;
+				}
+			}
+
+			// Pads to the next byte
+			void flush(){
+				if( bits > 0 )
+					out.push_back( static_cast<uint8_t>( acc ));
+				acc = 0;
+				bits = 0;
+			}
+
+		private:
+			std::vector<uint8_t>& out;
+			uint64_t acc{ 0 };
+			uint32_t bits{ 0 };
+	};
+
+	class BitReader {
+		public:
+			BitReader( const uint8_t* begin, const uint8_t* end ): p( begin ), end( end ){}
+
+			uint32_t read( uint32_t width ){
+				while( bits < width ){
+					if( p == end )
+						throw std::runtime_error( "Snapshot column exceeds its frame" );
+					acc |= static_cast<uint64_t>( *p++ ) << bits;
+					bits += 8;
+				}
+
+				uint32_t value = static_cast<uint32_t>( acc & (( 1ull << width ) - 1 ));
+				acc >>= width;
+				bits -= width;
+				return value;
+			}
+
+			void align(){
+				acc = 0;
+				bits = 0;
+			}
+
+			const uint8_t* position() const {
+				return p;
+			}
+
+		private:
+			const uint8_t* p;
+			const uint8_t* end;
+			uint64_t acc{ 0 };
+			uint32_t bits{ 0 };
+	};
+
+	uint32_t quantise( float value, float scale ){
+		// Saturates instead of wrapping around, a far away entity stays far away in the same direction
+		double scaled = std::isnan( value ) ? 0 : std::clamp( static_cast<double>( value ) * scale,
+				static_cast<double>( INT32_MIN ), static_cast<double>( INT32_MAX ));
+		return static_cast<uint32_t>( static_cast<int32_t>( std::lround( scaled )));
+	}
+
+	float dequantise( uint32_t value, float scale ){
+		return static_cast<int32_t>( value ) / scale;
+	}
+
+	uint32_t zigzag( uint32_t v ){
+		return ( v << 1 ) ^ static_cast<uint32_t>( static_cast<int32_t>( v ) >> 31 );
+	}
+
+	uint32_t unzigzag( uint32_t v ){
+		return ( v >> 1 ) ^ ( ~( v & 1 ) + 1 );
+	}
+
+	std::vector<std::vector<uint32_t>> quantise( const SimulationState& state ){
+		std::vector<std::vector<uint32_t>> columns( column_count );
+		for( auto& c: columns )
+			c.reserve( state.entities.size() );
+
+		for( auto& e: state.entities ){
+			columns[0].push_back( e.id );
+			for( int i = 0; i < 3; ++i )
+				columns[1 + i].push_back( quantise( e.position[i], Quantisation::position ));
+			for( int i = 0; i < 4; ++i )
+				columns[4 + i].push_back( quantise( e.orientation[i], Quantisation::orientation ));
+			for( int i = 0; i < 3; ++i )
+				columns[8 + i].push_back( quantise( e.velocity[i], Quantisation::velocity ));
+			columns[11].push_back( e.flags );
+		}
+
+		return columns;
+	}
+
+	SimulationState dequantise( const std::vector<std::vector<uint32_t>>& columns, uint64_t tick ){
+		SimulationState state{ tick, std::vector<EntityState>( columns[0].size() )};
+
+		for( size_t n = 0; n < state.entities.size(); ++n ){
+			auto& e = state.entities[n];
+			e.id = columns[0][n];
+			for( int i = 0; i < 3; ++i )
+				e.position[i] = dequantise( columns[1 + i][n], Quantisation::position );
+			for( int i = 0; i < 4; ++i )
+				e.orientation[i] = dequantise( columns[4 + i][n], Quantisation::orientation );
+			for( int i = 0; i < 3; ++i )
+				e.velocity[i] = dequantise( columns[8 + i][n], Quantisation::velocity );
+			e.flags = columns[11][n];
+		}
+
+		return state;
+	}
+
+	/**
+	 *	Predicts a delta frame column from the two frames before it. before is empty right after a keyframe
+	 */
+	void predict( std::vector<uint32_t>& prediction, const std::vector<uint32_t>& previous, const std::vector<uint32_t>& before, bool linear ){
+		prediction = previous;
+		if( linear )
+			for( size_t i = 0; i < std::min( previous.size(), before.size() ); ++i )
+				prediction[i] = 2 * previous[i] - before[i];
+	}
+
+	/**
+	 *	Keyframes store zigzag encoded differences between neighbouring entities, deltas the XOR with the
+	 *	prediction. Entities moving at constant speed thus cost nothing in deltas. The residuals are bit packed
+	 *	densely, or as a bitmap plus the non zero residuals if that is smaller
+	 */
+	void encode_column( std::vector<uint8_t>& out, const std::vector<uint32_t>& column, const std::vector<uint32_t>* prediction,
+			std::vector<uint32_t>& residuals ){
+		residuals.resize( column.size() );
+
+		uint32_t prior = 0;
+		for( size_t i = 0; i < column.size(); ++i ){
+			if( prediction )
+				residuals[i] = column[i] ^ ( i < prediction->size() ? ( *prediction )[i] : 0 );
+			else {
+				residuals[i] = zigzag( column[i] - prior );
+				prior = column[i];
+			}
+		}
+
+		uint32_t combined = 0;
+		size_t non_zero = 0;
+		for( auto r: residuals ){
+			combined |= r;
+			non_zero += r != 0;
+		}
+
+		uint32_t width = std::bit_width( combined );
+		bool sparse = residuals.size() + non_zero * width < residuals.size() * width;
+		out.push_back( static_cast<uint8_t>( width | ( sparse ? column_sparse : 0 )));
+
+		BitWriter bits( out );
+		if( sparse ){
+			for( auto r: residuals )
+				bits.write( r != 0, 1 );
+			bits.flush();
+			for( auto r: residuals )
+				if( r != 0 )
+					bits.write( r, width );
+		} else if( width > 0 )
+			for( auto r: residuals )
+				bits.write( r, width );
+		bits.flush();
+	}
+
+	const uint8_t* decode_column( const uint8_t* p, const uint8_t* end, std::vector<uint32_t>& column, size_t count,
+			const std::vector<uint32_t>* prediction ){
+		if( p == end )
+			throw std::runtime_error( "Snapshot column exceeds its frame" );
+
+		uint8_t mode = *p++;
+		uint32_t width = mode & ~column_sparse;
+		if( width > 32 )
+			throw std::runtime_error( "Invalid snapshot column width" );
+
+		column.assign( count, 0 );
+
+		BitReader bits( p, end );
+		if( mode & column_sparse ){
+			std::vector<bool> present( count );
+			for( size_t i = 0; i < count; ++i )
+				present[i] = bits.read( 1 );
+			bits.align();
+			for( size_t i = 0; i < count; ++i )
+				if( present[i] )
+					column[i] = bits.read( width );
+		} else if( width > 0 )
+			for( size_t i = 0; i < count; ++i )
+				column[i] = bits.read( width );
+
+		uint32_t prior = 0;
+		for( size_t i = 0; i < count; ++i ){
+			if( !prediction ){
+				column[i] = prior + unzigzag( column[i] );
+				prior = column[i];
+			} else
+				column[i] ^= i < prediction->size() ? ( *prediction )[i] : 0;
+		}
+
+		return bits.position();
+	}
+}
+
+/*
+ *	SnapshotWriter
+ */
+
+SnapshotWriter::SnapshotWriter( const std::filesystem::path& path, uint32_t keyframe_interval ):
+	file( path, std::ios::binary | std::ios::trunc ), keyframe_interval( std::max( keyframe_interval, 1u )){
+
+	if( !file.is_open() )
+		throw std::runtime_error( "Failed to open snapshot file " + path.string() );
+
+	for( char c: stream_magic )
+		put<uint8_t>( buffer, c );
+	put<uint32_t>( buffer, stream_version );
+	put<uint32_t>( buffer, this->keyframe_interval );
+	put<uint32_t>( buffer, 0 );
+
+	file.write( reinterpret_cast<const char*>( buffer.data() ), buffer.size() );
+	offset = buffer.size();
+}
+
+SnapshotWriter::~SnapshotWriter(){
+	close();
+}
+
+void SnapshotWriter::write( const SimulationState& state ){
+	auto columns = quantise( state );
+	bool keyframe = previous.empty() || frames_since_keyframe + 1 >= keyframe_interval;
+	frames_since_keyframe = keyframe ? 0 : frames_since_keyframe + 1;
+
+	buffer.resize( frame_header_size );
+	std::vector<uint32_t> residuals;
+	std::vector<uint32_t> prediction;
+	for( size_t c = 0; c < column_count; ++c ){
+		if( !keyframe )
+			predict( prediction, previous[c], before_previous.empty() ? std::vector<uint32_t>{} : before_previous[c], extrapolated( c ));
+		encode_column( buffer, columns[c], keyframe ? nullptr : &prediction, residuals );
+	}
+
+	std::vector<uint8_t> header;
+	put<uint32_t>( header, buffer.size() - frame_header_size );
+	put<uint8_t>( header, keyframe ? frame_keyframe : frame_delta );
+	put<uint8_t>( header, 0 );
+	put<uint16_t>( header, 0 );
+	put<uint64_t>( header, state.tick );
+	put<uint32_t>( header, state.entities.size() );
+	std::copy( header.begin(), header.end(), buffer.begin() );
+
+	file.write( reinterpret_cast<const char*>( buffer.data() ), buffer.size() );
+
+	offsets.push_back( offset );
+	offset += buffer.size();
+	// Nothing before a keyframe may be used for predictions
+	before_previous = keyframe ? decltype( previous ){} : std::move( previous );
+	previous = std::move( columns );
+}
+
+void SnapshotWriter::close(){
+	if( !file.is_open() )
+		return;
+
+	buffer.clear();
+	for( auto o: offsets )
+		put<uint64_t>( buffer, o );
+	put<uint32_t>( buffer, offsets.size() );
+	for( char c: index_magic )
+		put<uint8_t>( buffer, c );
+
+	file.write( reinterpret_cast<const char*>( buffer.data() ), buffer.size() );
+	offset += buffer.size();
+	file.close();
+}
+
+size_t SnapshotWriter::bytes_written() const {
+	return offset;
+}
+
+/*
+ *	SnapshotReader
+ */
+
+SnapshotReader::SnapshotReader( const std::filesystem::path& path ){
+	int fd = open( path.c_str(), O_RDONLY );
+	if( fd < 0 )
+		throw std::runtime_error( "Failed to open snapshot file " + path.string() );
+
+	struct stat st;
+	if( fstat( fd, &st ) != 0 || static_cast<size_t>( st.st_size ) < stream_header_size ){
+		close( fd );
+		throw std::runtime_error( "Invalid snapshot file " + path.string() );
+	}
+
+	size = st.st_size;
+	void* mapping = mmap( nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0 );
+	close( fd );
+	if( mapping == MAP_FAILED )
+		throw std::runtime_error( "Failed to map snapshot file " + path.string() );
+	data = static_cast<const uint8_t*>( mapping );
+
+	if( memcmp( data, stream_magic, sizeof( stream_magic )) != 0 || get<uint32_t>( data + 4 ) != stream_version ){
+		munmap( const_cast<uint8_t*>( data ), size );
+		throw std::runtime_error( "Invalid snapshot file " + path.string() );
+	}
+
+	auto add_frame = [this]( uint64_t offset ){
+		frames.push_back({ offset, get<uint64_t>( data + offset + 8 ), data[offset + 4] == frame_keyframe });
+	};
+
+	// Prefer the index, fall back to walking the frames of streams that were not closed
+	size_t index_count = size >= stream_header_size + 8 && memcmp( data + size - 4, index_magic, sizeof( index_magic )) == 0 ?
+		get<uint32_t>( data + size - 8 ) : SIZE_MAX;
+	size_t frames_end = size;
+
+	if( index_count != SIZE_MAX && index_count * 8 + 8 <= size - stream_header_size ){
+		frames_end = size - 8 - index_count * 8;
+		for( size_t i = 0; i < index_count; ++i ){
+			uint64_t offset = get<uint64_t>( data + frames_end + i * 8 );
+			if( offset + frame_header_size > frames_end || offset + frame_header_size + get<uint32_t>( data + offset ) > frames_end ){
+				munmap( const_cast<uint8_t*>( data ), size );
+				throw std::runtime_error( "Invalid snapshot index in " + path.string() );
+			}
+			add_frame( offset );
+		}
+	} else {
+		for( uint64_t offset = stream_header_size; offset + frame_header_size <= size; ){
+			uint64_t next = offset + frame_header_size + get<uint32_t>( data + offset );
+			// Truncated last frame
+			if( next > size )
+				break;
+			add_frame( offset );
+			offset = next;
+		}
+	}
+}
+
+SnapshotReader::~SnapshotReader(){
+	munmap( const_cast<uint8_t*>( data ), size );
+}
+
+size_t SnapshotReader::frame_count() const {
+	return frames.size();
+}
+
+uint64_t SnapshotReader::tick( size_t frame ) const {
+	return frames.at( frame ).tick;
+}
+
+void SnapshotReader::decode( size_t frame ){
+	auto& f = frames[frame];
+	if( !f.keyframe && current + 1 != frame )
+		throw std::runtime_error( "Snapshot delta decoded without its predecessor" );
+
+	const uint8_t* p = data + f.offset;
+	const uint8_t* end = p + frame_header_size + get<uint32_t>( p );
+	size_t count = get<uint32_t>( p + 16 );
+
+	// Rotates the buffers, columns receives the new frame and reuses the memory of the oldest one
+	std::swap( before_previous, previous );
+	std::swap( previous, columns );
+	if( f.keyframe )
+		before_previous.clear();
+
+	columns.resize( column_count );
+	p += frame_header_size;
+	std::vector<uint32_t> prediction;
+	for( size_t c = 0; c < column_count; ++c ){
+		if( !f.keyframe )
+			predict( prediction, previous[c], before_previous.empty() ? std::vector<uint32_t>{} : before_previous[c], extrapolated( c ));
+		p = decode_column( p, end, columns[c], count, f.keyframe ? nullptr : &prediction );
+	}
+
+	// Nothing before a keyframe may be used for predictions
+	if( f.keyframe )
+		previous.clear();
+
+	current = frame;
+}
+
+SimulationState SnapshotReader::read( size_t frame ){
+	if( frame >= frames.size() )
+		throw std::out_of_range( "Snapshot frame out of range" );
+
+	size_t keyframe = frame;
+	while( !frames[keyframe].keyframe ){
+		if( keyframe == 0 )
+			throw std::runtime_error( "Snapshot stream does not start with a keyframe" );
+		--keyframe;
+	}
+
+	// Continue from the last decoded frame if it lies between the keyframe and the target
+	size_t first = ( current != SIZE_MAX && current >= keyframe && current <= frame ) ? current + 1 : keyframe;
+	for( size_t f = first; f <= frame; ++f )
+		decode( f );
+
+	return dequantise( columns, frames[frame].tick );
+}
+
+/*
+ *	SnapshotRecorder
+ */
+
+SnapshotRecorder::SnapshotRecorder( const std::filesystem::path& path, uint32_t keyframe_interval ):
+	writer( path, keyframe_interval ), thread( [this]{ run(); }){}
+
+SnapshotRecorder::~SnapshotRecorder(){
+	{
+		std::scoped_lock lock( mutex );
+		stopping = true;
+	}
+	cv.notify_one();
+	thread.join();
+}
+
+void SnapshotRecorder::record( const SimulationState& state ){
+	{
+		std::scoped_lock lock( mutex );
+
+		SimulationState copy;
+		if( !spare.empty() ){
+			copy = std::move( spare.back() );
+			spare.pop_back();
+		}
+		copy.tick = state.tick;
+		copy.entities.assign( state.entities.begin(), state.entities.end() );
+
+		queue.push_back( std::move( copy ));
+	}
+	cv.notify_one();
+}
+
+void SnapshotRecorder::run(){
+	std::unique_lock lock( mutex );
+
+	while( true ){
+		cv.wait( lock, [this]{ return stopping || !queue.empty(); });
+		if( queue.empty() )
+			break;
+
+		auto state = std::move( queue.front() );
+		queue.pop_front();
+
+		lock.unlock();
+		writer.write( state );
+		lock.lock();
+
+		spare.push_back( std::move( state ));
+	}
+
+	writer.close();
+}
+
+void SpaceAppSim::save_snapshot( const std::filesystem::path& path, const SimulationState& state ){
+	SnapshotWriter writer( path, 1 );
+	writer.write( state );
+	writer.close();
+}
+
+SimulationState SpaceAppSim::load_snapshot( const std::filesystem::path& path ){
+	SnapshotReader reader( path );
+	if( reader.frame_count() == 0 )
+		throw std::runtime_error( "Snapshot file " + path.string() + " contains no state" );
+
+	return reader.read( reader.frame_count() - 1 );
+}
@@ -0,0 +1,625 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  Starfield.cpp
+ *
+ *    Description:  Implementation of the procedural starfield
+ *
+ *        Version:  1.0
+ *        Created:  10/19/2026 05:21:06 PM
+ *       Revision:  none
+ *
+ *         Author:  Samuel Knoethig (), samuel@knoethig.net
+ *
+ * =====================================================================================
+ */
+
+#include "Util.hpp"
+#include "Starfield.hpp"
+#include "AllocationCounter.hpp"
+#include "FrameArena.hpp"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <fstream>
+#include <string.h>
+#include <thread>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace SpaceAppVideo;
+
+namespace {
+	constexpr char cache_magic[4]{ 'S', 'F', 'S', 'T' };
+	constexpr uint32_t cache_version{ 1 };
+
+	struct CacheHeader {
+		char magic[4];
+		uint32_t version;
+		uint64_t seed;
+		int32_t sector[3];
+		uint32_t chunk_count;
+		uint32_t star_count;
+		uint32_t padding;
+	};
+	static_assert( sizeof( CacheHeader ) == 40 );
+
+	// Has to match the push constants in star.vert.glsl
+	struct DrawParams {
+		glm::mat4 view_proj;
+		glm::vec4 sector_offset;
+		glm::vec4 camera_right;
+		glm::vec4 camera_up;
+		glm::vec2 pixel_size;
+	};
+
+	// Galaxy shape, in world units. The origin lies in the outer disc
+	const glm::vec3 galaxy_center{ -160000, 0, 0 };
+	constexpr float disc_scale_length{ 80000 };
+	constexpr float disc_scale_height{ 2000 };
+	constexpr float bulge_radius{ 20000 };
+	constexpr float arm_count{ 2 };
+	constexpr float arm_pitch{ 0.3f };
+	// Stars in a chunk of density 1
+	constexpr float stars_per_chunk{ 2000 };
+	constexpr float nebula_probability{ 0.15f };
+	constexpr float nebula_radius_step{ 4 };
+
+	// Magnitude quantisation, has to match star.vert.glsl
+	constexpr float magnitude_min{ -8 };
+	constexpr float magnitude_scale{ 5.25f };
+	constexpr uint8_t nebula_flag{ 0x80 };
+
+	struct SpectralClass {
+		float frequency;
+		float magnitude;
+		uint8_t color[3];
+	};
+
+	// O, B, A, F, G, K, M
+	constexpr SpectralClass spectral_classes[] = {
+		{ 0.01f, -5, { 155, 176, 255 }},
+		{ 0.05f, -2, { 170, 191, 255 }},
+		{ 0.07f,  1, { 202, 215, 255 }},
+		{ 0.10f,  3, { 248, 247, 255 }},
+		{ 0.12f,  5, { 255, 244, 234 }},
+		{ 0.20f,  7, { 255, 210, 161 }},
+		{ 0.45f, 10, { 255, 204, 111 }},
+	};
+
+	constexpr uint8_t nebula_tints[][3] = {
+		{ 200,  60,  80 },
+		{  70, 110, 220 },
+		{ 150,  70, 200 },
+		{  60, 170, 160 },
+	};
+
+	/**
+	 *	Small deterministic generator, the standard distributions are not specified bit exact across implementations
+	 */
+	struct Rng {
+		uint64_t state;
+
+		uint64_t next(){
+			// splitmix64
+			uint64_t z = ( state += 0x9e3779b97f4a7c15ull );
+			z = ( z ^ ( z >> 30 )) * 0xbf58476d1ce4e5b9ull;
+			z = ( z ^ ( z >> 27 )) * 0x94d049bb133111ebull;
+			return z ^ ( z >> 31 );
+		}
+
+		float uniform(){
+			return ( next() >> 40 ) * ( 1.0f / ( 1 << 24 ));
+		}
+
+		float uniform( float min, float max ){
+			return min + ( max - min ) * uniform();
+		}
+	};
+
+	uint64_t chunk_seed( uint64_t seed, SectorCoord sector, uint32_t chunk ){
+		Rng rng{ seed };
+		for( int64_t v: { (int64_t)sector.x, (int64_t)sector.y, (int64_t)sector.z, (int64_t)chunk })
+			rng.state ^= rng.next() + static_cast<uint64_t>( v );
+		return rng.next();
+	}
+
+	float galaxy_density( glm::vec3 p ){
+		p -= galaxy_center;
+		float r = std::max( std::hypot( p.x, p.z ), 1.0f );
+
+		float disc = std::exp( -r / disc_scale_length ) * std::exp( -std::abs( p.y ) / disc_scale_height );
+		float bulge = std::exp( -glm::dot( p, p ) / ( bulge_radius * bulge_radius ));
+
+		// Logarithmic spiral arms
+		float phase = arm_count * ( std::atan2( p.z, p.x ) - std::log( r / bulge_radius ) / arm_pitch );
+		float arms = std::pow( 0.5f + 0.5f * std::cos( phase ), 4.0f );
+
+		return disc * ( 0.3f + 0.7f * arms ) * 8 + bulge;
+	}
+
+	float arm_strength( glm::vec3 p ){
+		p -= galaxy_center;
+		float r = std::max( std::hypot( p.x, p.z ), 1.0f );
+		float phase = arm_count * ( std::atan2( p.z, p.x ) - std::log( r / bulge_radius ) / arm_pitch );
+		return std::pow( 0.5f + 0.5f * std::cos( phase ), 4.0f ) * std::exp( -std::abs( p.y ) / disc_scale_height );
+	}
+
+	Star make_star( Rng& rng, glm::vec3 position ){
+		float pick = rng.uniform();
+		const SpectralClass* spectral = &spectral_classes[std::size( spectral_classes ) - 1];
+		for( auto& c: spectral_classes ){
+			if( pick < c.frequency ){
+				spectral = &c;
+				break;
+			}
+			pick -= c.frequency;
+		}
+
+		float magnitude = spectral->magnitude + rng.uniform( -1.5f, 1.5f );
+		Star star{ position, { spectral->color[0], spectral->color[1], spectral->color[2] }, 0 };
+		star.magnitude = static_cast<uint8_t>( std::clamp(( magnitude - magnitude_min ) * magnitude_scale, 0.0f, 127.0f ));
+		return star;
+	}
+
+	/**
+	 *	Generates the stars of one chunk, positions relative to the sector origin
+	 */
+	std::vector<Star> generate_chunk( uint64_t seed, SectorCoord sector, uint32_t chunk ){
+		Rng rng{ chunk_seed( seed, sector, chunk )};
+
+		glm::uvec3 cc( chunk % StarCatalog::chunks_per_axis, ( chunk / StarCatalog::chunks_per_axis ) % StarCatalog::chunks_per_axis,
+				chunk / ( StarCatalog::chunks_per_axis * StarCatalog::chunks_per_axis ));
+		glm::vec3 chunk_min = glm::vec3( cc ) * StarCatalog::chunk_size;
+		glm::vec3 world_center = glm::vec3( sector ) * StarCatalog::sector_size + chunk_min + StarCatalog::chunk_size * 0.5f;
+
+		// Stochastic rounding keeps the expected count exact for sparse chunks
+		uint32_t count = static_cast<uint32_t>( stars_per_chunk * galaxy_density( world_center ) + rng.uniform() );
+
+		std::vector<Star> stars;
+		stars.reserve( count );
+		for( uint32_t i = 0; i < count; ++i ){
+			glm::vec3 p = chunk_min + glm::vec3( rng.uniform(), rng.uniform(), rng.uniform() ) * StarCatalog::chunk_size;
+			stars.push_back( make_star( rng, p ));
+		}
+
+		// Nebulae are clusters of large, faint clouds, mostly along the spiral arms
+		if( rng.uniform() < nebula_probability * arm_strength( world_center )){
+			glm::vec3 center = chunk_min + glm::vec3( rng.uniform(), rng.uniform(), rng.uniform() ) * StarCatalog::chunk_size;
+			auto& tint = nebula_tints[rng.next() % std::size( nebula_tints )];
+			uint32_t clouds = 8 + rng.next() % 17;
+
+			for( uint32_t i = 0; i < clouds; ++i ){
+				glm::vec3 offset( rng.uniform( -1, 1 ), rng.uniform( -0.3f, 0.3f ), rng.uniform( -1, 1 ));
+				uint8_t radius = static_cast<uint8_t>( 16 + rng.next() % 48 );
+
+				Star cloud{ center + offset * 200.0f, {}, static_cast<uint8_t>( nebula_flag | radius )};
+				for( int c = 0; c < 3; ++c )
+					cloud.color[c] = static_cast<uint8_t>( std::clamp( tint[c] * rng.uniform( 0.8f, 1.2f ), 0.0f, 255.0f ));
+				stars.push_back( cloud );
+			}
+		}
+
+		return stars;
+	}
+
+	std::filesystem::path cache_file( const std::filesystem::path& cache_dir, uint64_t seed, SectorCoord sector ){
+		return cache_dir / ( std::to_string( seed ) + "_" + std::to_string( sector.x ) + "_" + std::to_string( sector.y ) + "_" +
+				std::to_string( sector.z ) + ".stars" );
+	}
+
+	/**
+	 *	Generates all chunks of a sector and writes them to file. The data is written to a temporary file first,
+	 *	so a concurrent or interrupted run never sees a partial catalog
+	 */
+	void generate_sector( const std::filesystem::path& file, uint64_t seed, SectorCoord sector ){
+		std::vector<std::vector<Star>> chunk_stars( StarCatalog::chunk_count );
+
+		uint32_t thread_count = std::clamp( std::thread::hardware_concurrency(), 1u, StarCatalog::chunk_count );
+		std::vector<std::future<void>> workers;
+		for( uint32_t t = 0; t < thread_count; ++t )
+			workers.push_back( std::async( std::launch::async, [&, t]{
+				for( uint32_t c = t; c < StarCatalog::chunk_count; c += thread_count )
+					chunk_stars[c] = generate_chunk( seed, sector, c );
+			}));
+		for( auto& w: workers )
+			w.get();
+
+		CacheHeader header{};
+		memcpy( header.magic, cache_magic, sizeof( cache_magic ));
+		header.version = cache_version;
+		header.seed = seed;
+		header.sector[0] = sector.x;
+		header.sector[1] = sector.y;
+		header.sector[2] = sector.z;
+		header.chunk_count = StarCatalog::chunk_count;
+
+		std::vector<StarCatalog::Chunk> chunks;
+		for( auto& stars: chunk_stars ){
+			StarCatalog::Chunk chunk{ header.star_count, static_cast<uint32_t>( stars.size() ), glm::vec3( StarCatalog::sector_size ), glm::vec3( 0 )};
+			for( auto& s: stars ){
+				float extent = ( s.magnitude & nebula_flag ) ? ( s.magnitude & ~nebula_flag ) * nebula_radius_step : 0;
+				chunk.min = glm::min( chunk.min, s.position - extent );
+				chunk.max = glm::max( chunk.max, s.position + extent );
+			}
+			chunks.push_back( chunk );
+			header.star_count += chunk.count;
+		}
+
+		auto tmp = file;
+		tmp += ".tmp" + std::to_string( std::hash<std::thread::id>{}( std::this_thread::get_id() ));
+		{
+			std::ofstream out( tmp, std::ios::binary | std::ios::trunc );
+			if( !out.is_open() )
+				throw std::runtime_error( "Failed to write star cache " + tmp.string() );
+
+			out.write( reinterpret_cast<const char*>( &header ), sizeof( header ));
+			out.write( reinterpret_cast<const char*>( chunks.data() ), chunks.size() * sizeof( StarCatalog::Chunk ));
+			for( auto& stars: chunk_stars )
+				out.write( reinterpret_cast<const char*>( stars.data() ), stars.size() * sizeof( Star ));
+		}
+		std::filesystem::rename( tmp, file );
+	}
+}
+
+StarCatalog StarCatalog::load( const std::filesystem::path& cache_dir, uint64_t seed, SectorCoord sector ){
+	auto file = cache_file( cache_dir, seed, sector );
+
+	StarCatalog catalog;
+	if( catalog.map( file, seed, sector ))
+		return catalog;
+
+	std::filesystem::create_directories( cache_dir );
+	generate_sector( file, seed, sector );
+
+	if( !catalog.map( file, seed, sector ))
+		throw std::runtime_error( "Failed to map generated star cache " + file.string() );
+
+	return catalog;
+}
+
+bool StarCatalog::map( const std::filesystem::path& file, uint64_t seed, SectorCoord sector ){
+	int fd = open( file.c_str(), O_RDONLY );
+	if( fd < 0 )
+		return false;
+
+	struct stat st;
+	if( fstat( fd, &st ) != 0 || static_cast<size_t>( st.st_size ) < sizeof( CacheHeader ) + chunk_count * sizeof( Chunk )){
+		close( fd );
+		return false;
+	}
+
+	void* mapping = mmap( nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+	close( fd );
+	if( mapping == MAP_FAILED )
+		return false;
+
+	unmap();
+	data = mapping;
+	size = st.st_size;
+
+	auto header = static_cast<const CacheHeader*>( data );
+	bool valid = memcmp( header->magic, cache_magic, sizeof( cache_magic )) == 0
+		&& header->version == cache_version
+		&& header->seed == seed
+		&& header->sector[0] == sector.x && header->sector[1] == sector.y && header->sector[2] == sector.z
+		&& header->chunk_count == chunk_count
+		&& size == sizeof( CacheHeader ) + chunk_count * sizeof( Chunk ) + header->star_count * sizeof( Star );
+
+	if( !valid ){
+		logger << LogChannel::Video << LogLevel::Info << "Discarding invalid star cache " << file.string();
+		unmap();
+	}
+
+	return valid;
+}
+
+void StarCatalog::unmap(){
+	if( data )
+		munmap( data, size );
+	data = nullptr;
+	size = 0;
+}
+
+StarCatalog::StarCatalog( StarCatalog&& other ): data( other.data ), size( other.size ){
+	other.data = nullptr;
+	other.size = 0;
+}
+
+StarCatalog& StarCatalog::operator=( StarCatalog&& other ){
+	if( this != &other ){
+		unmap();
+		std::swap( data, other.data );
+		std::swap( size, other.size );
+	}
+	return *this;
+}
+
+StarCatalog::~StarCatalog(){
+	unmap();
+}
+
+std::span<const StarCatalog::Chunk> StarCatalog::chunks() const {
+	return { reinterpret_cast<const Chunk*>( static_cast<const char*>( data ) + sizeof( CacheHeader )), chunk_count };
+}
+
+std::span<const Star> StarCatalog::stars() const {
+	auto header = static_cast<const CacheHeader*>( data );
+	return { reinterpret_cast<const Star*>( static_cast<const char*>( data ) + sizeof( CacheHeader ) + chunk_count * sizeof( Chunk )), header->star_count };
+}
+
+SectorCoord StarCatalog::sector() const {
+	auto header = static_cast<const CacheHeader*>( data );
+	return { header->sector[0], header->sector[1], header->sector[2] };
+}
+
+Starfield::Starfield( vk::PhysicalDevice phys_dev, vk::Device device, ShaderManager& shaders, vk::PipelineCache cache,
+		std::filesystem::path cache_dir, uint64_t seed ):
+	phys_dev( phys_dev ), device( device ), shaders( shaders ), cache( cache ), cache_dir( std::move( cache_dir )), seed( seed ){
+
+	vk::PushConstantRange push_range( vk::ShaderStageFlagBits::eVertex, 0, sizeof( DrawParams ));
+	layout = device.createPipelineLayoutUnique({ {}, 0, nullptr, 1, &push_range });
+}
+
+Starfield::~Starfield(){
+	for( auto& [coord, load]: pending )
+		load.wait();
+}
+
+void Starfield::create_render_pipeline( vk::RenderPass render_pass ){
+	std::vector<vk::PipelineShaderStageCreateInfo> stage_infos{
+			{ {}, vk::ShaderStageFlagBits::eVertex, shaders.get( "star.vert.glsl.spv" ), "main", {} },
+			{ {}, vk::ShaderStageFlagBits::eFragment, shaders.get( "star.frag.glsl.spv" ), "main", {} },
+		};
+
+	// One quad per star, the catalog entries are per instance data
+	vk::VertexInputBindingDescription binding( 0, sizeof( Star ), vk::VertexInputRate::eInstance );
+	std::array<vk::VertexInputAttributeDescription, 2> attribs{
+			vk::VertexInputAttributeDescription( 0, 0, vk::Format::eR32G32B32Sfloat, offsetof( Star, position )),
+			vk::VertexInputAttributeDescription( 1, 0, vk::Format::eR8G8B8A8Uint, offsetof( Star, color )),
+		};
+
+	vk::PipelineVertexInputStateCreateInfo vertex_input_info(
+			{},
+			1, &binding,
+			attribs.size(), attribs.data()
+		);
+
+	vk::PipelineInputAssemblyStateCreateInfo input_assembly_info(
+			{},
+			vk::PrimitiveTopology::eTriangleStrip,
+			VK_FALSE
+		);
+
+	vk::PipelineViewportStateCreateInfo viewport_state_info(
+			{},
+			1, nullptr,
+			1, nullptr
+		);
+
+	std::vector dynamic_states{ vk::DynamicState::eViewport, vk::DynamicState::eScissor };
+	vk::PipelineDynamicStateCreateInfo dynamic_state_info(
+			{},
+			dynamic_states
+		);
+
+	vk::PipelineRasterizationStateCreateInfo rasterization_state_info(
+			{},
+			VK_FALSE,
+			VK_FALSE,
+			vk::PolygonMode::eFill,
+			vk::CullModeFlagBits::eNone,
+			vk::FrontFace::eClockwise,
+			VK_FALSE,
+			0,
+			0,
+			0,
+			1
+		);
+
+	vk::PipelineMultisampleStateCreateInfo multisample_state_info(
+			{},
+			vk::SampleCountFlagBits::e1,
+			VK_FALSE,
+			1,
+			nullptr,
+			VK_FALSE,
+			VK_FALSE
+		);
+
+	// Additive, the background is drawn first onto black
+	vk::PipelineColorBlendAttachmentState color_blend_attachment(
+			VK_TRUE,
+			vk::BlendFactor::eOne,
+			vk::BlendFactor::eOne,
+			vk::BlendOp::eAdd,
+			vk::BlendFactor::eOne,
+			vk::BlendFactor::eOne,
+			vk::BlendOp::eAdd,
+			vk::ColorComponentFlagBits::eR | vk::ColorComponentFlagBits::eG | vk::ColorComponentFlagBits::eB | vk::ColorComponentFlagBits::eA
+		);
+
+	vk::PipelineColorBlendStateCreateInfo color_blend_info(
+			{},
+			VK_FALSE,
+			vk::LogicOp::eCopy,
+			1, &color_blend_attachment,
+			{ 0, 0, 0, 0 }
+		);
+
+	// Drawn first as the background, everything else covers it
+	vk::PipelineDepthStencilStateCreateInfo depth_stencil_info(
+			{},
+			VK_FALSE,
+			VK_FALSE,
+			vk::CompareOp::eAlways
+		);
+
+	vk::GraphicsPipelineCreateInfo pipeline_create_info(
+			{},
+			stage_infos,
+			&vertex_input_info,
+			&input_assembly_info,
+			nullptr,
+			&viewport_state_info,
+			&rasterization_state_info,
+			&multisample_state_info,
+			&depth_stencil_info,
+			&color_blend_info,
+			&dynamic_state_info,
+			*layout,
+			render_pass,
+			0,
+			vk::Pipeline{},
+			-1
+		);
+
+	pipeline = std::move( device.createGraphicsPipelinesUnique( cache, pipeline_create_info ).value[0] );
+}
+
+static SectorCoord sector_of( glm::vec3 position ){
+	return SectorCoord( glm::floor( position / StarCatalog::sector_size ));
+}
+
+static int sector_distance( SectorCoord a, SectorCoord b ){
+	auto d = glm::abs( a - b );
+	return std::max({ d.x, d.y, d.z });
+}
+
+void Starfield::upload( const StarCatalog& catalog ){
+	auto stars = catalog.stars();
+
+	auto chunks = catalog.chunks();
+
+	ResidentSector sector{ catalog.sector(), std::vector<StarCatalog::Chunk>( chunks.begin(), chunks.end() ), {} };
+	if( !stars.empty() ){
+		sector.stars = create_buffer( phys_dev, device, stars.size_bytes(), vk::BufferUsageFlagBits::eVertexBuffer,
+				vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent );
+		// Pages of the catalog are only read in here
+		memcpy( sector.stars.mapped, stars.data(), stars.size_bytes() );
+	}
+
+	resident.push_back( std::move( sector ));
+}
+
+void Starfield::update( const Camera& camera ){
+	++frame;
+	auto center = sector_of( camera.position );
+
+	// Buffers of evicted sectors may still be read by frames in flight
+	std::erase_if( retired, [this]( auto& r ){ return r.frame + MAX_FRAMES_IN_FLIGHT < frame; });
+
+	for( auto it = resident.begin(); it != resident.end(); ){
+		if( sector_distance( it->coord, center ) > resident_radius ){
+			// Streaming only allocates when the camera crosses into another sector
+			Debug::AllowAllocations allow_allocations;
+			retired.push_back({ std::move( it->stars ), frame });
+			it = resident.erase( it );
+		} else
+			++it;
+	}
+
+	for( auto it = pending.begin(); it != pending.end(); ){
+		if( it->second.wait_for( std::chrono::seconds( 0 )) != std::future_status::ready ){
+			++it;
+			continue;
+		}
+
+		Debug::AllowAllocations allow_allocations;
+		try {
+			auto catalog = it->second.get();
+			cached.insert( it->first );
+			if( sector_distance( it->first, center ) <= resident_radius )
+				upload( catalog );
+		} catch( std::exception& e ){
+			logger << LogChannel::Video << LogLevel::Error << "Failed to load star sector: " << e.what();
+		}
+		it = pending.erase( it );
+	}
+
+	// Nearest sectors first, anything resident or already cached further out needs no work
+	SpaceAppVideo::FixedVector<SectorCoord, ( 2 * prefetch_radius + 1 ) * ( 2 * prefetch_radius + 1 ) * ( 2 * prefetch_radius + 1 )> wanted;
+	for( int z = -prefetch_radius; z <= prefetch_radius; ++z )
+		for( int y = -prefetch_radius; y <= prefetch_radius; ++y )
+			for( int x = -prefetch_radius; x <= prefetch_radius; ++x ){
+				SectorCoord coord = center + SectorCoord( x, y, z );
+				if( pending.contains( coord ))
+					continue;
+
+				if( sector_distance( coord, center ) <= resident_radius ){
+					if( std::none_of( resident.begin(), resident.end(), [&]( auto& r ){ return r.coord == coord; }))
+						wanted.push_back( coord );
+				} else if( !cached.contains( coord ))
+					wanted.push_back( coord );
+			}
+
+	std::stable_sort( wanted.begin(), wanted.end(), [&]( auto& a, auto& b ){ return sector_distance( a, center ) < sector_distance( b, center ); });
+
+	for( auto& coord: wanted ){
+		if( pending.size() >= max_pending_loads )
+			break;
+
+		Debug::AllowAllocations allow_allocations;
+		pending.emplace( coord, std::async( std::launch::async, [dir = cache_dir, seed = seed, coord]{ return StarCatalog::load( dir, seed, coord ); }));
+	}
+}
+
+/**
+ *	Returns true if the box lies at least partially on the inner side of all frustum side planes
+ */
+static bool box_visible( const std::array<glm::vec4, 4>& planes, glm::vec3 min, glm::vec3 max ){
+	for( auto& p: planes ){
+		// Corner furthest along the plane normal
+		glm::vec3 v( p.x > 0 ? max.x : min.x, p.y > 0 ? max.y : min.y, p.z > 0 ? max.z : min.z );
+		if( glm::dot( glm::vec3( p ), v ) + p.w < 0 )
+			return false;
+	}
+	return true;
+}
+
+void Starfield::record_draw( vk::CommandBuffer cmd, const Camera& camera, vk::Extent2D extent ){
+	if( resident.empty() )
+		return;
+
+	// Everything is drawn relative to the camera, so coordinates stay small far from the origin
+	glm::mat4 view = glm::lookAt( glm::vec3( 0 ), camera.forward, camera.up );
+	glm::mat4 view_proj = camera.projection( (float)extent.width / extent.height ) * view;
+
+	// Side planes of the frustum, the far plane is irrelevant for the few sectors around the camera
+	glm::mat4 t = glm::transpose( view_proj );
+	std::array<glm::vec4, 4> planes{ t[3] + t[0], t[3] - t[0], t[3] + t[1], t[3] - t[1] };
+
+	DrawParams params{
+		view_proj,
+		glm::vec4( 0 ),
+		glm::vec4( camera.right(), 0 ),
+		glm::vec4( glm::normalize( glm::cross( camera.right(), camera.forward )), 0 ),
+		glm::vec2( 2.0f / extent.width, 2.0f / extent.height ),
+	};
+
+	cmd.bindPipeline( vk::PipelineBindPoint::eGraphics, *pipeline );
+
+	for( auto& sector: resident ){
+		if( !sector.stars.buffer )
+			continue;
+
+		glm::vec3 offset = glm::vec3( sector.coord ) * StarCatalog::sector_size - camera.position;
+		params.sector_offset = glm::vec4( offset, 0 );
+
+		cmd.pushConstants( *layout, vk::ShaderStageFlagBits::eVertex, 0, sizeof( params ), &params );
+		vk::Buffer buffer{ *sector.stars.buffer };
+		vk::DeviceSize buffer_offset{ 0 };
+		cmd.bindVertexBuffers( 0, buffer, buffer_offset );
+
+		for( auto& chunk: sector.chunks )
+			if( chunk.count > 0 && box_visible( planes, chunk.min + offset, chunk.max + offset ))
+				cmd.draw( 4, chunk.count, 0, chunk.first );
+	}
+}
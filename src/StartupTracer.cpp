@@ -0,0 +1,69 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  StartupTracer.cpp
+ *
+ *    Description:  Implementation of the startup tracer
+ *
+ *        Version:  1.0
+ *        Created:  10/19/2026 12:21:47 PM
+ *       Revision:  none
+ *
+ *         Author:  Samuel Knoethig (), samuel@knoethig.net
+ *
+ * =====================================================================================
+ */
+
+#include "Util.hpp"
+#include "StartupTracer.hpp"
+
+#include <sstream>
+#include <cstdint>
+
+StartupTracer startup_tracer;
+
+StartupTracer::Scope::Scope( StartupTracer& tracer, size_t index ): tracer( tracer ), index( index ){}
+
+StartupTracer::Scope::~Scope(){
+	tracer.finish( index );
+}
+
+StartupTracer::Scope StartupTracer::trace( std::string name ){
+	std::scoped_lock lock( phases_mutex );
+
+	// Phases after the first frame (e.g. swapchain recreation) are not part of startup
+	if( reported )
+		return Scope( *this, SIZE_MAX );
+
+	phases.push_back({ std::move( name ), Clock::now(), {}, std::this_thread::get_id() });
+
+	return Scope( *this, phases.size() - 1 );
+}
+
+void StartupTracer::finish( size_t index ){
+	std::scoped_lock lock( phases_mutex );
+	if( index < phases.size() )
+		phases[index].end = Clock::now();
+}
+
+void StartupTracer::report(){
+	std::scoped_lock lock( phases_mutex );
+
+	if( reported )
+		return;
+	reported = true;
+
+	auto ms = []( Clock::duration d ){ return std::chrono::duration<double, std::milli>( d ).count(); };
+
+	Logger::LoggerHelper lmsg = logger << LogChannel::Default << LogLevel::Info;
+	lmsg << "Startup trace (start, duration, thread):";
+
+	for( auto& p: phases ){
+		std::stringstream thread;
+		thread << p.thread;
+
+		lmsg << "\n\t" << ms( p.start - origin ) << "ms\t" << ms( p.end - p.start ) << "ms\t" << thread.str() << "\t" << p.name;
+	}
+
+	lmsg << "\n\tTime to first frame: " << ms( Clock::now() - origin ) << "ms";
+}
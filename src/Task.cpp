@@ -0,0 +1,167 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  Task.cpp
+ *
+ *    Description:  Source file defining things from Task.hpp
+ *
+ *        Version:  1.0
+ *        Created:  10/20/2026 07:14:52 AM
+ *       Revision:  none
+ *
+ *         Author:  Samuel Knoethig (), samuel@knoethig.net
+ *
+ * =====================================================================================
+ */
+
+#include "Util.hpp"
+#include "Task.hpp"
+
+#include <chrono>
+#include <fstream>
+
+using namespace SpaceAppVideo;
+
+namespace {
+	// Longest the waiting thread sleeps in the driver before it looks for new waits
+	constexpr uint64_t poll_timeout_ns{ 1000000 };
+	// Fences and semaphores can not be waited on in one call, with both pending the thread alternates in slices this long
+	constexpr uint64_t mixed_timeout_ns{ 100000 };
+}
+
+ThreadPool::ThreadPool( size_t thread_count ){
+	for( size_t i = 0; i < thread_count; ++i )
+		threads.emplace_back( &ThreadPool::run, this );
+}
+
+ThreadPool::~ThreadPool(){
+	{
+		std::scoped_lock lock( mutex );
+		stopping = true;
+	}
+	cv.notify_all();
+
+	for( auto& t: threads )
+		t.join();
+}
+
+void ThreadPool::post( std::coroutine_handle<> handle ){
+	{
+		std::scoped_lock lock( mutex );
+		queue.push_back( handle );
+	}
+	cv.notify_one();
+}
+
+size_t ThreadPool::size() const {
+	return threads.size();
+}
+
+void ThreadPool::run(){
+	std::unique_lock lock( mutex );
+
+	while( true ){
+		cv.wait( lock, [this]{ return stopping || !queue.empty(); });
+		if( queue.empty() )
+			return;
+
+		auto handle = queue.front();
+		queue.pop_front();
+
+		lock.unlock();
+		handle.resume();
+		lock.lock();
+	}
+}
+
+GpuWaiter::GpuWaiter( vk::Device device, ThreadPool& pool ): device( device ), pool( pool ){
+	thread = std::thread( &GpuWaiter::run, this );
+}
+
+GpuWaiter::~GpuWaiter(){
+	{
+		std::scoped_lock lock( mutex );
+		stopping = true;
+	}
+	cv.notify_all();
+
+	thread.join();
+}
+
+bool GpuWaiter::signalled( const Pending& p ) const {
+	if( p.fence )
+		return device.getFenceStatus( p.fence ) == vk::Result::eSuccess;
+	return device.getSemaphoreCounterValue( p.semaphore ) >= p.value;
+}
+
+void GpuWaiter::add( const Pending& p ){
+	{
+		std::scoped_lock lock( mutex );
+		added.push_back( p );
+	}
+	cv.notify_one();
+}
+
+void GpuWaiter::run(){
+	while( true ){
+		{
+			std::unique_lock lock( mutex );
+			cv.wait( lock, [this]{ return stopping || !added.empty() || !pending.empty(); });
+			if( stopping && added.empty() && pending.empty() )
+				return;
+
+			pending.insert( pending.end(), added.begin(), added.end() );
+			added.clear();
+		}
+
+		// Whatever is ready continues on the pool, so one slow continuation never delays the others
+		bool resumed = false;
+		for( size_t i = 0; i < pending.size(); ){
+			if( signalled( pending[i] )){
+				pool.post( pending[i].handle );
+				pending[i] = pending.back();
+				pending.pop_back();
+				resumed = true;
+			} else
+				++i;
+		}
+
+		if( resumed || pending.empty() )
+			continue;
+
+		fences.clear();
+		semaphores.clear();
+		values.clear();
+		for( auto& p: pending ){
+			if( p.fence )
+				fences.push_back( p.fence );
+			else {
+				semaphores.push_back( p.semaphore );
+				values.push_back( p.value );
+			}
+		}
+
+		// Either finishes early or times out, new waits are picked up after at most the timeout
+		uint64_t timeout = !fences.empty() && !semaphores.empty() ? mixed_timeout_ns : poll_timeout_ns;
+		if( !fences.empty() && vk::Result::eSuccess == device.waitForFences( fences, false, timeout ))
+			continue;
+		if( !semaphores.empty() )
+			(void)device.waitSemaphores({ vk::SemaphoreWaitFlagBits::eAny, semaphores, values }, timeout );
+	}
+}
+
+Task<std::vector<char>> SpaceAppVideo::read_file( ThreadPool& pool, std::filesystem::path path ){
+	co_await pool.schedule();
+
+	std::ifstream file( path, std::ios::ate | std::ios::binary );
+	if( !file.is_open() )
+		throw std::runtime_error( "Could not open file " + path.string() );
+
+	size_t file_size = ( size_t )file.tellg();
+	std::vector<char> data( file_size );
+
+	file.seekg( 0 );
+	file.read( data.data(), file_size );
+
+	co_return data;
+}
@@ -0,0 +1,533 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  Terrain.cpp
+ *
+ *    Description:  Source file defining things from Terrain.hpp
+ *
+ *        Version:  1.0
+ *        Created:  10/20/2026 04:41:27 AM
+ *       Revision:  none
+ *
+ *         Author:  Samuel Knoethig (), samuel@knoethig.net
+ *
+ * =====================================================================================
+ */
+
+#include "Util.hpp"
+#include "Terrain.hpp"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+using namespace SpaceAppVideo;
+
+namespace {
+	// Have to match terrain.vert.glsl, terrain.frag.glsl and terrain_generate.comp.glsl
+	struct DrawParams {
+		glm::mat4 view_proj;
+		// Direction towards the sun and the planet's maximum height
+		glm::vec4 sun;
+		float radius;
+	};
+
+	struct GenerateParams {
+		float max_height;
+		uint32_t seed;
+		uint32_t first_job;
+	};
+
+	struct FaceAxes {
+		glm::dvec3 normal;
+		glm::dvec3 u;
+		glm::dvec3 v;
+	};
+
+	// u x v is the normal, so grid triangles are counter clockwise seen from outside.
+	// Has to match terrain_generate.comp.glsl
+	const std::array<FaceAxes, 6> faces{{
+		{{ 1, 0, 0 }, { 0, 0, -1 }, { 0, 1, 0 }},
+		{{ -1, 0, 0 }, { 0, 0, 1 }, { 0, 1, 0 }},
+		{{ 0, 1, 0 }, { 1, 0, 0 }, { 0, 0, -1 }},
+		{{ 0, -1, 0 }, { 1, 0, 0 }, { 0, 0, 1 }},
+		{{ 0, 0, 1 }, { 1, 0, 0 }, { 0, 1, 0 }},
+		{{ 0, 0, -1 }, { -1, 0, 0 }, { 0, 1, 0 }},
+	}};
+
+	constexpr uint32_t generate_workgroup{ 8 };
+	constexpr uint32_t binding_count{ 3 };
+	const glm::vec3 sun_direction = glm::normalize( glm::vec3( 1, 0.5f, -1 ));
+
+	/**
+	 *	Returns true if the box lies at least partially on the inner side of all frustum side planes
+	 */
+	bool box_visible( const std::array<glm::vec4, 4>& planes, glm::vec3 min, glm::vec3 max ){
+		for( auto& p: planes ){
+			glm::vec3 v( p.x > 0 ? max.x : min.x, p.y > 0 ? max.y : min.y, p.z > 0 ? max.z : min.z );
+			if( glm::dot( glm::vec3( p ), v ) + p.w < 0 )
+				return false;
+		}
+		return true;
+	}
+}
+
+Terrain::Terrain( vk::PhysicalDevice phys_dev, vk::Device device, ShaderManager& shaders, vk::PipelineCache cache, const Planet& planet ):
+		phys_dev( phys_dev ), device( device ), shaders( shaders ), cache( cache ), planet( planet ){
+	// A face is 2 wide in cube space and about as long as the radius times that at its center
+	double levels = std::floor( std::log2( 2 * planet.radius / ( grid_size * min_spacing )));
+	depth = static_cast<uint32_t>( std::clamp( levels, 1.0, double( max_depth )));
+
+	double leaf_size = 2 * planet.radius / ( 1u << depth );
+	for( uint32_t lod = 0; lod <= max_depth; ++lod ){
+		ranges[lod] = leaf_size * lod_range * ( 1u << lod );
+		double previous = lod > 0 ? ranges[lod - 1] : 0;
+		morph_starts[lod] = previous + ( ranges[lod] - previous ) * morph_ratio;
+	}
+
+	hash.assign( hash_size, { empty_key, no_slot });
+	tile_keys.assign( max_tiles, empty_key );
+	tile_used.assign( max_tiles, 0 );
+	lru_prev.assign( max_tiles + 1, no_slot );
+	lru_next.assign( max_tiles + 1, no_slot );
+	lru_prev[max_tiles] = lru_next[max_tiles] = max_tiles;
+
+	for( uint32_t face = 0; face < root_count; ++face ){
+		tile_keys[face] = key({ face, 0, 0, 0 });
+		hash_insert( tile_keys[face], face );
+	}
+
+	auto storage = vk::BufferUsageFlagBits::eStorageBuffer;
+	auto host = vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent;
+
+	tiles = create_buffer( phys_dev, device, vk::DeviceSize( max_tiles ) * tile_samples * sizeof( float ), storage, vk::MemoryPropertyFlagBits::eDeviceLocal );
+	patches = create_buffer( phys_dev, device, MAX_FRAMES_IN_FLIGHT * max_views * max_patches * sizeof( TerrainPatch ), storage, host );
+	job_buffer = create_buffer( phys_dev, device, MAX_FRAMES_IN_FLIGHT * max_generated * sizeof( TileJob ), storage, host );
+
+	// The same grid for every patch, vertices are numbered row by row
+	std::vector<uint16_t> grid;
+	grid.reserve( grid_size * grid_size * 6 );
+	for( uint32_t y = 0; y < grid_size; ++y )
+		for( uint32_t x = 0; x < grid_size; ++x ){
+			uint16_t v00 = y * ( grid_size + 1 ) + x;
+			uint16_t v10 = v00 + 1;
+			uint16_t v01 = v00 + grid_size + 1;
+			uint16_t v11 = v01 + 1;
+			grid.insert( grid.end(), { v00, v10, v11, v00, v11, v01 });
+		}
+	indices = create_buffer( phys_dev, device, grid.size() * sizeof( uint16_t ), vk::BufferUsageFlagBits::eIndexBuffer, host );
+	memcpy( indices.mapped, grid.data(), grid.size() * sizeof( uint16_t ));
+
+	create_descriptors();
+	create_generate_pipeline( cache );
+
+	logger << LogChannel::Video << LogLevel::Info << "Created terrain of radius " << planet.radius << " with " << depth <<
+		" levels and " << max_tiles << " tiles of " << grid_size << "x" << grid_size;
+}
+
+uint64_t Terrain::key( const Node& node ){
+	return uint64_t( node.face ) << 56 | uint64_t( node.level ) << 48 | uint64_t( node.x ) << 24 | node.y;
+}
+
+vk::Buffer Terrain::buffer() const {
+	return *tiles.buffer;
+}
+
+uint32_t Terrain::patch_count( uint32_t view_index ) const {
+	return patch_counts[view_index];
+}
+
+void Terrain::create_descriptors(){
+	auto stages = vk::ShaderStageFlagBits::eVertex | vk::ShaderStageFlagBits::eCompute;
+
+	std::vector<vk::DescriptorSetLayoutBinding> bindings;
+	for( uint32_t i = 0; i < binding_count; ++i )
+		bindings.emplace_back( i, vk::DescriptorType::eStorageBuffer, 1, stages );
+
+	descriptor_layout = device.createDescriptorSetLayoutUnique({ {}, bindings });
+
+	vk::DescriptorPoolSize pool_size( vk::DescriptorType::eStorageBuffer, binding_count );
+	descriptor_pool = device.createDescriptorPoolUnique({ {}, 1, 1, &pool_size });
+
+	descriptors = device.allocateDescriptorSets({ *descriptor_pool, 1, &*descriptor_layout })[0];
+
+	const Buffer* buffers[binding_count] = { &patches, &tiles, &job_buffer };
+
+	std::vector<vk::DescriptorBufferInfo> buffer_infos;
+	for( auto b: buffers )
+		buffer_infos.emplace_back( *b->buffer, 0, VK_WHOLE_SIZE );
+
+	std::vector<vk::WriteDescriptorSet> writes;
+	for( uint32_t i = 0; i < binding_count; ++i )
+		writes.emplace_back( descriptors, i, 0, 1, vk::DescriptorType::eStorageBuffer, nullptr, &buffer_infos[i] );
+
+	device.updateDescriptorSets( writes, {} );
+}
+
+void Terrain::create_generate_pipeline( vk::PipelineCache cache ){
+	vk::PushConstantRange push_range( vk::ShaderStageFlagBits::eCompute, 0, sizeof( GenerateParams ));
+	generate_layout = device.createPipelineLayoutUnique({ {}, 1, &*descriptor_layout, 1, &push_range });
+
+	vk::ComputePipelineCreateInfo cr_inf(
+			{},
+			{ {}, vk::ShaderStageFlagBits::eCompute, shaders.get( "terrain_generate.comp.glsl.spv" ), "main" },
+			*generate_layout
+		);
+	generate_pipeline = std::move( device.createComputePipelinesUnique( cache, cr_inf ).value[0] );
+}
+
+void Terrain::create_render_pipeline( vk::RenderPass render_pass ){
+	if( !draw_layout ){
+		vk::PushConstantRange push_range( vk::ShaderStageFlagBits::eVertex | vk::ShaderStageFlagBits::eFragment, 0, sizeof( DrawParams ));
+		draw_layout = device.createPipelineLayoutUnique({ {}, 1, &*descriptor_layout, 1, &push_range });
+	}
+
+	std::vector<vk::PipelineShaderStageCreateInfo> stage_infos{
+			{ {}, vk::ShaderStageFlagBits::eVertex, shaders.get( "terrain.vert.glsl.spv" ), "main", {} },
+			{ {}, vk::ShaderStageFlagBits::eFragment, shaders.get( "terrain.frag.glsl.spv" ), "main", {} },
+		};
+
+	// Vertices are generated from their index and the patch of their instance
+	vk::PipelineVertexInputStateCreateInfo vertex_input_info;
+
+	vk::PipelineInputAssemblyStateCreateInfo input_assembly_info(
+			{},
+			vk::PrimitiveTopology::eTriangleList,
+			VK_FALSE
+		);
+
+	vk::PipelineViewportStateCreateInfo viewport_state_info(
+			{},
+			1, nullptr,
+			1, nullptr
+		);
+
+	std::vector dynamic_states{ vk::DynamicState::eViewport, vk::DynamicState::eScissor };
+	vk::PipelineDynamicStateCreateInfo dynamic_state_info(
+			{},
+			dynamic_states
+		);
+
+	vk::PipelineRasterizationStateCreateInfo rasterization_state_info(
+			{},
+			VK_FALSE,
+			VK_FALSE,
+			vk::PolygonMode::eFill,
+			vk::CullModeFlagBits::eBack,
+			vk::FrontFace::eCounterClockwise,
+			VK_FALSE,
+			0,
+			0,
+			0,
+			1
+		);
+
+	vk::PipelineMultisampleStateCreateInfo multisample_state_info(
+			{},
+			vk::SampleCountFlagBits::e1,
+			VK_FALSE,
+			1,
+			nullptr,
+			VK_FALSE,
+			VK_FALSE
+		);
+
+	vk::PipelineColorBlendAttachmentState color_blend_attachment(
+			VK_FALSE,
+			vk::BlendFactor::eOne,
+			vk::BlendFactor::eZero,
+			vk::BlendOp::eAdd,
+			vk::BlendFactor::eOne,
+			vk::BlendFactor::eZero,
+			vk::BlendOp::eAdd,
+			vk::ColorComponentFlagBits::eR | vk::ColorComponentFlagBits::eG | vk::ColorComponentFlagBits::eB | vk::ColorComponentFlagBits::eA
+		);
+
+	vk::PipelineColorBlendStateCreateInfo color_blend_info(
+			{},
+			VK_FALSE,
+			vk::LogicOp::eCopy,
+			1, &color_blend_attachment,
+			{ 0, 0, 0, 0 }
+		);
+
+	// Reversed depth, the terrain is the main occluder of everything drawn after it
+	vk::PipelineDepthStencilStateCreateInfo depth_stencil_info(
+			{},
+			VK_TRUE,
+			VK_TRUE,
+			vk::CompareOp::eGreater
+		);
+
+	vk::GraphicsPipelineCreateInfo pipeline_create_info(
+			{},
+			stage_infos,
+			&vertex_input_info,
+			&input_assembly_info,
+			nullptr,
+			&viewport_state_info,
+			&rasterization_state_info,
+			&multisample_state_info,
+			&depth_stencil_info,
+			&color_blend_info,
+			&dynamic_state_info,
+			*draw_layout,
+			render_pass,
+			0,
+			vk::Pipeline{},
+			-1
+		);
+
+	draw_pipeline = std::move( device.createGraphicsPipelinesUnique( cache, pipeline_create_info ).value[0] );
+}
+
+glm::mat4 Terrain::view_proj( const Camera& camera, vk::Extent2D extent ) const {
+	// Camera relative like the starfield
+	return camera.projection( (float)extent.width / extent.height ) * glm::lookAt( glm::vec3( 0 ), camera.forward, camera.up );
+}
+
+void Terrain::begin_frame( size_t frame ){
+	++frame_counter;
+	patch_counts.fill( 0 );
+	jobs = static_cast<TileJob*>( job_buffer.mapped ) + frame * max_generated;
+	job_count = 0;
+
+	// Root tiles are the fallback of everything else, so they are generated before anything is drawn
+	if( frame_counter == 1 )
+		for( uint32_t face = 0; face < root_count; ++face )
+			jobs[job_count++] = { face, 0, 0, face };
+}
+
+void Terrain::select( size_t frame, uint32_t view_index, const Camera& camera, vk::Extent2D extent ){
+	if( view_index >= max_views )
+		throw std::runtime_error( "Too many terrain views" );
+
+	// Side planes of the frustum, the far plane is at infinity
+	glm::mat4 t = glm::transpose( view_proj( camera, extent ));
+
+	Selection s{
+		{ t[3] + t[0], t[3] - t[0], t[3] + t[1], t[3] - t[1] },
+		glm::dvec3( camera.position ),
+		static_cast<TerrainPatch*>( patches.mapped ) + ( frame * max_views + view_index ) * max_patches,
+		0,
+	};
+
+	for( uint32_t face = 0; face < root_count; ++face )
+		select_node( s, { face, 0, 0, 0 });
+
+	patch_counts[view_index] = s.count;
+}
+
+void Terrain::bounds( const Node& node, const glm::dvec3& camera, glm::dvec3& min, glm::dvec3& max ) const {
+	auto& axes = faces[node.face];
+	double size = 2.0 / ( 1u << node.level );
+	double u0 = -1 + node.x * size;
+	double v0 = -1 + node.y * size;
+
+	// Corners, edge midpoints and center on the lowest and highest possible surface, which holds the bulge of
+	// even a whole face
+	min = glm::dvec3( std::numeric_limits<double>::max() );
+	max = glm::dvec3( std::numeric_limits<double>::lowest() );
+	for( int j = 0; j < 3; ++j )
+		for( int i = 0; i < 3; ++i ){
+			glm::dvec3 dir = glm::normalize( axes.normal + ( u0 + i * size / 2 ) * axes.u + ( v0 + j * size / 2 ) * axes.v );
+			for( double r: { planet.radius, planet.radius + planet.max_height }){
+				glm::dvec3 p = planet.center + dir * r - camera;
+				min = glm::min( min, p );
+				max = glm::max( max, p );
+			}
+		}
+}
+
+bool Terrain::select_node( Selection& s, const Node& node ){
+	uint32_t lod = depth - node.level;
+
+	glm::dvec3 min, max;
+	bounds( node, s.camera, min, max );
+
+	// Outside of the frustum neither the node nor its parent draws anything here
+	if( !box_visible( s.planes, glm::vec3( min ), glm::vec3( max )))
+		return true;
+
+	// Closest point of the box to the camera, which is the origin
+	double distance = glm::length( glm::max( glm::max( min, -max ), glm::dvec3( 0 )));
+	if( node.level > 0 && distance > ranges[lod] )
+		return false;
+
+	// None of the children would be in range of their lod, so they are drawn by this node as a whole
+	if( lod == 0 || distance > ranges[lod - 1] ){
+		add_patch( s, node, lod, 0 );
+		return true;
+	}
+
+	for( uint32_t c = 0; c < 4; ++c ){
+		Node child{ node.face, node.level + 1, node.x * 2 + ( c & 1 ), node.y * 2 + ( c >> 1 )};
+		if( !select_node( s, child ))
+			add_patch( s, child, lod, 1 );
+	}
+	return true;
+}
+
+void Terrain::add_patch( Selection& s, const Node& node, uint32_t lod, uint32_t shift ){
+	if( s.count == max_patches )
+		return;
+
+	// Finest resident tile along the path to the root, the roots are always resident
+	uint32_t level = node.level + 1;
+	uint32_t slot = no_slot;
+	while( slot == no_slot ){
+		--level;
+		slot = find_tile( key({ node.face, level, node.x >> ( node.level - level ), node.y >> ( node.level - level )}));
+	}
+
+	// One level finer per frame, so detail arrives coarse to fine
+	if( level < node.level ){
+		uint32_t diff = node.level - level - 1;
+		if( uint32_t finer = allocate_tile({ node.face, level + 1, node.x >> diff, node.y >> diff }); finer != no_slot ){
+			slot = finer;
+			++level;
+		}
+	}
+	touch( slot );
+
+	auto& axes = faces[node.face];
+	double size = 2.0 / ( 1u << node.level );
+	glm::dvec3 q = axes.normal + ( -1 + ( node.x + 0.5 ) * size ) * axes.u + ( -1 + ( node.y + 0.5 ) * size ) * axes.v;
+	double length = glm::length( q );
+	glm::dvec3 direction = q / length;
+
+	uint32_t diff = node.level - level;
+	uint32_t mask = ( 1u << diff ) - 1;
+	float tile_scale = 1.0f / ( 1u << diff );
+
+	s.patches[s.count++] = {
+		glm::vec3( planet.center + direction * planet.radius - s.camera ),
+		float( morph_starts[lod] ),
+		glm::vec3( direction ),
+		float( ranges[lod] ),
+		glm::vec3( axes.u * ( size / length )),
+		tile_scale,
+		glm::vec3( axes.v * ( size / length )),
+		slot,
+		glm::vec2(( node.x & mask ) * tile_scale, ( node.y & mask ) * tile_scale ),
+		shift,
+		0,
+	};
+}
+
+uint32_t Terrain::allocate_tile( const Node& node ){
+	if( job_count == max_generated )
+		return no_slot;
+
+	uint32_t slot;
+	if( unused_tiles < max_tiles )
+		slot = unused_tiles++;
+	else {
+		// Tiles used this frame may still be drawn, the pool is too small for the view then
+		slot = lru_prev[max_tiles];
+		if( slot == max_tiles || tile_used[slot] == frame_counter )
+			return no_slot;
+
+		hash_erase( tile_keys[slot] );
+		unlink( slot );
+	}
+
+	tile_keys[slot] = key( node );
+	hash_insert( tile_keys[slot], slot );
+	jobs[job_count++] = { node.face | node.level << 8, node.x, node.y, slot };
+
+	return slot;
+}
+
+void Terrain::touch( uint32_t slot ){
+	if( slot < root_count )
+		return;
+
+	tile_used[slot] = frame_counter;
+	if( lru_prev[slot] != no_slot )
+		unlink( slot );
+
+	// Most recently used at the head, evicted from the tail
+	lru_prev[slot] = max_tiles;
+	lru_next[slot] = lru_next[max_tiles];
+	lru_prev[lru_next[max_tiles]] = slot;
+	lru_next[max_tiles] = slot;
+}
+
+void Terrain::unlink( uint32_t slot ){
+	lru_next[lru_prev[slot]] = lru_next[slot];
+	lru_prev[lru_next[slot]] = lru_prev[slot];
+	lru_prev[slot] = lru_next[slot] = no_slot;
+}
+
+static uint32_t home( uint64_t key, uint32_t size ){
+	return static_cast<uint32_t>(( key * 0x9E3779B97F4A7C15ull ) >> 32 ) & ( size - 1 );
+}
+
+uint32_t Terrain::find_tile( uint64_t key ) const {
+	for( uint32_t i = home( key, hash_size );; i = ( i + 1 ) & ( hash_size - 1 )){
+		if( hash[i].key == key )
+			return hash[i].slot;
+		if( hash[i].key == empty_key )
+			return no_slot;
+	}
+}
+
+void Terrain::hash_insert( uint64_t key, uint32_t slot ){
+	// Never more than half full, so there always is an empty entry
+	uint32_t i = home( key, hash_size );
+	while( hash[i].key != empty_key )
+		i = ( i + 1 ) & ( hash_size - 1 );
+	hash[i] = { key, slot };
+}
+
+void Terrain::hash_erase( uint64_t key ){
+	uint32_t i = home( key, hash_size );
+	while( hash[i].key != key )
+		i = ( i + 1 ) & ( hash_size - 1 );
+
+	// Later entries of the probe sequence move into the gap, so lookups never stop early
+	for( uint32_t j = ( i + 1 ) & ( hash_size - 1 ); hash[j].key != empty_key; j = ( j + 1 ) & ( hash_size - 1 )){
+		uint32_t h = home( hash[j].key, hash_size );
+		bool movable = i <= j ? ( h <= i || h > j ) : ( h <= i && h > j );
+		if( movable ){
+			hash[i] = hash[j];
+			i = j;
+		}
+	}
+	hash[i] = { empty_key, no_slot };
+}
+
+void Terrain::record_generation( vk::CommandBuffer cmd, size_t frame ){
+	if( job_count == 0 )
+		return;
+
+	GenerateParams params{ planet.max_height, planet.seed, uint32_t( frame * max_generated )};
+
+	cmd.bindPipeline( vk::PipelineBindPoint::eCompute, *generate_pipeline );
+	cmd.bindDescriptorSets( vk::PipelineBindPoint::eCompute, *generate_layout, 0, descriptors, {} );
+	cmd.pushConstants( *generate_layout, vk::ShaderStageFlagBits::eCompute, 0, sizeof( params ), &params );
+
+	// One workgroup layer per tile
+	uint32_t groups = ( grid_size + generate_workgroup ) / generate_workgroup;
+	cmd.dispatch( groups, groups, job_count );
+}
+
+void Terrain::record_draw( vk::CommandBuffer cmd, size_t frame, uint32_t view_index, const Camera& camera, vk::Extent2D extent ){
+	uint32_t count = patch_counts[view_index];
+	if( count == 0 )
+		return;
+
+	DrawParams params{ view_proj( camera, extent ), glm::vec4( sun_direction, planet.max_height ), float( planet.radius )};
+
+	cmd.bindPipeline( vk::PipelineBindPoint::eGraphics, *draw_pipeline );
+	cmd.bindDescriptorSets( vk::PipelineBindPoint::eGraphics, *draw_layout, 0, descriptors, {} );
+	cmd.pushConstants( *draw_layout, vk::ShaderStageFlagBits::eVertex | vk::ShaderStageFlagBits::eFragment, 0, sizeof( params ), &params );
+	cmd.bindIndexBuffer( *indices.buffer, 0, vk::IndexType::eUint16 );
+
+	// The patches of the view start at its instance index
+	cmd.drawIndexed( grid_size * grid_size * 6, count, 0, 0, uint32_t(( frame * max_views + view_index ) * max_patches ));
+}
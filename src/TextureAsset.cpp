@@ -0,0 +1,164 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  TextureAsset.cpp
+ *
+ *    Description:  Reading and writing texture files
+ *
+ *        Version:  1.0
+ *        Created:  10/20/2026 02:13:40 AM
+ *       Revision:  none
+ *
+ *         Author:  Samuel Knoethig (), samuel@knoethig.net
+ *
+ * =====================================================================================
+ */
+
+#include "TextureAsset.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <stdexcept>
+#include <string.h>
+#include <thread>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace SpaceAppVideo;
+
+namespace {
+	constexpr char asset_magic[4]{ 'S', 'T', 'E', 'X' };
+
+	uint64_t align_page( uint64_t offset ){
+		return ( offset + TextureAsset::page_size - 1 ) & ~( TextureAsset::page_size - 1 );
+	}
+}
+
+uint32_t SpaceAppVideo::block_bytes( TextureCodec codec ){
+	return codec == TextureCodec::BC4 ? 8 : 16;
+}
+
+TextureAsset::TextureAsset( const std::filesystem::path& path ){
+	int fd = open( path.c_str(), O_RDONLY );
+	if( fd < 0 )
+		throw std::runtime_error( "Failed to open texture " + path.string() );
+
+	struct stat st;
+	if( fstat( fd, &st ) != 0 || static_cast<size_t>( st.st_size ) < sizeof( TextureHeader )){
+		close( fd );
+		throw std::runtime_error( "Texture " + path.string() + " is truncated" );
+	}
+
+	void* mapped = mmap( nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+	close( fd );
+	if( mapped == MAP_FAILED )
+		throw std::runtime_error( "Failed to map texture " + path.string() );
+
+	mapping = static_cast<const uint8_t*>( mapped );
+	size = st.st_size;
+
+	auto& h = header();
+	bool valid = memcmp( h.magic, asset_magic, sizeof( asset_magic )) == 0
+		&& h.version == version
+		&& h.codec <= TextureCodec::BC4
+		&& h.mip_count > 0 && h.mip_count <= max_mips
+		&& size >= sizeof( TextureHeader ) + h.mip_count * sizeof( MipEntry );
+
+	for( uint32_t i = 0; valid && i < h.mip_count; ++i ){
+		auto& m = mip( i );
+		uint64_t expected = uint64_t(( m.width + 3 ) / 4 ) * (( m.height + 3 ) / 4 ) * block_bytes( h.codec );
+		valid = m.width == std::max( h.width >> i, 1u ) && m.height == std::max( h.height >> i, 1u )
+			&& m.size == expected && m.offset + m.size <= size;
+	}
+
+	if( !valid ){
+		unmap();
+		throw std::runtime_error( "Texture " + path.string() + " is invalid" );
+	}
+}
+
+TextureAsset::TextureAsset( TextureAsset&& other ): mapping( other.mapping ), size( other.size ){
+	other.mapping = nullptr;
+	other.size = 0;
+}
+
+TextureAsset& TextureAsset::operator=( TextureAsset&& other ){
+	if( this != &other ){
+		unmap();
+		std::swap( mapping, other.mapping );
+		std::swap( size, other.size );
+	}
+	return *this;
+}
+
+TextureAsset::~TextureAsset(){
+	unmap();
+}
+
+void TextureAsset::unmap(){
+	if( mapping )
+		munmap( const_cast<uint8_t*>( mapping ), size );
+	mapping = nullptr;
+	size = 0;
+}
+
+const TextureHeader& TextureAsset::header() const {
+	return *reinterpret_cast<const TextureHeader*>( mapping );
+}
+
+const MipEntry& TextureAsset::mip( uint32_t level ) const {
+	return reinterpret_cast<const MipEntry*>( mapping + sizeof( TextureHeader ))[level];
+}
+
+std::span<const uint8_t> TextureAsset::data( uint32_t level ) const {
+	auto& m = mip( level );
+	return { mapping + m.offset, m.size };
+}
+
+void TextureAsset::prefetch( uint32_t level ) const {
+	auto& m = mip( level );
+	madvise( const_cast<uint8_t*>( mapping + m.offset ), m.size, MADV_WILLNEED );
+}
+
+void SpaceAppVideo::write_texture_asset( const std::filesystem::path& path, TextureCodec codec, bool srgb, std::span<const MipData> mips ){
+	if( mips.empty() || mips.size() > TextureAsset::max_mips )
+		throw std::runtime_error( "Unsupported mip count for " + path.string() );
+
+	TextureHeader header{};
+	memcpy( header.magic, asset_magic, sizeof( asset_magic ));
+	header.version = TextureAsset::version;
+	header.codec = codec;
+	header.srgb = srgb;
+	header.width = mips[0].width;
+	header.height = mips[0].height;
+	header.mip_count = mips.size();
+
+	std::vector<MipEntry> entries;
+	uint64_t offset = align_page( sizeof( TextureHeader ) + mips.size() * sizeof( MipEntry ));
+	for( auto& m: mips ){
+		entries.push_back({ offset, m.blocks.size(), m.width, m.height });
+		offset = align_page( offset + m.blocks.size() );
+	}
+
+	auto tmp = path;
+	tmp += ".tmp" + std::to_string( std::hash<std::thread::id>{}( std::this_thread::get_id() ));
+	{
+		std::ofstream out( tmp, std::ios::binary | std::ios::trunc );
+		if( !out.is_open() )
+			throw std::runtime_error( "Failed to write texture " + tmp.string() );
+
+		out.write( reinterpret_cast<const char*>( &header ), sizeof( header ));
+		out.write( reinterpret_cast<const char*>( entries.data() ), entries.size() * sizeof( MipEntry ));
+		for( size_t i = 0; i < mips.size(); ++i ){
+			out.seekp( entries[i].offset );
+			out.write( reinterpret_cast<const char*>( mips[i].blocks.data() ), mips[i].blocks.size() );
+		}
+
+		if( !out )
+			throw std::runtime_error( "Failed to write texture " + tmp.string() );
+	}
+	std::filesystem::rename( tmp, path );
+}
@@ -0,0 +1,581 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  TextureStreamer.cpp
+ *
+ *    Description:  Source file defining things from TextureStreamer.hpp
+ *
+ *        Version:  1.0
+ *        Created:  10/20/2026 03:20:05 AM
+ *       Revision:  none
+ *
+ *         Author:  Samuel Knoethig (), samuel@knoethig.net
+ *
+ * =====================================================================================
+ */
+
+#include "Util.hpp"
+#include "TextureStreamer.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+using namespace SpaceAppVideo;
+
+namespace {
+	vk::Format vk_format( const TextureHeader& header ){
+		switch( header.codec ){
+			case TextureCodec::BC7:
+				return header.srgb ? vk::Format::eBc7SrgbBlock : vk::Format::eBc7UnormBlock;
+			case TextureCodec::BC5:
+				return vk::Format::eBc5UnormBlock;
+			case TextureCodec::BC4:
+				return vk::Format::eBc4UnormBlock;
+		}
+		return vk::Format::eUndefined;
+	}
+
+	vk::ImageSubresourceRange mip_range( uint32_t mip, uint32_t count = 1 ){
+		return { vk::ImageAspectFlagBits::eColor, mip, count, 0, 1 };
+	}
+
+	void share( vk::ImageCreateInfo& info, const std::vector<uint32_t>& families ){
+		if( families.size() < 2 )
+			return;
+		info.sharingMode = vk::SharingMode::eConcurrent;
+		info.queueFamilyIndexCount = families.size();
+		info.pQueueFamilyIndices = families.data();
+	}
+
+	// Black placeholder texel, at the start of the first frame's staging buffer
+	constexpr std::array<uint8_t, 4> placeholder_texel{ 0, 0, 0, 255 };
+}
+
+bool TextureStreamer::sparse_supported( vk::PhysicalDevice phys_dev, uint32_t queue_family ){
+	auto features = phys_dev.getFeatures();
+	auto families = phys_dev.getQueueFamilyProperties();
+	return features.sparseBinding && features.sparseResidencyImage2D &&
+		( families[queue_family].queueFlags & vk::QueueFlagBits::eSparseBinding );
+}
+
+TextureStreamer::TextureStreamer( vk::PhysicalDevice phys_dev, vk::Device device, vk::Queue bind_queue, uint32_t sample_family,
+		uint32_t upload_family, bool sparse, vk::DeviceSize budget ):
+		phys_dev( phys_dev ), device( device ), bind_queue( bind_queue ), sparse( sparse ), budget( budget ){
+	queue_families.push_back( sample_family );
+	if( upload_family != sample_family )
+		queue_families.push_back( upload_family );
+
+	if( phys_dev.getQueueFamilyProperties()[upload_family].queueFlags & vk::QueueFlagBits::eGraphics ){
+		sampled_stages = vk::PipelineStageFlagBits::eVertexShader | vk::PipelineStageFlagBits::eFragmentShader;
+		sampled_access = vk::AccessFlagBits::eShaderRead;
+	} else
+		sampled_stages = vk::PipelineStageFlagBits::eBottomOfPipe;
+
+	uploaded_metric = Metrics::registry().counter( "textures.uploaded_bytes" );
+	allocated_metric = Metrics::registry().gauge( "textures.allocated_bytes" );
+
+	textures.reserve( max_textures );
+	uploads.reserve( max_textures * TextureAsset::max_mips );
+	order.reserve( max_textures );
+	barriers.reserve( max_textures * TextureAsset::max_mips );
+	image_infos.reserve( max_textures );
+	writes.reserve( max_textures );
+	tail_binds.reserve( max_textures );
+
+	for( uint32_t lod = 0; lod < samplers.size(); ++lod ){
+		vk::SamplerCreateInfo cr_inf(
+				{},
+				vk::Filter::eLinear, vk::Filter::eLinear, vk::SamplerMipmapMode::eLinear,
+				vk::SamplerAddressMode::eRepeat, vk::SamplerAddressMode::eRepeat, vk::SamplerAddressMode::eRepeat,
+				0, false, 1, false, vk::CompareOp::eNever,
+				lod, VK_LOD_CLAMP_NONE
+			);
+		samplers[lod] = device.createSamplerUnique( cr_inf );
+	}
+
+	for( auto& s: staging )
+		s = create_buffer( phys_dev, device, staging_size, vk::BufferUsageFlagBits::eTransferSrc,
+				vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent );
+	for( auto& s: bind_semaphores )
+		s = device.createSemaphoreUnique({});
+	for( auto& s: upload_semaphores )
+		s = device.createSemaphoreUnique({});
+
+	vk::ImageCreateInfo placeholder_info(
+			{},
+			vk::ImageType::e2D, vk::Format::eR8G8B8A8Unorm, { 1, 1, 1 }, 1, 1,
+			vk::SampleCountFlagBits::e1, vk::ImageTiling::eOptimal,
+			vk::ImageUsageFlagBits::eSampled | vk::ImageUsageFlagBits::eTransferDst
+		);
+	share( placeholder_info, queue_families );
+	placeholder = device.createImageUnique( placeholder_info );
+	auto placeholder_reqs = device.getImageMemoryRequirements( *placeholder );
+	placeholder_memory = device.allocateMemoryUnique({ placeholder_reqs.size,
+			find_mem_type( phys_dev, placeholder_reqs.memoryTypeBits, vk::MemoryPropertyFlagBits::eDeviceLocal )});
+	device.bindImageMemory( *placeholder, *placeholder_memory, 0 );
+	placeholder_view = device.createImageViewUnique({ {}, *placeholder, vk::ImageViewType::e2D, vk::Format::eR8G8B8A8Unorm, {}, mip_range( 0 )});
+
+	create_descriptors();
+
+	logger << LogChannel::Video << LogLevel::Info << "Created texture streamer with a budget of " << ( budget >> 20 ) << " MiB, " <<
+		( sparse ? "using" : "without" ) << " sparse residency";
+}
+
+void TextureStreamer::create_descriptors(){
+	vk::DescriptorSetLayoutBinding binding( 0, vk::DescriptorType::eCombinedImageSampler, max_textures,
+			vk::ShaderStageFlagBits::eVertex | vk::ShaderStageFlagBits::eFragment );
+	descriptor_layout = device.createDescriptorSetLayoutUnique({ {}, 1, &binding });
+
+	vk::DescriptorPoolSize pool_size( vk::DescriptorType::eCombinedImageSampler, max_textures * MAX_FRAMES_IN_FLIGHT );
+	descriptor_pool = device.createDescriptorPoolUnique({ {}, MAX_FRAMES_IN_FLIGHT, 1, &pool_size });
+
+	std::array<vk::DescriptorSetLayout, MAX_FRAMES_IN_FLIGHT> layouts;
+	layouts.fill( *descriptor_layout );
+	auto sets = device.allocateDescriptorSets({ *descriptor_pool, layouts.size(), layouts.data() });
+	std::copy( sets.begin(), sets.end(), descriptors.begin() );
+
+	// Every element has to be valid, textures replace the placeholder once they have a resident mip
+	std::vector<vk::DescriptorImageInfo> infos( max_textures, { *samplers[0], *placeholder_view, vk::ImageLayout::eShaderReadOnlyOptimal });
+	for( auto set: descriptors )
+		device.updateDescriptorSets( vk::WriteDescriptorSet( set, 0, 0, max_textures, vk::DescriptorType::eCombinedImageSampler, infos.data() ), {} );
+}
+
+TextureStreamer::TextureId TextureStreamer::load( const std::filesystem::path& path ){
+	if( textures.size() == max_textures )
+		throw std::runtime_error( "Too many textures" );
+
+	TextureAsset asset( path );
+	auto& header = asset.header();
+	auto format = vk_format( header );
+	auto usage = vk::ImageUsageFlagBits::eSampled | vk::ImageUsageFlagBits::eTransferDst;
+
+	bool use_sparse = sparse && !phys_dev.getSparseImageFormatProperties( format, vk::ImageType::e2D,
+			vk::SampleCountFlagBits::e1, usage, vk::ImageTiling::eOptimal ).empty();
+
+	vk::ImageCreateInfo cr_inf(
+			use_sparse ? vk::ImageCreateFlagBits::eSparseBinding | vk::ImageCreateFlagBits::eSparseResidency : vk::ImageCreateFlags(),
+			vk::ImageType::e2D, format, { header.width, header.height, 1 }, header.mip_count, 1,
+			vk::SampleCountFlagBits::e1, vk::ImageTiling::eOptimal, usage
+		);
+	share( cr_inf, queue_families );
+
+	Texture t{ std::move( asset ), format, device.createImageUnique( cr_inf )};
+	t.sparse = use_sparse;
+	t.resident = header.mip_count;
+	t.tail_first = header.mip_count;
+	t.stale.fill( true );
+
+	t.resident_first = header.mip_count - 1;
+	while( t.resident_first > 0 && std::max( t.asset.mip( t.resident_first - 1 ).width, t.asset.mip( t.resident_first - 1 ).height ) <= resident_size )
+		--t.resident_first;
+	t.requested = t.resident_first;
+
+	auto reqs = device.getImageMemoryRequirements( *t.image );
+	if( !use_sparse ){
+		t.memory = device.allocateMemoryUnique({ reqs.size, find_mem_type( phys_dev, reqs.memoryTypeBits, vk::MemoryPropertyFlagBits::eDeviceLocal )});
+		device.bindImageMemory( *t.image, *t.memory, 0 );
+		allocated += reqs.size;
+
+		if( allocated > budget )
+			logger << LogChannel::Video << LogLevel::Warning << "Textures exceed their budget by " << (( allocated - budget ) >> 20 ) << " MiB";
+	} else {
+		if( page_size == 0 ){
+			page_size = reqs.alignment;
+			page_memory_type = find_mem_type( phys_dev, reqs.memoryTypeBits, vk::MemoryPropertyFlagBits::eDeviceLocal );
+
+			// Each page is bound at most once and unbound at most once per frame
+			size_t max_pages = budget / page_size;
+			free_pages.reserve( max_pages );
+			page_blocks.reserve( max_pages / pages_per_block + 1 );
+			image_binds.reserve( 2 * max_pages );
+			image_bind_infos.reserve( 2 * max_textures * TextureAsset::max_mips );
+			image_bind_first.reserve( 2 * max_textures * TextureAsset::max_mips );
+		}
+		if( reqs.alignment != page_size || !( reqs.memoryTypeBits & ( 1u << page_memory_type )))
+			throw std::runtime_error( "Texture " + path.string() + " can not share the sparse page pool" );
+
+		auto sparse_reqs = device.getImageSparseMemoryRequirements( *t.image );
+		auto color = std::find_if( sparse_reqs.begin(), sparse_reqs.end(), []( auto& r ){
+			return bool( r.formatProperties.aspectMask & vk::ImageAspectFlagBits::eColor ); });
+		if( color == sparse_reqs.end() )
+			throw std::runtime_error( "Texture " + path.string() + " has no sparse colour aspect" );
+
+		t.granularity = color->formatProperties.imageGranularity;
+		t.tail_first = std::min( color->imageMipTailFirstLod, header.mip_count );
+		// Mips in the tail cost nothing once it is bound
+		t.resident_first = std::min( t.resident_first, t.tail_first );
+
+		if( t.tail_first < header.mip_count ){
+			t.memory = device.allocateMemoryUnique({ color->imageMipTailSize, page_memory_type });
+			t.tail_bind = vk::SparseMemoryBind( color->imageMipTailOffset, color->imageMipTailSize, *t.memory, 0 );
+			allocated += color->imageMipTailSize;
+		}
+
+		for( uint32_t mip = 0; mip < t.tail_first; ++mip )
+			t.pages[mip].reserve( tile_count( t, mip ));
+	}
+
+	t.view = device.createImageViewUnique({ {}, *t.image, vk::ImageViewType::e2D, format, {}, mip_range( 0, header.mip_count )});
+
+	textures.push_back( std::move( t ));
+	auto& added = textures.back();
+	if( added.sparse && added.tail_first < header.mip_count )
+		tail_binds.push_back({ *added.image, 1, &added.tail_bind });
+
+	logger << LogChannel::Video << LogLevel::Info << "Loaded texture " << path.string() << " with " << header.width << "x" << header.height <<
+		" and " << header.mip_count << " mips";
+
+	return textures.size() - 1;
+}
+
+void TextureStreamer::request( TextureId id, uint32_t mip ){
+	auto& t = textures[id];
+	mip = std::min( mip, t.asset.header().mip_count - 1 );
+
+	// begin_frame advances the counter, so this frame is the next one
+	if( t.requested_at == frame_counter + 1 )
+		t.requested = std::min( t.requested, mip );
+	else
+		t.requested = mip;
+	t.requested_at = frame_counter + 1;
+}
+
+uint32_t TextureStreamer::resident_mip( TextureId id ) const {
+	return textures[id].resident;
+}
+
+uint32_t TextureStreamer::mip_count( TextureId id ) const {
+	return textures[id].asset.header().mip_count;
+}
+
+vk::DeviceSize TextureStreamer::allocated_bytes() const {
+	return allocated;
+}
+
+vk::DescriptorSetLayout TextureStreamer::set_layout() const {
+	return *descriptor_layout;
+}
+
+vk::DescriptorSet TextureStreamer::descriptor_set( size_t frame ) const {
+	return descriptors[frame];
+}
+
+uint32_t TextureStreamer::target_mip( const Texture& t ) const {
+	if( t.requested_at != 0 && t.requested_at + request_frames >= frame_counter )
+		return std::min( t.requested, t.resident_first );
+	return t.resident_first;
+}
+
+bool TextureStreamer::needs_pages( const Texture& t, uint32_t mip ) const {
+	return t.sparse && mip < t.tail_first;
+}
+
+uint32_t TextureStreamer::tile_count( const Texture& t, uint32_t mip ) const {
+	auto& m = t.asset.mip( mip );
+	return (( m.width + t.granularity.width - 1 ) / t.granularity.width ) * (( m.height + t.granularity.height - 1 ) / t.granularity.height );
+}
+
+void TextureStreamer::add_image_bind( vk::Image image, const vk::SparseImageMemoryBind& bind ){
+	// Binds of one image are contiguous, their pointers are filled in once the frame's binds are complete
+	if( image_bind_infos.empty() || image_bind_infos.back().image != image ){
+		image_bind_infos.push_back({ image, 0, nullptr });
+		image_bind_first.push_back( image_binds.size() );
+	}
+	image_binds.push_back( bind );
+	++image_bind_infos.back().bindCount;
+}
+
+bool TextureStreamer::bind_mip( TextureId id, uint32_t mip ){
+	auto& t = textures[id];
+	uint32_t tiles = tile_count( t, mip );
+	vk::DeviceSize block_size = page_size * pages_per_block;
+
+	while( free_pages.size() < tiles && allocated + block_size <= budget ){
+		// Rare, at most budget / block_size times over the whole run
+		page_blocks.push_back( device.allocateMemoryUnique({ block_size, page_memory_type }));
+		for( uint32_t i = 0; i < pages_per_block; ++i )
+			free_pages.push_back({ static_cast<uint32_t>( page_blocks.size() - 1 ), i });
+		allocated += block_size;
+	}
+	if( free_pages.size() < tiles )
+		return false;
+
+	auto& m = t.asset.mip( mip );
+	auto g = t.granularity;
+	for( uint32_t y = 0; y < m.height; y += g.height ){
+		for( uint32_t x = 0; x < m.width; x += g.width ){
+			auto page = free_pages.back();
+			free_pages.pop_back();
+			t.pages[mip].push_back( page );
+
+			add_image_bind( *t.image, {
+					{ vk::ImageAspectFlagBits::eColor, mip, 0 },
+					{ static_cast<int32_t>( x ), static_cast<int32_t>( y ), 0 },
+					{ std::min( g.width, m.width - x ), std::min( g.height, m.height - y ), 1 },
+					*page_blocks[page.block], page.index * page_size });
+		}
+	}
+	return true;
+}
+
+void TextureStreamer::unbind_mip( TextureId id, uint32_t mip ){
+	auto& t = textures[id];
+	auto& m = t.asset.mip( mip );
+	auto g = t.granularity;
+
+	for( uint32_t y = 0; y < m.height; y += g.height )
+		for( uint32_t x = 0; x < m.width; x += g.width )
+			add_image_bind( *t.image, {
+					{ vk::ImageAspectFlagBits::eColor, mip, 0 },
+					{ static_cast<int32_t>( x ), static_cast<int32_t>( y ), 0 },
+					{ std::min( g.width, m.width - x ), std::min( g.height, m.height - y ), 1 },
+					nullptr, 0 });
+
+	free_pages.insert( free_pages.end(), t.pages[mip].begin(), t.pages[mip].end() );
+	t.pages[mip].clear();
+	t.evicted_at[mip] = 0;
+}
+
+void TextureStreamer::release_evicted(){
+	for( TextureId id = 0; id < textures.size(); ++id )
+		for( uint32_t mip = 0; mip < TextureAsset::max_mips; ++mip )
+			if( textures[id].evicted_at[mip] != 0 && frame_counter >= textures[id].evicted_at[mip] + MAX_FRAMES_IN_FLIGHT )
+				unbind_mip( id, mip );
+}
+
+void TextureStreamer::evict_for( TextureId id, uint32_t pages_needed ){
+	size_t available = free_pages.size();
+	for( auto& t: textures )
+		for( uint32_t mip = 0; mip < TextureAsset::max_mips; ++mip )
+			if( t.evicted_at[mip] != 0 )
+				available += t.pages[mip].size();
+
+	auto requested_at = textures[id].requested_at;
+	while( available < pages_needed ){
+		// Mips nobody asks for go first, then the finest mips of the least recently requested textures
+		Texture* victim = nullptr;
+		for( TextureId v = 0; v < textures.size(); ++v ){
+			auto& t = textures[v];
+			if( v == id || !t.sparse || t.resident >= t.resident_first || t.rows_uploaded != 0 )
+				continue;
+
+			bool unwanted = t.resident < target_mip( t );
+			if( !unwanted && t.requested_at >= requested_at )
+				continue;
+
+			if( !victim || std::make_pair( !unwanted, t.requested_at ) < std::make_pair( victim->resident >= target_mip( *victim ), victim->requested_at ))
+				victim = &t;
+		}
+		if( !victim )
+			return;
+
+		// Sampling stops right away, the pages follow once no frame in flight can still use them
+		uint32_t mip = victim->resident++;
+		victim->evicted_at[mip] = frame_counter;
+		victim->stale.fill( true );
+		available += victim->pages[mip].size();
+	}
+}
+
+void TextureStreamer::schedule_uploads( size_t frame ){
+	uploads.clear();
+	order.clear();
+	for( TextureId id = 0; id < textures.size(); ++id )
+		if( textures[id].resident > target_mip( textures[id] ))
+			order.push_back( id );
+
+	// Textures without anything to sample first, then the most recently requested ones, then the blurriest
+	std::sort( order.begin(), order.end(), [this]( TextureId a, TextureId b ){
+		auto& ta = textures[a];
+		auto& tb = textures[b];
+		bool empty_a = ta.resident == ta.asset.header().mip_count;
+		bool empty_b = tb.resident == tb.asset.header().mip_count;
+		if( empty_a != empty_b )
+			return empty_a;
+		if( ta.requested_at != tb.requested_at )
+			return ta.requested_at > tb.requested_at;
+		return ta.resident - target_mip( ta ) > tb.resident - target_mip( tb );
+	});
+
+	auto staged = static_cast<uint8_t*>( staging[frame].mapped );
+	vk::DeviceSize used = 0;
+	if( !placeholder_cleared ){
+		memcpy( staged, placeholder_texel.data(), placeholder_texel.size() );
+		used = placeholder_texel.size();
+	}
+	bool staging_full = false;
+
+	for( auto id: order ){
+		auto& t = textures[id];
+		uint32_t target = target_mip( t );
+
+		while( !staging_full && t.resident > target ){
+			uint32_t mip = t.resident - 1;
+
+			if( t.rows_uploaded == 0 ){
+				// Evicted recently enough that its pages and contents are still there
+				if( t.evicted_at[mip] != 0 ){
+					t.evicted_at[mip] = 0;
+					t.resident = mip;
+					t.stale.fill( true );
+					continue;
+				}
+				if( needs_pages( t, mip ) && !bind_mip( id, mip )){
+					evict_for( id, tile_count( t, mip ));
+					break;
+				}
+			}
+
+			auto& m = t.asset.mip( mip );
+			vk::DeviceSize row_bytes = (( m.width + 3 ) / 4 ) * block_bytes( t.asset.header().codec );
+			uint32_t row_count = ( m.height + 3 ) / 4;
+
+			// Copies have to start on a block
+			used = ( used + 15 ) & ~vk::DeviceSize( 15 );
+			auto rows = static_cast<uint32_t>( std::min<vk::DeviceSize>( row_count - t.rows_uploaded, ( staging_size - used ) / row_bytes ));
+			if( rows == 0 ){
+				staging_full = true;
+				break;
+			}
+
+			memcpy( staged + used, t.asset.data( mip ).data() + t.rows_uploaded * row_bytes, rows * row_bytes );
+			uploads.push_back({ id, mip, t.rows_uploaded, rows, used, !t.initialised });
+			t.initialised = true;
+			used += rows * row_bytes;
+			t.rows_uploaded += rows;
+
+			if( t.rows_uploaded < row_count ){
+				staging_full = true;
+				break;
+			}
+
+			t.rows_uploaded = 0;
+			t.resident = mip;
+			t.stale.fill( true );
+		}
+	}
+
+	uploaded_metric.add( used );
+	allocated_metric.set( allocated );
+
+	// Whatever is still missing is read in by the kernel until the next frame
+	for( auto id: order ){
+		auto& t = textures[id];
+		if( t.resident > target_mip( t ))
+			t.asset.prefetch( t.resident - 1 );
+	}
+}
+
+void TextureStreamer::update_descriptors( size_t frame ){
+	image_infos.clear();
+	writes.clear();
+
+	for( TextureId id = 0; id < textures.size(); ++id ){
+		auto& t = textures[id];
+		if( !t.stale[frame] || t.resident == t.asset.header().mip_count )
+			continue;
+		t.stale[frame] = false;
+
+		image_infos.push_back({ *samplers[t.resident], *t.view, vk::ImageLayout::eShaderReadOnlyOptimal });
+		writes.push_back({ descriptors[frame], 0, id, 1, vk::DescriptorType::eCombinedImageSampler, &image_infos.back() });
+	}
+
+	if( !writes.empty() )
+		device.updateDescriptorSets( writes, {} );
+}
+
+vk::Semaphore TextureStreamer::begin_frame( size_t frame ){
+	++frame_counter;
+
+	release_evicted();
+	schedule_uploads( frame );
+	update_descriptors( frame );
+
+	if( image_binds.empty() && tail_binds.empty() )
+		return nullptr;
+
+	for( size_t i = 0; i < image_bind_infos.size(); ++i )
+		image_bind_infos[i].pBinds = image_binds.data() + image_bind_first[i];
+
+	vk::BindSparseInfo bind_info(
+			0, nullptr,
+			0, nullptr,
+			tail_binds.size(), tail_binds.data(),
+			image_bind_infos.size(), image_bind_infos.data(),
+			1, &*bind_semaphores[frame]
+		);
+	bind_queue.bindSparse( bind_info, nullptr );
+
+	image_binds.clear();
+	image_bind_infos.clear();
+	image_bind_first.clear();
+	tail_binds.clear();
+
+	return *bind_semaphores[frame];
+}
+
+void TextureStreamer::record_uploads( vk::CommandBuffer cmd, size_t frame ){
+	if( !placeholder_cleared ){
+		vk::ImageMemoryBarrier to_transfer( {}, vk::AccessFlagBits::eTransferWrite, vk::ImageLayout::eUndefined, vk::ImageLayout::eTransferDstOptimal,
+				VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED, *placeholder, mip_range( 0 ));
+		cmd.pipelineBarrier( vk::PipelineStageFlagBits::eTopOfPipe, vk::PipelineStageFlagBits::eTransfer, {}, {}, {}, to_transfer );
+
+		// Copied instead of cleared, transfer queues can not clear images
+		vk::BufferImageCopy texel( 0, 0, 0, { vk::ImageAspectFlagBits::eColor, 0, 0, 1 }, { 0, 0, 0 }, { 1, 1, 1 });
+		cmd.copyBufferToImage( *staging[frame].buffer, *placeholder, vk::ImageLayout::eTransferDstOptimal, texel );
+
+		vk::ImageMemoryBarrier to_sampled( vk::AccessFlagBits::eTransferWrite, sampled_access, vk::ImageLayout::eTransferDstOptimal,
+				vk::ImageLayout::eShaderReadOnlyOptimal, VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED, *placeholder, mip_range( 0 ));
+		cmd.pipelineBarrier( vk::PipelineStageFlagBits::eTransfer, sampled_stages, {}, {}, {}, to_sampled );
+
+		placeholder_cleared = true;
+	}
+
+	if( uploads.empty() )
+		return;
+
+	// The descriptors expect every mip in the sampled layout, including the ones that never arrived.
+	// The source stage is transfer, so transitions happen after the wait for the memory binds
+	barriers.clear();
+	for( auto& u: uploads ){
+		if( !u.initialise )
+			continue;
+		auto& t = textures[u.texture];
+		barriers.push_back({ {}, {}, vk::ImageLayout::eUndefined, vk::ImageLayout::eShaderReadOnlyOptimal,
+				VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED, *t.image, mip_range( 0, t.asset.header().mip_count )});
+	}
+	if( !barriers.empty() )
+		cmd.pipelineBarrier( vk::PipelineStageFlagBits::eTransfer, sampled_stages, {}, {}, {}, barriers );
+
+	// A mip uploaded over several frames is moved back to the sampled layout in between, keeping what already arrived
+	barriers.clear();
+	for( auto& u: uploads )
+		barriers.push_back({ {}, vk::AccessFlagBits::eTransferWrite,
+				u.first_row == 0 ? vk::ImageLayout::eUndefined : vk::ImageLayout::eShaderReadOnlyOptimal, vk::ImageLayout::eTransferDstOptimal,
+				VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED, *textures[u.texture].image, mip_range( u.mip )});
+	cmd.pipelineBarrier( vk::PipelineStageFlagBits::eTransfer | sampled_stages, vk::PipelineStageFlagBits::eTransfer, {}, {}, {}, barriers );
+
+	for( auto& u: uploads ){
+		auto& t = textures[u.texture];
+		auto& m = t.asset.mip( u.mip );
+		vk::BufferImageCopy region(
+				u.offset, 0, 0,
+				{ vk::ImageAspectFlagBits::eColor, u.mip, 0, 1 },
+				{ 0, static_cast<int32_t>( u.first_row * 4 ), 0 },
+				{ m.width, std::min( u.rows * 4, m.height - u.first_row * 4 ), 1 }
+			);
+		cmd.copyBufferToImage( *staging[frame].buffer, *t.image, vk::ImageLayout::eTransferDstOptimal, region );
+	}
+
+	for( auto& b: barriers ){
+		b.srcAccessMask = vk::AccessFlagBits::eTransferWrite;
+		b.dstAccessMask = sampled_access;
+		b.oldLayout = vk::ImageLayout::eTransferDstOptimal;
+		b.newLayout = vk::ImageLayout::eShaderReadOnlyOptimal;
+	}
+	cmd.pipelineBarrier( vk::PipelineStageFlagBits::eTransfer, sampled_stages, {}, {}, {}, barriers );
+}
+
+vk::Semaphore TextureStreamer::uploads_done( size_t frame ) const {
+	return *upload_semaphores[frame];
+}
@@ -0,0 +1,527 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  View.cpp
+ *
+ *    Description:  Source file defining things from View.hpp
+ *
+ *        Version:  1.0
+ *        Created:  10/19/2026 10:12:48 PM
+ *       Revision:  none
+ *
+ *         Author:  Samuel Knoethig (), samuel@knoethig.net
+ *
+ * =====================================================================================
+ */
+
+#include "Util.hpp"
+#include "View.hpp"
+
+#include <bit>
+#include <cmath>
+#include <limits>
+#include <tuple>
+
+using namespace SpaceAppVideo;
+
+namespace {
+	// Height above the player the tactical map looks down from
+	constexpr float tactical_height{ 2000 };
+
+	// Every pyramid gets its own, so culling notices recreated targets
+	uint64_t next_hiz_id{ 1 };
+
+	std::pair<vk::UniqueImage, vk::UniqueDeviceMemory> create_image( vk::PhysicalDevice phys_dev, vk::Device device,
+			vk::Format format, vk::Extent2D extent, uint32_t mip_levels, vk::ImageUsageFlags usage ){
+		vk::ImageCreateInfo cr_inf(
+				{},
+				vk::ImageType::e2D,
+				format,
+				vk::Extent3D( extent.width, extent.height, 1 ),
+				mip_levels, 1,
+				vk::SampleCountFlagBits::e1,
+				vk::ImageTiling::eOptimal,
+				usage,
+				vk::SharingMode::eExclusive,
+				0, nullptr,
+				vk::ImageLayout::eUndefined
+			);
+
+		auto image = device.createImageUnique( cr_inf );
+		auto memreqs = device.getImageMemoryRequirements( *image );
+		auto memory = device.allocateMemoryUnique({ memreqs.size,
+				find_mem_type( phys_dev, memreqs.memoryTypeBits, vk::MemoryPropertyFlagBits::eDeviceLocal )});
+		device.bindImageMemory( *image, *memory, 0 );
+
+		return { std::move( image ), std::move( memory )};
+	}
+}
+
+View::View( std::string name, GLFWwindow* window, vk::UniqueSurfaceKHR surface, ViewPlacement placement ):
+		view_name( std::move( name )), placement( placement ), glfw_window( window ), view_surface( std::move( surface )){}
+
+View::View( std::string name, vk::Extent2D extent, ViewPlacement placement ):
+		view_name( std::move( name )), placement( placement ), target_extent( extent ){}
+
+View::~View(){
+	frame_capture.reset();
+	framebuffers.clear();
+	image_views.clear();
+	scene_framebuffer.reset();
+	hiz_levels.clear();
+	view_swapchain.reset();
+	view_surface.reset();
+
+	if( glfw_window )
+		glfwDestroyWindow( glfw_window );
+}
+
+vk::SurfaceFormatKHR View::preferred_format( vk::PhysicalDevice phys_dev ) const {
+	auto formats = phys_dev.getSurfaceFormatsKHR( *view_surface );
+
+	for( const auto& format: formats ){
+		if( format.format == vk::Format::eB8G8R8A8Srgb && format.colorSpace == vk::ColorSpaceKHR::eSrgbNonlinear )
+			return format;
+	}
+
+	logger << LogChannel::Video << LogLevel::Warning <<
+		"Preferred surfaceformat/colorspace not available. Falling back to " <<
+		vk::to_string( formats[0].format ) << " / " <<
+		vk::to_string( formats[0].colorSpace );
+
+	return formats[0];
+}
+
+vk::PresentModeKHR View::choose_present_mode( const SwapchainDetails& details ) const {
+	std::vector<vk::PresentModeKHR> preferred;
+
+	switch( config.present_strategy ){
+		case Config::PresentStrategy::LowLatency:
+			preferred = { vk::PresentModeKHR::eImmediate, vk::PresentModeKHR::eMailbox };
+			break;
+		case Config::PresentStrategy::MaxThroughput:
+			preferred = { vk::PresentModeKHR::eMailbox, vk::PresentModeKHR::eImmediate };
+			break;
+		case Config::PresentStrategy::PowerSaving:
+			preferred = { vk::PresentModeKHR::eFifo };
+			break;
+	}
+
+	for( const auto& mode: preferred ){
+		if( std::find( details.present_modes.begin(), details.present_modes.end(), mode ) != details.present_modes.end() )
+			return mode;
+	}
+	logger << LogChannel::Video << LogLevel::Warning <<
+		"Preferred presentmode not available. Falling back to FIFO";
+	return vk::PresentModeKHR::eFifo;
+}
+
+vk::Extent2D View::choose_extent( const SwapchainDetails& details ) const {
+	if( details.capabilities.currentExtent.width != std::numeric_limits<uint32_t>::max() )
+		return details.capabilities.currentExtent;
+
+	// Headless surfaces have no size of their own, the configured resolution is used
+	vk::Extent2D size{ config.res.x, config.res.y };
+	if( !config.fullscreen && glfw_window ){
+		int width, height;
+		glfwGetFramebufferSize( glfw_window, &width, &height );
+		size = vk::Extent2D( width, height );
+	}
+
+	size.width = std::max( details.capabilities.minImageExtent.width,
+			std::min( details.capabilities.maxImageExtent.width, size.width ));
+	size.height = std::max( details.capabilities.minImageExtent.height,
+			std::min( details.capabilities.maxImageExtent.height, size.height ));
+
+	return size;
+}
+
+void View::create_target( vk::PhysicalDevice phys_dev, vk::Device device, const QueueFamilyIndices& queue_indices,
+		vk::Format format, vk::RenderPass render_pass ){
+	frame_capture.reset();
+	framebuffers.clear();
+	image_views.clear();
+	scene_framebuffer.reset();
+	scene_view.reset();
+	scene_image.reset();
+
+	this->format = format;
+	target_render_pass = render_pass;
+
+	if( presents() )
+		create_swapchain( phys_dev, device, queue_indices, format );
+	else
+		create_offscreen_images( phys_dev, device, format );
+	create_depth( phys_dev, device );
+
+	// Scaled views draw into the scene image, the acquired images are only blitted to
+	if( presents() && config.dynamic_resolution )
+		create_scene_image( phys_dev, device );
+	else {
+		for( auto image: images ){
+			vk::ImageViewCreateInfo cr_inf(
+					{},
+					image,
+					vk::ImageViewType::e2D,
+					format,
+					{},
+					vk::ImageSubresourceRange( vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1 )
+				);
+
+			image_views.push_back( device.createImageViewUnique( cr_inf ));
+
+			std::array<vk::ImageView, 2> attachments{ *image_views.back(), *depth_view };
+			vk::FramebufferCreateInfo frame_cr_inf(
+					{},
+					render_pass,
+					attachments.size(), attachments.data(),
+					target_extent.width,
+					target_extent.height,
+					1
+				);
+
+			framebuffers.push_back( device.createFramebufferUnique( frame_cr_inf ));
+		}
+	}
+
+	inflight_imgs.assign( images.size(), vk::Fence{} );
+
+	if( img_available_sema.empty() && presents() ){
+		for( size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i ){
+			img_available_sema.push_back( device.createSemaphoreUnique({}));
+			img_ready_sema.push_back( device.createSemaphoreUnique({}));
+		}
+	}
+
+	if( config.capture != Config::CaptureMode::Off ){
+		if( !( usage & vk::ImageUsageFlagBits::eTransferSrc ))
+			logger << LogChannel::Video << LogLevel::Warning << "Images of view " << view_name << " can not be copied from, frame capture is disabled";
+		else if( !FrameCapture::supported( format ))
+			logger << LogChannel::Video << LogLevel::Warning << "Can not capture format " << vk::to_string( format ) << " of view " << view_name;
+		else
+			frame_capture = std::make_unique<FrameCapture>( phys_dev, device, target_extent, format, config.capture, "./capture/" + view_name );
+	}
+
+	logger << LogChannel::Video << LogLevel::Info << "Created " << images.size() << " " << target_extent.width << "x" << target_extent.height <<
+		" images for view " << view_name;
+}
+
+void View::create_swapchain( vk::PhysicalDevice phys_dev, vk::Device device, const QueueFamilyIndices& queue_indices, vk::Format format ){
+	SwapchainDetails details( phys_dev, *view_surface );
+
+	// The renderer's device was chosen for the first view, every other one has to be checked
+	if( !phys_dev.getSurfaceSupportKHR( queue_indices.present.value(), *view_surface ))
+		throw std::runtime_error( "View " + view_name + " can not be presented from the renderer's present queue" );
+
+	auto surface_format = std::find_if( details.formats.begin(), details.formats.end(), [format]( auto& f ){ return f.format == format; });
+	if( surface_format == details.formats.end() )
+		throw std::runtime_error( "View " + view_name + " does not support the renderer's format " + vk::to_string( format ));
+
+	target_extent = choose_extent( details );
+
+	usage = vk::ImageUsageFlagBits::eColorAttachment;
+	if( config.dynamic_resolution ){
+		// The scene image is blitted onto it instead of rendering to it
+		if( !( details.capabilities.supportedUsageFlags & vk::ImageUsageFlagBits::eTransferDst ))
+			throw std::runtime_error( "Swapchain of view " + view_name + " can not be copied to, dynamic resolution is not supported" );
+		usage |= vk::ImageUsageFlagBits::eTransferDst;
+	}
+	if( config.capture != Config::CaptureMode::Off && ( details.capabilities.supportedUsageFlags & vk::ImageUsageFlagBits::eTransferSrc ))
+		usage |= vk::ImageUsageFlagBits::eTransferSrc;
+
+	uint32_t image_count = details.capabilities.minImageCount + 1;
+	if( details.capabilities.maxImageCount > 0 && details.capabilities.maxImageCount < image_count )
+		image_count = details.capabilities.maxImageCount;
+
+	vk::SwapchainCreateInfoKHR cr_inf(
+			{},
+			*view_surface,
+			image_count,
+			surface_format->format,
+			surface_format->colorSpace,
+			target_extent,
+			1,
+			usage,
+			vk::SharingMode::eExclusive,
+			{},
+			nullptr,
+			details.capabilities.currentTransform,
+			vk::CompositeAlphaFlagBitsKHR::eOpaque,
+			choose_present_mode( details ),
+			true,
+			*view_swapchain );
+
+	uint32_t queue_family_indices[] = { queue_indices.graphics.value(), queue_indices.present.value() };
+	if( queue_indices.graphics != queue_indices.present ){
+		cr_inf.imageSharingMode = vk::SharingMode::eConcurrent;
+		cr_inf.queueFamilyIndexCount = 2;
+		cr_inf.pQueueFamilyIndices = queue_family_indices;
+	}
+
+	view_swapchain = device.createSwapchainKHRUnique( cr_inf );
+	images = device.getSwapchainImagesKHR( *view_swapchain );
+}
+
+void View::create_offscreen_images( vk::PhysicalDevice phys_dev, vk::Device device, vk::Format format ){
+	usage = vk::ImageUsageFlagBits::eColorAttachment | vk::ImageUsageFlagBits::eSampled | vk::ImageUsageFlagBits::eTransferSrc;
+
+	images.clear();
+	offscreen_images.clear();
+	offscreen_memory.clear();
+
+	for( size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i ){
+		vk::ImageCreateInfo cr_inf(
+				{},
+				vk::ImageType::e2D,
+				format,
+				vk::Extent3D( target_extent.width, target_extent.height, 1 ),
+				1, 1,
+				vk::SampleCountFlagBits::e1,
+				vk::ImageTiling::eOptimal,
+				usage,
+				vk::SharingMode::eExclusive,
+				0, nullptr,
+				vk::ImageLayout::eUndefined
+			);
+
+		auto image = device.createImageUnique( cr_inf );
+		auto memreqs = device.getImageMemoryRequirements( *image );
+
+		vk::MemoryAllocateInfo mem_alloc_inf(
+				memreqs.size,
+				find_mem_type( phys_dev, memreqs.memoryTypeBits, vk::MemoryPropertyFlagBits::eDeviceLocal )
+			);
+
+		auto memory = device.allocateMemoryUnique( mem_alloc_inf );
+		device.bindImageMemory( *image, *memory, 0 );
+
+		images.push_back( *image );
+		offscreen_images.push_back( std::move( image ));
+		offscreen_memory.push_back( std::move( memory ));
+	}
+}
+
+void View::create_scene_image( vk::PhysicalDevice phys_dev, vk::Device device ){
+	// As large as the swapchain, so no scale ever needs a bigger one
+	std::tie( scene_image, scene_memory ) = create_image( phys_dev, device, format, target_extent, 1,
+			vk::ImageUsageFlagBits::eColorAttachment | vk::ImageUsageFlagBits::eTransferSrc );
+	scene_view = device.createImageViewUnique({ {}, *scene_image, vk::ImageViewType::e2D, format, {},
+			vk::ImageSubresourceRange( vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1 )});
+
+	std::array<vk::ImageView, 2> attachments{ *scene_view, *depth_view };
+	scene_framebuffer = device.createFramebufferUnique({ {}, target_render_pass, attachments.size(), attachments.data(),
+			target_extent.width, target_extent.height, 1 });
+	scaled_extent = target_extent;
+}
+
+void View::create_depth( vk::PhysicalDevice phys_dev, vk::Device device ){
+	hiz_levels.clear();
+	hiz_view.reset();
+	depth_view.reset();
+
+	std::tie( depth_image, depth_memory ) = create_image( phys_dev, device, DEPTH_FORMAT, target_extent, 1,
+			vk::ImageUsageFlagBits::eDepthStencilAttachment | vk::ImageUsageFlagBits::eSampled );
+	depth_view = device.createImageViewUnique({ {}, *depth_image, vk::ImageViewType::e2D, DEPTH_FORMAT, {},
+			vk::ImageSubresourceRange( vk::ImageAspectFlagBits::eDepth, 0, 1, 0, 1 )});
+
+	// Power of two levels halve exactly, so each texel covers at most two of the level before in each direction
+	constexpr uint32_t max_size{ 1u << ( MAX_HIZ_LEVELS - 1 )};
+	hiz_extent = vk::Extent2D(
+			std::min( std::bit_floor( target_extent.width ), max_size ),
+			std::min( std::bit_floor( target_extent.height ), max_size ));
+	uint32_t level_count = std::bit_width( std::max( hiz_extent.width, hiz_extent.height ));
+
+	std::tie( hiz_image, hiz_memory ) = create_image( phys_dev, device, vk::Format::eR32Sfloat, hiz_extent, level_count,
+			vk::ImageUsageFlagBits::eStorage | vk::ImageUsageFlagBits::eSampled );
+	hiz_view = device.createImageViewUnique({ {}, *hiz_image, vk::ImageViewType::e2D, vk::Format::eR32Sfloat, {},
+			vk::ImageSubresourceRange( vk::ImageAspectFlagBits::eColor, 0, level_count, 0, 1 )});
+	for( uint32_t level = 0; level < level_count; ++level )
+		hiz_levels.push_back( device.createImageViewUnique({ {}, *hiz_image, vk::ImageViewType::e2D, vk::Format::eR32Sfloat, {},
+				vk::ImageSubresourceRange( vk::ImageAspectFlagBits::eColor, level, 1, 0, 1 )}));
+
+	hiz_id = next_hiz_id++;
+}
+
+void View::wait_until_visible() const {
+	if( !glfw_window )
+		return;
+
+	int width = 0, height = 0;
+	glfwGetFramebufferSize( glfw_window, &width, &height );
+	while( width == 0 || height == 0 ){
+		glfwGetFramebufferSize( glfw_window, &width, &height );
+		glfwWaitEvents();
+	}
+}
+
+bool View::acquire( vk::Device device, size_t frame, vk::Fence frame_fence ){
+	if( !presents() ){
+		// One image per frame in flight, the frame's fence already guards it
+		current_image = frame;
+		return true;
+	}
+
+	// An out of date swapchain happens on every resize, so it is a result and not an exception
+	uint32_t index;
+	auto result = device.acquireNextImageKHR( *view_swapchain, UINT64_MAX, *img_available_sema[frame], {}, &index );
+	if( result == vk::Result::eErrorOutOfDateKHR )
+		return false;
+	if( result != vk::Result::eSuccess && result != vk::Result::eSuboptimalKHR )
+		throw std::runtime_error( "Failed to acquire swapchain image" );
+	current_image = index;
+
+	if( inflight_imgs[current_image] != vk::Fence{} )
+		if( vk::Result::eSuccess != device.waitForFences( 1, &inflight_imgs[current_image], VK_TRUE, UINT64_MAX ))
+			throw std::runtime_error( "Wait for fence failed" );
+	inflight_imgs[current_image] = frame_fence;
+
+	return true;
+}
+
+void View::follow( const Camera& player ){
+	view_camera = player;
+
+	if( placement.top_down ){
+		view_camera.position = player.position + player.up * tactical_height;
+		view_camera.forward = -player.up;
+		view_camera.up = player.forward;
+		return;
+	}
+
+	if( placement.column != 0 ){
+		// Turned by the horizontal field of view, so neighbouring monitors continue the main view
+		float aspect = (float)target_extent.width / target_extent.height;
+		float yaw = placement.column * 2 * std::atan( std::tan( player.fov / 2 ) * aspect );
+		view_camera.forward = glm::normalize( player.forward * std::cos( yaw ) + player.right() * std::sin( yaw ));
+	}
+}
+
+void View::set_render_scale( float scale ){
+	if( !scaled() )
+		return;
+
+	scaled_extent = vk::Extent2D(
+			std::clamp( static_cast<uint32_t>( std::lround( target_extent.width * scale )), 1u, target_extent.width ),
+			std::clamp( static_cast<uint32_t>( std::lround( target_extent.height * scale )), 1u, target_extent.height ));
+}
+
+void View::record_upscale( vk::CommandBuffer cmd ){
+	if( !scaled() )
+		return;
+
+	auto color_range = vk::ImageSubresourceRange( vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1 );
+
+	// The render pass left the scene in TransferSrcOptimal, the acquired image's contents are overwritten completely
+	std::array<vk::ImageMemoryBarrier, 2> to_transfer{
+		vk::ImageMemoryBarrier(
+				vk::AccessFlagBits::eColorAttachmentWrite, vk::AccessFlagBits::eTransferRead,
+				vk::ImageLayout::eTransferSrcOptimal, vk::ImageLayout::eTransferSrcOptimal,
+				VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED,
+				*scene_image, color_range
+			),
+		vk::ImageMemoryBarrier(
+				{}, vk::AccessFlagBits::eTransferWrite,
+				vk::ImageLayout::eUndefined, vk::ImageLayout::eTransferDstOptimal,
+				VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED,
+				images[current_image], color_range
+			),
+	};
+	cmd.pipelineBarrier( vk::PipelineStageFlagBits::eColorAttachmentOutput | vk::PipelineStageFlagBits::eTransfer,
+			vk::PipelineStageFlagBits::eTransfer, {}, {}, {}, to_transfer );
+
+	vk::ImageBlit region(
+			{ vk::ImageAspectFlagBits::eColor, 0, 0, 1 },
+			{ vk::Offset3D( 0, 0, 0 ), vk::Offset3D( scaled_extent.width, scaled_extent.height, 1 )},
+			{ vk::ImageAspectFlagBits::eColor, 0, 0, 1 },
+			{ vk::Offset3D( 0, 0, 0 ), vk::Offset3D( target_extent.width, target_extent.height, 1 )}
+		);
+	cmd.blitImage( *scene_image, vk::ImageLayout::eTransferSrcOptimal, images[current_image], vk::ImageLayout::eTransferDstOptimal,
+			region, vk::Filter::eLinear );
+
+	// The next frame's render pass must not clear the scene before the blit read it
+	vk::ImageMemoryBarrier to_present(
+			vk::AccessFlagBits::eTransferWrite, {},
+			vk::ImageLayout::eTransferDstOptimal, vk::ImageLayout::ePresentSrcKHR,
+			VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED,
+			images[current_image], color_range
+		);
+	cmd.pipelineBarrier( vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eColorAttachmentOutput, {}, {}, {}, to_present );
+}
+
+void View::record_capture( vk::CommandBuffer cmd, size_t frame, uint64_t frame_number ){
+	if( frame_capture )
+		frame_capture->record_copy( cmd, images[current_image], frame, frame_number,
+				presents() ? vk::ImageLayout::ePresentSrcKHR : vk::ImageLayout::eShaderReadOnlyOptimal );
+}
+
+void View::frame_retired( size_t frame ){
+	if( frame_capture )
+		frame_capture->frame_retired( frame );
+}
+
+bool View::presents() const {
+	return static_cast<bool>( view_surface );
+}
+
+bool View::scaled() const {
+	return static_cast<bool>( scene_image );
+}
+
+const std::string& View::name() const {
+	return view_name;
+}
+
+GLFWwindow* View::window() const {
+	return glfw_window;
+}
+
+vk::SurfaceKHR View::surface() const {
+	return *view_surface;
+}
+
+vk::Extent2D View::extent() const {
+	return target_extent;
+}
+
+vk::Extent2D View::render_extent() const {
+	return scaled() ? scaled_extent : target_extent;
+}
+
+vk::RenderPass View::render_pass() const {
+	return target_render_pass;
+}
+
+vk::Framebuffer View::framebuffer() const {
+	return scaled() ? *scene_framebuffer : *framebuffers[current_image];
+}
+
+const Camera& View::camera() const {
+	return view_camera;
+}
+
+HizTarget View::hiz_target() const {
+	HizTarget target{ hiz_id, *depth_view, *hiz_image, *hiz_view, {}, static_cast<uint32_t>( hiz_levels.size() ), hiz_extent, render_extent() };
+	for( size_t level = 0; level < hiz_levels.size(); ++level )
+		target.levels[level] = *hiz_levels[level];
+	return target;
+}
+
+vk::SwapchainKHR View::swapchain() const {
+	return *view_swapchain;
+}
+
+uint32_t View::image_index() const {
+	return current_image;
+}
+
+vk::Semaphore View::image_available( size_t frame ) const {
+	return *img_available_sema[frame];
+}
+
+vk::PipelineStageFlags View::image_write_stage() const {
+	return scaled() ? vk::PipelineStageFlagBits::eTransfer : vk::PipelineStageFlagBits::eColorAttachmentOutput;
+}
+
+vk::Semaphore View::render_finished( size_t frame ) const {
+	return *img_ready_sema[frame];
+}
@@ -16,6 +16,8 @@
 
 #include "Util.hpp"
 #include "Application.hpp"
+#include "StartupTracer.hpp"
+#include "ConfigStore.hpp"
 
 #include <stdint.h>
 
@@ -30,13 +32,30 @@ void setupLogging(){
 
 int main( int argc, char** argv ){
 	setupLogging();
-	config.read( "./config.cfg" );
+
+	Config::ConfigStore config_store( "./config.cfg", "./config.cache" );
+	{
+		auto trace = startup_tracer.trace( "Read config" );
+		config_store.load( config );
+	}
 
 	logger << LogChannel::Config << LogLevel::Info << "Succesfully read config";
 
 	SpaceApplication app;
 
+	if( argc > 1 && std::string( argv[1] ) == "--precompile-pipelines" ){
+		app.precompile_pipelines();
+		return 0;
+	}
+
+	// Used by CI, renders the given number of frames without a window, combine with capture in the config for image tests
+	if( argc > 2 && std::string( argv[1] ) == "--headless" ){
+		app.run_headless( std::stoull( argv[2] ));
+		return 0;
+	}
+
+	app.watch_config( config_store );
 	app();
 
-	config.write( "./config.cfg" );
+	config_store.write( config );
 }
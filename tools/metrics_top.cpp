@@ -0,0 +1,211 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  metrics_top.cpp
+ *
+ *    Description:  Shows the metrics of a running game live, reading its shared memory segment
+ *
+ *        Version:  1.0
+ *        Created:  10/20/2026 08:03:19 AM
+ *       Revision:  none
+ *
+ *         Author:  Samuel Knoethig (), samuel@knoethig.net
+ *
+ * =====================================================================================
+ */
+
+#include "Metrics.hpp"
+
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace {
+	struct Options {
+		// Found in /dev/shm if empty
+		std::string segment;
+		std::chrono::milliseconds interval{ 1000 };
+		bool once{ false };
+	};
+
+	void usage(){
+		std::fprintf( stderr,
+				"Usage: metrics_top [--once] [--interval <ms>] [pid | segment]\n"
+				"Prints the metrics of a running game every interval. Without a pid or segment name the only running game is shown\n" );
+	}
+
+	/**
+	 *	Segments of all running games, glibc keeps POSIX shared memory in /dev/shm
+	 */
+	std::vector<std::string> find_segments(){
+		std::vector<std::string> found;
+		// The files are named without the leading slash
+		std::string prefix = Metrics::segment_prefix + 1;
+
+		std::error_code error;
+		for( auto& entry: std::filesystem::directory_iterator( "/dev/shm", error )){
+			auto name = entry.path().filename().string();
+			if( name.starts_with( prefix ))
+				found.push_back( "/" + name );
+		}
+		return found;
+	}
+
+	bool numeric( const char* s ){
+		for( ; *s; ++s )
+			if( !std::isdigit( static_cast<unsigned char>( *s )))
+				return false;
+		return true;
+	}
+
+	const Metrics::Segment* open_segment( const std::string& name ){
+		int fd = shm_open( name.c_str(), O_RDONLY, 0 );
+		if( fd < 0 )
+			return nullptr;
+
+		void* memory = mmap( nullptr, sizeof( Metrics::Segment ), PROT_READ, MAP_SHARED, fd, 0 );
+		close( fd );
+		if( memory == MAP_FAILED )
+			return nullptr;
+
+		auto segment = static_cast<const Metrics::Segment*>( memory );
+		if( segment->magic.load( std::memory_order_acquire ) != Metrics::segment_magic || segment->version != Metrics::segment_version ){
+			munmap( memory, sizeof( Metrics::Segment ));
+			return nullptr;
+		}
+		return segment;
+	}
+
+	/**
+	 *	Lower bound of the bucket holding the given fraction of all recorded values
+	 */
+	uint64_t percentile( const std::vector<uint64_t>& buckets, uint64_t count, double fraction ){
+		uint64_t rank = static_cast<uint64_t>( fraction * count ), seen = 0;
+		for( uint32_t i = 0; i < buckets.size(); ++i ){
+			seen += buckets[i];
+			if( seen > rank )
+				return Metrics::bucket_lower( i );
+		}
+		return 0;
+	}
+
+	void print( const Metrics::Segment& segment, std::vector<int64_t>& previous, double seconds ){
+		uint32_t count = segment.metric_count.load( std::memory_order_acquire );
+		previous.resize( Metrics::max_metrics, 0 );
+
+		std::printf( "pid %u, %u metrics\n\n", segment.pid, count );
+		std::printf( "%-40s %16s %12s\n", "counter / gauge", "value", "per second" );
+
+		std::vector<uint64_t> buckets( Metrics::histogram_buckets );
+		for( uint32_t i = 0; i < count; ++i ){
+			auto& m = segment.metrics[i];
+			int64_t value = m.value.load( std::memory_order_relaxed );
+
+			if( m.kind == Metrics::Kind::Counter ){
+				double rate = seconds > 0 ? ( value - previous[i] ) / seconds : 0;
+				std::printf( "%-40s %16lld %12.1f\n", m.name, static_cast<long long>( value ), rate );
+			} else if( m.kind == Metrics::Kind::Gauge )
+				std::printf( "%-40s %16lld\n", m.name, static_cast<long long>( value ));
+			previous[i] = value;
+		}
+
+		std::printf( "\n%-40s %10s %10s %10s %10s %10s %10s\n", "histogram", "count", "mean", "p50", "p90", "p99", "max" );
+		for( uint32_t i = 0; i < count; ++i ){
+			auto& m = segment.metrics[i];
+			if( m.kind != Metrics::Kind::Histogram )
+				continue;
+
+			auto& h = segment.histograms[m.histogram];
+			// Writers never stop, so the snapshot is only consistent up to a few values
+			uint64_t total = 0;
+			for( uint32_t b = 0; b < buckets.size(); ++b ){
+				buckets[b] = h.buckets[b].load( std::memory_order_relaxed );
+				total += buckets[b];
+			}
+			uint64_t sum = h.sum.load( std::memory_order_relaxed );
+
+			std::printf( "%-40s %10llu %10llu %10llu %10llu %10llu %10llu\n", m.name,
+					static_cast<unsigned long long>( total ),
+					static_cast<unsigned long long>( total ? sum / total : 0 ),
+					static_cast<unsigned long long>( percentile( buckets, total, 0.5 )),
+					static_cast<unsigned long long>( percentile( buckets, total, 0.9 )),
+					static_cast<unsigned long long>( percentile( buckets, total, 0.99 )),
+					static_cast<unsigned long long>( h.max.load( std::memory_order_relaxed )));
+		}
+	}
+}
+
+int main( int argc, char** argv ){
+	Options options;
+	for( int i = 1; i < argc; ++i ){
+		if( std::strcmp( argv[i], "--once" ) == 0 )
+			options.once = true;
+		else if( std::strcmp( argv[i], "--interval" ) == 0 && i + 1 < argc )
+			options.interval = std::chrono::milliseconds( std::stoul( argv[++i] ));
+		else if( argv[i][0] == '/' )
+			options.segment = argv[i];
+		else if( argv[i][0] != '\0' && numeric( argv[i] ))
+			options.segment = Metrics::segment_for( std::stoul( argv[i] ));
+		else {
+			usage();
+			return 1;
+		}
+	}
+
+	if( options.segment.empty() ){
+		auto found = find_segments();
+		if( found.empty() ){
+			std::fprintf( stderr, "No metrics segment found, is the game running?\n" );
+			return 1;
+		}
+		if( found.size() > 1 ){
+			std::fprintf( stderr, "Several games are running, pass one of their pids or segments:\n" );
+			for( auto& name: found )
+				std::fprintf( stderr, "  %s\n", name.c_str() );
+			return 1;
+		}
+		options.segment = found[0];
+	}
+
+	auto segment = open_segment( options.segment );
+	if( !segment ){
+		std::fprintf( stderr, "No metrics segment %s, is the game running?\n", options.segment.c_str() );
+		return 1;
+	}
+
+	std::vector<int64_t> previous;
+	auto last = std::chrono::steady_clock::now();
+	double seconds = 0;
+
+	while( true ){
+		if( !options.once )
+			// Clears the terminal
+			std::printf( "\x1b[H\x1b[2J" );
+		print( *segment, previous, seconds );
+		std::fflush( stdout );
+
+		if( options.once )
+			return 0;
+
+		// The segment is unlinked once the game exits, the mapping stays readable but never changes again
+		if( kill( static_cast<pid_t>( segment->pid ), 0 ) != 0 ){
+			std::printf( "\nProcess %u exited\n", segment->pid );
+			return 0;
+		}
+
+		std::this_thread::sleep_for( options.interval );
+		auto now = std::chrono::steady_clock::now();
+		seconds = std::chrono::duration<double>( now - last ).count();
+		last = now;
+	}
+}
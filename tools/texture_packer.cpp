@@ -0,0 +1,247 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  texture_packer.cpp
+ *
+ *    Description:  Offline packer turning images into block compressed texture assets with mip chains
+ *
+ *        Version:  1.0
+ *        Created:  10/20/2026 02:52:18 AM
+ *       Revision:  none
+ *
+ *         Author:  Samuel Knoethig (), samuel@knoethig.net
+ *
+ * =====================================================================================
+ */
+
+#include "BlockCompression.hpp"
+#include "TextureAsset.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace SpaceAppVideo;
+
+namespace {
+	struct Image {
+		uint32_t width;
+		uint32_t height;
+		// Four floats per pixel, linear
+		std::vector<float> pixels;
+	};
+
+	enum class Kind {
+		Color,
+		Normal,
+	};
+
+	float srgb_to_linear( float c ){
+		return c <= 0.04045f ? c / 12.92f : std::pow(( c + 0.055f ) / 1.055f, 2.4f );
+	}
+
+	float linear_to_srgb( float c ){
+		return c <= 0.0031308f ? c * 12.92f : 1.055f * std::pow( c, 1 / 2.4f ) - 0.055f;
+	}
+
+	std::string read_token( std::istream& in ){
+		std::string token;
+		while( in >> token ){
+			if( token[0] != '#' )
+				return token;
+			std::getline( in, token );
+		}
+		throw std::runtime_error( "Unexpected end of image header" );
+	}
+
+	/**
+	 *	Reads binary PGM (P5), PPM (P6) and PAM (P7) images with 8 bit channels into RGBA.
+	 *	Grey is replicated into every colour channel, missing alpha is opaque
+	 */
+	Image read_pnm( const std::string& path, bool srgb ){
+		std::ifstream in( path, std::ios::binary );
+		if( !in.is_open() )
+			throw std::runtime_error( "Failed to open " + path );
+
+		std::string magic = read_token( in );
+		uint32_t width, height, channels, maxval;
+		if( magic == "P5" || magic == "P6" ){
+			width = std::stoul( read_token( in ));
+			height = std::stoul( read_token( in ));
+			maxval = std::stoul( read_token( in ));
+			channels = magic == "P5" ? 1 : 3;
+		} else if( magic == "P7" ){
+			width = height = channels = maxval = 0;
+			for( std::string key = read_token( in ); key != "ENDHDR"; key = read_token( in )){
+				if( key == "WIDTH" )
+					width = std::stoul( read_token( in ));
+				else if( key == "HEIGHT" )
+					height = std::stoul( read_token( in ));
+				else if( key == "DEPTH" )
+					channels = std::stoul( read_token( in ));
+				else if( key == "MAXVAL" )
+					maxval = std::stoul( read_token( in ));
+				else if( key == "TUPLTYPE" )
+					read_token( in );
+			}
+		} else {
+			throw std::runtime_error( path + " is no binary PGM, PPM or PAM image" );
+		}
+
+		if( maxval != 255 || width == 0 || height == 0 || channels == 0 || channels > 4 )
+			throw std::runtime_error( path + " has to have between one and four 8 bit channels" );
+		// Exactly one whitespace character separates the header from the pixels
+		in.get();
+
+		std::vector<uint8_t> raw( size_t( width ) * height * channels );
+		in.read( reinterpret_cast<char*>( raw.data() ), raw.size() );
+		if( !in )
+			throw std::runtime_error( path + " is truncated" );
+
+		Image image{ width, height, std::vector<float>( size_t( width ) * height * 4 )};
+		for( size_t p = 0; p < size_t( width ) * height; ++p ){
+			const uint8_t* src = &raw[p * channels];
+			float* dst = &image.pixels[p * 4];
+			for( uint32_t c = 0; c < 3; ++c ){
+				float v = src[channels < 3 ? 0 : c] / 255.0f;
+				dst[c] = srgb ? srgb_to_linear( v ) : v;
+			}
+			dst[3] = channels == 2 || channels == 4 ? src[channels - 1] / 255.0f : 1;
+		}
+		return image;
+	}
+
+	/**
+	 *	Box filters to half the size, odd edges repeat their last pixel. Normals are renormalised,
+	 *	so shading of distant surfaces keeps its strength
+	 */
+	Image downsample( const Image& src, Kind kind ){
+		Image dst{ std::max( src.width / 2, 1u ), std::max( src.height / 2, 1u ), {}};
+		dst.pixels.resize( size_t( dst.width ) * dst.height * 4 );
+
+		for( uint32_t y = 0; y < dst.height; ++y ){
+			for( uint32_t x = 0; x < dst.width; ++x ){
+				float sum[4]{};
+				for( uint32_t s = 0; s < 4; ++s ){
+					uint32_t sx = std::min( x * 2 + s % 2, src.width - 1 );
+					uint32_t sy = std::min( y * 2 + s / 2, src.height - 1 );
+					const float* p = &src.pixels[( size_t( sy ) * src.width + sx ) * 4];
+
+					if( kind == Kind::Normal ){
+						float nx = p[0] * 2 - 1, ny = p[1] * 2 - 1;
+						sum[0] += nx;
+						sum[1] += ny;
+						sum[2] += std::sqrt( std::max( 1 - nx * nx - ny * ny, 0.0f ));
+					} else {
+						for( int c = 0; c < 4; ++c )
+							sum[c] += p[c];
+					}
+				}
+
+				float* out = &dst.pixels[( size_t( y ) * dst.width + x ) * 4];
+				if( kind == Kind::Normal ){
+					float length = std::max( std::sqrt( sum[0] * sum[0] + sum[1] * sum[1] + sum[2] * sum[2] ), 1e-6f );
+					out[0] = sum[0] / length * 0.5f + 0.5f;
+					out[1] = sum[1] / length * 0.5f + 0.5f;
+					out[2] = 0;
+					out[3] = 1;
+				} else {
+					for( int c = 0; c < 4; ++c )
+						out[c] = sum[c] / 4;
+				}
+			}
+		}
+		return dst;
+	}
+
+	std::vector<uint8_t> to_rgba8( const Image& image, bool srgb ){
+		std::vector<uint8_t> out( image.pixels.size() );
+		for( size_t i = 0; i < image.pixels.size(); ++i ){
+			float v = image.pixels[i];
+			if( srgb && i % 4 != 3 )
+				v = linear_to_srgb( v );
+			out[i] = static_cast<uint8_t>( std::lround( std::clamp( v, 0.0f, 1.0f ) * 255 ));
+		}
+		return out;
+	}
+
+	void usage(){
+		fprintf( stderr,
+				"Usage: texture_packer [options] <input.pgm|ppm|pam> <output.stex>\n"
+				"\t--bc7\t\tRGBA colour, the default for images with more than one channel\n"
+				"\t--bc4\t\tRed only, the default for grey images\n"
+				"\t--normal\tTangent space normal map in red and green, packed as BC5\n"
+				"\t--srgb\t\tColour is sRGB encoded, mips are filtered in linear space\n" );
+	}
+}
+
+int main( int argc, char** argv ){
+	std::vector<std::string> files;
+	std::optional<TextureCodec> codec;
+	Kind kind = Kind::Color;
+	bool srgb = false;
+
+	for( int i = 1; i < argc; ++i ){
+		std::string arg = argv[i];
+		if( arg == "--bc7" )
+			codec = TextureCodec::BC7;
+		else if( arg == "--bc4" )
+			codec = TextureCodec::BC4;
+		else if( arg == "--normal" )
+			kind = Kind::Normal;
+		else if( arg == "--srgb" )
+			srgb = true;
+		else if( arg.starts_with( "--" )){
+			usage();
+			return 1;
+		} else
+			files.push_back( arg );
+	}
+
+	if( files.size() != 2 || ( kind == Kind::Normal && ( codec || srgb ))){
+		usage();
+		return 1;
+	}
+
+	try {
+		Image image = read_pnm( files[0], srgb );
+		if( kind == Kind::Normal )
+			codec = TextureCodec::BC5;
+		if( !codec ){
+			// Grey images have the same value in every colour channel
+			bool grey = true;
+			for( size_t i = 0; grey && i < image.pixels.size(); i += 4 ){
+				const float* p = &image.pixels[i];
+				grey = p[0] == p[1] && p[1] == p[2] && p[3] == 1;
+			}
+			codec = grey && !srgb ? TextureCodec::BC4 : TextureCodec::BC7;
+		}
+		if( srgb && *codec != TextureCodec::BC7 )
+			throw std::runtime_error( "Only BC7 textures can be sRGB" );
+
+		std::vector<MipData> mips;
+		while( true ){
+			auto rgba = to_rgba8( image, srgb );
+			mips.push_back({ image.width, image.height, compress( *codec, rgba.data(), image.width, image.height )});
+
+			if(( image.width == 1 && image.height == 1 ) || mips.size() == TextureAsset::max_mips )
+				break;
+			image = downsample( image, kind );
+		}
+
+		write_texture_asset( files[1], *codec, srgb, mips );
+
+		size_t bytes = 0;
+		for( auto& m: mips )
+			bytes += m.blocks.size();
+		printf( "%s: %ux%u, %zu mips, %zu bytes\n", files[1].c_str(), mips[0].width, mips[0].height, mips.size(), bytes );
+	} catch( const std::exception& e ){
+		fprintf( stderr, "%s\n", e.what() );
+		return 1;
+	}
+}